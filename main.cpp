@@ -1,369 +1,1006 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <iostream>
-#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <sstream>
-#include <csignal>
+#include <string>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#ifdef __linux__
-    #define debugBreak() raise(SIGTRAP)
-#elif _WIN32
-    #define debugBreak() __debugbreak()
-#endif
+#include "src/Renderer.h"
+#include "src/GLBackend.h"
+#include "src/NullBackend.h"
+#include "src/Scene.h"
+#include "src/CommandBuffer.h"
+#include "src/JobSystem.h"
+#include "src/FrameArena.h"
+#include "src/UniformRing.h"
+#include "src/PipelineWarmup.h"
+#include "src/FlightRecorder.h"
+#include "src/HostMemory.h"
+#include "src/AssetLoader.h"
+#include "src/AssetPack.h"
+#include "src/AsyncIO.h"
+#include "src/Startup.h"
+#include "src/SceneBinding.h"
+#include "src/RayQuery.h"
+#include "src/StaticBatcher.h"
+#include "src/Hlod.h"
+#include "src/Impostor.h"
+#include "src/Pvs.h"
+#include "src/SdfRenderer.h"
+#include "src/VolumeRenderer.h"
+#include "src/ControlServer.h"
+#include "src/FrameStreamer.h"
+#include "src/Shader.h"
+#include "ShaderLayouts.h"
 
-#define ASSERT(x) if (!(x)) debugBreak();
-#define GLCall(x) GLClearError();\
-    x;\
-    ASSERT(GLLogCall(#x, __FILE__, __LINE__));
+double eyeX = 5.0, eyeY = 3.0, eyeZ = 5.0;
+double objX = 0.0, objY = 0.0, objZ = 0.0;
+double upX = 0.0, upY = 1.0, upZ = 0.0;
 
-static void GLClearError() {
-    while (glGetError() != GL_NO_ERROR);
-}
+glm::mat4 view = glm::lookAt(
+    glm::vec3(eyeX, eyeY, eyeZ),  // Camera position
+    glm::vec3(objX, objY, objZ),  // Target position (where the camera looks)
+    glm::vec3(upX, upY, upZ)   // Up vector (defines camera's upward direction)
+);
+glm::mat4 proj = CameraProjection(SceneCameraDesc(), 1920.0f / 1080.0f);
 
-static bool GLLogCall(const char* function, const char* file, int line) {
-    while (GLenum error = glGetError()) {
-        std::cout << "[OpenGL Error] (" << error << "): " << function << " " << file << ":" << line << std::endl;
-        return false;
-    }
-    return true;
+bool dumpMemoryRequested = false;
+bool pickRequested = false;
+
+static void UpdateView() {
+    view = glm::lookAt(
+        glm::vec3(eyeX, eyeY, eyeZ),
+        glm::vec3(objX, objY, objZ),
+        glm::vec3(upX, upY, upZ)
+    );
 }
 
-struct ShaderProgramSource {
-    std::string VertexSource;
-    std::string FragmentSource;
-};
+static void SetCamera(const SceneCameraDesc& camera) {
+    eyeX = camera.Eye.x; eyeY = camera.Eye.y; eyeZ = camera.Eye.z;
+    objX = camera.Target.x; objY = camera.Target.y; objZ = camera.Target.z;
+    upX = camera.Up.x; upY = camera.Up.y; upZ = camera.Up.z;
+    UpdateView();
+    proj = CameraProjection(camera, 1920.0f / 1080.0f);
+}
 
-static ShaderProgramSource ParseShader(const std::string& filepath) {
-    std::ifstream stream(filepath);
-    enum class ShaderType {
-        NONE = -1, VERTEX = 0, FRAGMENT = 1
-    };
+// Camera controls shared by the GLFW key callback and the scripted input of
+// the null backend benchmark. Returns true when the key asks to quit.
+static bool ProcessKey(int key, int action) {
+    if (action != GLFW_PRESS)
+        return false;
 
-    std::string line;
-    std::stringstream ss[2];
-    ShaderType type = ShaderType::NONE;
-    while (getline(stream, line)) {
-        if (line.find("#shader") != std::string::npos) {
-            if (line.find("vertex") != std::string::npos)
-                type = ShaderType::VERTEX;
-            else if (line.find("fragment") != std::string::npos)
-                type = ShaderType::FRAGMENT;
-        } else {
-            ss[static_cast<int>(type)] << line << '\n';
-        }
+    switch (key) {
+        case GLFW_KEY_ESCAPE:       return true;
+        case GLFW_KEY_M:            dumpMemoryRequested = true; return false;
+        case GLFW_KEY_SPACE:        eyeY += 0.5; break;
+        case GLFW_KEY_LEFT_CONTROL: eyeY -= 0.5; break;
+        case GLFW_KEY_W:            eyeZ -= 0.5; break;
+        case GLFW_KEY_S:            eyeZ += 0.5; break;
+        case GLFW_KEY_A:            eyeX -= 0.5; break;
+        case GLFW_KEY_D:            eyeX += 0.5; break;
+        default:                    return false;
     }
-    return {
-        ss[static_cast<int>(ShaderType::VERTEX)].str(),
-        ss[static_cast<int>(ShaderType::FRAGMENT)].str()
-    };
+    UpdateView();
+    return false;
 }
 
-static unsigned int CompileShader(unsigned int type, const std::string& source) {
-    unsigned int id = glCreateShader(type);
-    const char* src = source.c_str();
-    glShaderSource(id, 1, &src, nullptr);
-    glCompileShader(id);
-
-    int result;
-    glGetShaderiv(id, GL_COMPILE_STATUS, &result);
-    if (result == GL_FALSE) {
-        int length;
-        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
-        char* message = static_cast<char*>(alloca(length * sizeof(char)));
-        glGetShaderInfoLog(id, length, &length, message);
-        std::cout << "Failed to compile " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader!" << std::endl;
-        std::cout << message << std::endl;
-        glDeleteShader(id);
-        return 0;
-    }
-    return id;
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+        pickRequested = true;
 }
 
-static unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader) {
-    GLCall(unsigned int program = glCreateProgram());
-    unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
-    unsigned int fs = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
-
-    GLCall(glAttachShader(program, vs));
-    GLCall(glAttachShader(program, fs));
-    GLCall(glLinkProgram(program));
-    GLCall(glValidateProgram(program));
-    GLCall(glDeleteShader(vs));
-    GLCall(glDeleteShader(fs));
-
-    return program;
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (ProcessKey(key, action)) {
+        glfwSetWindowShouldClose(window, GLFW_TRUE);  // Close the window when ESC is pressed
+    }
 }
 
-double eyeX = 5.0, eyeY = 3.0, eyeZ = 5.0;
-double objX = 0.0, objY = 0.0, objZ = 0.0;
-double upX = 0.0, upY = 1.0, upZ = 0.0;
+// Read on the I/O path, parsed on a worker, registered on the render thread.
+// The GL compile happens later, batched with every other variant.
+static Task<void> LoadShader(AssetLoader& loader, Scene& scene, std::string path) {
+    std::optional<std::string> text = co_await loader.ReadFile(path);
+    co_await loader.SwitchToJobs();
+    ShaderProgramSource source = text ? ParseShaderSource(*text) : ShaderProgramSource{};
+    co_await loader.SwitchToRenderThread();
+    AddShader(scene, path, std::move(source));
+}
 
-glm::mat4 view = glm::lookAt(
-    glm::vec3(eyeX, eyeY, eyeZ),  // Camera position
-    glm::vec3(objX, objY, objZ),  // Target position (where the camera looks)
-    glm::vec3(upX, upY, upZ)   // Up vector (defines camera's upward direction)
-);
+// State passed between the scene setup steps
+struct SceneSetup {
+    SceneDesc Desc;
+    SceneBinding Binding;
+    RayQuery Rays;                 // built on the first pick, then kept up to date every frame
+    bool StaticBatching = true;
+    bool Hlod = true;              // proxies for the batches' inner clusters
+    bool Visibility = true;        // gate drawing by the baked sets of the camera's cell
+    PvsStats Pvs;
+    bool ImpostorsEnabled = true;  // far objects drawn on their own become baked quads
+    ImpostorRenderer Impostors;
+    // Shaders of the renderers in use that draw without materials, read
+    // with the materials' shaders
+    std::vector<std::string> RendererShaders;
+    // Objects placed by the scene file and --instances, which never move;
+    // control objects come after them
+    size_t StaticObjects = 0;
+};
 
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, GLFW_TRUE);  // Close the window when ESC is pressed
-    }
-    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
-        eyeY += 0.5;
-        view = glm::lookAt(
-            glm::vec3(eyeX, eyeY, eyeZ),
-            glm::vec3(0, 0, 0),
-            glm::vec3(0, 1, 0)
-        );
-    }
-    if (key == GLFW_KEY_LEFT_CONTROL && action == GLFW_PRESS) {
-        eyeY -= 0.5;
-        view = glm::lookAt(
-            glm::vec3(eyeX, eyeY, eyeZ),
-            glm::vec3(0, 0, 0),
-            glm::vec3(0, 1, 0)
-        );
-    }
-    if (key == GLFW_KEY_W && action == GLFW_PRESS) {
-        eyeZ -= 0.5;
-        view = glm::lookAt(
-            glm::vec3(eyeX, eyeY, eyeZ),
-            glm::vec3(0, 0, 0),
-            glm::vec3(0, 1, 0)
-        );
-    }
-    if (key == GLFW_KEY_S && action == GLFW_PRESS) {
-        eyeZ += 0.5;
-        view = glm::lookAt(
-            glm::vec3(eyeX, eyeY, eyeZ),
-            glm::vec3(0, 0, 0),
-            glm::vec3(0, 1, 0)
-        );
-    }
-    if (key == GLFW_KEY_A && action == GLFW_PRESS) {
-        eyeX -= 0.5;
-        view = glm::lookAt(
-            glm::vec3(eyeX, eyeY, eyeZ),
-            glm::vec3(0, 0, 0),
-            glm::vec3(0, 1, 0)
-        );
-    }
-    if (key == GLFW_KEY_D && action == GLFW_PRESS) {
-        eyeX += 0.5;
-        view = glm::lookAt(
-            glm::vec3(eyeX, eyeY, eyeZ),
-            glm::vec3(0, 0, 0),
-            glm::vec3(0, 1, 0)
-        );
+static std::vector<std::string> GetRendererShaders(int sdfPrimitives, bool volume, bool impostors) {
+    std::vector<std::string> paths;
+    if (sdfPrimitives >= 0)
+        paths.push_back(SDF_SHADER_PATH);
+    if (volume)
+        paths.push_back(VOLUME_SHADER_PATH);
+    if (impostors) {
+        paths.push_back(IMPOSTOR_SHADER_PATH);
+        paths.push_back(IMPOSTOR_BAKE_SHADER_PATH);
     }
+    return paths;
 }
 
-int main() {
-    if (!glfwInit())
-        return -1;
+// Needs no GL context. The loader's render thread is whichever thread runs
+// this; AddShader only stores the parsed source.
+static bool LoadShaders(Scene& scene, JobSystem* jobs, const AssetPack* pack, const SceneSetup& setup) {
+    MemoryTagScope tag(MemoryTag::Scene);
+
+    // Anything in the pack comes from there, the rest from loose files
+    AsyncIO io(jobs);
+    AssetLoader loader(jobs, &io, pack);
+    std::vector<std::string> paths = setup.RendererShaders;
+    for (const SceneMaterialDesc& material : setup.Desc.Materials) {
+        if (std::find(paths.begin(), paths.end(), material.Shader) == paths.end())
+            paths.push_back(material.Shader);
+    }
+    for (const std::string& path : paths)
+        loader.Spawn(LoadShader(loader, scene, path));
+    loader.WaitAll();
+    return true;
+}
 
-    GLFWwindow* window = glfwCreateWindow(1920, 1080, "3D Scene", nullptr, nullptr);
-    if (!window) {
-        glfwTerminate();
-        return -1;
+// Extra copies on a grid behind the origin, to load the CPU side of the frame.
+// Uses the scene file's Cube and Pyramid meshes and Instanced material.
+static void AddInstanceGrid(Scene& scene, const SceneSetup& setup, int instances) {
+    MemoryTagScope tag(MemoryTag::Scene);
+    int cube = setup.Desc.FindMesh("Cube");
+    int pyramid = setup.Desc.FindMesh("Pyramid");
+    int material = setup.Desc.FindMaterial("Instanced");
+    if (instances > 0 && (cube < 0 || pyramid < 0 || material < 0)) {
+        std::cout << "[Scene File] --instances needs Cube and Pyramid meshes and an Instanced material" << std::endl;
+        return;
     }
 
-    glfwSetKeyCallback(window, keyCallback);
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(instances))));
+    for (int i = 0; i < instances; i++) {
+        glm::vec3 position(static_cast<float>(i % side) * 2.0f - side, 0.0f, -2.0f - static_cast<float>(i / side) * 2.0f);
+        glm::vec4 color(0.3f + 0.7f * (i % side) / side, 0.3f + 0.7f * (i / side) / side, 0.6f, 1.0f);
+        AddObject(scene, setup.Binding.Meshes[i % 2 ? pyramid : cube], setup.Binding.Materials[material],
+                  glm::translate(glm::mat4(1.0f), position), color);
+    }
+}
 
-    glfwMakeContextCurrent(window);
-    glfwSwapInterval(1);
+// --sdf: the scene file's cubes and pyramids as distance functions, and
+// `count` more primitives on a field behind them, in clusters of a box, a
+// sphere melted into it and a pyramid on top
+static std::vector<SdfPrimitive> BuildSdfPrimitives(const SceneDesc& desc, int count) {
+    std::vector<SdfPrimitive> primitives;
+    int cube = desc.FindMesh("Cube");
+    int pyramid = desc.FindMesh("Pyramid");
+    for (const SceneObjectDesc& object : desc.Objects) {
+        if (cube >= 0 && object.Mesh == static_cast<uint32_t>(cube))
+            primitives.push_back(MakeSdfPrimitive(SdfShape::Box, object.Model, object.Color));
+        else if (pyramid >= 0 && object.Mesh == static_cast<uint32_t>(pyramid))
+            primitives.push_back(MakeSdfPrimitive(SdfShape::Pyramid, object.Model, object.Color));
+    }
 
-    if (glewInit() != GLEW_OK) {
-        std::cout << "Error initializing GLEW!" << std::endl;
-        return -1;
+    int clusters = (count + 2) / 3;
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(clusters))));
+    for (int i = 0; i < count; i++) {
+        int cluster = i / 3;
+        float jitter = static_cast<float>((cluster * 7919) % 101) / 100.0f;
+        glm::vec3 base(static_cast<float>(cluster % side) * 2.5f - side * 1.25f, 0.0f,
+                       -3.0f - static_cast<float>(cluster / side) * 2.5f);
+        glm::vec4 color(0.35f + 0.6f * (cluster % side) / side, 0.35f + 0.6f * jitter, 0.9f - 0.5f * (cluster / side) / side, 1.0f);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), base);
+        model = glm::rotate(model, jitter * 1.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+        if (i % 3 == 0) {
+            primitives.push_back(MakeSdfPrimitive(SdfShape::Box, glm::scale(model, glm::vec3(1.2f, 0.8f, 1.2f)), color));
+        } else if (i % 3 == 1) {
+            model = glm::translate(model, glm::vec3(0.6f, 0.3f + 0.4f * jitter, 0.0f));
+            primitives.push_back(MakeSdfPrimitive(SdfShape::Sphere, glm::scale(model, glm::vec3(0.9f)), color * 0.8f, 0.3f));
+        } else {
+            model = glm::translate(model, glm::vec3(0.0f, 0.4f, 0.0f));
+            primitives.push_back(MakeSdfPrimitive(SdfShape::Pyramid, glm::scale(model, glm::vec3(0.9f, 0.6f + jitter, 0.9f)),
+                                                  glm::vec4(0.9f, 0.85f, 0.7f, 1.0f)));
+        }
     }
+    return primitives;
+}
 
-    // Enable depth test for correct 3D rendering
-    glEnable(GL_DEPTH_TEST);
-
-    // Cube vertices and indices
-    float cubePositions[] = {
-        // Front face
-        -0.5f, -0.5f,  0.5f,
-         0.5f, -0.5f,  0.5f,
-         0.5f,  0.5f,  0.5f,
-        -0.5f,  0.5f,  0.5f,
-        // Back face
-        -0.5f, -0.5f, -0.5f,
-         0.5f, -0.5f, -0.5f,
-         0.5f,  0.5f, -0.5f,
-        -0.5f,  0.5f, -0.5f
-    };
+static void BatchStaticObjects(Scene& scene, RenderBackend& backend, const SceneSetup& setup) {
+    StaticBatchStats stats = BuildStaticBatches(scene, backend, setup.Desc, setup.Binding, setup.StaticObjects, setup.Hlod);
+    std::cout << "[Static Batching] " << stats.Objects << " of " << setup.StaticObjects << " object(s) in "
+              << stats.Batches << " batch(es) and " << stats.Proxies << " HLOD prox(ies), " << stats.Vertices << " vertices, " << stats.Indices << " indices, "
+              << stats.Bytes / 1024 << " KB, built in " << stats.BuildMilliseconds << " ms" << std::endl;
+}
 
-    unsigned int cubeIndices[] = {
-        // Front
-        0, 1, 2, 2, 3, 0,
-        // Back
-        4, 5, 6, 6, 7, 4,
-        // Left
-        0, 3, 7, 7, 4, 0,
-        // Right
-        1, 2, 6, 6, 5, 1,
-        // Top
-        3, 2, 6, 6, 7, 3,
-        // Bottom
-        0, 1, 5, 5, 4, 0
-    };
+static void BakeImpostors(Scene& scene, RenderBackend& backend, SceneSetup& setup) {
+    ImpostorStats stats = setup.Impostors.Build(scene, backend, setup.StaticObjects);
+    if (stats.Impostors == 0)
+        return;
+    std::cout << "[Impostors] " << stats.Objects << " object(s) of " << stats.Impostors << " mesh(es) in "
+              << stats.Clusters << " cluster(s), atlas " << stats.AtlasSize.x << "x" << stats.AtlasSize.y << ", "
+              << stats.Bytes / 1024 << " KB, baked in " << stats.BakeMilliseconds << " ms" << std::endl;
+}
 
-    unsigned int cubeVao, cubeVbo, cubeIbo;
-    GLCall(glGenVertexArrays(1, &cubeVao));
-    GLCall(glBindVertexArray(cubeVao));
-
-    GLCall(glGenBuffers(1, &cubeVbo));
-    GLCall(glBindBuffer(GL_ARRAY_BUFFER, cubeVbo));
-    GLCall(glBufferData(GL_ARRAY_BUFFER, sizeof(cubePositions), cubePositions, GL_STATIC_DRAW));
-
-    GLCall(glEnableVertexAttribArray(0));
-    GLCall(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr));
-
-    GLCall(glGenBuffers(1, &cubeIbo));
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeIbo));
-    GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW));
-
-    // Pyramid vertices and indices
-    float pyramidPositions[] = {
-        // Base
-        -0.5f, 0.0f, -0.5f,
-         0.5f, 0.0f, -0.5f,
-         0.5f, 0.0f,  0.5f,
-        -0.5f, 0.0f,  0.5f,
-        // Apex
-         0.0f, 1.0f,  0.0f
-    };
+static bool StartSdf(SdfRenderer& sdf, Scene& scene, RenderBackend& backend, const SceneDesc& desc, int count) {
+    ShaderVariantSet* shader = FindShader(scene, SDF_SHADER_PATH);
+    if (!shader || !sdf.Init(backend, *shader))
+        return false;
+    sdf.SetPrimitives(backend, BuildSdfPrimitives(desc, count));
+    const SdfStats& stats = sdf.GetStats();
+    std::cout << "[SDF] " << stats.Primitives << " primitive(s), grid " << stats.GridSize.x << "x" << stats.GridSize.y
+              << "x" << stats.GridSize.z << " with " << stats.OccupiedCells << " occupied cell(s), " << stats.Entries
+              << " entries, " << stats.Bytes / 1024 << " KB, built in " << stats.BuildMilliseconds << " ms" << std::endl;
+    return true;
+}
 
-    unsigned int pyramidIndices[] = {
-        // Base
-        0, 1, 2, 2, 3, 0,
-        // Sides
-        0, 1, 4,
-        1, 2, 4,
-        2, 3, 4,
-        3, 0, 4
-    };
+// --volume: a raw file, or the test volume without one, filling a 3-unit
+// box around the origin so the scene's cube sits inside it
+static bool StartVolume(VolumeRenderer& volume, Scene& scene, RenderBackend& backend, const std::string& path, size_t poolBytes) {
+    ShaderVariantSet* shader = FindShader(scene, VOLUME_SHADER_PATH);
+    if (!shader)
+        return false;
+    VolumeData data;
+    if (path.empty())
+        data = MakeTestVolume(256);
+    else if (!LoadRawVolume(path, data))
+        return false;
+    glm::vec3 extent = glm::vec3(data.Size) / static_cast<float>(std::max(data.Size.x, std::max(data.Size.y, data.Size.z))) * 3.0f;
+    if (!volume.Init(backend, *shader, std::move(data), poolBytes))
+        return false;
+    volume.SetBounds(-0.5f * extent, 0.5f * extent);
+    const VolumeStats& stats = volume.GetStats();
+    std::cout << "[Volume] " << stats.Bricks << " brick(s), " << stats.VisibleBricks << " not empty, pool of "
+              << stats.Slots << " slot(s) in " << stats.PoolBytes / (1024 * 1024) << " MB" << std::endl;
+    return true;
+}
 
-    unsigned int pyramidVao, pyramidVbo, pyramidIbo;
-    GLCall(glGenVertexArrays(1, &pyramidVao));
-    GLCall(glBindVertexArray(pyramidVao));
-
-    GLCall(glGenBuffers(1, &pyramidVbo));
-    GLCall(glBindBuffer(GL_ARRAY_BUFFER, pyramidVbo));
-    GLCall(glBufferData(GL_ARRAY_BUFFER, sizeof(pyramidPositions), pyramidPositions, GL_STATIC_DRAW));
-
-    GLCall(glEnableVertexAttribArray(0));
-    GLCall(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr));
-
-    GLCall(glGenBuffers(1, &pyramidIbo));
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pyramidIbo));
-    GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(pyramidIndices), pyramidIndices, GL_STATIC_DRAW));
-
-    // Axes vertices
-    float axes[] = {
-        // X axis (red)
-        0.0f, 0.0f, 0.0f,
-        3.0f, 0.0f, 0.0f,
-        // Y axis (green)
-        0.0f, 0.0f, 0.0f,
-        0.0f, 3.0f, 0.0f,
-        // Z axis (blue)
-        0.0f, 0.0f, 0.0f,
-        0.0f, 0.0f, 3.0f
-    };
+// Adds the scene setup to the startup graph. Loading the scene file and
+// reading and parsing its shaders run on workers; the GL steps wait for
+// `context`. Shader compiles are issued before the mesh uploads whenever the
+// sources are in by then, so the two overlap. Returns the step after which
+// the scene is complete.
+static unsigned int AddSceneSteps(StartupGraph& startup, Scene& scene, RenderBackend& backend, JobSystem* jobs,
+                                  AssetPack& pack, const std::string& packPath, const std::string& scenePath,
+                                  SceneSetup& setup, int instances, const std::vector<unsigned int>& context) {
+    unsigned int packStep = startup.Add("Open asset pack", StartupThread::Worker, [&pack, &packPath] {
+        // Optional: without a pack every asset is read from res/
+        if (pack.Open(packPath))
+            std::cout << "[Asset Pack] " << pack.GetAssetCount() << " asset(s) from " << packPath << std::endl;
+        return true;
+    });
+    unsigned int sceneStep = startup.Add("Load scene file", StartupThread::Worker, [&pack, &scenePath, &setup] {
+        return LoadSceneDesc(scenePath, pack.IsOpen() ? &pack : nullptr, setup.Desc);
+    }, { packStep });
+    unsigned int shaderStep = startup.Add("Load shaders", StartupThread::Worker, [&scene, jobs, &pack, &setup] {
+        return LoadShaders(scene, jobs, pack.IsOpen() ? &pack : nullptr, setup);
+    }, { sceneStep });
+
+    std::vector<unsigned int> compileDeps = context;
+    compileDeps.push_back(shaderStep);
+    unsigned int compileStep = startup.Add("Compile shaders", StartupThread::Main, [&scene, &backend, &setup] {
+        AddSceneMaterials(scene, setup.Desc, setup.Binding);
+        if (setup.StaticBatching)
+            RequestStaticBatchVariants(scene);
+        BeginCompileMaterials(scene, backend);
+        return true;
+    }, compileDeps);
+    std::vector<unsigned int> meshDeps = context;
+    meshDeps.push_back(sceneStep);
+    unsigned int meshStep = startup.Add("Upload meshes", StartupThread::Main, [&scene, &backend, &setup] {
+        AddSceneMeshes(scene, backend, setup.Desc, setup.Binding);
+        return true;
+    }, meshDeps);
+    return startup.Add("Populate scene", StartupThread::Main, [&scene, &backend, &setup, instances] {
+        AddSceneObjects(scene, setup.Desc, setup.Binding);
+        AddInstanceGrid(scene, setup, instances);
+        SetCamera(setup.Desc.Camera);
+        // The compiles ran in the driver while the meshes uploaded and the objects were placed
+        FinishCompileMaterials(scene, backend);
+        setup.StaticObjects = scene.Objects.size();
+        if (setup.StaticBatching)
+            BatchStaticObjects(scene, backend, setup);
+        // After batching, which takes its objects first
+        if (setup.ImpostorsEnabled)
+            BakeImpostors(scene, backend, setup);
+        return true;
+    }, { compileStep, meshStep });
+}
 
-    unsigned int axesVao, axesVbo;
-    GLCall(glGenVertexArrays(1, &axesVao));
-    GLCall(glBindVertexArray(axesVao));
+// Hot reload: re-reads the loose scene file when it changes and applies only the differences
+static void ReloadSceneIfChanged(SceneFileWatcher& watcher, Scene& scene, RenderBackend& backend, SceneSetup& setup) {
+    if (!watcher.Poll())
+        return;
+    SceneDesc next;
+    if (!LoadSceneDesc(watcher.GetPath(), nullptr, next)) {
+        std::cout << "[Scene File] keeping the previous scene" << std::endl;
+        return;
+    }
+    size_t fileObjects = setup.Binding.ObjectCount;
+    SceneReloadStats stats = ApplySceneDesc(scene, backend, setup.Desc, next, setup.Binding);
+    if (stats.CameraChanged)
+        SetCamera(next.Camera);
+    setup.Desc = std::move(next);
+    if (stats.MeshesUploaded > 0 && setup.Rays.HasMeshes())
+        setup.Rays.BuildMeshes(setup.Desc, setup.Binding);
+    std::cout << "[Scene File] reloaded: " << stats.MeshesUploaded << " mesh(es) uploaded, " << stats.MaterialsAdded
+              << " material(s) added, " << stats.ObjectsUpdated << " object(s) updated, " << stats.ObjectsRemoved
+              << " removed" << std::endl;
+    // The file's objects are resized in place, moving the rest of the static range with them
+    setup.StaticObjects = setup.StaticObjects - fileObjects + setup.Binding.ObjectCount;
+    bool changed = stats.MeshesUploaded > 0 || stats.MaterialsAdded > 0 || stats.ObjectsUpdated > 0 ||
+                   stats.ObjectsRemoved > 0 || stats.ObjectsMoved;
+    if (setup.StaticBatching && changed)
+        BatchStaticObjects(scene, backend, setup);
+    if (setup.ImpostorsEnabled && changed)
+        BakeImpostors(scene, backend, setup);
+}
 
-    GLCall(glGenBuffers(1, &axesVbo));
-    GLCall(glBindBuffer(GL_ARRAY_BUFFER, axesVbo));
-    GLCall(glBufferData(GL_ARRAY_BUFFER, sizeof(axes), axes, GL_STATIC_DRAW));
+// Before the frame is built, once the camera has moved. Entering a cell is
+// logged when `log` is set; the benchmark's scripted walk would flood it.
+static void UpdateCameraCell(Scene& scene, SceneSetup& setup, bool log) {
+    if (!setup.Visibility)
+        return;
+    int previous = setup.Pvs.Cell;
+    UpdateVisibility(scene, setup.Desc, setup.Binding, glm::vec3(eyeX, eyeY, eyeZ), setup.Pvs);
+    if (log && setup.Pvs.Cell != previous) {
+        if (setup.Pvs.Cell < 0)
+            std::cout << "[PVS] outside every cell, nothing gated" << std::endl;
+        else
+            std::cout << "[PVS] cell " << setup.Desc.Cells[setup.Pvs.Cell].Name << ": " << setup.Pvs.HiddenObjects << " of "
+                      << setup.Desc.Objects.size() << " object(s) and " << setup.Pvs.HiddenNodes << " batch node(s) hidden" << std::endl;
+    }
+}
+
+struct FrameData {
+    unsigned long long Index = 0;
+    FrameArena Arena;              // draw lists and command buffers live here
+    UniformRing Uniforms;          // per-draw ObjectData blocks
+    JobSystem* Jobs = nullptr;     // null selects the single-threaded packet path
+    SdfRenderer* Sdf = nullptr;    // --sdf: raymarched instead of drawing the scene's meshes
+    VolumeRenderer* Volume = nullptr;  // --volume: composited over the scene's meshes
+    ImpostorRenderer* Impostors = nullptr; // quads for far objects, drawn after the meshes
+    HlodStats Hlod;                // static batches drawn last frame
+    int Width = 1920, Height = 1080;
+    FlightRecorder Recorder;       // last few hundred frames, dumped on budget overruns
+};
 
-    GLCall(glEnableVertexAttribArray(0));
-    GLCall(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr));
+static void RenderFrame(RenderBackend& backend, const Scene& scene, const glm::mat4& proj, FrameData& frame) {
+    MemoryTagScope tag(MemoryTag::Rendering);
+    unsigned long long index = frame.Index++;
+    FlightRecorder* recorder = &frame.Recorder;
+    recorder->BeginFrame(backend, index);
+    frame.Arena.BeginFrame(index);
+    backend.BeginFrame();
+    // Load-time passes such as the impostor bake leave a viewport of their own behind
+    if (frame.Volume)
+        frame.Volume->BeginScene(backend, frame.Width, frame.Height);
+    else
+        backend.SetViewport(0, 0, frame.Width, frame.Height);
+    backend.Clear();
+    {
+        FlightScope scope(recorder, "Wait for uniform ring");
+        size_t slotBytes = sizeof(ObjectData), slots = scene.Objects.size() + scene.Batches.size();
+        if (frame.Volume) {
+            slotBytes = std::max(slotBytes, sizeof(VolumeFrame));
+            slots++;
+        }
+        if (frame.Impostors) {
+            slotBytes = std::max(slotBytes, sizeof(ImpostorFrame));
+            slots++;
+        }
+        if (frame.Sdf)
+            frame.Uniforms.BeginFrame(backend, index, sizeof(SdfFrame), 1);
+        else
+            frame.Uniforms.BeginFrame(backend, index, slotBytes, slots);
+    }
+    size_t volumeOffset = 0;
+    if (frame.Volume) {
+        FlightScope scope(recorder, "Stream volume bricks");
+        volumeOffset = frame.Volume->WriteFrameData(backend, frame.Uniforms, view, proj, frame.Width, frame.Height);
+    }
+    size_t impostorOffset = 0;
+    if (frame.Impostors && !frame.Sdf)
+        impostorOffset = frame.Impostors->WriteFrameData(frame.Uniforms, view, proj);
+
+    if (frame.Sdf) {
+        FlightScope scope(recorder, "Raymarch");
+        size_t offset = frame.Sdf->WriteFrameData(frame.Uniforms, view, proj, frame.Width, frame.Height);
+        frame.Uniforms.FinishWrites(backend);
+        frame.Sdf->Draw(backend, frame.Uniforms, offset, frame.Width, frame.Height);
+    } else if (frame.Jobs) {
+        std::pmr::vector<unsigned int> batches(frame.Arena.GetResource());
+        std::pmr::vector<CommandBuffer> chunks(frame.Arena.GetResource());
+        {
+            FlightScope scope(recorder, "Select batches");
+            SelectBatches(scene, view, proj, frame.Height, batches, frame.Hlod);
+        }
+        {
+            FlightScope scope(recorder, "Record draw commands");
+            RecordDrawCommands(scene, proj * view, batches, frame.Uniforms, *frame.Jobs, frame.Arena, chunks);
+            frame.Uniforms.FinishWrites(backend);
+        }
+        FlightScope scope(recorder, "Replay");
+        CommandReplayer replayer(backend);
+        for (const CommandBuffer& chunk : chunks)
+            replayer.Replay(chunk);
+    } else {
+        std::pmr::vector<unsigned int> batches(frame.Arena.GetResource());
+        std::pmr::vector<DrawPacket> packets(frame.Arena.GetResource());
+        {
+            FlightScope scope(recorder, "Build draw packets");
+            SelectBatches(scene, view, proj, frame.Height, batches, frame.Hlod);
+            BuildDrawPackets(scene, proj * view, batches, frame.Uniforms, packets);
+            frame.Uniforms.FinishWrites(backend);
+        }
+        FlightScope scope(recorder, "Submit");
+        SubmitDrawPackets(backend, frame.Uniforms, packets);
+    }
+    if (frame.Impostors && !frame.Sdf) {
+        FlightScope scope(recorder, "Draw impostors");
+        frame.Impostors->Draw(backend, frame.Uniforms, impostorOffset);
+    }
+    if (frame.Volume) {
+        FlightScope scope(recorder, "Raymarch volume");
+        frame.Volume->Draw(backend, frame.Uniforms, volumeOffset, frame.Width, frame.Height);
+    }
+    {
+        FlightScope scope(recorder, "End frame");
+        frame.Uniforms.EndFrame(backend);
+        backend.EndFrame();
+    }
+    EndHostMemoryFrame();
+    recorder->EndFrame(backend, frame.Arena.GetStats());
 
-    // Load shaders
-    ShaderProgramSource srcCube = ParseShader("res/shaders/Cube.shader");
-    unsigned int cubeShader = CreateShader(srcCube.VertexSource, srcCube.FragmentSource);
+    if (dumpMemoryRequested) {
+        backend.DumpMemory(std::cout);
+        DumpHostMemory(std::cout);
+        dumpMemoryRequested = false;
+    }
+}
 
-    ShaderProgramSource srcAxes = ParseShader("res/shaders/Axes.shader");
-    unsigned int axesShader = CreateShader(srcAxes.VertexSource, srcAxes.FragmentSource);
+// Closest object under a pixel of a width x height view, (0, 0) at the top
+// left. The first pick builds the per-mesh BVHs; after that the frame loop
+// keeps the top level current and this only traces.
+static RayHit PickObject(SceneSetup& setup, const Scene& scene, JobSystem* jobs, double x, double y, int width, int height) {
+    if (!setup.Rays.HasMeshes())
+        setup.Rays.BuildMeshes(setup.Desc, setup.Binding);
+    setup.Rays.Update(scene, jobs);
+
+    glm::mat4 inverse = glm::inverse(proj * view);
+    float ndcX = static_cast<float>(2.0 * x / width - 1.0);
+    float ndcY = static_cast<float>(1.0 - 2.0 * y / height);
+    glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    RayDesc ray;
+    ray.Origin = glm::vec3(nearPoint) / nearPoint.w;
+    ray.Direction = glm::vec3(farPoint) / farPoint.w - ray.Origin;
+    // Direction spans near to far plane, so t = 1 is the far plane
+    ray.TMax = 1.0f;
+    return setup.Rays.TraceClosest(ray);
+}
 
-    ShaderProgramSource srcPyramid = ParseShader("res/shaders/Cube.shader");
-    unsigned int pyramidShader = CreateShader(srcPyramid.VertexSource, srcPyramid.FragmentSource);
+// Objects added through the control socket stay at the end of scene.Objects,
+// behind everything the scene file and --instances placed, so hot reload
+// resizing the file's range moves them as a block
+struct ControlState {
+    ControlServer Server;
+    std::vector<unsigned int> Objects;     // handle of each control object, in scene order
+    unsigned int NextHandle = 1;
+    std::vector<ControlCommand> Screenshots;
+    std::chrono::steady_clock::time_point LastFrame = std::chrono::steady_clock::now();
+    double FrameMs = 0.0;
+};
 
-    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 1920.0f / 1080.0f, 0.1f, 100.0f);
+// Frame boundary, before the frame is built: applies every queued command.
+// Screenshots are only noted here and read back once the frame is drawn.
+static void ApplyControlCommands(ControlState& control, Scene& scene, RenderBackend& backend,
+                                 SceneSetup& setup, const FrameData& frame) {
+    auto now = std::chrono::steady_clock::now();
+    control.FrameMs = std::chrono::duration<double, std::milli>(now - control.LastFrame).count();
+    control.LastFrame = now;
+    if (!control.Server.IsRunning())
+        return;
+
+    ControlCommand command;
+    while (control.Server.Poll(command)) {
+        switch (command.Type) {
+            case ControlCommandType::SetCamera: {
+                SceneCameraDesc camera = setup.Desc.Camera;
+                camera.Eye = command.Eye;
+                camera.Target = command.Target;
+                camera.Up = command.Up;
+                SetCamera(camera);
+                control.Server.ReplyOk(command);
+                break;
+            }
+            case ControlCommandType::AddObject: {
+                int mesh = setup.Desc.FindMesh(command.Mesh);
+                int material = setup.Desc.FindMaterial(command.Material);
+                if (mesh < 0 || material < 0) {
+                    control.Server.ReplyError(command, "unknown " + (mesh < 0 ? "mesh " + command.Mesh : "material " + command.Material));
+                    break;
+                }
+                MemoryTagScope tag(MemoryTag::Scene);
+                AddObject(scene, setup.Binding.Meshes[mesh], setup.Binding.Materials[material], command.Model, command.Color);
+                unsigned int handle = control.NextHandle++;
+                control.Objects.push_back(handle);
+                control.Server.ReplyOk(command, "\"object\": " + std::to_string(handle));
+                break;
+            }
+            case ControlCommandType::RemoveObject: {
+                auto it = std::find(control.Objects.begin(), control.Objects.end(), command.Object);
+                if (it == control.Objects.end()) {
+                    control.Server.ReplyError(command, "unknown object " + std::to_string(command.Object));
+                    break;
+                }
+                size_t first = scene.Objects.size() - control.Objects.size();
+                scene.Objects.erase(scene.Objects.begin() + static_cast<std::ptrdiff_t>(first + (it - control.Objects.begin())));
+                control.Objects.erase(it);
+                control.Server.ReplyOk(command);
+                break;
+            }
+            case ControlCommandType::Screenshot:
+                control.Screenshots.push_back(std::move(command));
+                break;
+            case ControlCommandType::QueryStats: {
+                const RenderStats& stats = backend.GetFrameStats();
+                std::ostringstream fields;
+                fields << "\"frame\": " << frame.Index << ", \"frame_ms\": " << control.FrameMs
+                       << ", \"objects\": " << scene.Objects.size() << ", \"draws\": " << stats.DrawCalls
+                       << ", \"triangles\": " << stats.Triangles << ", \"state_changes\": " << stats.StateChanges
+                       << ", \"gpu_bytes\": " << backend.GetMemoryTracker().GetTotalBytes()
+                       << ", \"host_bytes\": " << GetHostMemoryTotals().LiveBytes;
+                control.Server.ReplyOk(command, fields.str());
+                break;
+            }
+            case ControlCommandType::Pick: {
+                RayHit hit = PickObject(setup, scene, frame.Jobs, command.X, command.Y, 1, 1);
+                if (hit.Object == RAY_QUERY_MISS) {
+                    control.Server.ReplyOk(command, "\"hit\": false");
+                    break;
+                }
+                glm::vec3 eye(eyeX, eyeY, eyeZ);
+                glm::mat4 inverse = glm::inverse(proj * view);
+                glm::vec4 nearPoint = inverse * glm::vec4(2.0f * command.X - 1.0f, 1.0f - 2.0f * command.Y, -1.0f, 1.0f);
+                glm::vec4 farPoint = inverse * glm::vec4(2.0f * command.X - 1.0f, 1.0f - 2.0f * command.Y, 1.0f, 1.0f);
+                glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+                glm::vec3 position = origin + (glm::vec3(farPoint) / farPoint.w - origin) * hit.T;
+                std::ostringstream fields;
+                fields << "\"hit\": true, \"index\": " << hit.Object;
+                size_t firstControl = scene.Objects.size() - control.Objects.size();
+                if (hit.Object >= firstControl)
+                    fields << ", \"object\": " << control.Objects[hit.Object - firstControl];
+                fields << ", \"position\": [" << position.x << ", " << position.y << ", " << position.z
+                       << "], \"distance\": " << glm::length(position - eye);
+                control.Server.ReplyOk(command, fields.str());
+                break;
+            }
+            case ControlCommandType::Invalid:
+                control.Server.ReplyError(command, command.Error);
+                break;
+        }
+    }
+}
 
-    glm::mat4 cubeModel = glm::mat4(1.0f);
-    glm::mat4 cubeMvp = proj * view * cubeModel;
+// After the frame is drawn and before it is presented
+static void CaptureControlScreenshots(ControlState& control, RenderBackend& backend, int width, int height) {
+    for (const ControlCommand& command : control.Screenshots) {
+        std::vector<unsigned char> pixels(static_cast<size_t>(width) * static_cast<size_t>(height) * 4);
+        backend.ReadPixels(0, 0, width, height, pixels.data());
+        control.Server.ReplyScreenshot(command, width, height, std::move(pixels));
+    }
+    control.Screenshots.clear();
+}
 
-    glm::mat4 pyramidModel = glm::translate(glm::mat4(1.0f), glm::vec3(2.5f, 0.0f, 1.0f));
-    // glm::mat4 pyramidModel = glm::mat4(1.0f);
-    glm::mat4 pyramidModelTranslation = glm::translate(glm::mat4(1.0f), glm::vec3(2.5f, 0.0f, 1.0f));
-    glm::mat4 pyramidMvp = proj * view * pyramidModel;
+static void PrintStats(const RenderBackend& backend, FrameArena& arena, int frames, double seconds) {
+    const RenderStats& stats = backend.GetStats();
+    std::cout << "[" << backend.GetName() << " Backend] " << frames << " frames in " << seconds * 1000.0 << " ms ("
+              << (seconds > 0.0 ? frames / seconds : 0.0) << " fps)" << std::endl;
+    std::cout << "  draws/frame: " << (frames ? stats.DrawCalls / frames : 0)
+              << ", triangles/frame: " << (frames ? stats.Triangles / frames : 0)
+              << ", state changes: " << stats.StateChanges
+              << ", uniform updates: " << stats.UniformUpdates << std::endl;
+    std::cout << "  resources created: " << stats.ResourcesCreated
+              << ", deleted: " << stats.ResourcesDeleted
+              << ", bytes uploaded: " << stats.BytesUploaded
+              << ", validation errors: " << stats.ValidationErrors << std::endl;
+
+    FrameArenaStats arenaStats = arena.GetStats();
+    std::cout << "  frame arena: " << arenaStats.Used << " bytes last frame, peak " << arenaStats.Peak
+              << " of " << arenaStats.Capacity << " across " << arenaStats.Threads << " thread(s), "
+              << arenaStats.Overflows << " heap fallback(s) last frame" << std::endl;
+
+    HostMemoryStats host = GetHostMemoryTotals();
+    std::cout << "  host memory: " << host.LiveBytes / 1024.0 << " KB live, peak " << host.PeakBytes / 1024.0
+              << " KB, " << host.Allocations << " allocation(s) total, " << host.FrameAllocations << " last frame" << std::endl;
+}
 
-    glm::mat4 axesMvp = proj * view;
+static void WarmUp(RenderBackend& backend, const Scene& scene, const SceneSetup& setup, int width, int height) {
+    // The impostor quads are the one draw outside the scene's objects and batches made from startup on
+    std::vector<PipelineWarmupDraw> extraDraws;
+    if (setup.Impostors.HasImpostors())
+        extraDraws.push_back({ setup.Impostors.GetProgram(), setup.Impostors.GetVertexArray(), GL_TRIANGLES, true,
+                               setup.Impostors.GetTextures() });
+    PipelineWarmupStats warmup = WarmUpPipelines(backend, scene, width, height, extraDraws);
+    std::cout << "[Warm-up] " << warmup.Combinations << " pipeline combination(s) in " << warmup.Milliseconds
+              << " ms, slowest " << warmup.SlowestMilliseconds << " ms (program " << warmup.SlowestProgram << ")" << std::endl;
+}
 
-    int mvpLocationCube = glGetUniformLocation(cubeShader, "u_MVP");
-    int mvpLocationPyramid = glGetUniformLocation(pyramidShader, "u_MVP");
+// Runs the whole frame pipeline (input, view update, culling, packet
+// generation, submission) with no window or GL context
+static int RunNullBenchmark(StartupTimeline& timeline, int frames, int instances, JobSystem* jobs, const std::string& packPath,
+                            const std::string& scenePath, const std::string& controlPath, const std::string& streamAddress,
+                            int sdfPrimitives, bool volume, const std::string& volumePath, size_t volumePool,
+                            bool staticBatching, bool hlod, bool pvs, bool impostors, size_t gpuBudget, bool warmup, double frameBudget) {
+    NullBackend backend;
+    backend.GetMemoryTracker().SetBudget(gpuBudget);
+    Scene scene;
+    AssetPack pack;
+    SceneSetup setup;
+    setup.StaticBatching = staticBatching;
+    setup.Hlod = hlod;
+    setup.Visibility = pvs;
+    setup.ImpostorsEnabled = impostors;
+    setup.RendererShaders = GetRendererShaders(sdfPrimitives, volume, impostors);
+    StartupGraph startup(jobs, timeline);
+    unsigned int sceneStep = AddSceneSteps(startup, scene, backend, jobs, pack, packPath, scenePath, setup, instances, {});
+    if (warmup) {
+        startup.Add("Warm up pipelines", StartupThread::Main, [&backend, &scene, &setup] {
+            WarmUp(backend, scene, setup, 1920, 1080);
+            return true;
+        }, { sceneStep });
+    }
+    if (!startup.Run())
+        return 1;
+
+    FrameData frameData;
+    frameData.Jobs = jobs;
+    frameData.Recorder.SetBudget(frameBudget);
+    SdfRenderer sdf;
+    if (sdfPrimitives >= 0) {
+        if (!StartSdf(sdf, scene, backend, setup.Desc, sdfPrimitives))
+            return 1;
+        frameData.Sdf = &sdf;
+    }
+    VolumeRenderer volumeRenderer;
+    if (volume) {
+        if (!StartVolume(volumeRenderer, scene, backend, volumePath, volumePool))
+            return 1;
+        frameData.Volume = &volumeRenderer;
+    }
+    if (setup.ImpostorsEnabled)
+        frameData.Impostors = &setup.Impostors;
 
-    while (!glfwWindowShouldClose(window)) {
-        GLCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    // Walk the camera around and back so every frame has a fresh view matrix
+    const int script[] = {
+        GLFW_KEY_W, GLFW_KEY_A, GLFW_KEY_SPACE, GLFW_KEY_S, GLFW_KEY_D, GLFW_KEY_LEFT_CONTROL
+    };
 
-        // Draw the cube
-        // cubeModel = glm::rotate(glm::mat4(1.0f), static_cast<float>(glfwGetTime()), glm::vec3(0.0f, 1.0f, 0.0f));
-        cubeMvp = proj * view * cubeModel;
-        GLCall(glUseProgram(cubeShader));
-        GLCall(glBindVertexArray(cubeVao));
-        GLCall(glUniformMatrix4fv(mvpLocationCube, 1, GL_FALSE, glm::value_ptr(cubeMvp)));
-        GLCall(glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr));
+    SceneFileWatcher watcher(scenePath);
+    ControlState control;
+    if (!controlPath.empty())
+        control.Server.Start(controlPath);
+    FrameStreamer streamer;
+    if (!streamAddress.empty())
+        streamer.Start(streamAddress, jobs);
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        ReloadSceneIfChanged(watcher, scene, backend, setup);
+        ApplyControlCommands(control, scene, backend, setup, frameData);
+        if (setup.Rays.HasMeshes())
+            setup.Rays.Update(scene, jobs);
+        StreamInputEvent input;
+        while (streamer.PollInput(input))
+            ProcessKey(input.Key, input.Action);
+        ProcessKey(script[frame % std::size(script)], GLFW_PRESS);
+        UpdateCameraCell(scene, setup, false);
+        if (setup.ImpostorsEnabled)
+            setup.Impostors.Select(scene, view, proj, frameData.Height);
+        if (frame == 0) {
+            StartupStep step(timeline, "First frame");
+            RenderFrame(backend, scene, proj, frameData);
+        } else {
+            RenderFrame(backend, scene, proj, frameData);
+        }
+        CaptureControlScreenshots(control, backend, 1920, 1080);
+        streamer.EndFrame(backend, 1920, 1080);
+    }
+    control.Server.Stop();
+    streamer.Stop(backend);
+    timeline.Print(std::cout);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!scene.BatchRoots.empty()) {
+        const HlodStats& stats = frameData.Hlod;
+        std::cout << "[HLOD] last frame: " << stats.BatchDraws << " batch(es) and " << stats.ProxyDraws << " prox(ies), "
+                  << stats.Primitives << " primitive(s), " << stats.Nodes << " node(s) visited"
+                  << (stats.OverBudget ? ", held back by the budget" : "") << std::endl;
+    }
+    if (setup.Visibility && !setup.Desc.Cells.empty()) {
+        const PvsStats& stats = setup.Pvs;
+        if (!setup.Desc.HasPvs())
+            std::cout << "[PVS] " << stats.Cells << " cell(s) without baked sets; run PvsBake on " << scenePath
+                      << (pack.Find(scenePath) ? " and rebuild the asset pack" : "") << std::endl;
+        else if (stats.Cell < 0)
+            std::cout << "[PVS] last frame: outside every cell, " << stats.Changes << " cell change(s)" << std::endl;
+        else
+            std::cout << "[PVS] last frame: cell " << setup.Desc.Cells[stats.Cell].Name << ", " << stats.HiddenObjects << " of "
+                      << setup.Desc.Objects.size() << " object(s) and " << stats.HiddenNodes << " batch node(s) hidden, "
+                      << stats.Changes << " cell change(s)" << std::endl;
+    }
+    if (setup.Impostors.HasImpostors()) {
+        const ImpostorStats& stats = setup.Impostors.GetStats();
+        std::cout << "[Impostors] last frame: " << stats.FarClusters << " of " << stats.Clusters << " cluster(s) far, "
+                  << stats.ReplacedObjects << " object(s) replaced, " << stats.Quads << " quad(s) in " << stats.Draws
+                  << " draw(s)" << std::endl;
+    }
+    if (volume) {
+        const VolumeStats& stats = volumeRenderer.GetStats();
+        std::cout << "[Volume] last frame: " << stats.WantedBricks << " brick(s) in view, " << stats.ResidentBricks
+                  << " resident, " << stats.UploadedBricks << " uploaded, " << stats.MissingBricks << " from the fallback" << std::endl;
+    }
+    backend.DumpMemory(std::cout);
+    DumpHostMemory(std::cout);
+    if (AllocationStacksEnabled())
+        DumpAllocationStacks(std::cout, 10);
+    DestroyScene(scene);
+    sdf.Release();
+    volumeRenderer.Release();
+    setup.Impostors.Release();
+    frameData.Uniforms.Release(backend);
+    frameData.Recorder.Release();
+    backend.GetDeletionQueue().Flush();
+    PrintStats(backend, frameData.Arena, frames, seconds);
+    return backend.GetStats().ValidationErrors == 0 ? 0 : 1;
+}
 
+int main(int argc, char** argv) {
+    StartupTimeline timeline;
+    bool nullBackend = false;
+    int frames = 0;
+    int instances = 0;
+    int threads = -1;
+    size_t gpuBudget = 0;
+    bool warmup = true;
+    double frameBudget = FLIGHT_RECORDER_DEFAULT_BUDGET_MS;
+    std::string packPath = ASSET_PACK_DEFAULT_PATH;
+    std::string scenePath = SCENE_DEFAULT_PATH;
+    std::string controlPath;
+    std::string streamAddress;
+    int sdfPrimitives = -1;
+    bool volume = false;
+    std::string volumePath;
+    size_t volumePool = VOLUME_POOL_BYTES;
+    bool staticBatching = true;
+    bool hlod = true;
+    bool pvs = true;
+    bool impostors = true;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--null") == 0)
+            nullBackend = true;
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+            instances = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--gpu-budget") == 0 && i + 1 < argc)
+            gpuBudget = static_cast<size_t>(std::atof(argv[++i]) * 1024 * 1024);
+        else if (std::strcmp(argv[i], "--frame-budget") == 0 && i + 1 < argc)
+            frameBudget = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--alloc-stacks") == 0)
+            EnableAllocationStacks(true);
+        else if (std::strcmp(argv[i], "--no-warmup") == 0)
+            warmup = false;
+        else if (std::strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+            packPath = argv[++i];
+        else if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+            scenePath = argv[++i];
+        else if (std::strcmp(argv[i], "--control") == 0)
+            controlPath = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : CONTROL_SOCKET_DEFAULT_PATH;
+        else if (std::strcmp(argv[i], "--stream") == 0)
+            streamAddress = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : FRAME_STREAM_DEFAULT_ADDRESS;
+        else if (std::strcmp(argv[i], "--sdf") == 0)
+            sdfPrimitives = i + 1 < argc && argv[i + 1][0] != '-' ? std::atoi(argv[++i]) : 0;
+        else if (std::strcmp(argv[i], "--volume") == 0) {
+            volume = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                volumePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--volume-pool") == 0 && i + 1 < argc)
+            volumePool = static_cast<size_t>(std::atof(argv[++i]) * 1024 * 1024);
+        else if (std::strcmp(argv[i], "--no-static-batching") == 0)
+            staticBatching = false;
+        else if (std::strcmp(argv[i], "--no-hlod") == 0)
+            hlod = false;
+        else if (std::strcmp(argv[i], "--no-pvs") == 0)
+            pvs = false;
+        else if (std::strcmp(argv[i], "--no-impostors") == 0)
+            impostors = false;
+        else
+            std::cout << "Unknown argument: " << argv[i] << std::endl;
+    }
+    if (volume && sdfPrimitives >= 0) {
+        // The SDF pass writes no depth for the volume to stop at
+        std::cout << "--volume is ignored with --sdf" << std::endl;
+        volume = false;
+    }
 
-        // Draw the pyramid
-        // pyramidModel = glm::rotate(glm::mat4(1.0f), static_cast<float>(glfwGetTime()), glm::vec3(0.0f, 1.0f, 0.0f)) * pyramidModelTranslation;
-        // pyramidModel = pyramidModelTranslation * glm::rotate(glm::mat4(1.0f), static_cast<float>(glfwGetTime()), glm::vec3(0.0f, 1.0f, 0.0f));
-        pyramidMvp = proj * view * pyramidModel;
-        GLCall(glUseProgram(pyramidShader));
-        GLCall(glBindVertexArray(pyramidVao));
-        GLCall(glUniformMatrix4fv(mvpLocationPyramid, 1, GL_FALSE, glm::value_ptr(pyramidMvp)));
-        GLCall(glDrawElements(GL_TRIANGLES, 18, GL_UNSIGNED_INT, nullptr));
+    // --threads 0 keeps culling and submission on the main thread
+    std::unique_ptr<JobSystem> jobs;
+    {
+        StartupStep step(timeline, "Start job system");
+        if (threads < 0)
+            jobs = std::make_unique<JobSystem>();
+        else if (threads > 0)
+            jobs = std::make_unique<JobSystem>(threads - 1);
+    }
 
-        // Draw the axes
-        axesMvp = proj * view;
-        GLCall(glUseProgram(axesShader));
-        GLCall(glBindVertexArray(axesVao));
-        int axesMvpLocation = glGetUniformLocation(axesShader, "u_MVP");
-        GLCall(glUniformMatrix4fv(axesMvpLocation, 1, GL_FALSE, glm::value_ptr(axesMvp)));
+    if (nullBackend)
+        return RunNullBenchmark(timeline, frames > 0 ? frames : 10000, instances, jobs.get(), packPath, scenePath,
+                                controlPath, streamAddress, sdfPrimitives, volume, volumePath, volumePool, staticBatching,
+                                hlod, pvs, impostors, gpuBudget, warmup, frameBudget);
+
+    // Window and context creation run on this thread while a worker reads and
+    // loads the scene file and parses its shaders
+    GLFWwindow* window = nullptr;
+    GLBackend backend;
+    backend.GetMemoryTracker().SetBudget(gpuBudget);
+    Scene scene;
+    AssetPack pack;
+    SceneSetup setup;
+    setup.StaticBatching = staticBatching;
+    setup.Hlod = hlod;
+    setup.Visibility = pvs;
+    setup.ImpostorsEnabled = impostors;
+    setup.RendererShaders = GetRendererShaders(sdfPrimitives, volume, impostors);
+    StartupGraph startup(jobs.get(), timeline);
+    unsigned int windowStep = startup.Add("Create window", StartupThread::Main, [&window, &streamAddress] {
+        if (!glfwInit())
+            return false;
+        // Headless nodes are watched through the stream instead
+        if (!streamAddress.empty())
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        window = glfwCreateWindow(1920, 1080, "3D Scene", nullptr, nullptr);
+        if (!window) {
+            glfwTerminate();
+            return false;
+        }
 
-        // Draw X axis in red
-        int colorLocation = glGetUniformLocation(axesShader, "u_Color");
-        GLCall(glUniform4f(colorLocation, 1.0f, 0.0f, 0.0f, 1.0f));
-        GLCall(glDrawArrays(GL_LINES, 0, 2));
+        glfwSetKeyCallback(window, keyCallback);
+        glfwSetMouseButtonCallback(window, mouseButtonCallback);
+
+        glfwMakeContextCurrent(window);
+        glfwSwapInterval(1);
+        return true;
+    });
+    unsigned int contextStep = startup.Add("Initialize GLEW", StartupThread::Main, [] {
+        if (glewInit() != GLEW_OK) {
+            std::cout << "Error initializing GLEW!" << std::endl;
+            return false;
+        }
 
-        // Draw Y axis in green
-        GLCall(glUniform4f(colorLocation, 0.0f, 1.0f, 0.0f, 1.0f));
-        GLCall(glDrawArrays(GL_LINES, 2, 2));
+        // Enable depth test for correct 3D rendering
+        glEnable(GL_DEPTH_TEST);
+        return true;
+    }, { windowStep });
+    unsigned int sceneStep = AddSceneSteps(startup, scene, backend, jobs.get(), pack, packPath, scenePath, setup, instances,
+                                            { contextStep });
+    if (warmup) {
+        startup.Add("Warm up pipelines", StartupThread::Main, [&backend, &scene, &setup, &window] {
+            int width, height;
+            glfwGetFramebufferSize(window, &width, &height);
+            WarmUp(backend, scene, setup, width, height);
+            return true;
+        }, { sceneStep });
+    }
+    if (!startup.Run())
+        return -1;
 
-        // Draw Z axis in blue
-        GLCall(glUniform4f(colorLocation, 0.0f, 0.0f, 1.0f, 1.0f));
-        GLCall(glDrawArrays(GL_LINES, 4, 2));
+    FrameData frameData;
+    frameData.Jobs = jobs.get();
+    frameData.Recorder.SetBudget(frameBudget);
+    SdfRenderer sdf;
+    if (sdfPrimitives >= 0) {
+        if (!StartSdf(sdf, scene, backend, setup.Desc, sdfPrimitives))
+            return -1;
+        frameData.Sdf = &sdf;
+    }
+    VolumeRenderer volumeRenderer;
+    if (volume) {
+        if (!StartVolume(volumeRenderer, scene, backend, volumePath, volumePool))
+            return -1;
+        frameData.Volume = &volumeRenderer;
+    }
+    if (setup.ImpostorsEnabled)
+        frameData.Impostors = &setup.Impostors;
+
+    // Run with --no-warmup to compare against lazy driver compilation
+    HitchMonitor hitches;
+    SceneFileWatcher watcher(scenePath);
+    ControlState control;
+    if (!controlPath.empty())
+        control.Server.Start(controlPath);
+    FrameStreamer streamer;
+    if (!streamAddress.empty())
+        streamer.Start(streamAddress, jobs.get());
+    int frame = 0;
+    hitches.Start();
+    while (!glfwWindowShouldClose(window) && (frames == 0 || frame < frames)) {
+        auto frameStart = StartupTimeline::Clock::now();
+        ReloadSceneIfChanged(watcher, scene, backend, setup);
+        ApplyControlCommands(control, scene, backend, setup, frameData);
+        if (setup.Rays.HasMeshes())
+            setup.Rays.Update(scene, jobs.get());
+        if (pickRequested) {
+            double x, y;
+            int width, height;
+            glfwGetCursorPos(window, &x, &y);
+            glfwGetWindowSize(window, &width, &height);
+            RayHit hit = PickObject(setup, scene, jobs.get(), x, y, width, height);
+            if (hit.Object == RAY_QUERY_MISS)
+                std::cout << "[Pick] nothing" << std::endl;
+            else
+                std::cout << "[Pick] object " << hit.Object << " at t = " << hit.T << std::endl;
+            pickRequested = false;
+        }
+        StreamInputEvent input;
+        while (streamer.PollInput(input)) {
+            if (ProcessKey(input.Key, input.Action))
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+        UpdateCameraCell(scene, setup, true);
+        glfwGetFramebufferSize(window, &frameData.Width, &frameData.Height);
+        if (setup.ImpostorsEnabled)
+            setup.Impostors.Select(scene, view, proj, frameData.Height);
+        RenderFrame(backend, scene, proj, frameData);
+        if (!control.Screenshots.empty() || streamer.IsRunning()) {
+            int width, height;
+            glfwGetFramebufferSize(window, &width, &height);
+            CaptureControlScreenshots(control, backend, width, height);
+            streamer.EndFrame(backend, width, height);
+        }
 
         glfwSwapBuffers(window);
+        if (frame == 0) {
+            timeline.Record("First frame", frameStart, StartupTimeline::Clock::now());
+            timeline.Print(std::cout);
+        }
         glfwPollEvents();
+        hitches.FrameFinished();
+        frame++;
     }
 
-    glDeleteProgram(cubeShader);
-    glDeleteProgram(pyramidShader);
-    glDeleteProgram(axesShader);
+    control.Server.Stop();
+    streamer.Stop(backend);
+    if (AllocationStacksEnabled())
+        DumpAllocationStacks(std::cout, 10);
+    DestroyScene(scene);
+    sdf.Release();
+    volumeRenderer.Release();
+    setup.Impostors.Release();
+    frameData.Uniforms.Release(backend);
+    frameData.Recorder.Release();
+    backend.GetDeletionQueue().Flush();
     glfwTerminate();
     return 0;
 }
-
-
@@ -1,12 +1,26 @@
+#keywords STATIC_BATCH
+
 #shader vertex
 #version 330 core
    
 layout(location = 0) in vec3 a_Position;
 
-uniform mat4 u_MVP;
+layout(std140) uniform ObjectData {
+    mat4 u_MVP;
+    vec4 u_Color;
+};
+
+#ifdef STATIC_BATCH
+// World-space positions with each axis' color per vertex
+layout(location = 2) in vec4 a_Color;
+out vec4 v_Color;
+#endif
 
 void main() {
     gl_Position = u_MVP * vec4(a_Position, 1.0);
+#ifdef STATIC_BATCH
+    v_Color = a_Color;
+#endif
 }
 
 #shader fragment
@@ -14,8 +28,19 @@ void main() {
 
 out vec4 color;
 
-uniform vec4 u_Color;
+layout(std140) uniform ObjectData {
+    mat4 u_MVP;
+    vec4 u_Color;
+};
+
+#ifdef STATIC_BATCH
+in vec4 v_Color;
+#endif
 
 void main() {
+#ifdef STATIC_BATCH
+    color = v_Color;
+#else
     color = u_Color;
+#endif
 }
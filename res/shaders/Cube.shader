@@ -1,12 +1,38 @@
+#keywords UNIFORM_COLOR HEIGHT_SHADE STATIC_BATCH
+
 #shader vertex
 #version 330 core
 
 layout(location = 0) in vec3 a_Position;
 
-uniform mat4 u_MVP;
+layout(std140) uniform ObjectData {
+    mat4 u_MVP;
+    vec4 u_Color;
+};
+
+#ifdef STATIC_BATCH
+// Batches are pre-transformed to world space (u_MVP is the view-projection)
+// and carry each object's own position and color per vertex
+layout(location = 1) in vec3 a_ObjectPosition;
+layout(location = 2) in vec4 a_Color;
+out vec4 v_Color;
+#endif
+
+#ifdef HEIGHT_SHADE
+out float v_Height;
+#endif
 
 void main() {
     gl_Position = u_MVP * vec4(a_Position, 1.0);
+#ifdef STATIC_BATCH
+    vec3 objectPosition = a_ObjectPosition;
+    v_Color = a_Color;
+#else
+    vec3 objectPosition = a_Position;
+#endif
+#ifdef HEIGHT_SHADE
+    v_Height = objectPosition.y + 0.5;
+#endif
 }
 
 #shader fragment
@@ -14,6 +40,28 @@ void main() {
 
 out vec4 color;
 
+layout(std140) uniform ObjectData {
+    mat4 u_MVP;
+    vec4 u_Color;
+};
+
+#ifdef STATIC_BATCH
+in vec4 v_Color;
+#endif
+
+#ifdef HEIGHT_SHADE
+in float v_Height;
+#endif
+
 void main() {
+#if defined(UNIFORM_COLOR) && defined(STATIC_BATCH)
+    color = v_Color;
+#elif defined(UNIFORM_COLOR)
+    color = u_Color;
+#else
     color = vec4(1.0, 0.0, 0.0, 1.0);
+#endif
+#ifdef HEIGHT_SHADE
+    color.rgb *= 0.5 + 0.5 * clamp(v_Height, 0.0, 1.0);
+#endif
 }
@@ -0,0 +1,153 @@
+#shader vertex
+#version 330 core
+
+// Camera-facing quads of ImpostorRenderer. Each quad finds the three baked
+// views around its direction to the eye on the hemi-octahedral grid and
+// passes its position in each view's square on to the fragment shader.
+
+layout(location = 0) in vec3 a_Center;     // world space
+layout(location = 1) in vec2 a_Corner;     // -1 or 1
+layout(location = 2) in vec2 a_Size;       // bounding sphere radius, rotation about y
+layout(location = 3) in vec4 a_Color;
+layout(location = 4) in vec2 a_Tile;       // atlas texel of the mesh's first view
+
+layout(std140) uniform ImpostorFrame {
+    mat4 u_ViewProj;
+    vec4 u_Eye;
+    ivec4 u_Atlas;             // views per side, texels per view
+};
+
+out vec3 v_Frame[3];           // per view: square coordinate, distance along the view from the centre
+flat out vec3 v_Ray[3];        // per view: direction to the eye in its axes
+flat out ivec2 v_Origin[3];    // per view: atlas texel
+flat out vec3 v_Weights;
+flat out vec3 v_View;          // direction to the eye, mesh space
+flat out vec4 v_Color;
+out vec3 v_World;
+flat out vec4 v_ToEye;         // world space; w: radius
+
+// Must match GetViewBasis in Impostor.cpp
+void GetViewBasis(vec3 direction, out vec3 right, out vec3 up) {
+    right = cross(vec3(0.0, 1.0, 0.0), direction);
+    float size = length(right);
+    right = size > 1e-4 ? right / size : vec3(1.0, 0.0, 0.0);
+    up = cross(direction, right);
+}
+
+// Must match GetViewDirection in Impostor.cpp
+vec3 GetViewDirection(ivec2 view) {
+    vec2 square = vec2(view) / float(u_Atlas.x - 1) * 2.0 - 1.0;
+    vec3 direction = vec3(0.5 * (square.x + square.y), 0.0, 0.5 * (square.x - square.y));
+    direction.y = 1.0 - abs(direction.x) - abs(direction.z);
+    return normalize(direction);
+}
+
+void main() {
+    float c = cos(a_Size.y), s = sin(a_Size.y);
+    vec3 toEye = normalize(u_Eye.xyz - a_Center);
+    // Into the mesh's axes: undo the rotation about y
+    vec3 view = vec3(c * toEye.x - s * toEye.z, toEye.y, s * toEye.x + c * toEye.z);
+    vec3 right, up;
+    GetViewBasis(view, right, up);
+    vec3 corner = right * a_Corner.x + up * a_Corner.y;
+    vec3 world = vec3(c * corner.x + s * corner.z, corner.y, -s * corner.x + c * corner.z);
+    v_World = a_Center + world * a_Size.x;
+    gl_Position = u_ViewProj * vec4(v_World, 1.0);
+
+    // Only the upper hemisphere was baked; from below, the horizon views stand in
+    vec3 above = vec3(view.x, max(view.y, 0.0), view.z);
+    float sum = abs(above.x) + above.y + abs(above.z);
+    above = sum > 1e-6 ? above / sum : vec3(0.0, 1.0, 0.0);
+    vec2 grid = (vec2(above.x + above.z, above.x - above.z) * 0.5 + 0.5) * float(u_Atlas.x - 1);
+    vec2 base = clamp(floor(grid), vec2(0.0), vec2(float(u_Atlas.x - 2)));
+    vec2 f = grid - base;
+    // The grid square splits into two triangles; blend the corners of the one we are in
+    ivec2 views[3];
+    ivec2 cell = ivec2(base);
+    views[1] = cell + ivec2(1, 0);
+    views[2] = cell + ivec2(0, 1);
+    if (f.x + f.y <= 1.0) {
+        views[0] = cell;
+        v_Weights = vec3(1.0 - f.x - f.y, f.x, f.y);
+    } else {
+        views[0] = cell + ivec2(1, 1);
+        v_Weights = vec3(f.x + f.y - 1.0, 1.0 - f.y, 1.0 - f.x);
+    }
+    for (int i = 0; i < 3; i++) {
+        vec3 direction = GetViewDirection(views[i]);
+        vec3 viewRight, viewUp;
+        GetViewBasis(direction, viewRight, viewUp);
+        v_Frame[i] = vec3(vec2(dot(corner, viewRight), dot(corner, viewUp)) * 0.5 + 0.5, dot(corner, direction));
+        v_Ray[i] = vec3(dot(view, viewRight), dot(view, viewUp), dot(view, direction));
+        v_Origin[i] = ivec2(a_Tile) + views[i] * u_Atlas.y;
+    }
+    v_View = view;
+    v_Color = a_Color;
+    v_ToEye = vec4(toEye, a_Size.x);
+}
+
+#shader fragment
+#version 330 core
+
+layout(std140) uniform ImpostorFrame {
+    mat4 u_ViewProj;
+    vec4 u_Eye;
+    ivec4 u_Atlas;
+};
+
+uniform sampler2D u_ColorAtlas;
+uniform sampler2D u_NormalDepthAtlas;  // mesh-space normal; a: depth through the bounding sphere
+
+in vec3 v_Frame[3];
+flat in vec3 v_Ray[3];
+flat in ivec2 v_Origin[3];
+flat in vec3 v_Weights;
+flat in vec3 v_View;
+flat in vec4 v_Color;
+in vec3 v_World;
+flat in vec4 v_ToEye;
+
+out vec4 color;
+
+// Nothing outside the view's square
+vec4 Fetch(sampler2D atlas, ivec2 origin, vec2 square) {
+    if (any(lessThan(square, vec2(0.0))) || any(greaterThan(square, vec2(1.0))))
+        return vec4(0.0);
+    ivec2 texel = min(ivec2(square * float(u_Atlas.y)), ivec2(u_Atlas.y - 1));
+    return texelFetch(atlas, origin + texel, 0);
+}
+
+void main() {
+    vec3 sum = vec3(0.0);
+    float weights = 0.0, coverage = 0.0, strongest = -1.0, depth = 0.0;
+    for (int i = 0; i < 3; i++) {
+        vec2 square = v_Frame[i].xy;
+        // One parallax step: slide along the ray to the surface this view
+        // stored where the ray crosses its square, and read from there, so
+        // the three views line up on the surface instead of on the quad
+        float t = 0.0;
+        if (Fetch(u_ColorAtlas, v_Origin[i], square).a > 0.0) {
+            float surface = 1.0 - 2.0 * Fetch(u_NormalDepthAtlas, v_Origin[i], square).a;
+            t = (v_Frame[i].z - surface) / max(v_Ray[i].z, 0.1);
+            square -= t * v_Ray[i].xy * 0.5;
+        }
+        vec4 albedo = Fetch(u_ColorAtlas, v_Origin[i], square);
+        vec4 normalDepth = Fetch(u_NormalDepthAtlas, v_Origin[i], square);
+        // Surfaces a view saw edge-on, or that face away from the eye now, count less
+        float facing = max(dot(normalDepth.xyz * 2.0 - 1.0, v_View), 0.0);
+        float weight = v_Weights[i] * albedo.a * (0.25 + 0.75 * facing);
+        sum += albedo.rgb * weight;
+        weights += weight;
+        coverage += v_Weights[i] * albedo.a;
+        if (v_Weights[i] * albedo.a > strongest) {
+            strongest = v_Weights[i] * albedo.a;
+            depth = t;
+        }
+    }
+    if (coverage < 0.5 || weights <= 0.0)
+        discard;
+    color = vec4(sum / weights, 1.0) * v_Color;
+
+    vec4 clip = u_ViewProj * vec4(v_World - v_ToEye.xyz * depth * v_ToEye.w, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+}
@@ -0,0 +1,43 @@
+#shader vertex
+#version 330 core
+
+// Second bake pass of ImpostorRenderer: the mesh through one view's
+// orthographic projection, writing its surface normal and depth
+
+layout(location = 0) in vec3 a_Position;
+
+layout(std140) uniform ObjectData {
+    mat4 u_MVP;
+    vec4 u_Color;
+};
+
+out vec3 v_Position;
+
+void main() {
+    gl_Position = u_MVP * vec4(a_Position, 1.0);
+    v_Position = a_Position;
+}
+
+#shader fragment
+#version 330 core
+
+layout(std140) uniform ObjectData {
+    mat4 u_MVP;
+    vec4 u_Color;
+};
+
+in vec3 v_Position;
+
+out vec4 color;
+
+void main() {
+    // Meshes carry positions only, so the face normal comes from the
+    // position's screen derivatives. The projection's depth row is the view
+    // direction over the radius; turning the normal towards the viewer makes
+    // it independent of the winding.
+    vec3 normal = normalize(cross(dFdx(v_Position), dFdy(v_Position)));
+    vec3 toViewer = -vec3(u_MVP[0][2], u_MVP[1][2], u_MVP[2][2]);
+    if (dot(normal, toViewer) < 0.0)
+        normal = -normal;
+    color = vec4(normal * 0.5 + 0.5, gl_FragCoord.z);
+}
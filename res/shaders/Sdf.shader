@@ -0,0 +1,215 @@
+#keywords CONE_PREPASS
+
+#shader vertex
+#version 330 core
+
+// One triangle covering the viewport
+layout(location = 0) in vec2 a_Position;
+
+void main() {
+    gl_Position = vec4(a_Position, 0.0, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+// Raymarches the primitives of SdfRenderer. The grid lists, per cell, the
+// primitives whose surface can reach into it, followed by those that reach
+// only into a neighbouring cell; sphere tracing inside a cell evaluates just
+// its list and never steps past the cell, and empty cells are skipped whole.
+//
+// CONE_PREPASS runs at a fraction of the resolution and marches a cone
+// around each coarse pixel instead of a ray, stopping while every ray in the
+// cone is still clear of all surfaces. Each level starts from the previous,
+// coarser one and the full-resolution pass starts from the last.
+
+layout(std140) uniform SdfFrame {
+    mat4 u_InverseViewProj;
+    vec4 u_Eye;                // w: hit distance per unit of ray length (half a pixel)
+    vec4 u_Viewport;           // full-resolution width, height
+    vec4 u_GridMin;            // w: cell size
+    ivec4 u_GridSize;          // cells per axis; w: texels per row of the data textures
+    vec4 u_SunDirection;
+};
+
+uniform sampler2D u_Primitives;    // five texels each: world-to-local rows, shape, material
+uniform usampler2D u_Cells;        // first entry, entries inside, entries inside or next to the cell
+uniform usampler2D u_Entries;      // primitive indices
+uniform sampler2D u_Start;         // distance to start at, from the coarser level
+uniform vec4 u_Pass;               // tile size in pixels, cone slope, coarser level's tile size (0: none)
+
+out vec4 color;
+
+const int MAX_STEPS = 384;
+
+ivec2 TexelCoord(int index) {
+    return ivec2(index % u_GridSize.w, index / u_GridSize.w);
+}
+
+float Box(vec3 p, vec3 halfSize) {
+    vec3 q = abs(p) - halfSize;
+    return length(max(q, 0.0)) + min(max(q.x, max(q.y, q.z)), 0.0);
+}
+
+// Unit square base on y = 0, apex at height h
+float Pyramid(vec3 p, float h) {
+    float m2 = h * h + 0.25;
+    p.xz = abs(p.xz);
+    p.xz = p.z > p.x ? p.zx : p.xz;
+    p.xz -= 0.5;
+    vec3 q = vec3(p.z, h * p.y - 0.5 * p.x, h * p.x + 0.5 * p.y);
+    float s = max(-q.x, 0.0);
+    float t = clamp((q.y - 0.5 * p.z) / (m2 + 0.25), 0.0, 1.0);
+    float a = m2 * (q.x + s) * (q.x + s) + q.y * q.y;
+    float b = m2 * (q.x + 0.5 * t) * (q.x + 0.5 * t) + (q.y - m2 * t) * (q.y - m2 * t);
+    float d2 = min(q.y, -q.x * m2 - q.y * 0.5) > 0.0 ? 0.0 : min(a, b);
+    return sqrt((d2 + q.z * q.z) / m2) * sign(max(q.z, -p.y));
+}
+
+float PrimitiveDistance(int primitive, vec3 p, out vec4 material) {
+    int base = primitive * 5;
+    vec4 row0 = texelFetch(u_Primitives, TexelCoord(base), 0);
+    vec4 row1 = texelFetch(u_Primitives, TexelCoord(base + 1), 0);
+    vec4 row2 = texelFetch(u_Primitives, TexelCoord(base + 2), 0);
+    vec4 shape = texelFetch(u_Primitives, TexelCoord(base + 3), 0);
+    material = texelFetch(u_Primitives, TexelCoord(base + 4), 0);
+    vec3 local = vec3(dot(row0.xyz, p) + row0.w, dot(row1.xyz, p) + row1.w, dot(row2.xyz, p) + row2.w);
+    if (shape.w < 0.5)
+        return Box(local, shape.xyz);
+    if (shape.w < 1.5)
+        return shape.x * Pyramid(local / shape.x, shape.y);
+    return length(local) - shape.x;
+}
+
+// Union of entries [first, first + count); a primitive with a blend radius
+// merges smoothly into those before it, and so does its color
+float SceneDistance(vec3 p, int first, int count, out vec3 albedo) {
+    float d = 1e30;
+    albedo = vec3(0.0);
+    for (int i = 0; i < count; i++) {
+        int primitive = int(texelFetch(u_Entries, TexelCoord(first + i), 0).r);
+        vec4 material;
+        float di = PrimitiveDistance(primitive, p, material);
+        if (material.w > 0.0) {
+            float h = clamp(0.5 + 0.5 * (di - d) / material.w, 0.0, 1.0);
+            d = mix(di, d, h) - material.w * h * (1.0 - h);
+            albedo = mix(material.rgb, albedo, h);
+        } else if (di < d) {
+            d = di;
+            albedo = material.rgb;
+        }
+    }
+    return d;
+}
+
+vec3 SceneNormal(vec3 p, int first, int count, float h) {
+    const vec2 k = vec2(1.0, -1.0);
+    vec3 albedo;
+    return normalize(k.xyy * SceneDistance(p + k.xyy * h, first, count, albedo) +
+                     k.yyx * SceneDistance(p + k.yyx * h, first, count, albedo) +
+                     k.yxy * SceneDistance(p + k.yxy * h, first, count, albedo) +
+                     k.xxx * SceneDistance(p + k.xxx * h, first, count, albedo));
+}
+
+void main() {
+    float tile = u_Pass.x;
+    vec2 pixel = floor(gl_FragCoord.xy) * tile + 0.5 * tile;
+    vec2 ndc = pixel / u_Viewport.xy * 2.0 - 1.0;
+    vec4 far = u_InverseViewProj * vec4(ndc, 1.0, 1.0);
+    vec3 origin = u_Eye.xyz;
+    vec3 direction = normalize(far.xyz / far.w - origin);
+    // A zero component would make 0 * inf = NaN below
+    direction = mix(direction, vec3(1e-8), lessThan(abs(direction), vec3(1e-8)));
+    vec3 inverse = 1.0 / direction;
+
+    float start = 0.0;
+    if (u_Pass.z > 0.0)
+        start = texelFetch(u_Start, ivec2(pixel / u_Pass.z), 0).r;
+
+    float cellSize = u_GridMin.w;
+    vec3 gridMin = u_GridMin.xyz;
+    vec3 gridMax = gridMin + vec3(u_GridSize.xyz) * cellSize;
+    vec3 t0 = (gridMin - origin) * inverse;
+    vec3 t1 = (gridMax - origin) * inverse;
+    vec3 tLow = min(t0, t1), tHigh = max(t0, t1);
+    float tEnter = max(max(tLow.x, tLow.y), max(tLow.z, 0.0));
+    float tExit = min(min(tHigh.x, tHigh.y), tHigh.z);
+    float t = max(tEnter, start);
+
+    if (t >= tExit) {
+#ifdef CONE_PREPASS
+        color = vec4(t, 0.0, 0.0, 0.0);
+        return;
+#else
+        discard;
+#endif
+    }
+    vec3 entry = origin + direction * t;
+    ivec3 cell = clamp(ivec3(floor((entry - gridMin) / cellSize)), ivec3(0), u_GridSize.xyz - 1);
+    ivec3 stepDirection = ivec3(sign(direction));
+    vec3 tDelta = cellSize * abs(inverse);
+    vec3 tNext = (gridMin + (vec3(cell) + step(0.0, direction)) * cellSize - origin) * inverse;
+
+    bool done = false;
+    int steps = 0;
+    while (!done && steps < MAX_STEPS) {
+        float tCellExit = min(min(tNext.x, tNext.y), min(tNext.z, tExit));
+        int index = (cell.z * u_GridSize.y + cell.y) * u_GridSize.x + cell.x;
+        uvec3 entries = texelFetch(u_Cells, TexelCoord(index), 0).xyz;
+        int first = int(entries.x);
+#ifdef CONE_PREPASS
+        float slope = u_Pass.y;
+        // Nothing reaches within a cell of an empty neighbourhood, so the
+        // cone crosses it whole while it is narrower than a cell
+        int count = int(entries.z);
+        if (count == 0 && tCellExit * slope >= cellSize)
+            break;
+        while (count > 0 && t < tCellExit && steps < MAX_STEPS) {
+            vec3 albedo;
+            float clear = min(SceneDistance(origin + direction * t, first, count, albedo), cellSize);
+            float radius = t * slope;
+            if (clear < radius * 1.5) {
+                done = true;
+                break;
+            }
+            t = min(t + (clear - radius) / (1.0 + slope), tCellExit);
+            steps++;
+        }
+#else
+        int count = int(entries.y);
+        while (count > 0 && t < tCellExit && steps < MAX_STEPS) {
+            vec3 p = origin + direction * t;
+            vec3 albedo;
+            float d = SceneDistance(p, first, count, albedo);
+            if (d < t * u_Eye.w) {
+                vec3 normal = SceneNormal(p, first, count, max(t * u_Eye.w, 1e-4));
+                float diffuse = max(dot(normal, u_SunDirection.xyz), 0.0);
+                float sky = 0.5 + 0.5 * normal.y;
+                color = vec4(albedo * (0.15 + 0.15 * sky + 0.7 * diffuse), 1.0);
+                return;
+            }
+            t = min(t + d, tCellExit);
+            steps++;
+        }
+#endif
+        if (done || tCellExit >= tExit)
+            break;
+        t = max(t, tCellExit);
+        if (tNext.x <= tNext.y && tNext.x <= tNext.z) {
+            cell.x += stepDirection.x;
+            tNext.x += tDelta.x;
+        } else if (tNext.y <= tNext.z) {
+            cell.y += stepDirection.y;
+            tNext.y += tDelta.y;
+        } else {
+            cell.z += stepDirection.z;
+            tNext.z += tDelta.z;
+        }
+        steps++;
+    }
+#ifdef CONE_PREPASS
+    color = vec4(t, 0.0, 0.0, 0.0);
+#else
+    discard;
+#endif
+}
@@ -0,0 +1,122 @@
+#shader vertex
+#version 330 core
+
+// One triangle covering the viewport
+layout(location = 0) in vec2 a_Position;
+
+void main() {
+    gl_Position = vec4(a_Position, 0.0, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+// Raymarches the volume of VolumeRenderer over the scene drawn before it.
+// The ray walks the brick grid: bricks the page table marks empty are
+// skipped whole, resident ones are sampled from their atlas slot and the
+// rest from the low-resolution fallback. It ends at the volume's far side,
+// at the scene's depth, or once practically opaque.
+
+layout(std140) uniform VolumeFrame {
+    mat4 u_InverseViewProj;
+    vec4 u_Eye;                // w: world distance between samples
+    vec4 u_BoundsMin;          // w: sample spacing in voxels, for opacity correction
+    vec4 u_VoxelSize;          // world size of a voxel
+    vec4 u_VolumeSize;         // voxels per axis
+    ivec4 u_BrickGrid;         // bricks per axis; w: voxels per brick side
+    vec4 u_AtlasScale;         // reciprocal atlas size in texels; w: stored brick side
+    vec4 u_FallbackScale;      // fallback texture coordinate per voxel
+    vec4 u_Viewport;
+};
+
+uniform sampler2D u_SceneColor;
+uniform sampler2D u_SceneDepth;
+uniform sampler3D u_Atlas;
+uniform usampler3D u_Pages;        // slot x, y, z; w: 0 empty, 1 resident, 2 fallback
+uniform sampler3D u_Fallback;
+uniform sampler2D u_Transfer;      // 256 x 1 RGBA, opacity per voxel
+
+out vec4 color;
+
+const float OPAQUE = 0.99;
+const float APRON = 1.0;
+const int MAX_BRICK_STEPS = 1024;
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec3 scene = texelFetch(u_SceneColor, pixel, 0).rgb;
+    float depth = texelFetch(u_SceneDepth, pixel, 0).r;
+    vec2 ndc = gl_FragCoord.xy / u_Viewport.xy * 2.0 - 1.0;
+    vec4 far = u_InverseViewProj * vec4(ndc, 1.0, 1.0);
+    vec3 origin = u_Eye.xyz;
+    vec3 direction = normalize(far.xyz / far.w - origin);
+    // Nothing behind the scene's surface is seen
+    float tScene = 1e30;
+    if (depth < 1.0) {
+        vec4 surface = u_InverseViewProj * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+        tScene = dot(surface.xyz / surface.w - origin, direction);
+    }
+
+    // March in voxel coordinates with t still in world units
+    vec3 voxelOrigin = (origin - u_BoundsMin.xyz) / u_VoxelSize.xyz;
+    vec3 voxelDirection = direction / u_VoxelSize.xyz;
+    // A zero component would make 0 * inf = NaN below
+    voxelDirection = mix(voxelDirection, vec3(1e-8), lessThan(abs(voxelDirection), vec3(1e-8)));
+    vec3 inverse = 1.0 / voxelDirection;
+    vec3 t0 = -voxelOrigin * inverse;
+    vec3 t1 = (u_VolumeSize.xyz - voxelOrigin) * inverse;
+    vec3 tLow = min(t0, t1), tHigh = max(t0, t1);
+    float tEnter = max(max(tLow.x, tLow.y), max(tLow.z, 0.0));
+    float tExit = min(min(min(tHigh.x, tHigh.y), tHigh.z), tScene);
+    if (tEnter >= tExit) {
+        color = vec4(scene, 1.0);
+        return;
+    }
+
+    float brickSide = float(u_BrickGrid.w);
+    float spacing = u_Eye.w;
+    vec3 entry = voxelOrigin + voxelDirection * tEnter;
+    ivec3 brick = clamp(ivec3(floor(entry / brickSide)), ivec3(0), u_BrickGrid.xyz - 1);
+    ivec3 stepDirection = ivec3(sign(voxelDirection));
+    vec3 tDelta = brickSide * abs(inverse);
+    vec3 tNext = ((vec3(brick) + step(0.0, voxelDirection)) * brickSide - voxelOrigin) * inverse;
+    // Jittered first sample: noise instead of wood-grain banding
+    float t = tEnter + spacing * fract(sin(dot(gl_FragCoord.xy, vec2(12.9898, 78.233))) * 43758.5453);
+
+    vec4 sum = vec4(0.0);
+    for (int i = 0; i < MAX_BRICK_STEPS; i++) {
+        float tBrickExit = min(min(tNext.x, tNext.y), min(tNext.z, tExit));
+        uvec4 page = texelFetch(u_Pages, brick, 0);
+        if (page.w != 0u) {
+            vec3 slot = vec3(page.xyz) * u_AtlasScale.w + APRON;
+            vec3 brickOrigin = vec3(brick) * brickSide;
+            for (; t < tBrickExit && sum.a < OPAQUE; t += spacing) {
+                vec3 voxel = voxelOrigin + voxelDirection * t;
+                float value;
+                if (page.w == 1u)
+                    value = texture(u_Atlas, (slot + clamp(voxel - brickOrigin, 0.0, brickSide)) * u_AtlasScale.xyz).r;
+                else
+                    value = texture(u_Fallback, voxel * u_FallbackScale.xyz).r;
+                vec4 point = texelFetch(u_Transfer, ivec2(int(value * 255.0 + 0.5), 0), 0);
+                if (point.a > 0.0) {
+                    float alpha = 1.0 - pow(1.0 - point.a, u_BoundsMin.w);
+                    sum += (1.0 - sum.a) * vec4(point.rgb * alpha, alpha);
+                }
+            }
+        }
+        if (sum.a >= OPAQUE || tBrickExit >= tExit)
+            break;
+        t = max(t, tBrickExit);
+        if (tNext.x <= tNext.y && tNext.x <= tNext.z) {
+            brick.x += stepDirection.x;
+            tNext.x += tDelta.x;
+        } else if (tNext.y <= tNext.z) {
+            brick.y += stepDirection.y;
+            tNext.y += tDelta.y;
+        } else {
+            brick.z += stepDirection.z;
+            tNext.z += tDelta.z;
+        }
+    }
+    color = vec4(sum.rgb + (1.0 - sum.a) * scene, 1.0);
+}
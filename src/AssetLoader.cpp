@@ -0,0 +1,153 @@
+#include "AssetLoader.h"
+#include "AssetPack.h"
+#include "AsyncIO.h"
+#include "HostMemory.h"
+#include "JobSystem.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+struct AssetLoader::Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+static std::optional<std::string> ReadPacked(const AssetPack& pack, const PackEntry& entry, JobSystem* jobs) {
+    std::string data(entry.Size, '\0');
+    if (!pack.Read(entry, data.data(), jobs))
+        return std::nullopt;
+    return data;
+}
+
+static std::optional<std::string> ReadWholeFile(const std::string& path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        std::cout << "[Asset Loader] cannot read " << path << std::endl;
+        return std::nullopt;
+    }
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+AssetLoader::AssetLoader(JobSystem* jobs, AsyncIO* io, const AssetPack* pack)
+    : m_Jobs(jobs), m_IO(io), m_Pack(pack), m_RenderThread(std::this_thread::get_id()) {
+}
+
+AssetLoader::Detached AssetLoader::Run(AssetLoader& loader, Task<void> task) {
+    co_await task;
+    loader.Finished();
+}
+
+void AssetLoader::Spawn(Task<void> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Pending++;
+    }
+    Run(*this, std::move(task));
+}
+
+void AssetLoader::Finished() {
+    // Notify under the lock: WaitAll may return, and the loader go away, as soon as it is released
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Pending--;
+    m_Wake.notify_all();
+}
+
+void AssetLoader::PumpRenderThread() {
+    std::vector<std::coroutine_handle<>> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        ready.swap(m_RenderQueue);
+    }
+    for (std::coroutine_handle<> handle : ready)
+        handle.resume();
+}
+
+void AssetLoader::WaitAll() {
+    while (true) {
+        PumpRenderThread();
+        // Pools without workers only make progress when someone runs their jobs
+        if (m_Jobs && m_Jobs->RunOne())
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if (m_Pending == 0 && m_RenderQueue.empty())
+            return;
+        // The timeout picks up jobs queued after RunOne found the queue empty
+        m_Wake.wait_for(lock, std::chrono::milliseconds(1), [this] { return !m_RenderQueue.empty() || m_Pending == 0; });
+    }
+}
+
+size_t AssetLoader::GetPendingCount() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Pending;
+}
+
+bool AssetLoader::ReadFileAwaiter::await_ready() {
+    if (const PackEntry* entry = Loader.m_Pack ? Loader.m_Pack->Find(Path) : nullptr) {
+        if (Loader.m_Jobs)
+            return false;
+        MemoryTagScope tag(MemoryTag::Streaming);
+        Data = ReadPacked(*Loader.m_Pack, *entry, nullptr);
+        return true;
+    }
+    if (Loader.m_Jobs || Loader.m_IO)
+        return false;
+    MemoryTagScope tag(MemoryTag::Streaming);
+    Data = ReadWholeFile(Path);
+    return true;
+}
+
+void AssetLoader::ReadFileAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    if (const PackEntry* entry = Loader.m_Pack ? Loader.m_Pack->Find(Path) : nullptr) {
+        // The pack is already mapped, so this is pure decompression; large
+        // assets fan their blocks out across the pool
+        Loader.m_Jobs->Enqueue([this, handle, entry] {
+            MemoryTagScope tag(MemoryTag::Streaming);
+            Data = ReadPacked(*Loader.m_Pack, *entry, Loader.m_Jobs);
+            handle.resume();
+        });
+        return;
+    }
+    if (Loader.m_IO) {
+        // Resumes on whichever thread AsyncIO runs completions on
+        Loader.m_IO->ReadFile(Path, [this, handle](const IoResult& result, std::string&& data) {
+            MemoryTagScope tag(MemoryTag::Streaming);
+            if (result.Error == 0)
+                Data = std::move(data);
+            else
+                std::cout << "[Asset Loader] cannot read " << Path << ": " << std::strerror(result.Error) << std::endl;
+            handle.resume();
+        });
+        return;
+    }
+    Loader.m_Jobs->Enqueue([this, handle] {
+        MemoryTagScope tag(MemoryTag::Streaming);
+        Data = ReadWholeFile(Path);
+        handle.resume();
+    });
+}
+
+bool AssetLoader::JobAwaiter::await_ready() const {
+    return !Loader.m_Jobs;
+}
+
+void AssetLoader::JobAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    Loader.m_Jobs->Enqueue([handle] {
+        MemoryTagScope tag(MemoryTag::Streaming);
+        handle.resume();
+    });
+}
+
+void AssetLoader::RenderThreadAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    std::lock_guard<std::mutex> lock(Loader.m_Mutex);
+    Loader.m_RenderQueue.push_back(handle);
+    Loader.m_Wake.notify_all();
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Task.h"
+
+#include <condition_variable>
+#include <coroutine>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+class AsyncIO;
+class AssetPack;
+
+// Runs asset load pipelines written as coroutines:
+//
+//     Task<void> LoadThing(AssetLoader& loader, ...) {
+//         std::optional<std::string> file = co_await loader.ReadFile(path);  // I/O
+//         co_await loader.SwitchToJobs();                                    // decode on a worker
+//         ...
+//         co_await loader.SwitchToRenderThread();                            // GL work
+//     }
+//
+// Every pipeline passed to Spawn runs concurrently with the others, so one
+// asset's read, another's decode and a third's upload overlap. Paths found
+// in the AssetPack, when one is given, are decompressed from it on a worker.
+// Other reads go through AsyncIO when one is given, otherwise they are
+// blocking reads on a worker. Without a JobSystem or AsyncIO everything runs
+// inline on the render thread.
+class AssetLoader {
+public:
+    // The constructing thread becomes the render thread
+    explicit AssetLoader(JobSystem* jobs, AsyncIO* io = nullptr, const AssetPack* pack = nullptr);
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // Starts the pipeline now; it runs until its first suspension on this thread
+    void Spawn(Task<void> task);
+    // Render thread. Resumes pipelines waiting for it, helps run jobs and
+    // returns once every spawned pipeline has finished.
+    void WaitAll();
+    // Render thread. Resumes pipelines waiting for it without blocking, for
+    // loading in the background of a running frame loop.
+    void PumpRenderThread();
+    size_t GetPendingCount() const;
+
+    struct ReadFileAwaiter {
+        AssetLoader& Loader;
+        std::string Path;
+        std::optional<std::string> Data;
+
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> handle);
+        std::optional<std::string> await_resume() { return std::move(Data); }
+    };
+    struct JobAwaiter {
+        AssetLoader& Loader;
+
+        bool await_ready() const;
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const {}
+    };
+    struct RenderThreadAwaiter {
+        AssetLoader& Loader;
+
+        bool await_ready() const { return std::this_thread::get_id() == Loader.m_RenderThread; }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const {}
+    };
+
+    // Whole file contents, or nullopt (after logging) if it cannot be read
+    ReadFileAwaiter ReadFile(std::string path) { return { *this, std::move(path), std::nullopt }; }
+    // Continues the coroutine on a job system worker
+    JobAwaiter SwitchToJobs() { return { *this }; }
+    // Continues the coroutine on the render thread, at its next Pump/WaitAll
+    RenderThreadAwaiter SwitchToRenderThread() { return { *this }; }
+
+private:
+    struct Detached;
+    static Detached Run(AssetLoader& loader, Task<void> task);
+    void Finished();
+
+    JobSystem* m_Jobs;
+    AsyncIO* m_IO;
+    const AssetPack* m_Pack;
+    std::thread::id m_RenderThread;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::vector<std::coroutine_handle<>> m_RenderQueue;
+    size_t m_Pending = 0;
+};
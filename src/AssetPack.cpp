@@ -0,0 +1,153 @@
+#include "AssetPack.h"
+#include "JobSystem.h"
+#include "Lz4.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+AssetPack::~AssetPack() {
+    Close();
+}
+
+bool AssetPack::Open(const std::string& path) {
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(PackHeader)) {
+        close(fd);
+        std::cout << "[Asset Pack] " << path << " is too small to be a pack" << std::endl;
+        return false;
+    }
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file alive
+    close(fd);
+    if (data == MAP_FAILED) {
+        std::cout << "[Asset Pack] cannot map " << path << std::endl;
+        return false;
+    }
+    m_Data = static_cast<const uint8_t*>(data);
+    m_Size = static_cast<size_t>(info.st_size);
+    m_Path = path;
+
+    // Validate every table once so lookups and reads can trust them
+    m_Header = reinterpret_cast<const PackHeader*>(m_Data);
+    uint64_t entriesEnd = sizeof(PackHeader) + uint64_t(m_Header->AssetCount) * sizeof(PackEntry);
+    uint64_t blocksEnd = entriesEnd + uint64_t(m_Header->BlockCount) * sizeof(PackBlock);
+    uint64_t namesEnd = blocksEnd + m_Header->NamesSize;
+    const char* error = nullptr;
+    if (std::memcmp(m_Header->Magic, ASSET_PACK_MAGIC, sizeof(m_Header->Magic)) != 0)
+        error = "bad magic";
+    else if (m_Header->Version != ASSET_PACK_VERSION)
+        error = "unsupported version";
+    else if (namesEnd > m_Size || m_Header->DataOffset < namesEnd || m_Header->DataOffset > m_Size)
+        error = "truncated tables";
+
+    if (!error) {
+        m_Entries = reinterpret_cast<const PackEntry*>(m_Data + sizeof(PackHeader));
+        m_Blocks = reinterpret_cast<const PackBlock*>(m_Data + entriesEnd);
+        m_Names = reinterpret_cast<const char*>(m_Data + blocksEnd);
+        for (uint32_t i = 0; i < m_Header->AssetCount && !error; i++) {
+            const PackEntry& entry = m_Entries[i];
+            uint64_t expectedBlocks = (entry.Size + ASSET_PACK_BLOCK_SIZE - 1) / ASSET_PACK_BLOCK_SIZE;
+            if (uint64_t(entry.NameOffset) + entry.NameLength > m_Header->NamesSize)
+                error = "name out of range";
+            else if (entry.BlockCount != expectedBlocks || uint64_t(entry.FirstBlock) + entry.BlockCount > m_Header->BlockCount)
+                error = "block range out of range";
+            else if (i > 0 && GetName(m_Entries[i - 1]) >= GetName(entry))
+                error = "index not sorted";
+        }
+        for (uint32_t i = 0; i < m_Header->BlockCount && !error; i++) {
+            const PackBlock& block = m_Blocks[i];
+            if (block.Offset < m_Header->DataOffset || block.Offset + block.StoredSize > m_Size)
+                error = "block out of range";
+            else if (block.Compression != PackCompression::Stored && block.Compression != PackCompression::Lz4)
+                error = "unknown compression";
+        }
+    }
+    if (error) {
+        std::cout << "[Asset Pack] " << path << ": " << error << std::endl;
+        Close();
+        return false;
+    }
+
+    // Blocks are read in index order at startup
+    madvise(const_cast<uint8_t*>(m_Data), m_Size, MADV_WILLNEED);
+    return true;
+}
+
+void AssetPack::Close() {
+    if (m_Data)
+        munmap(const_cast<uint8_t*>(m_Data), m_Size);
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Header = nullptr;
+    m_Entries = nullptr;
+    m_Blocks = nullptr;
+    m_Names = nullptr;
+}
+
+std::string_view AssetPack::GetName(const PackEntry& entry) const {
+    return std::string_view(m_Names + entry.NameOffset, entry.NameLength);
+}
+
+const PackEntry* AssetPack::Find(std::string_view name) const {
+    if (!m_Header)
+        return nullptr;
+    const PackEntry* end = m_Entries + m_Header->AssetCount;
+    const PackEntry* it = std::lower_bound(m_Entries, end, name, [this](const PackEntry& entry, std::string_view value) {
+        return GetName(entry) < value;
+    });
+    return it != end && GetName(*it) == name ? it : nullptr;
+}
+
+bool AssetPack::ReadBlock(const PackEntry& entry, uint32_t block, char* out) const {
+    const PackBlock& stored = m_Blocks[entry.FirstBlock + block];
+    uint64_t rawOffset = uint64_t(block) * ASSET_PACK_BLOCK_SIZE;
+    size_t rawSize = static_cast<size_t>(std::min<uint64_t>(ASSET_PACK_BLOCK_SIZE, entry.Size - rawOffset));
+    const uint8_t* source = m_Data + stored.Offset;
+
+    if (stored.Compression == PackCompression::Stored) {
+        if (stored.StoredSize != rawSize)
+            return false;
+        std::memcpy(out + rawOffset, source, rawSize);
+        return true;
+    }
+    return Lz4Decompress(source, stored.StoredSize, out + rawOffset, rawSize) == static_cast<long long>(rawSize);
+}
+
+bool AssetPack::Read(const PackEntry& entry, void* out, JobSystem* jobs) const {
+    char* destination = static_cast<char*>(out);
+    bool ok = true;
+    if (jobs && entry.BlockCount > 1) {
+        std::atomic<bool> failed{ false };
+        jobs->Dispatch(entry.BlockCount, [&](unsigned int block) {
+            if (!ReadBlock(entry, block, destination))
+                failed.store(true, std::memory_order_relaxed);
+        });
+        ok = !failed.load();
+    } else {
+        for (uint32_t block = 0; block < entry.BlockCount && ok; block++)
+            ok = ReadBlock(entry, block, destination);
+    }
+    if (!ok)
+        std::cout << "[Asset Pack] corrupt block in " << GetName(entry) << " (" << m_Path << ")" << std::endl;
+    return ok;
+}
+
+bool AssetPack::Read(std::string_view name, std::string& out, JobSystem* jobs) const {
+    const PackEntry* entry = Find(name);
+    if (!entry)
+        return false;
+    out.resize(entry->Size);
+    return Read(*entry, out.data(), jobs);
+}
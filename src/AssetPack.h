@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class JobSystem;
+
+// Single-file archive for everything under res/, built by tools/AssetPacker.
+//
+//     PackHeader
+//     PackEntry[AssetCount]     sorted by name for binary search
+//     PackBlock[BlockCount]     each asset's blocks are contiguous
+//     names                     UTF-8, not terminated
+//     padding to ASSET_PACK_ALIGNMENT
+//     block data                every block starts ASSET_PACK_ALIGNMENT aligned
+//
+// Assets are split into ASSET_PACK_BLOCK_SIZE blocks that compress
+// independently, so a large asset decompresses on every worker at once and
+// any block can be fetched with an O_DIRECT read. All integers are little endian.
+#define ASSET_PACK_MAGIC "MGLPACK1"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_BLOCK_SIZE (64 * 1024)
+#define ASSET_PACK_ALIGNMENT 4096
+// Read when no --pack is given; loose files are used if it does not exist
+#define ASSET_PACK_DEFAULT_PATH "assets.pack"
+
+enum class PackCompression : uint32_t {
+    Stored = 0,
+    Lz4 = 1
+};
+
+struct PackHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t AssetCount;
+    uint32_t BlockCount;
+    uint32_t NamesSize;
+    uint64_t DataOffset;
+};
+
+struct PackEntry {
+    uint32_t NameOffset;
+    uint32_t NameLength;
+    uint64_t Size;                 // uncompressed bytes
+    uint32_t FirstBlock;
+    uint32_t BlockCount;
+};
+
+struct PackBlock {
+    uint64_t Offset;               // from the start of the file
+    uint32_t StoredSize;           // bytes in the file; the raw size is ASSET_PACK_BLOCK_SIZE except for an asset's last block
+    PackCompression Compression;
+};
+
+// Read-only view of a pack mapped into memory. Lookups and reads are thread safe.
+class AssetPack {
+public:
+    AssetPack() = default;
+    ~AssetPack();
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // Maps and validates the pack; logs and returns false if it is missing or malformed
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return m_Data != nullptr; }
+
+    const PackEntry* Find(std::string_view name) const;
+    std::string_view GetName(const PackEntry& entry) const;
+    uint32_t GetAssetCount() const { return m_Header ? m_Header->AssetCount : 0; }
+    const PackEntry& GetEntry(uint32_t index) const { return m_Entries[index]; }
+
+    // Decompresses the asset into `out` (entry.Size bytes), one block per job
+    // when there are several. Returns false and logs on corrupt blocks.
+    bool Read(const PackEntry& entry, void* out, JobSystem* jobs) const;
+    bool Read(std::string_view name, std::string& out, JobSystem* jobs) const;
+
+private:
+    bool ReadBlock(const PackEntry& entry, uint32_t block, char* out) const;
+
+    const uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+    std::string m_Path;
+    const PackHeader* m_Header = nullptr;
+    const PackEntry* m_Entries = nullptr;
+    const PackBlock* m_Blocks = nullptr;
+    const char* m_Names = nullptr;
+};
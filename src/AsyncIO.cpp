@@ -0,0 +1,398 @@
+#include "AsyncIO.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define ASYNC_IO_URING 1
+#endif
+
+// user_data of the no-op that wakes the completion thread for shutdown
+#define ASYNC_IO_WAKE_TAG ~0ull
+
+IoBuffer::IoBuffer(size_t size)
+    : m_Data(static_cast<unsigned char*>(std::aligned_alloc(ASYNC_IO_DIRECT_ALIGNMENT,
+          (size + ASYNC_IO_DIRECT_ALIGNMENT - 1) / ASYNC_IO_DIRECT_ALIGNMENT * ASYNC_IO_DIRECT_ALIGNMENT))),
+      m_Size(size) {
+}
+
+IoBuffer::~IoBuffer() {
+    std::free(m_Data);
+}
+
+IoBuffer::IoBuffer(IoBuffer&& other) noexcept
+    : m_Data(std::exchange(other.m_Data, nullptr)), m_Size(std::exchange(other.m_Size, 0)) {
+}
+
+IoBuffer& IoBuffer::operator=(IoBuffer&& other) noexcept {
+    if (this != &other) {
+        std::free(m_Data);
+        m_Data = std::exchange(other.m_Data, nullptr);
+        m_Size = std::exchange(other.m_Size, 0);
+    }
+    return *this;
+}
+
+AsyncIO::AsyncIO(JobSystem* jobs, bool allowUring) : m_Jobs(jobs) {
+    m_Slots.resize(ASYNC_IO_QUEUE_DEPTH);
+    for (unsigned int i = 0; i < ASYNC_IO_QUEUE_DEPTH; i++)
+        m_FreeSlots.push_back(ASYNC_IO_QUEUE_DEPTH - 1 - i);
+
+    if (allowUring && SetupRing())
+        m_Reaper = std::thread(&AsyncIO::ReapLoop, this);
+}
+
+AsyncIO::~AsyncIO() {
+    WaitIdle();
+#ifdef ASYNC_IO_URING
+    if (m_RingFd >= 0) {
+        m_Quit = true;
+        {
+            std::lock_guard<std::mutex> lock(m_SubmitMutex);
+            io_uring_sqe* sqe = &static_cast<io_uring_sqe*>(m_Sqes)[*m_SqTail & *m_SqMask];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_NOP;
+            sqe->user_data = ASYNC_IO_WAKE_TAG;
+            m_SqArray[*m_SqTail & *m_SqMask] = *m_SqTail & *m_SqMask;
+            __atomic_store_n(m_SqTail, *m_SqTail + 1, __ATOMIC_RELEASE);
+            m_Unsubmitted++;
+        }
+        FlushSubmissions();
+        m_Reaper.join();
+
+        UnregisterBuffers();
+        munmap(m_Sqes, m_SqesSize);
+        if (m_CqRing != m_SqRing)
+            munmap(m_CqRing, m_CqRingSize);
+        munmap(m_SqRing, m_SqRingSize);
+        close(m_RingFd);
+    }
+#endif
+}
+
+const char* AsyncIO::GetBackendName() const {
+    if (UsesUring())
+        return m_Registered ? "io_uring (registered buffers)" : "io_uring";
+    return m_Jobs ? "thread pool" : "inline";
+}
+
+bool AsyncIO::SetupRing() {
+#ifdef ASYNC_IO_URING
+    io_uring_params params = {};
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, ASYNC_IO_QUEUE_DEPTH, &params));
+    if (fd < 0)
+        return false;
+
+    // IORING_OP_READ needs 5.6; older kernels and seccomp sandboxes fall back to the pool
+    size_t probeSize = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+    std::unique_ptr<unsigned char[]> probeStorage(new unsigned char[probeSize]());
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probeStorage.get());
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0 ||
+        probe->last_op < IORING_OP_READ || !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)) {
+        close(fd);
+        return false;
+    }
+
+    m_SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    m_CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap)
+        m_SqRingSize = m_CqRingSize = std::max(m_SqRingSize, m_CqRingSize);
+
+    m_SqRing = mmap(nullptr, m_SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (m_SqRing == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    m_CqRing = singleMap ? m_SqRing
+                         : mmap(nullptr, m_CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    m_SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_Sqes = mmap(nullptr, m_SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (m_CqRing == MAP_FAILED || m_Sqes == MAP_FAILED) {
+        if (m_Sqes != MAP_FAILED)
+            munmap(m_Sqes, m_SqesSize);
+        if (m_CqRing != MAP_FAILED && m_CqRing != m_SqRing)
+            munmap(m_CqRing, m_CqRingSize);
+        munmap(m_SqRing, m_SqRingSize);
+        close(fd);
+        return false;
+    }
+
+    unsigned char* sq = static_cast<unsigned char*>(m_SqRing);
+    unsigned char* cq = static_cast<unsigned char*>(m_CqRing);
+    m_SqHead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+    m_SqTail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+    m_SqMask = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+    m_SqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+    m_CqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+    m_CqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+    m_CqMask = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+    m_Cqes = cq + params.cq_off.cqes;
+    m_RingFd = fd;
+    return true;
+#else
+    return false;
+#endif
+}
+
+IoFile AsyncIO::Open(const std::string& path, bool direct) {
+    IoFile file;
+#ifdef O_DIRECT
+    if (direct) {
+        file.Fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+        file.Direct = file.Fd >= 0;
+    }
+#endif
+    if (file.Fd < 0)
+        file.Fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file.Fd < 0) {
+        file.Error = errno;
+        std::cout << "[Async IO] cannot open " << path << ": " << std::strerror(file.Error) << std::endl;
+        return file;
+    }
+    struct stat info;
+    if (fstat(file.Fd, &info) == 0)
+        file.Size = static_cast<size_t>(info.st_size);
+    return file;
+}
+
+void AsyncIO::Close(IoFile& file) {
+    if (file.Fd >= 0)
+        close(file.Fd);
+    file = {};
+}
+
+bool AsyncIO::RegisterBuffers(void* const* buffers, const size_t* sizes, unsigned int count) {
+#ifdef ASYNC_IO_URING
+    if (!UsesUring())
+        return false;
+    WaitIdle();
+    UnregisterBuffers();
+    std::vector<iovec> vectors(count);
+    for (unsigned int i = 0; i < count; i++)
+        vectors[i] = { buffers[i], sizes[i] };
+    m_Registered = syscall(__NR_io_uring_register, m_RingFd, IORING_REGISTER_BUFFERS, vectors.data(), count) == 0;
+    if (!m_Registered)
+        std::cout << "[Async IO] buffer registration refused: " << std::strerror(errno) << std::endl;
+    return m_Registered;
+#else
+    return false;
+#endif
+}
+
+void AsyncIO::UnregisterBuffers() {
+#ifdef ASYNC_IO_URING
+    if (m_Registered) {
+        WaitIdle();
+        syscall(__NR_io_uring_register, m_RingFd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        m_Registered = false;
+    }
+#endif
+}
+
+unsigned int AsyncIO::AcquireSlot() {
+    std::unique_lock<std::mutex> lock(m_SlotMutex);
+    if (m_FreeSlots.empty()) {
+        // Reads queued but not yet submitted may be holding every slot
+        lock.unlock();
+        FlushSubmissions();
+        lock.lock();
+        m_SlotFree.wait(lock, [this] { return !m_FreeSlots.empty(); });
+    }
+    unsigned int slot = m_FreeSlots.back();
+    m_FreeSlots.pop_back();
+    return slot;
+}
+
+void AsyncIO::QueueRead(unsigned int slot) {
+#ifdef ASYNC_IO_URING
+    Slot& entry = m_Slots[slot];
+    const IoRead& read = entry.Read;
+    std::lock_guard<std::mutex> lock(m_SubmitMutex);
+    unsigned int tail = *m_SqTail;
+    unsigned int index = tail & *m_SqMask;
+    io_uring_sqe* sqe = &static_cast<io_uring_sqe*>(m_Sqes)[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    bool fixed = m_Registered && read.RegisteredBuffer >= 0;
+    sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = read.Fd;
+    sqe->off = read.Offset + entry.Done;
+    sqe->addr = reinterpret_cast<uint64_t>(static_cast<unsigned char*>(read.Buffer) + entry.Done);
+    // One SQE moves at most 2 GB; the remainder is resubmitted like a short read
+    sqe->len = static_cast<unsigned int>(std::min<size_t>(read.Size - entry.Done, 1u << 31));
+    if (fixed)
+        sqe->buf_index = static_cast<uint16_t>(read.RegisteredBuffer);
+    sqe->user_data = slot;
+    m_SqArray[index] = index;
+    __atomic_store_n(m_SqTail, tail + 1, __ATOMIC_RELEASE);
+    m_Unsubmitted++;
+#else
+    (void)slot;
+#endif
+}
+
+void AsyncIO::FlushSubmissions() {
+#ifdef ASYNC_IO_URING
+    std::lock_guard<std::mutex> lock(m_SubmitMutex);
+    while (m_Unsubmitted > 0) {
+        long submitted = syscall(__NR_io_uring_enter, m_RingFd, m_Unsubmitted, 0, 0, nullptr, 0);
+        if (submitted < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                continue;
+            std::cout << "[Async IO] io_uring_enter failed: " << std::strerror(errno) << std::endl;
+            return;
+        }
+        m_Unsubmitted -= static_cast<unsigned int>(submitted);
+    }
+#endif
+}
+
+void AsyncIO::Submit(IoRead* reads, size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(m_IdleMutex);
+        m_InFlight += count;
+    }
+    if (!UsesUring()) {
+        for (size_t i = 0; i < count; i++) {
+            if (m_Jobs)
+                m_Jobs->Enqueue([this, read = std::move(reads[i])]() mutable { ReadBlocking(std::move(read)); });
+            else
+                ReadBlocking(std::move(reads[i]));
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        unsigned int slot = AcquireSlot();
+        m_Slots[slot].Read = std::move(reads[i]);
+        m_Slots[slot].Done = 0;
+        QueueRead(slot);
+    }
+    FlushSubmissions();
+}
+
+void AsyncIO::ReadBlocking(IoRead&& read) {
+    IoResult result;
+    while (result.Bytes < read.Size) {
+        ssize_t bytes = pread(read.Fd, static_cast<unsigned char*>(read.Buffer) + result.Bytes,
+                              read.Size - result.Bytes, static_cast<off_t>(read.Offset + result.Bytes));
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        // Like pread itself, an error after partial progress reports the bytes read
+        if (bytes < 0 && result.Bytes == 0)
+            result.Error = errno;
+        if (bytes <= 0)
+            break;
+        result.Bytes += static_cast<size_t>(bytes);
+    }
+    Complete(std::move(read), result);
+}
+
+void AsyncIO::Complete(IoRead&& read, const IoResult& result) {
+    if (read.OnComplete)
+        read.OnComplete(result);
+    std::lock_guard<std::mutex> lock(m_IdleMutex);
+    if (--m_InFlight == 0)
+        m_Idle.notify_all();
+}
+
+void AsyncIO::WaitIdle() {
+    std::unique_lock<std::mutex> lock(m_IdleMutex);
+    while (m_InFlight > 0) {
+        // A pool without workers only runs completion jobs when asked to
+        if (m_Jobs) {
+            lock.unlock();
+            bool ran = m_Jobs->RunOne();
+            lock.lock();
+            if (ran)
+                continue;
+        }
+        m_Idle.wait_for(lock, std::chrono::milliseconds(1));
+    }
+}
+
+void AsyncIO::ReapLoop() {
+#ifdef ASYNC_IO_URING
+    bool quit = false;
+    while (!quit) {
+        if (syscall(__NR_io_uring_enter, m_RingFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+            std::cout << "[Async IO] waiting for completions failed: " << std::strerror(errno) << std::endl;
+            return;
+        }
+
+        unsigned int head = *m_CqHead;
+        unsigned int tail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            const io_uring_cqe& cqe = static_cast<io_uring_cqe*>(m_Cqes)[head & *m_CqMask];
+            if (cqe.user_data == ASYNC_IO_WAKE_TAG) {
+                quit = m_Quit;
+                continue;
+            }
+            unsigned int slot = static_cast<unsigned int>(cqe.user_data);
+            Slot& entry = m_Slots[slot];
+            if (cqe.res > 0) {
+                entry.Done += static_cast<size_t>(cqe.res);
+                if (entry.Done < entry.Read.Size) {
+                    // Short read before the end of the request: ask for the rest
+                    QueueRead(slot);
+                    FlushSubmissions();
+                    continue;
+                }
+            }
+
+            IoResult result;
+            result.Bytes = entry.Done;
+            // An error on the resubmitted tail (EINVAL past EOF under O_DIRECT) still delivers what was read
+            result.Error = cqe.res < 0 && entry.Done == 0 ? -cqe.res : 0;
+            IoRead read = std::move(entry.Read);
+            {
+                std::lock_guard<std::mutex> lock(m_SlotMutex);
+                m_FreeSlots.push_back(slot);
+            }
+            m_SlotFree.notify_one();
+
+            if (m_Jobs)
+                m_Jobs->Enqueue([this, read = std::move(read), result]() mutable { Complete(std::move(read), result); });
+            else
+                Complete(std::move(read), result);
+        }
+        __atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+    }
+#endif
+}
+
+void AsyncIO::ReadFile(const std::string& path, std::function<void(const IoResult&, std::string&&)> onComplete) {
+    IoFile file = Open(path);
+    if (file.Fd < 0) {
+        IoResult result;
+        result.Error = file.Error;
+        onComplete(result, std::string());
+        return;
+    }
+
+    auto data = std::make_shared<std::string>(file.Size, '\0');
+    IoRead read;
+    read.Fd = file.Fd;
+    read.Buffer = data->data();
+    read.Size = file.Size;
+    read.OnComplete = [this, file, data, onComplete = std::move(onComplete)](const IoResult& result) mutable {
+        Close(file);
+        data->resize(result.Bytes);
+        onComplete(result, std::move(*data));
+    };
+    Submit(&read, 1);
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Reads in flight at once; further submissions wait for a free slot
+#define ASYNC_IO_QUEUE_DEPTH 64
+// O_DIRECT offsets, sizes and buffers must be multiples of the device's
+// logical block size; 4096 covers every common device
+#define ASYNC_IO_DIRECT_ALIGNMENT 4096
+
+struct IoResult {
+    int Error = 0;                 // errno value, 0 on success
+    size_t Bytes = 0;              // less than requested only at end of file
+};
+
+struct IoRead {
+    int Fd = -1;
+    uint64_t Offset = 0;
+    void* Buffer = nullptr;
+    size_t Size = 0;
+    int RegisteredBuffer = -1;     // index passed to RegisterBuffers, or -1
+    std::function<void(const IoResult&)> OnComplete;
+};
+
+struct IoFile {
+    int Fd = -1;
+    size_t Size = 0;
+    bool Direct = false;           // opened with O_DIRECT; reads must be ASYNC_IO_DIRECT_ALIGNMENT aligned
+    int Error = 0;                 // errno value when Fd is -1
+};
+
+// Heap block aligned for O_DIRECT
+class IoBuffer {
+public:
+    IoBuffer() = default;
+    explicit IoBuffer(size_t size);
+    ~IoBuffer();
+
+    IoBuffer(IoBuffer&& other) noexcept;
+    IoBuffer& operator=(IoBuffer&& other) noexcept;
+    IoBuffer(const IoBuffer&) = delete;
+    IoBuffer& operator=(const IoBuffer&) = delete;
+
+    unsigned char* Data() const { return m_Data; }
+    size_t Size() const { return m_Size; }
+
+private:
+    unsigned char* m_Data = nullptr;
+    size_t m_Size = 0;
+};
+
+// Asynchronous file reads. On Linux with io_uring available, a batch of
+// reads is queued and submitted with one system call and a completion
+// thread reaps the results; otherwise every read is a pread() on the job
+// system (or inline without one). Either way each completion callback runs
+// as a job, or on the completion thread when there is no job system.
+class AsyncIO {
+public:
+    explicit AsyncIO(JobSystem* jobs, bool allowUring = true);
+    ~AsyncIO();
+
+    AsyncIO(const AsyncIO&) = delete;
+    AsyncIO& operator=(const AsyncIO&) = delete;
+
+    bool UsesUring() const { return m_RingFd >= 0; }
+    const char* GetBackendName() const;
+
+    // direct asks for O_DIRECT, falling back to buffered I/O on filesystems
+    // that refuse it; check IoFile::Direct. Fd is -1 if the file cannot be opened,
+    // with the reason in IoFile::Error.
+    IoFile Open(const std::string& path, bool direct = false);
+    void Close(IoFile& file);
+
+    // Pins buffers with the kernel once so reads into them skip the per-I/O
+    // page mapping. Replaces any previous set; false (and plain reads are
+    // used) when the backend or the memlock limit does not allow it.
+    bool RegisterBuffers(void* const* buffers, const size_t* sizes, unsigned int count);
+    void UnregisterBuffers();
+
+    // Queues every read and submits the batch; callbacks may run before this returns
+    void Submit(IoRead* reads, size_t count);
+    // Blocks until every submitted read has completed and its callback has returned
+    void WaitIdle();
+
+    // Whole-file convenience; the callback receives the contents
+    void ReadFile(const std::string& path, std::function<void(const IoResult&, std::string&&)> onComplete);
+
+private:
+    struct Slot {
+        IoRead Read;
+        size_t Done = 0;           // bytes already read, for resubmitting short reads
+    };
+
+    bool SetupRing();
+    void ReapLoop();
+    unsigned int AcquireSlot();
+    void QueueRead(unsigned int slot);
+    void FlushSubmissions();
+    void Complete(IoRead&& read, const IoResult& result);
+    void ReadBlocking(IoRead&& read);
+
+    JobSystem* m_Jobs;
+
+    int m_RingFd = -1;
+    void* m_SqRing = nullptr;
+    void* m_CqRing = nullptr;
+    void* m_Sqes = nullptr;
+    size_t m_SqRingSize = 0;
+    size_t m_CqRingSize = 0;
+    size_t m_SqesSize = 0;
+    unsigned int* m_SqHead = nullptr;
+    unsigned int* m_SqTail = nullptr;
+    unsigned int* m_SqMask = nullptr;
+    unsigned int* m_SqArray = nullptr;
+    unsigned int* m_CqHead = nullptr;
+    unsigned int* m_CqTail = nullptr;
+    unsigned int* m_CqMask = nullptr;
+    void* m_Cqes = nullptr;
+    bool m_Registered = false;
+
+    std::mutex m_SubmitMutex;
+    unsigned int m_Unsubmitted = 0;
+
+    std::mutex m_SlotMutex;
+    std::condition_variable m_SlotFree;
+    std::vector<Slot> m_Slots;
+    std::vector<unsigned int> m_FreeSlots;
+
+    std::mutex m_IdleMutex;
+    std::condition_variable m_Idle;
+    size_t m_InFlight = 0;
+
+    std::thread m_Reaper;
+    std::atomic<bool> m_Quit = false;
+};
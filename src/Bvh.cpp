@@ -0,0 +1,238 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+BvhRay::BvhRay(const glm::vec3& origin, const glm::vec3& direction)
+    : Origin(origin), Direction(direction) {
+    // A zero component would make 0 * inf = NaN in the slab test
+    for (int axis = 0; axis < 3; axis++) {
+        float d = direction[axis];
+        InvDirection[axis] = 1.0f / (std::fabs(d) > 1e-20f ? d : std::copysign(1e-20f, d));
+    }
+}
+
+BvhRayPacket::BvhRayPacket(const BvhRay* rays) {
+    OriginX = _mm_setr_ps(rays[0].Origin.x, rays[1].Origin.x, rays[2].Origin.x, rays[3].Origin.x);
+    OriginY = _mm_setr_ps(rays[0].Origin.y, rays[1].Origin.y, rays[2].Origin.y, rays[3].Origin.y);
+    OriginZ = _mm_setr_ps(rays[0].Origin.z, rays[1].Origin.z, rays[2].Origin.z, rays[3].Origin.z);
+    DirectionX = _mm_setr_ps(rays[0].Direction.x, rays[1].Direction.x, rays[2].Direction.x, rays[3].Direction.x);
+    DirectionY = _mm_setr_ps(rays[0].Direction.y, rays[1].Direction.y, rays[2].Direction.y, rays[3].Direction.y);
+    DirectionZ = _mm_setr_ps(rays[0].Direction.z, rays[1].Direction.z, rays[2].Direction.z, rays[3].Direction.z);
+    InvDirectionX = _mm_setr_ps(rays[0].InvDirection.x, rays[1].InvDirection.x, rays[2].InvDirection.x, rays[3].InvDirection.x);
+    InvDirectionY = _mm_setr_ps(rays[0].InvDirection.y, rays[1].InvDirection.y, rays[2].InvDirection.y, rays[3].InvDirection.y);
+    InvDirectionZ = _mm_setr_ps(rays[0].InvDirection.z, rays[1].InvDirection.z, rays[2].InvDirection.z, rays[3].InvDirection.z);
+}
+
+struct BvhBuildNode {
+    BvhBounds Bounds;
+    uint32_t Left = 0, Right = 0;  // children while Count == 0
+    uint32_t First = 0, Count = 0;
+};
+
+struct BvhBuilder {
+    const std::vector<BvhBounds>& Primitives;
+    std::vector<glm::vec3> Centers;
+    std::vector<uint32_t>& Order;
+    std::vector<BvhBuildNode> Nodes;
+
+    uint32_t Build(uint32_t first, uint32_t count) {
+        uint32_t index = static_cast<uint32_t>(Nodes.size());
+        Nodes.emplace_back();
+        BvhBounds bounds, centers;
+        for (uint32_t i = first; i < first + count; i++) {
+            bounds.Grow(Primitives[Order[i]]);
+            centers.Grow(Centers[Order[i]]);
+        }
+        Nodes[index].Bounds = bounds;
+
+        uint32_t split = count <= 1 ? 0 : Split(first, count, bounds, centers);
+        if (split == 0) {
+            Nodes[index].First = first;
+            Nodes[index].Count = count;
+            return index;
+        }
+        uint32_t left = Build(first, split);
+        uint32_t right = Build(first + split, count - split);
+        Nodes[index].Left = left;
+        Nodes[index].Right = right;
+        return index;
+    }
+
+    // Partitions the range at the cheapest binned SAH split and returns the
+    // size of the left half, or 0 when a leaf is cheaper
+    uint32_t Split(uint32_t first, uint32_t count, const BvhBounds& bounds, const BvhBounds& centers) {
+        struct Bin {
+            BvhBounds Bounds;
+            uint32_t Count = 0;
+        };
+        float bestCost = FLT_MAX;
+        int bestAxis = -1, bestBin = 0;
+        for (int axis = 0; axis < 3; axis++) {
+            float extent = centers.Max[axis] - centers.Min[axis];
+            if (extent <= 0.0f)
+                continue;
+            float scale = BVH_SAH_BINS / extent;
+            Bin bins[BVH_SAH_BINS];
+            for (uint32_t i = first; i < first + count; i++) {
+                int bin = std::min(BVH_SAH_BINS - 1, static_cast<int>((Centers[Order[i]][axis] - centers.Min[axis]) * scale));
+                bins[bin].Bounds.Grow(Primitives[Order[i]]);
+                bins[bin].Count++;
+            }
+            // Sweep from the right to get every right-hand cost, then from the left
+            float rightArea[BVH_SAH_BINS];
+            uint32_t rightCount[BVH_SAH_BINS];
+            BvhBounds right;
+            uint32_t rightSum = 0;
+            for (int i = BVH_SAH_BINS - 1; i > 0; i--) {
+                right.Grow(bins[i].Bounds);
+                rightSum += bins[i].Count;
+                rightArea[i] = right.HalfArea();
+                rightCount[i] = rightSum;
+            }
+            BvhBounds left;
+            uint32_t leftSum = 0;
+            for (int i = 0; i < BVH_SAH_BINS - 1; i++) {
+                left.Grow(bins[i].Bounds);
+                leftSum += bins[i].Count;
+                if (leftSum == 0 || rightCount[i + 1] == 0)
+                    continue;
+                float cost = left.HalfArea() * leftSum + rightArea[i + 1] * rightCount[i + 1];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = i;
+                }
+            }
+        }
+
+        // Traversal step and primitive test both count as 1
+        float leafCost = static_cast<float>(count);
+        float splitCost = 1.0f + bestCost / std::max(bounds.HalfArea(), FLT_MIN);
+        if (bestAxis < 0 || (count <= BVH_MAX_LEAF_SIZE && leafCost <= splitCost)) {
+            if (count <= BVH_MAX_LEAF_SIZE)
+                return 0;
+            // Coincident centroids: halve by index
+            return count / 2;
+        }
+
+        float scale = BVH_SAH_BINS / (centers.Max[bestAxis] - centers.Min[bestAxis]);
+        auto middle = std::partition(Order.begin() + first, Order.begin() + first + count, [&](uint32_t primitive) {
+            int bin = std::min(BVH_SAH_BINS - 1, static_cast<int>((Centers[primitive][bestAxis] - centers.Min[bestAxis]) * scale));
+            return bin <= bestBin;
+        });
+        return static_cast<uint32_t>(middle - (Order.begin() + first));
+    }
+};
+
+static void SetChild(BvhNode& node, int slot, const BvhBounds& bounds, uint32_t child, uint32_t count) {
+    // Padded by a few ulps: an axis-parallel ray lying in a box's face plane
+    // (a camera ray along a cube edge) would otherwise leave the slab at t = 0
+    glm::vec3 pad = (glm::abs(bounds.Min) + glm::abs(bounds.Max)) * 1e-6f + glm::vec3(FLT_MIN);
+    glm::vec3 min = bounds.Min - pad, max = bounds.Max + pad;
+    node.MinX[slot] = min.x; node.MaxX[slot] = max.x;
+    node.MinY[slot] = min.y; node.MaxY[slot] = max.y;
+    node.MinZ[slot] = min.z; node.MaxZ[slot] = max.z;
+    node.Child[slot] = child;
+    node.Count[slot] = count;
+}
+
+// Turns binary node `index` into a four-wide node by repeatedly opening the
+// child with the largest surface, the one most likely to be entered anyway
+static uint32_t Collapse(const std::vector<BvhBuildNode>& binary, uint32_t index, std::vector<BvhNode>& nodes) {
+    uint32_t wide = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+
+    uint32_t children[BVH_WIDTH];
+    int count = 0;
+    if (binary[index].Count > 0) {
+        children[count++] = index;
+    } else {
+        children[count++] = binary[index].Left;
+        children[count++] = binary[index].Right;
+    }
+    while (count < BVH_WIDTH) {
+        int open = -1;
+        float largest = -1.0f;
+        for (int i = 0; i < count; i++) {
+            const BvhBuildNode& child = binary[children[i]];
+            if (child.Count == 0 && child.Bounds.HalfArea() > largest) {
+                largest = child.Bounds.HalfArea();
+                open = i;
+            }
+        }
+        if (open < 0)
+            break;
+        const BvhBuildNode& opened = binary[children[open]];
+        children[open] = opened.Left;
+        children[count++] = opened.Right;
+    }
+
+    BvhNode node = {};
+    node.ChildCount = static_cast<uint32_t>(count);
+    for (int i = 0; i < count; i++) {
+        const BvhBuildNode& child = binary[children[i]];
+        if (child.Count > 0)
+            SetChild(node, i, child.Bounds, child.First, child.Count);
+        else
+            SetChild(node, i, child.Bounds, Collapse(binary, children[i], nodes), 0);
+    }
+    nodes[wide] = node;
+    return wide;
+}
+
+void Bvh4::Build(const std::vector<BvhBounds>& primitives) {
+    m_Nodes.clear();
+    m_Primitives.clear();
+    m_Bounds = BvhBounds();
+    if (primitives.empty())
+        return;
+
+    m_Primitives.resize(primitives.size());
+    BvhBuilder builder{ primitives, {}, m_Primitives, {} };
+    builder.Centers.resize(primitives.size());
+    for (uint32_t i = 0; i < primitives.size(); i++) {
+        m_Primitives[i] = i;
+        builder.Centers[i] = primitives[i].Center();
+    }
+    builder.Nodes.reserve(primitives.size() * 2 / BVH_MAX_LEAF_SIZE + 1);
+    uint32_t root = builder.Build(0, static_cast<uint32_t>(primitives.size()));
+    m_Bounds = builder.Nodes[root].Bounds;
+
+    m_Nodes.reserve(builder.Nodes.size() / 2 + 1);
+    Collapse(builder.Nodes, root, m_Nodes);
+    m_BuildCost = 0.0f;
+    RefitNode(0, primitives, m_BuildCost);
+    m_BuildArea = m_Bounds.HalfArea();
+}
+
+// Sum of the children's surface areas over the root's: what SAH minimizes,
+// up to constants, since a child's area is the chance a ray enters it
+BvhBounds Bvh4::RefitNode(uint32_t index, const std::vector<BvhBounds>& primitives, float& cost) {
+    BvhNode& node = m_Nodes[index];
+    BvhBounds bounds;
+    for (uint32_t i = 0; i < node.ChildCount; i++) {
+        BvhBounds child;
+        if (node.Count[i] > 0) {
+            for (uint32_t j = 0; j < node.Count[i]; j++)
+                child.Grow(primitives[m_Primitives[node.Child[i] + j]]);
+        } else {
+            child = RefitNode(node.Child[i], primitives, cost);
+        }
+        SetChild(node, static_cast<int>(i), child, node.Child[i], node.Count[i]);
+        cost += child.HalfArea();
+        bounds.Grow(child);
+    }
+    return bounds;
+}
+
+float Bvh4::Refit(const std::vector<BvhBounds>& primitives) {
+    if (m_Nodes.empty() || primitives.size() != m_Primitives.size())
+        return 1.0f;
+    float cost = 0.0f;
+    m_Bounds = RefitNode(0, primitives, cost);
+    // Compared relative to the root so a scene that only moved keeps ratio 1
+    float area = std::max(m_Bounds.HalfArea(), FLT_MIN);
+    float buildArea = std::max(m_BuildArea, FLT_MIN);
+    return (cost / area) / std::max(m_BuildCost / buildArea, FLT_MIN);
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <xmmintrin.h>
+
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+// Children per node: one SSE register holds a coordinate of all four boxes
+#define BVH_WIDTH 4
+// Leaves hold up to this many primitives; smaller ones are made when SAH says so
+#define BVH_MAX_LEAF_SIZE 4
+// Centroid bins per axis when choosing a split
+#define BVH_SAH_BINS 16
+// Traversal stack; each node pushes at most BVH_WIDTH - 1 more entries than it pops
+#define BVH_STACK_SIZE 256
+
+struct BvhBounds {
+    glm::vec3 Min = glm::vec3(FLT_MAX);
+    glm::vec3 Max = glm::vec3(-FLT_MAX);
+
+    void Grow(const glm::vec3& point) { Min = glm::min(Min, point); Max = glm::max(Max, point); }
+    void Grow(const BvhBounds& bounds) { Min = glm::min(Min, bounds.Min); Max = glm::max(Max, bounds.Max); }
+    glm::vec3 Center() const { return (Min + Max) * 0.5f; }
+    // Surface area / 2; only ever compared
+    float HalfArea() const {
+        glm::vec3 size = glm::max(Max - Min, glm::vec3(0.0f));
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+};
+
+struct BvhRay {
+    glm::vec3 Origin;
+    glm::vec3 Direction;
+    glm::vec3 InvDirection;        // finite even for axis-aligned directions
+
+    BvhRay(const glm::vec3& origin, const glm::vec3& direction);
+};
+
+// Four rays by coordinate, traversed together when they are coherent
+// (camera rays through neighbouring pixels, bake rays from one texel)
+struct BvhRayPacket {
+    __m128 OriginX, OriginY, OriginZ;
+    __m128 DirectionX, DirectionY, DirectionZ;
+    __m128 InvDirectionX, InvDirectionY, InvDirectionZ;
+
+    explicit BvhRayPacket(const BvhRay* rays);
+    BvhRayPacket() = default;
+};
+
+// Four children with their boxes stored by coordinate, so a ray is tested
+// against all of them with a handful of SSE instructions
+struct alignas(16) BvhNode {
+    float MinX[BVH_WIDTH], MaxX[BVH_WIDTH];
+    float MinY[BVH_WIDTH], MaxY[BVH_WIDTH];
+    float MinZ[BVH_WIDTH], MaxZ[BVH_WIDTH];
+    // Inner children: node index. Leaves: first slot in the primitive order.
+    uint32_t Child[BVH_WIDTH];
+    // Primitives in a leaf child, 0 for inner children
+    uint32_t Count[BVH_WIDTH];
+    uint32_t ChildCount;
+};
+
+// Four-wide bounding volume hierarchy over anything with a box. The tree is
+// built by binned SAH as a binary tree and collapsed so every node holds up
+// to four children; the caller keeps the primitives and tests them in the
+// leaf callback, which lets the same tree serve triangles, instances or
+// anything else.
+class Bvh4 {
+public:
+    void Build(const std::vector<BvhBounds>& primitives);
+    // Recomputes the boxes of moved primitives and keeps the tree's shape.
+    // Returns the SAH cost relative to the last Build; callers rebuild once
+    // it has grown too far. `primitives` must have the Build's size.
+    float Refit(const std::vector<BvhBounds>& primitives);
+
+    bool IsEmpty() const { return m_Nodes.empty(); }
+    const BvhBounds& GetBounds() const { return m_Bounds; }
+    size_t GetNodeCount() const { return m_Nodes.size(); }
+    size_t GetMemorySize() const { return m_Nodes.size() * sizeof(BvhNode) + m_Primitives.size() * sizeof(uint32_t); }
+
+    // Closest hit. `leaf(primitive, tMax)` tests input primitive `primitive`
+    // and returns true after shrinking tMax to a closer hit.
+    template <typename Leaf>
+    bool Intersect(const BvhRay& ray, float& tMax, Leaf&& leaf) const {
+        return Traverse<false>(ray, tMax, leaf);
+    }
+    // Any hit before tMax, for shadow rays; returns on the first one
+    template <typename Leaf>
+    bool Occluded(const BvhRay& ray, float tMax, Leaf&& leaf) const {
+        return Traverse<true>(ray, tMax, leaf);
+    }
+
+    // Packet versions: lanes outside `active` (a 4-bit mask) are ignored.
+    // `leaf(primitive, tMax, active)` tests the active lanes and returns the
+    // mask of those that hit, having shrunk their tMax for the closest hit.
+    template <typename Leaf>
+    void IntersectPacket(const BvhRayPacket& packet, __m128& tMax, int active, Leaf&& leaf) const {
+        TraversePacket<false>(packet, tMax, active, leaf);
+    }
+    // Returns the lanes that hit anything before their tMax
+    template <typename Leaf>
+    int OccludedPacket(const BvhRayPacket& packet, __m128 tMax, int active, Leaf&& leaf) const {
+        return TraversePacket<true>(packet, tMax, active, leaf);
+    }
+
+private:
+    struct StackEntry {
+        uint32_t Child;
+        uint32_t Count;
+        float Near;
+    };
+
+    template <bool AnyHit, typename Leaf>
+    bool Traverse(const BvhRay& ray, float& tMax, Leaf& leaf) const {
+        if (m_Nodes.empty())
+            return false;
+        const __m128 originX = _mm_set1_ps(ray.Origin.x), invX = _mm_set1_ps(ray.InvDirection.x);
+        const __m128 originY = _mm_set1_ps(ray.Origin.y), invY = _mm_set1_ps(ray.InvDirection.y);
+        const __m128 originZ = _mm_set1_ps(ray.Origin.z), invZ = _mm_set1_ps(ray.InvDirection.z);
+
+        StackEntry stack[BVH_STACK_SIZE];
+        int size = 0;
+        stack[size++] = { 0, 0, 0.0f };
+        bool hit = false;
+        while (size > 0) {
+            StackEntry entry = stack[--size];
+            if (entry.Near > tMax)
+                continue;
+            if (entry.Count > 0) {
+                for (uint32_t i = 0; i < entry.Count; i++) {
+                    if (leaf(m_Primitives[entry.Child + i], tMax)) {
+                        hit = true;
+                        if (AnyHit)
+                            return true;
+                    }
+                }
+                continue;
+            }
+
+            // Slab test against the four boxes at once
+            const BvhNode& node = m_Nodes[entry.Child];
+            __m128 x0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinX), originX), invX);
+            __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxX), originX), invX);
+            __m128 y0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinY), originY), invY);
+            __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxY), originY), invY);
+            __m128 z0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinZ), originZ), invZ);
+            __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxZ), originZ), invZ);
+            __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)),
+                                      _mm_max_ps(_mm_min_ps(z0, z1), _mm_setzero_ps()));
+            __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)),
+                                     _mm_min_ps(_mm_max_ps(z0, z1), _mm_set1_ps(tMax)));
+            int mask = _mm_movemask_ps(_mm_cmple_ps(tNear, tFar)) & ((1 << node.ChildCount) - 1);
+            if (mask == 0)
+                continue;
+
+            // Push the hit children far to near so the nearest is popped first
+            alignas(16) float nears[BVH_WIDTH];
+            _mm_store_ps(nears, tNear);
+            int first = size;
+            for (int i = 0; i < BVH_WIDTH; i++) {
+                if ((mask & (1 << i)) == 0)
+                    continue;
+                StackEntry child = { node.Child[i], node.Count[i], nears[i] };
+                int j = size++;
+                for (; j > first && stack[j - 1].Near < child.Near; j--)
+                    stack[j] = stack[j - 1];
+                stack[j] = child;
+            }
+        }
+        return hit;
+    }
+
+    template <bool AnyHit, typename Leaf>
+    int TraversePacket(const BvhRayPacket& packet, __m128& tMax, int active, Leaf& leaf) const {
+        int hits = 0;
+        if (m_Nodes.empty())
+            return hits;
+        StackEntry stack[BVH_STACK_SIZE];
+        int size = 0;
+        stack[size++] = { 0, 0, 0.0f };
+        while (size > 0 && active != 0) {
+            StackEntry entry = stack[--size];
+            // Skipped only when it is behind every live ray's closest hit
+            if ((_mm_movemask_ps(_mm_cmple_ps(_mm_set1_ps(entry.Near), tMax)) & active) == 0)
+                continue;
+            if (entry.Count > 0) {
+                for (uint32_t i = 0; i < entry.Count && active != 0; i++) {
+                    int hit = leaf(m_Primitives[entry.Child + i], tMax, active) & active;
+                    hits |= hit;
+                    if (AnyHit)
+                        active &= ~hit;
+                }
+                continue;
+            }
+
+            // One child at a time, all four rays at once
+            const BvhNode& node = m_Nodes[entry.Child];
+            int first = size;
+            for (uint32_t i = 0; i < node.ChildCount; i++) {
+                __m128 x0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MinX[i]), packet.OriginX), packet.InvDirectionX);
+                __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MaxX[i]), packet.OriginX), packet.InvDirectionX);
+                __m128 y0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MinY[i]), packet.OriginY), packet.InvDirectionY);
+                __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MaxY[i]), packet.OriginY), packet.InvDirectionY);
+                __m128 z0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MinZ[i]), packet.OriginZ), packet.InvDirectionZ);
+                __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MaxZ[i]), packet.OriginZ), packet.InvDirectionZ);
+                __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)),
+                                          _mm_max_ps(_mm_min_ps(z0, z1), _mm_setzero_ps()));
+                __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)),
+                                         _mm_min_ps(_mm_max_ps(z0, z1), tMax));
+                __m128 hit = _mm_cmple_ps(tNear, tFar);
+                int mask = _mm_movemask_ps(hit) & active;
+                if (mask == 0)
+                    continue;
+                // Nearest entry over the lanes that hit (inactive lanes may hit too;
+                // that only makes the ordering approximate)
+                __m128 nears = _mm_or_ps(_mm_and_ps(hit, tNear), _mm_andnot_ps(hit, _mm_set1_ps(FLT_MAX)));
+                nears = _mm_min_ps(nears, _mm_shuffle_ps(nears, nears, _MM_SHUFFLE(2, 3, 0, 1)));
+                nears = _mm_min_ps(nears, _mm_shuffle_ps(nears, nears, _MM_SHUFFLE(1, 0, 3, 2)));
+                StackEntry child = { node.Child[i], node.Count[i], _mm_cvtss_f32(nears) };
+                int j = size++;
+                for (; j > first && stack[j - 1].Near < child.Near; j--)
+                    stack[j] = stack[j - 1];
+                stack[j] = child;
+            }
+        }
+        return hits;
+    }
+
+    BvhBounds RefitNode(uint32_t index, const std::vector<BvhBounds>& primitives, float& cost);
+
+    std::vector<BvhNode> m_Nodes;
+    std::vector<uint32_t> m_Primitives;    // leaf slots -> input primitive indices
+    BvhBounds m_Bounds;
+    float m_BuildCost = 0.0f;          // sum of child areas right after Build
+    float m_BuildArea = 0.0f;
+};
@@ -0,0 +1,142 @@
+#include "CommandBuffer.h"
+#include "RenderBackend.h"
+
+#include <cstring>
+#include <memory>
+
+namespace {
+    struct BufferRange { unsigned int Target; unsigned int Index; unsigned int Buffer; uint64_t Offset; uint64_t Size; };
+    struct UniformMat4 { int Location; float Value[16]; };
+    struct Uniform4f { int Location; float Value[4]; };
+    struct DrawIndexed { unsigned int Mode; int Count; uint64_t Offset; };
+    struct DrawRange { unsigned int Mode; int First; int Count; };
+}
+
+template<typename T>
+void CommandBuffer::Write(const T& value) {
+    size_t offset = m_Data.size();
+    m_Data.resize(offset + sizeof(T));
+    std::memcpy(m_Data.data() + offset, &value, sizeof(T));
+}
+
+void CommandBuffer::Reset(std::pmr::memory_resource* resource) {
+    // pmr containers never adopt another allocator on assignment, so rebuild.
+    // This also drops storage from a previous frame whose arena has been reset.
+    if (resource) {
+        std::destroy_at(&m_Data);
+        std::construct_at(&m_Data, resource);
+    }
+    m_Data.clear();
+    m_CommandCount = 0;
+    m_Program = m_Vao = 0;
+}
+
+void CommandBuffer::UseProgram(unsigned int program) {
+    if (program == m_Program)
+        return;
+    Write(Command::UseProgram);
+    Write(program);
+    m_Program = program;
+    m_CommandCount++;
+}
+
+void CommandBuffer::BindVertexArray(unsigned int vao) {
+    if (vao == m_Vao)
+        return;
+    Write(Command::BindVertexArray);
+    Write(vao);
+    m_Vao = vao;
+    m_CommandCount++;
+}
+
+void CommandBuffer::BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size) {
+    Write(Command::BindBufferRange);
+    Write(BufferRange{ target, index, buffer, offset, size });
+    m_CommandCount++;
+}
+
+void CommandBuffer::SetUniformMat4(int location, const float* value) {
+    UniformMat4 command;
+    command.Location = location;
+    std::memcpy(command.Value, value, sizeof(command.Value));
+    Write(Command::SetUniformMat4);
+    Write(command);
+    m_CommandCount++;
+}
+
+void CommandBuffer::SetUniform4f(int location, float x, float y, float z, float w) {
+    Write(Command::SetUniform4f);
+    Write(Uniform4f{ location, { x, y, z, w } });
+    m_CommandCount++;
+}
+
+void CommandBuffer::DrawElements(unsigned int mode, int count, size_t offset) {
+    Write(Command::DrawElements);
+    Write(DrawIndexed{ mode, count, offset });
+    m_CommandCount++;
+}
+
+void CommandBuffer::DrawArrays(unsigned int mode, int first, int count) {
+    Write(Command::DrawArrays);
+    Write(DrawRange{ mode, first, count });
+    m_CommandCount++;
+}
+
+template<typename T>
+static T Read(const uint8_t*& cursor) {
+    T value;
+    std::memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return value;
+}
+
+void CommandReplayer::Replay(const CommandBuffer& buffer) {
+    const uint8_t* cursor = buffer.m_Data.data();
+    const uint8_t* end = cursor + buffer.m_Data.size();
+    while (cursor < end) {
+        switch (Read<CommandBuffer::Command>(cursor)) {
+            case CommandBuffer::Command::UseProgram: {
+                auto program = Read<unsigned int>(cursor);
+                if (program != m_Program) {
+                    m_Backend.UseProgram(program);
+                    m_Program = program;
+                }
+                break;
+            }
+            case CommandBuffer::Command::BindVertexArray: {
+                auto vao = Read<unsigned int>(cursor);
+                if (vao != m_Vao) {
+                    m_Backend.BindVertexArray(vao);
+                    m_Vao = vao;
+                }
+                break;
+            }
+            case CommandBuffer::Command::BindBufferRange: {
+                auto command = Read<BufferRange>(cursor);
+                m_Backend.BindBufferRange(command.Target, command.Index, command.Buffer,
+                                          static_cast<size_t>(command.Offset), static_cast<size_t>(command.Size));
+                break;
+            }
+            case CommandBuffer::Command::SetUniformMat4: {
+                auto command = Read<UniformMat4>(cursor);
+                m_Backend.SetUniformMat4(command.Location, command.Value);
+                break;
+            }
+            case CommandBuffer::Command::SetUniform4f: {
+                auto command = Read<Uniform4f>(cursor);
+                m_Backend.SetUniform4f(command.Location, command.Value[0], command.Value[1], command.Value[2], command.Value[3]);
+                break;
+            }
+            case CommandBuffer::Command::DrawElements: {
+                auto command = Read<DrawIndexed>(cursor);
+                m_Backend.DrawElements(command.Mode, command.Count, static_cast<size_t>(command.Offset));
+                break;
+            }
+            case CommandBuffer::Command::DrawArrays: {
+                auto command = Read<DrawRange>(cursor);
+                m_Backend.DrawArrays(command.Mode, command.First, command.Count);
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+class RenderBackend;
+
+// Compact, backend-agnostic list of draw commands. Any thread may record into
+// its own buffer; only the GL thread replays them.
+class CommandBuffer {
+public:
+    enum class Command : uint8_t {
+        UseProgram, BindVertexArray, BindBufferRange, SetUniformMat4, SetUniform4f, DrawElements, DrawArrays
+    };
+
+    explicit CommandBuffer(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_Data(resource) {}
+
+    // Empties the buffer. Passing a resource (usually the recording thread's
+    // frame arena) moves future storage there; without one the current
+    // capacity is reused.
+    void Reset(std::pmr::memory_resource* resource = nullptr);
+    bool IsEmpty() const { return m_Data.empty(); }
+    size_t GetSize() const { return m_Data.size(); }
+    unsigned int GetCommandCount() const { return m_CommandCount; }
+
+    // Redundant program and vertex array binds are dropped while recording
+    void UseProgram(unsigned int program);
+    void BindVertexArray(unsigned int vao);
+    void BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size);
+    void SetUniformMat4(int location, const float* value);
+    void SetUniform4f(int location, float x, float y, float z, float w);
+    void DrawElements(unsigned int mode, int count, size_t offset);
+    void DrawArrays(unsigned int mode, int first, int count);
+
+private:
+    friend class CommandReplayer;
+
+    template<typename T>
+    void Write(const T& value);
+
+    std::pmr::vector<uint8_t> m_Data;
+    unsigned int m_CommandCount = 0;
+    unsigned int m_Program = 0;
+    unsigned int m_Vao = 0;
+};
+
+// Replays buffers in order on the GL thread. Bindings are tracked across
+// buffers, so a chunk that starts with the program the previous chunk ended on
+// does not rebind it.
+class CommandReplayer {
+public:
+    explicit CommandReplayer(RenderBackend& backend) : m_Backend(backend) {}
+
+    void Replay(const CommandBuffer& buffer);
+    // Forget cached bindings, e.g. after someone else touched GL state
+    void Invalidate() { m_Program = m_Vao = 0; }
+
+private:
+    RenderBackend& m_Backend;
+    unsigned int m_Program = 0;
+    unsigned int m_Vao = 0;
+};
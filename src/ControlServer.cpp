@@ -0,0 +1,399 @@
+#include "ControlServer.h"
+#include "Json.h"
+#include "SceneFile.h"
+
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static void AppendJsonString(std::string& out, const std::string& value) {
+    out += '"';
+    for (unsigned char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+static std::string ReplyPrefix(bool hasId, int id) {
+    return hasId ? "{\"id\": " + std::to_string(id) + ", " : std::string("{");
+}
+
+ControlServer::~ControlServer() {
+    Stop();
+}
+
+bool ControlServer::Start(const std::string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        std::cout << "[Control] socket path too long: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    m_ListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_ListenFd < 0) {
+        std::cout << "[Control] socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    // A previous run that crashed leaves its socket file behind
+    unlink(path.c_str());
+    if (bind(m_ListenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(m_ListenFd, CONTROL_MAX_CLIENTS) < 0) {
+        std::cout << "[Control] cannot listen on " << path << ": " << std::strerror(errno) << std::endl;
+        close(m_ListenFd);
+        m_ListenFd = -1;
+        return false;
+    }
+    m_WakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_WakeFd < 0) {
+        std::cout << "[Control] eventfd: " << std::strerror(errno) << std::endl;
+        close(m_ListenFd);
+        m_ListenFd = -1;
+        unlink(path.c_str());
+        return false;
+    }
+
+    m_Path = path;
+    m_Quit = false;
+    m_Thread = std::thread(&ControlServer::Run, this);
+    std::cout << "[Control] listening on " << path << std::endl;
+    return true;
+}
+
+void ControlServer::Stop() {
+    if (!m_Thread.joinable())
+        return;
+    m_Quit = true;
+    uint64_t one = 1;
+    (void)write(m_WakeFd, &one, sizeof(one));
+    m_Thread.join();
+
+    for (Client& client : m_Clients)
+        close(client.Fd);
+    m_Clients.clear();
+    close(m_ListenFd);
+    close(m_WakeFd);
+    m_ListenFd = m_WakeFd = -1;
+    unlink(m_Path.c_str());
+}
+
+bool ControlServer::Poll(ControlCommand& command) {
+    return m_Commands.Pop(command);
+}
+
+void ControlServer::PushReply(ControlReply&& reply) {
+    // The server thread pops a reply for every command it queued, so this
+    // only fails if that thread is stuck; the frame never waits for it
+    if (!m_Replies.Push(std::move(reply))) {
+        std::cout << "[Control] reply queue full, dropping a reply" << std::endl;
+        return;
+    }
+    uint64_t one = 1;
+    (void)write(m_WakeFd, &one, sizeof(one));
+}
+
+void ControlServer::ReplyOk(const ControlCommand& command, const std::string& fields) {
+    ControlReply reply;
+    reply.Client = command.Client;
+    reply.Text = ReplyPrefix(command.HasId, command.Id) + "\"ok\": true";
+    if (!fields.empty())
+        reply.Text += ", " + fields;
+    reply.Text += "}";
+    PushReply(std::move(reply));
+}
+
+void ControlServer::ReplyError(const ControlCommand& command, const std::string& message) {
+    ControlReply reply;
+    reply.Client = command.Client;
+    reply.Text = ReplyPrefix(command.HasId, command.Id) + "\"ok\": false, \"error\": ";
+    AppendJsonString(reply.Text, message);
+    reply.Text += "}";
+    PushReply(std::move(reply));
+}
+
+void ControlServer::ReplyScreenshot(const ControlCommand& command, int width, int height, std::vector<unsigned char>&& pixels) {
+    ControlReply reply;
+    reply.Client = command.Client;
+    reply.Text = ReplyPrefix(command.HasId, command.Id);
+    reply.ImagePath = command.Path;
+    reply.Width = width;
+    reply.Height = height;
+    reply.Pixels = std::move(pixels);
+    PushReply(std::move(reply));
+}
+
+void ControlServer::Run() {
+    std::vector<pollfd> fds;
+    while (!m_Quit) {
+        fds.clear();
+        fds.push_back({ m_WakeFd, POLLIN, 0 });
+        fds.push_back({ m_ListenFd, POLLIN, 0 });
+        for (const Client& client : m_Clients)
+            fds.push_back({ client.Fd, static_cast<short>((client.Parked ? 0 : POLLIN) | (client.Out.empty() ? 0 : POLLOUT)), 0 });
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            std::cout << "[Control] poll: " << std::strerror(errno) << std::endl;
+            return;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t count;
+            (void)read(m_WakeFd, &count, sizeof(count));
+            SendReplies();
+            // Each reply means the render thread took a command off the queue
+            for (Client& client : m_Clients) {
+                if (client.Parked)
+                    ProcessInput(client);
+            }
+        }
+        if (fds[1].revents & POLLIN)
+            Accept();
+
+        // fds[i + 2] belongs to m_Clients[i] as it was before Accept appended to it
+        size_t polled = fds.size() - 2;
+        std::vector<unsigned int> closed;
+        for (size_t i = 0; i < polled; i++) {
+            Client& client = m_Clients[i];
+            short events = fds[i + 2].revents;
+            bool open = true;
+            if (events & (POLLIN | POLLHUP | POLLERR))
+                open = ReadClient(client);
+            if (open && (events & POLLOUT))
+                open = WriteClient(client);
+            if (!open)
+                closed.push_back(client.Id);
+        }
+        for (unsigned int id : closed) {
+            for (size_t i = 0; i < m_Clients.size(); i++) {
+                if (m_Clients[i].Id == id) {
+                    close(m_Clients[i].Fd);
+                    m_Clients.erase(m_Clients.begin() + static_cast<std::ptrdiff_t>(i));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void ControlServer::Accept() {
+    while (true) {
+        int fd = accept4(m_ListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        if (m_Clients.size() >= CONTROL_MAX_CLIENTS) {
+            close(fd);
+            continue;
+        }
+        m_Clients.push_back({ m_NextClient++, fd, {}, {}, false });
+    }
+}
+
+bool ControlServer::ReadClient(Client& client) {
+    char buffer[4096];
+    while (true) {
+        ssize_t n = read(client.Fd, buffer, sizeof(buffer));
+        if (n == 0)
+            return false;
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        client.In.append(buffer, static_cast<size_t>(n));
+        ProcessInput(client);
+        if (client.Parked)
+            return true;
+        if (client.In.size() > CONTROL_MAX_LINE)
+            return false;
+    }
+}
+
+void ControlServer::ProcessInput(Client& client) {
+    client.Parked = false;
+    size_t start = 0;
+    size_t end;
+    while ((end = client.In.find('\n', start)) != std::string::npos) {
+        if (end > start && !HandleLine(client, client.In.data() + start, end - start)) {
+            client.Parked = true;
+            break;
+        }
+        start = end + 1;
+    }
+    client.In.erase(0, start);
+}
+
+bool ControlServer::WriteClient(Client& client) {
+    while (!client.Out.empty()) {
+        ssize_t n = send(client.Fd, client.Out.data(), client.Out.size(), MSG_NOSIGNAL);
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        client.Out.erase(0, static_cast<size_t>(n));
+    }
+    return true;
+}
+
+static bool ParseCommand(JsonReader& json, ControlCommand& command) {
+    glm::vec3 position(0.0f), rotation(0.0f), scale(1.0f);
+    glm::mat4 matrix(1.0f);
+    bool hasMatrix = false;
+    std::string type;
+
+    if (!json.Parse() || !json.BeginObject())
+        return false;
+    std::string_view key;
+    while (json.NextMember(key)) {
+        bool ok;
+        if (key == "id") {
+            ok = json.ReadInt(command.Id);
+            command.HasId = ok;
+        } else if (key == "cmd") {
+            ok = json.ReadString(type);
+        } else if (key == "eye") {
+            ok = json.ReadFloats(&command.Eye.x, 3);
+        } else if (key == "target") {
+            ok = json.ReadFloats(&command.Target.x, 3);
+        } else if (key == "up") {
+            ok = json.ReadFloats(&command.Up.x, 3);
+        } else if (key == "mesh") {
+            ok = json.ReadString(command.Mesh);
+        } else if (key == "material") {
+            ok = json.ReadString(command.Material);
+        } else if (key == "position") {
+            ok = json.ReadFloats(&position.x, 3);
+        } else if (key == "rotation") {
+            ok = json.ReadFloats(&rotation.x, 3);
+        } else if (key == "scale") {
+            if (json.Peek() == '[') {
+                ok = json.ReadFloats(&scale.x, 3);
+            } else {
+                float uniform = 1.0f;
+                ok = json.ReadFloat(uniform);
+                scale = glm::vec3(uniform);
+            }
+        } else if (key == "matrix") {
+            ok = json.ReadFloats(&matrix[0][0], 16);
+            hasMatrix = true;
+        } else if (key == "color") {
+            ok = json.ReadFloats(&command.Color.x, 4);
+        } else if (key == "object") {
+            ok = json.ReadUInt(command.Object);
+        } else if (key == "path") {
+            ok = json.ReadString(command.Path);
+        } else if (key == "x") {
+            ok = json.ReadFloat(command.X);
+        } else if (key == "y") {
+            ok = json.ReadFloat(command.Y);
+        } else {
+            ok = json.Skip();
+        }
+        if (!ok)
+            return false;
+    }
+    if (json.Failed())
+        return false;
+    if (json.Peek() != '\0')
+        return json.Fail("trailing data");
+
+    if (type == "camera") {
+        command.Type = ControlCommandType::SetCamera;
+    } else if (type == "add") {
+        command.Type = ControlCommandType::AddObject;
+        if (command.Mesh.empty() || command.Material.empty())
+            return json.Fail("add needs a mesh and a material");
+        command.Model = hasMatrix ? matrix : ComposeTransform(position, rotation, scale);
+    } else if (type == "remove") {
+        command.Type = ControlCommandType::RemoveObject;
+    } else if (type == "screenshot") {
+        command.Type = ControlCommandType::Screenshot;
+        if (command.Path.empty())
+            return json.Fail("screenshot needs a path");
+    } else if (type == "stats") {
+        command.Type = ControlCommandType::QueryStats;
+    } else if (type == "pick") {
+        command.Type = ControlCommandType::Pick;
+    } else {
+        return json.Fail(type.empty() ? "missing cmd" : "unknown cmd");
+    }
+    return true;
+}
+
+bool ControlServer::HandleLine(Client& client, const char* line, size_t size) {
+    ControlCommand command;
+    command.Client = client.Id;
+    JsonReader json(line, size);
+    // Rejected lines are queued too, so their replies keep their place among the others
+    if (!ParseCommand(json, command)) {
+        command.Type = ControlCommandType::Invalid;
+        command.Error = json.GetError();
+    }
+    // Fails when the render thread is CONTROL_QUEUE_CAPACITY commands behind;
+    // the line is parsed again once there is room
+    return m_Commands.Push(std::move(command));
+}
+
+static bool WritePpm(const std::string& path, int width, int height, const std::vector<unsigned char>& rgba) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+    // GL rows start at the bottom; PPM rows at the top
+    for (int y = height - 1; y >= 0; y--) {
+        const unsigned char* source = rgba.data() + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; x++) {
+            row[x * 3 + 0] = source[x * 4 + 0];
+            row[x * 3 + 1] = source[x * 4 + 1];
+            row[x * 3 + 2] = source[x * 4 + 2];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+    return static_cast<bool>(file);
+}
+
+void ControlServer::SendReplies() {
+    ControlReply reply;
+    while (m_Replies.Pop(reply)) {
+        if (!reply.ImagePath.empty()) {
+            if (WritePpm(reply.ImagePath, reply.Width, reply.Height, reply.Pixels)) {
+                reply.Text += "\"ok\": true, \"path\": ";
+                AppendJsonString(reply.Text, reply.ImagePath);
+                reply.Text += ", \"width\": " + std::to_string(reply.Width) + ", \"height\": " + std::to_string(reply.Height) + "}";
+            } else {
+                reply.Text += "\"ok\": false, \"error\": ";
+                AppendJsonString(reply.Text, "cannot write " + reply.ImagePath);
+                reply.Text += "}";
+            }
+            // Frees the pixels on this thread rather than the next Pop
+            reply.Pixels = {};
+        }
+        Send(reply.Client, reply.Text);
+    }
+}
+
+void ControlServer::Send(unsigned int id, const std::string& text) {
+    for (Client& client : m_Clients) {
+        if (client.Id == id) {
+            client.Out += text;
+            client.Out += '\n';
+            return;
+        }
+    }
+    // The client disconnected while its command was queued
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "SpscQueue.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CONTROL_SOCKET_DEFAULT_PATH "modernopengl.sock"
+// Commands waiting for the next frame boundary, and replies waiting to be sent
+#define CONTROL_QUEUE_CAPACITY 256
+#define CONTROL_MAX_CLIENTS 16
+// Longest accepted request line; a client sending more is disconnected
+#define CONTROL_MAX_LINE 65536
+
+// One request per line, one JSON object each; "id" is optional and echoed:
+//
+//     {"id": 1, "cmd": "camera", "eye": [x, y, z], "target": [x, y, z], "up": [x, y, z]}
+//     {"id": 2, "cmd": "add", "mesh": "Cube", "material": "Cube",
+//      "position": [x, y, z], "rotation": [x, y, z], "scale": s | [x, y, z],
+//      "matrix": [16 floats], "color": [r, g, b, a]}          -> "object": handle
+//     {"id": 3, "cmd": "remove", "object": handle}
+//     {"id": 4, "cmd": "screenshot", "path": "shot.ppm"}
+//     {"id": 5, "cmd": "stats"}
+//     {"id": 6, "cmd": "pick", "x": 0.5, "y": 0.5}   (view fractions from the top left)
+//                  -> "hit": true, "index": scene object, "object": handle if added here,
+//                     "position": [x, y, z], "distance": from the eye
+//
+// Every reply is one line: {"id": 1, "ok": true, ...} or {"id": 1, "ok": false, "error": "..."}.
+// A client's replies come back in the order it sent the requests, rejected
+// ones included.
+enum class ControlCommandType {
+    SetCamera, AddObject, RemoveObject, Screenshot, QueryStats, Pick,
+    Invalid                        // a line that did not parse; reply with ReplyError(command, command.Error)
+};
+
+struct ControlCommand {
+    ControlCommandType Type = ControlCommandType::QueryStats;
+    unsigned int Client = 0;       // connection the reply goes to
+    bool HasId = false;
+    int Id = 0;
+
+    // SetCamera
+    glm::vec3 Eye = glm::vec3(0.0f);
+    glm::vec3 Target = glm::vec3(0.0f);
+    glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
+    // AddObject
+    std::string Mesh, Material;
+    glm::mat4 Model = glm::mat4(1.0f);
+    glm::vec4 Color = glm::vec4(1.0f);
+    // RemoveObject
+    unsigned int Object = 0;
+    // Screenshot
+    std::string Path;
+    // Pick
+    float X = 0.5f, Y = 0.5f;
+    // Invalid
+    std::string Error;
+};
+
+struct ControlReply {
+    unsigned int Client = 0;
+    std::string Text;              // one JSON object, without the newline
+    // Screenshots are written to ImagePath by the server thread before Text is sent
+    std::string ImagePath;
+    int Width = 0, Height = 0;
+    std::vector<unsigned char> Pixels;  // RGBA, bottom row first
+};
+
+// Local command interface for test harnesses and orchestration. A server
+// thread owns the Unix socket: it accepts clients, parses their requests and
+// hands them to the render thread through a lock-free queue, which the frame
+// loop drains at the frame boundary. Replies travel back through a second
+// queue, so neither side ever waits on the other and a slow or stuck client
+// cannot stall a frame. Screenshot files are written on the server thread too.
+class ControlServer {
+public:
+    ControlServer() = default;
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    // Replaces a stale socket file at `path`; false if the socket cannot be bound
+    bool Start(const std::string& path);
+    void Stop();
+    bool IsRunning() const { return m_Thread.joinable(); }
+
+    // Render thread. Next queued command, false when there is none.
+    bool Poll(ControlCommand& command);
+    // Render thread. `fields` are extra members for the reply, e.g. "\"object\": 3".
+    void ReplyOk(const ControlCommand& command, const std::string& fields = {});
+    void ReplyError(const ControlCommand& command, const std::string& message);
+    // Render thread. Takes RGBA rows read back bottom row first.
+    void ReplyScreenshot(const ControlCommand& command, int width, int height, std::vector<unsigned char>&& pixels);
+
+private:
+    struct Client {
+        unsigned int Id;
+        int Fd;
+        std::string In;
+        std::string Out;
+        // The command queue was full: the rest of In waits for room, and the
+        // socket is not read meanwhile, so a fast client is throttled rather
+        // than refused
+        bool Parked;
+    };
+
+    void Run();
+    void Accept();
+    bool ReadClient(Client& client);
+    void ProcessInput(Client& client);
+    bool WriteClient(Client& client);
+    // False when the command queue is full
+    bool HandleLine(Client& client, const char* line, size_t size);
+    void SendReplies();
+    void Send(unsigned int client, const std::string& text);
+    void PushReply(ControlReply&& reply);
+
+    std::string m_Path;
+    int m_ListenFd = -1;
+    int m_WakeFd = -1;             // eventfd: new replies or Stop
+    std::vector<Client> m_Clients;
+    unsigned int m_NextClient = 1;
+
+    // Server thread -> render thread, and back
+    SpscQueue<ControlCommand, CONTROL_QUEUE_CAPACITY> m_Commands;
+    SpscQueue<ControlReply, CONTROL_QUEUE_CAPACITY> m_Replies;
+
+    std::thread m_Thread;
+    std::atomic<bool> m_Quit = false;
+};
@@ -0,0 +1,44 @@
+#include "DeletionQueue.h"
+#include "RenderBackend.h"
+
+void DeletionQueue::Enqueue(GLObjectType type, unsigned int id) {
+    m_Current.push_back({ type, id });
+}
+
+void DeletionQueue::Release(Frame& frame) {
+    for (const Object& object : frame.Objects)
+        m_Backend.DeleteObject(object.Type, object.Id);
+    m_Backend.DeleteFence(frame.Fence);
+}
+
+void DeletionQueue::EndFrame() {
+    if (!m_Current.empty()) {
+        m_InFlight.push_back({ m_Backend.InsertFence(), std::move(m_Current) });
+        m_Current.clear();
+    }
+
+    while (!m_InFlight.empty()) {
+        // Block only when too many frames are outstanding; otherwise just poll
+        bool mustWait = m_InFlight.size() > DELETION_QUEUE_MAX_FRAMES;
+        if (!m_Backend.WaitFence(m_InFlight.front().Fence, mustWait ? ~0ull : 0))
+            break;
+        Release(m_InFlight.front());
+        m_InFlight.pop_front();
+    }
+}
+
+void DeletionQueue::Flush() {
+    EndFrame();
+    for (Frame& frame : m_InFlight) {
+        m_Backend.WaitFence(frame.Fence, ~0ull);
+        Release(frame);
+    }
+    m_InFlight.clear();
+}
+
+size_t DeletionQueue::GetPendingCount() const {
+    size_t count = m_Current.size();
+    for (const Frame& frame : m_InFlight)
+        count += frame.Objects.size();
+    return count;
+}
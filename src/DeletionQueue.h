@@ -0,0 +1,49 @@
+#pragma once
+
+#include "GLResource.h"
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// Frames whose deletions may be outstanding before EndFrame() blocks on the
+// oldest fence instead of letting the queue grow
+#define DELETION_QUEUE_MAX_FRAMES 3
+
+class RenderBackend;
+
+// Defers GL object deletion until the GPU has finished the frames that may
+// still use the object. Deletions requested during a frame are tagged with a
+// fence at EndFrame() and released once that fence signals.
+class DeletionQueue {
+public:
+    explicit DeletionQueue(RenderBackend& backend) : m_Backend(backend) {}
+
+    DeletionQueue(const DeletionQueue&) = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+    void Enqueue(GLObjectType type, unsigned int id);
+
+    // Call once per frame after the last submission
+    void EndFrame();
+    // Waits for the GPU and releases everything; call before the context goes away
+    void Flush();
+
+    size_t GetPendingCount() const;
+
+private:
+    struct Object {
+        GLObjectType Type;
+        unsigned int Id;
+    };
+    struct Frame {
+        void* Fence;
+        std::vector<Object> Objects;
+    };
+
+    void Release(Frame& frame);
+
+    RenderBackend& m_Backend;
+    std::vector<Object> m_Current;
+    std::deque<Frame> m_InFlight;
+};
@@ -0,0 +1,176 @@
+#include "FlightRecorder.h"
+#include "HostMemory.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <climits>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static unsigned int GetThreadNumber() {
+    static std::atomic<unsigned int> next = 0;
+    thread_local unsigned int number = next.fetch_add(1, std::memory_order_relaxed);
+    return number;
+}
+
+static double ToMicroseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+FlightRecorder::FlightRecorder()
+    : m_Frames(std::make_unique<FlightFrameRecord[]>(FLIGHT_RECORDER_FRAMES)),
+      m_Epoch(std::chrono::steady_clock::now()) {
+    for (int i = 0; i < FLIGHT_RECORDER_FRAMES; i++)
+        m_Frames[i].Index = ULLONG_MAX;
+}
+
+FlightFrameRecord* FlightRecorder::FindFrame(unsigned long long index) {
+    FlightFrameRecord& record = m_Frames[index % FLIGHT_RECORDER_FRAMES];
+    return record.Index == index ? &record : nullptr;
+}
+
+void FlightRecorder::CollectGpuTimes(RenderBackend& backend) {
+    for (int i = 0; i < FLIGHT_RECORDER_GPU_LATENCY; i++) {
+        unsigned long long nanoseconds;
+        if (!m_QueryPending[i] || !backend.GetQueryResult(m_Queries[i].Get(), nanoseconds))
+            continue;
+        m_QueryPending[i] = false;
+        if (FlightFrameRecord* record = FindFrame(m_QueryFrames[i])) {
+            record->GpuMs = static_cast<float>(nanoseconds / 1e6);
+            // A GPU-bound spike is only known now; dump once the result is in
+            if (m_BudgetMs > 0.0 && record->GpuMs > m_BudgetMs && m_PendingDump == ULLONG_MAX &&
+                record->Index >= m_NextDumpFrame)
+                m_PendingDump = record->Index;
+        }
+    }
+}
+
+void FlightRecorder::BeginFrame(RenderBackend& backend, unsigned long long index) {
+    CollectGpuTimes(backend);
+
+    m_FrameStart = std::chrono::steady_clock::now();
+    m_Current = &m_Frames[index % FLIGHT_RECORDER_FRAMES];
+    m_Current->Index = index;
+    m_Current->StartUs = ToMicroseconds(m_FrameStart - m_Epoch);
+    m_Current->CpuMs = 0.0f;
+    m_Current->GpuMs = -1.0f;
+    m_Current->ScopeCount.store(0, std::memory_order_relaxed);
+
+    // A query whose result never arrived is simply restarted; its frame keeps no GPU time
+    int query = static_cast<int>(index % FLIGHT_RECORDER_GPU_LATENCY);
+    if (!m_Queries[query])
+        m_Queries[query] = QueryHandle(backend, backend.CreateQuery());
+    backend.BeginQuery(GL_TIME_ELAPSED, m_Queries[query].Get());
+    m_QueryFrames[query] = index;
+    m_QueryPending[query] = true;
+    m_TimerActive = true;
+}
+
+void FlightRecorder::EndFrame(RenderBackend& backend, const FrameArenaStats& arena) {
+    if (!m_Current)
+        return;
+    if (m_TimerActive) {
+        backend.EndQuery(GL_TIME_ELAPSED);
+        m_TimerActive = false;
+    }
+
+    FlightFrameRecord& record = *m_Current;
+    record.CpuMs = static_cast<float>(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_FrameStart).count());
+    record.Stats = backend.GetFrameStats();
+    record.Arena = arena;
+    HostMemoryStats host = GetHostMemoryTotals();
+    record.HostAllocations = host.FrameAllocations;
+    record.HostAllocatedBytes = host.FrameBytes;
+    record.HostLiveBytes = host.LiveBytes;
+    m_Current = nullptr;
+
+    if (m_BudgetMs > 0.0 && record.CpuMs > m_BudgetMs && m_PendingDump == ULLONG_MAX && record.Index >= m_NextDumpFrame)
+        m_PendingDump = record.Index;
+
+    // Wait for the GPU times of the spike frame before writing it out
+    if (m_PendingDump == ULLONG_MAX || record.Index < m_PendingDump + FLIGHT_RECORDER_GPU_LATENCY)
+        return;
+
+    std::error_code error;
+    std::filesystem::create_directories(FLIGHT_RECORDER_DIRECTORY, error);
+    std::string path = std::string(FLIGHT_RECORDER_DIRECTORY) + "/frame_" + std::to_string(m_PendingDump) + ".json";
+    if (Dump(path)) {
+        std::cout << "[Flight Recorder] frame " << m_PendingDump << " over the " << m_BudgetMs
+                  << " ms budget, wrote " << path << std::endl;
+        m_Dumps++;
+    }
+    m_NextDumpFrame = record.Index + FLIGHT_RECORDER_FRAMES;
+    m_PendingDump = ULLONG_MAX;
+}
+
+void FlightRecorder::Release() {
+    for (QueryHandle& query : m_Queries)
+        query.Reset();
+}
+
+void FlightRecorder::RecordScope(const char* name, std::chrono::steady_clock::time_point start,
+                                 std::chrono::steady_clock::time_point end) {
+    FlightFrameRecord* record = m_Current;
+    if (!record)
+        return;
+    unsigned int slot = record->ScopeCount.fetch_add(1, std::memory_order_relaxed);
+    if (slot >= FLIGHT_RECORDER_MAX_SCOPES)
+        return;
+    record->Scopes[slot] = {
+        name, GetThreadNumber(),
+        static_cast<float>(ToMicroseconds(start - m_FrameStart)), static_cast<float>(ToMicroseconds(end - m_FrameStart))
+    };
+}
+
+bool FlightRecorder::Dump(const std::string& path) const {
+    MemoryTagScope tag(MemoryTag::Logging);
+    std::vector<const FlightFrameRecord*> frames;
+    for (int i = 0; i < FLIGHT_RECORDER_FRAMES; i++) {
+        if (m_Frames[i].Index != ULLONG_MAX && &m_Frames[i] != m_Current)
+            frames.push_back(&m_Frames[i]);
+    }
+    std::sort(frames.begin(), frames.end(), [](const FlightFrameRecord* a, const FlightFrameRecord* b) {
+        return a->Index < b->Index;
+    });
+
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "[Flight Recorder] cannot write " << path << std::endl;
+        return false;
+    }
+    out.setf(std::ios::fixed);
+    out.precision(3);
+
+    // Chrome trace event format: frames on tid 0, scopes on one track per thread
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Frames\"}}";
+    for (const FlightFrameRecord* frame : frames) {
+        const RenderStats& stats = frame->Stats;
+        bool over = m_BudgetMs > 0.0 && (frame->CpuMs > m_BudgetMs || frame->GpuMs > m_BudgetMs);
+        out << ",\n{\"name\":\"" << (over ? "Frame (over budget)" : "Frame") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":0"
+            << ",\"ts\":" << frame->StartUs << ",\"dur\":" << frame->CpuMs * 1000.0
+            << ",\"args\":{\"index\":" << frame->Index << ",\"gpu_ms\":" << frame->GpuMs
+            << ",\"draws\":" << stats.DrawCalls << ",\"triangles\":" << stats.Triangles
+            << ",\"state_changes\":" << stats.StateChanges << ",\"resources_created\":" << stats.ResourcesCreated
+            << ",\"resources_deleted\":" << stats.ResourcesDeleted << ",\"bytes_uploaded\":" << stats.BytesUploaded
+            << ",\"arena_bytes\":" << frame->Arena.Used << ",\"arena_overflows\":" << frame->Arena.Overflows
+            << ",\"host_allocations\":" << frame->HostAllocations << ",\"host_allocated_bytes\":" << frame->HostAllocatedBytes
+            << ",\"host_live_bytes\":" << frame->HostLiveBytes << "}}";
+
+        out << ",\n{\"name\":\"Counters\",\"ph\":\"C\",\"pid\":1,\"ts\":" << frame->StartUs
+            << ",\"args\":{\"cpu_ms\":" << frame->CpuMs << ",\"gpu_ms\":" << std::max(frame->GpuMs, 0.0f)
+            << ",\"draws\":" << stats.DrawCalls << ",\"host_allocations\":" << frame->HostAllocations << "}}";
+
+        unsigned int scopes = std::min<unsigned int>(frame->ScopeCount.load(std::memory_order_relaxed), FLIGHT_RECORDER_MAX_SCOPES);
+        for (unsigned int i = 0; i < scopes; i++) {
+            const FlightScopeRecord& scope = frame->Scopes[i];
+            out << ",\n{\"name\":\"" << scope.Name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << scope.Thread + 1
+                << ",\"ts\":" << frame->StartUs + scope.StartUs << ",\"dur\":" << scope.EndUs - scope.StartUs << "}";
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
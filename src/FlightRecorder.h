@@ -0,0 +1,110 @@
+#pragma once
+
+#include "FrameArena.h"
+#include "GLResource.h"
+#include "RenderBackend.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+// Frames kept in the ring; a dump covers all of them
+#define FLIGHT_RECORDER_FRAMES 300
+// Scopes recorded per frame, across all threads; further scopes are dropped
+#define FLIGHT_RECORDER_MAX_SCOPES 32
+// Timer queries in flight; results are read this many frames late
+#define FLIGHT_RECORDER_GPU_LATENCY 4
+#define FLIGHT_RECORDER_DIRECTORY "flight_records"
+#define FLIGHT_RECORDER_DEFAULT_BUDGET_MS 50.0
+
+struct FlightScopeRecord {
+    const char* Name;              // must be a string literal or otherwise outlive the recorder
+    unsigned int Thread;
+    float StartUs;                 // relative to the frame start
+    float EndUs;
+};
+
+struct FlightFrameRecord {
+    unsigned long long Index = 0;
+    double StartUs = 0.0;          // since the recorder was created
+    float CpuMs = 0.0f;
+    float GpuMs = -1.0f;           // negative until the timer query result arrives
+    RenderStats Stats;
+    FrameArenaStats Arena;
+    unsigned long long HostAllocations = 0;  // operator new calls during the frame
+    size_t HostAllocatedBytes = 0;
+    size_t HostLiveBytes = 0;
+    std::atomic<unsigned int> ScopeCount = 0;
+    FlightScopeRecord Scopes[FLIGHT_RECORDER_MAX_SCOPES];
+};
+
+// Always-on record of the last FLIGHT_RECORDER_FRAMES frames: CPU scopes, GPU
+// frame time, draw and resource counters, host allocations and frame arena
+// usage. Storage is allocated once up front, so recording costs a few clock
+// reads per scope. When a frame runs over budget the whole ring is written as
+// a Chrome trace (chrome://tracing or Perfetto) to FLIGHT_RECORDER_DIRECTORY.
+class FlightRecorder {
+public:
+    FlightRecorder();
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    // 0 disables the automatic dumps; recording continues
+    void SetBudget(double milliseconds) { m_BudgetMs = milliseconds; }
+
+    // GL thread, around everything the frame does; EndHostMemoryFrame() must
+    // run before EndFrame so the host allocation counts cover this frame
+    void BeginFrame(RenderBackend& backend, unsigned long long index);
+    void EndFrame(RenderBackend& backend, const FrameArenaStats& arena);
+    // Drops the timer queries; call before the context goes away
+    void Release();
+
+    // Any thread, between BeginFrame and EndFrame
+    void RecordScope(const char* name, std::chrono::steady_clock::time_point start,
+                     std::chrono::steady_clock::time_point end);
+
+    // Writes every frame still in the ring; returns false if the file cannot be written
+    bool Dump(const std::string& path) const;
+    unsigned int GetDumpCount() const { return m_Dumps; }
+
+private:
+    void CollectGpuTimes(RenderBackend& backend);
+    FlightFrameRecord* FindFrame(unsigned long long index);
+
+    std::unique_ptr<FlightFrameRecord[]> m_Frames;
+    FlightFrameRecord* m_Current = nullptr;
+    unsigned long long m_Recorded = 0;
+    std::chrono::steady_clock::time_point m_Epoch;
+    std::chrono::steady_clock::time_point m_FrameStart;
+
+    QueryHandle m_Queries[FLIGHT_RECORDER_GPU_LATENCY];
+    unsigned long long m_QueryFrames[FLIGHT_RECORDER_GPU_LATENCY] = {};
+    bool m_QueryPending[FLIGHT_RECORDER_GPU_LATENCY] = {};
+    bool m_TimerActive = false;
+
+    double m_BudgetMs = 0.0;
+    unsigned long long m_PendingDump = ~0ull;  // over-budget frame waiting for its GPU time
+    unsigned long long m_NextDumpFrame = 0;    // dumps never overlap
+    unsigned int m_Dumps = 0;
+};
+
+// Records the enclosing block as one scope of the current frame
+class FlightScope {
+public:
+    FlightScope(FlightRecorder* recorder, const char* name)
+        : m_Recorder(recorder), m_Name(name), m_Start(std::chrono::steady_clock::now()) {}
+    ~FlightScope() {
+        if (m_Recorder)
+            m_Recorder->RecordScope(m_Name, m_Start, std::chrono::steady_clock::now());
+    }
+
+    FlightScope(const FlightScope&) = delete;
+    FlightScope& operator=(const FlightScope&) = delete;
+
+private:
+    FlightRecorder* m_Recorder;
+    const char* m_Name;
+    std::chrono::steady_clock::time_point m_Start;
+};
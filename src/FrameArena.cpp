@@ -0,0 +1,103 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <atomic>
+
+LinearArena::LinearArena(size_t capacity, std::pmr::memory_resource* upstream)
+    : m_Upstream(upstream), m_Capacity(capacity) {
+    m_Memory = static_cast<unsigned char*>(m_Upstream->allocate(m_Capacity, alignof(std::max_align_t)));
+}
+
+LinearArena::~LinearArena() {
+    Reset();
+    m_Upstream->deallocate(m_Memory, m_Capacity, alignof(std::max_align_t));
+}
+
+void LinearArena::Reset() {
+    bool overflowed = !m_Overflow.empty();
+    for (const Block& block : m_Overflow)
+        m_Upstream->deallocate(block.Memory, block.Size, block.Alignment);
+    m_Overflow.clear();
+
+    if (overflowed) {
+        // Grow to the high-water mark so steady-state frames stay inside the block
+        m_Upstream->deallocate(m_Memory, m_Capacity, alignof(std::max_align_t));
+        m_Capacity = std::max(m_Capacity * 2, m_Peak);
+        m_Memory = static_cast<unsigned char*>(m_Upstream->allocate(m_Capacity, alignof(std::max_align_t)));
+    }
+    m_Offset = 0;
+    m_Used = 0;
+}
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment) {
+    size_t offset = (m_Offset + alignment - 1) & ~(alignment - 1);
+    void* p;
+    if (offset + bytes <= m_Capacity) {
+        p = m_Memory + offset;
+        m_Used += offset + bytes - m_Offset;
+        m_Offset = offset + bytes;
+    } else {
+        p = m_Upstream->allocate(bytes, alignment);
+        m_Overflow.push_back({ p, bytes, alignment });
+        m_Used += bytes;
+    }
+    m_Peak = std::max(m_Peak, m_Used);
+    return p;
+}
+
+void LinearArena::do_deallocate(void*, size_t, size_t) {
+    // Memory is only reclaimed by Reset(). Rolling back the top allocation is
+    // not safe here: containers from an earlier use of this arena may still
+    // release blocks that now overlap live allocations.
+}
+
+static std::atomic<unsigned int> s_NextGeneration = 0;
+
+FrameArena::FrameArena(size_t bytesPerThread)
+    : m_BytesPerThread(bytesPerThread), m_Generation(++s_NextGeneration) {
+}
+
+void FrameArena::BeginFrame(unsigned long long frame) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Current = static_cast<unsigned int>(frame % FRAME_ARENA_BUFFERS);
+    for (auto& thread : m_Threads)
+        thread->Buffers[m_Current]->Reset();
+}
+
+LinearArena& FrameArena::GetThreadArena() {
+    // Cache the lookup per thread; the generation guards against a different
+    // (or destroyed and reallocated) FrameArena being used on the same thread
+    thread_local unsigned int cachedGeneration = 0;
+    thread_local ThreadArenas* cachedArenas = nullptr;
+    if (cachedGeneration != m_Generation) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        std::thread::id id = std::this_thread::get_id();
+        auto it = std::find_if(m_Threads.begin(), m_Threads.end(), [&](const auto& t) { return t->Thread == id; });
+        if (it == m_Threads.end()) {
+            auto arenas = std::make_unique<ThreadArenas>();
+            arenas->Thread = id;
+            for (auto& buffer : arenas->Buffers)
+                buffer = std::make_unique<LinearArena>(m_BytesPerThread);
+            m_Threads.push_back(std::move(arenas));
+            it = m_Threads.end() - 1;
+        }
+        cachedArenas = it->get();
+        cachedGeneration = m_Generation;
+    }
+    return *cachedArenas->Buffers[m_Current];
+}
+
+FrameArenaStats FrameArena::GetStats() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    FrameArenaStats stats;
+    stats.Threads = static_cast<unsigned int>(m_Threads.size());
+    for (const auto& thread : m_Threads) {
+        const LinearArena& arena = *thread->Buffers[m_Current];
+        stats.Used += arena.GetUsed();
+        stats.Capacity += arena.GetCapacity();
+        stats.Overflows += arena.GetOverflowCount();
+        for (const auto& buffer : thread->Buffers)
+            stats.Peak = std::max(stats.Peak, buffer->GetPeak());
+    }
+    return stats;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Frames of transient data kept alive at once. Data handed to the GPU in
+// frame N is not overwritten until frame N + FRAME_ARENA_BUFFERS begins.
+#define FRAME_ARENA_BUFFERS 3
+
+// Bump allocator over one contiguous block. Deallocation is a no-op; Reset()
+// releases everything at once, including memory still referenced by
+// containers that outlived the frame, so those must be rebuilt, not reused. Requests that do not fit are served from the
+// upstream resource, and the next Reset() grows the block so the following
+// frames fit again.
+class LinearArena : public std::pmr::memory_resource {
+public:
+    explicit LinearArena(size_t capacity, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~LinearArena() override;
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    void Reset();
+
+    size_t GetUsed() const { return m_Used; }
+    size_t GetPeak() const { return m_Peak; }
+    size_t GetCapacity() const { return m_Capacity; }
+    // Allocations since the last Reset() that had to go to the upstream resource
+    size_t GetOverflowCount() const { return m_Overflow.size(); }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    struct Block {
+        void* Memory;
+        size_t Size;
+        size_t Alignment;
+    };
+
+    std::pmr::memory_resource* m_Upstream;
+    unsigned char* m_Memory;
+    size_t m_Capacity;
+    size_t m_Offset = 0;
+    size_t m_Used = 0;     // includes overflow allocations
+    size_t m_Peak = 0;
+    std::vector<Block> m_Overflow;
+};
+
+struct FrameArenaStats {
+    size_t Used = 0;            // bytes allocated this frame, all threads
+    size_t Peak = 0;            // highest single-arena usage seen so far
+    size_t Capacity = 0;
+    size_t Overflows = 0;       // allocations this frame that fell back to the heap
+    unsigned int Threads = 0;
+};
+
+// Per-frame allocator for draw lists, visible sets and other data that dies at
+// the end of the frame. Every thread gets its own sub-arena so allocation
+// takes no lock, and each sub-arena is FRAME_ARENA_BUFFERS-buffered.
+class FrameArena {
+public:
+    explicit FrameArena(size_t bytesPerThread = 256 * 1024);
+
+    // Recycles the arenas last used FRAME_ARENA_BUFFERS frames ago. Must not
+    // race with allocations from other threads.
+    void BeginFrame(unsigned long long frame);
+
+    // Calling thread's arena for the current frame
+    LinearArena& GetThreadArena();
+    std::pmr::memory_resource* GetResource() { return &GetThreadArena(); }
+
+    FrameArenaStats GetStats();
+
+private:
+    struct ThreadArenas {
+        std::thread::id Thread;
+        std::unique_ptr<LinearArena> Buffers[FRAME_ARENA_BUFFERS];
+    };
+
+    size_t m_BytesPerThread;
+    unsigned int m_Current = 0;
+    unsigned int m_Generation;
+    std::mutex m_Mutex;
+    std::vector<std::unique_ptr<ThreadArenas>> m_Threads;
+};
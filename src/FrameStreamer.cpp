@@ -0,0 +1,417 @@
+#include "FrameStreamer.h"
+#include "JobSystem.h"
+#include "Lz4.h"
+#include "RenderBackend.h"
+
+#include <GL/glew.h>
+
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define STREAM_SSE2 1
+#endif
+
+// Tiles are compared row by row and most rows of a changed tile still match,
+// so the common case is a full 256-byte row (64 RGBA pixels) that is equal
+static bool RowsEqual(const unsigned char* a, const unsigned char* b, size_t size) {
+    size_t i = 0;
+#ifdef STREAM_SSE2
+    for (; i + 64 <= size; i += 64) {
+        __m128i equal = _mm_and_si128(
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))),
+                          _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 16)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 16)))),
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 32)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 32))),
+                          _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 48)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 48)))));
+        if (_mm_movemask_epi8(equal) != 0xFFFF)
+            return false;
+    }
+    for (; i + 16 <= size; i += 16) {
+        __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        if (_mm_movemask_epi8(equal) != 0xFFFF)
+            return false;
+    }
+#endif
+    return std::memcmp(a + i, b + i, size - i) == 0;
+}
+
+FrameStreamer::~FrameStreamer() {
+    // Stop(backend) releases the GL side; without it only the thread can go
+    if (m_Thread.joinable()) {
+        m_Quit = true;
+        uint64_t one = 1;
+        (void)write(m_WakeFd, &one, sizeof(one));
+        m_Thread.join();
+    }
+}
+
+bool FrameStreamer::Start(const std::string& address, JobSystem* jobs) {
+    m_ListenFd = ListenStreamSocket(address);
+    if (m_ListenFd < 0)
+        return false;
+    m_WakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_WakeFd < 0) {
+        close(m_ListenFd);
+        m_ListenFd = -1;
+        return false;
+    }
+    // Without workers nothing would run queued jobs between frames
+    m_Jobs = jobs && jobs->GetWorkerCount() > 0 ? jobs : nullptr;
+    m_Address = address;
+    m_Quit = false;
+    m_Thread = std::thread(&FrameStreamer::Run, this);
+    std::cout << "[Stream] listening on " << address << std::endl;
+    return true;
+}
+
+void FrameStreamer::Stop(RenderBackend& backend) {
+    if (!m_Thread.joinable())
+        return;
+    m_Quit = true;
+    uint64_t one = 1;
+    (void)write(m_WakeFd, &one, sizeof(one));
+    m_Thread.join();
+
+    while (m_Encoding && m_RowsLeft.load(std::memory_order_acquire) != 0) {
+        if (!m_Jobs || !m_Jobs->RunOne())
+            std::this_thread::yield();
+    }
+    if (m_Encoding) {
+        backend.UnmapBuffer(GL_PIXEL_PACK_BUFFER, m_Readbacks[m_EncodingReadback].Buffer.Get());
+        m_Encoding = false;
+    }
+    DropReadbacks(backend);
+    m_Readbacks.clear();
+
+    Disconnect();
+    close(m_ListenFd);
+    close(m_WakeFd);
+    m_ListenFd = m_WakeFd = -1;
+    if (m_Address.compare(0, 4, "tcp:") != 0)
+        unlink(m_Address.c_str());
+
+    std::cout << "[Stream] " << m_FramesSent << " frame(s) sent, " << m_FramesSkipped << " skipped, "
+              << (m_FramesSent ? m_BytesSent / 1024.0 / m_FramesSent : 0.0) << " KB/frame; encode "
+              << (m_FramesSent ? m_EncodeMsTotal / m_FramesSent : 0.0) << " ms avg, " << m_EncodeMsMax << " ms max, "
+              << m_OverTarget << " over " << FRAME_STREAM_TARGET_MS << " ms" << std::endl;
+}
+
+void FrameStreamer::DropReadbacks(RenderBackend& backend) {
+    for (unsigned int index : m_Pending) {
+        backend.DeleteFence(m_Readbacks[index].Fence);
+        m_Readbacks[index].Fence = nullptr;
+        m_Free.push_back(index);
+    }
+    m_Pending.clear();
+}
+
+void FrameStreamer::Resize(RenderBackend& backend, int width, int height) {
+    DropReadbacks(backend);
+    m_Width = width;
+    m_Height = height;
+    m_TileColumns = (static_cast<unsigned int>(width) + STREAM_TILE_SIZE - 1) / STREAM_TILE_SIZE;
+    m_TileRows = (static_cast<unsigned int>(height) + STREAM_TILE_SIZE - 1) / STREAM_TILE_SIZE;
+
+    size_t frameBytes = static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+    m_Readbacks.clear();
+    m_Readbacks.resize(FRAME_STREAM_READBACK_BUFFERS);
+    m_Free.clear();
+    for (unsigned int i = 0; i < FRAME_STREAM_READBACK_BUFFERS; i++) {
+        m_Readbacks[i].Buffer = BufferHandle(backend, backend.CreateBuffer(GL_PIXEL_PACK_BUFFER, nullptr, frameBytes, GL_STREAM_READ));
+        m_Free.push_back(i);
+    }
+    // A bound pack buffer would turn every other ReadPixels into a readback to it
+    backend.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_Previous.assign(frameBytes, 0);
+    m_Tiles.resize(static_cast<size_t>(m_TileColumns) * m_TileRows);
+    for (unsigned int row = 0; row < m_TileRows; row++) {
+        for (unsigned int column = 0; column < m_TileColumns; column++) {
+            size_t tileWidth = std::min<size_t>(STREAM_TILE_SIZE, width - column * STREAM_TILE_SIZE);
+            size_t tileHeight = std::min<size_t>(STREAM_TILE_SIZE, height - row * STREAM_TILE_SIZE);
+            // Compressed data is only kept when smaller than the raw tile
+            m_Tiles[row * m_TileColumns + column].Data.resize(tileWidth * tileHeight * 3);
+        }
+    }
+    m_KeyframeRequested = true;
+}
+
+void FrameStreamer::EndFrame(RenderBackend& backend, int width, int height) {
+    if (!m_Thread.joinable() || width <= 0 || height <= 0)
+        return;
+    if (m_Encoding && m_RowsLeft.load(std::memory_order_acquire) == 0)
+        FinishEncode(backend);
+    if (width != m_Width || height != m_Height) {
+        // Picked up again once the encode in flight no longer reads the old buffers
+        if (m_Encoding)
+            return;
+        Resize(backend, width, height);
+    }
+
+    bool connected = m_Connected.load(std::memory_order_acquire);
+    if (!m_Pending.empty()) {
+        unsigned int oldest = m_Pending.front();
+        Readback& readback = m_Readbacks[oldest];
+        if (backend.WaitFence(readback.Fence, 0)) {
+            backend.DeleteFence(readback.Fence);
+            readback.Fence = nullptr;
+            m_Pending.pop_front();
+            if (connected && !m_Encoding && !m_Sending.load(std::memory_order_acquire)) {
+                BeginEncode(backend, readback);
+                m_EncodingReadback = oldest;
+            } else {
+                if (connected)
+                    m_FramesSkipped++;
+                m_Free.push_back(oldest);
+            }
+        }
+    }
+
+    // Nobody watching: no readbacks at all
+    if (!connected || m_Free.empty())
+        return;
+    unsigned int index = m_Free.back();
+    m_Free.pop_back();
+    Readback& readback = m_Readbacks[index];
+    backend.BindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer.Get());
+    backend.ReadPixels(0, 0, width, height, nullptr);
+    backend.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.Fence = backend.InsertFence();
+    readback.Frame = m_Frame++;
+    m_Pending.push_back(index);
+}
+
+void FrameStreamer::BeginEncode(RenderBackend& backend, Readback& readback) {
+    size_t frameBytes = static_cast<size_t>(m_Width) * static_cast<size_t>(m_Height) * 4;
+    m_Mapped = static_cast<const unsigned char*>(backend.MapBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer.Get(), 0, frameBytes));
+    backend.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_EncodeStart = std::chrono::steady_clock::now();
+    m_EncodeFlags = 0;
+    if (m_KeyframeRequested.exchange(false)) {
+        // XOR against black sends the tiles as they are
+        m_EncodeFlags = STREAM_FRAME_KEY;
+        std::fill(m_Previous.begin(), m_Previous.end(), 0);
+    }
+    m_Encoding = true;
+    m_EncodingFrame = readback.Frame;
+
+    m_RowsLeft.store(m_TileRows, std::memory_order_relaxed);
+    if (!m_Jobs) {
+        for (unsigned int row = 0; row < m_TileRows; row++)
+            EncodeTileRow(row);
+        m_RowsLeft.store(0, std::memory_order_release);
+        return;
+    }
+    for (unsigned int row = 0; row < m_TileRows; row++) {
+        m_Jobs->Enqueue([this, row] {
+            EncodeTileRow(row);
+            m_RowsLeft.fetch_sub(1, std::memory_order_release);
+        });
+    }
+}
+
+void FrameStreamer::EncodeTileRow(unsigned int row) {
+    static thread_local std::vector<unsigned char> raw;
+    raw.resize(STREAM_TILE_SIZE * STREAM_TILE_SIZE * 3);
+
+    size_t width = static_cast<size_t>(m_Width);
+    size_t y0 = static_cast<size_t>(row) * STREAM_TILE_SIZE;
+    size_t tileHeight = std::min<size_t>(STREAM_TILE_SIZE, m_Height - y0);
+    bool keyframe = (m_EncodeFlags & STREAM_FRAME_KEY) != 0;
+
+    for (unsigned int column = 0; column < m_TileColumns; column++) {
+        EncodedTile& tile = m_Tiles[row * m_TileColumns + column];
+        tile.Changed = false;
+        size_t x0 = static_cast<size_t>(column) * STREAM_TILE_SIZE;
+        size_t tileWidth = std::min<size_t>(STREAM_TILE_SIZE, width - x0);
+        size_t rowBytes = tileWidth * 4;
+
+        size_t firstChanged = 0;
+        while (!keyframe && firstChanged < tileHeight) {
+            size_t offset = ((y0 + firstChanged) * width + x0) * 4;
+            if (!RowsEqual(m_Mapped + offset, m_Previous.data() + offset, rowBytes))
+                break;
+            firstChanged++;
+        }
+        if (firstChanged == tileHeight)
+            continue;
+
+        // Rows before the first change XOR to zero
+        std::memset(raw.data(), 0, firstChanged * tileWidth * 3);
+        for (size_t y = firstChanged; y < tileHeight; y++) {
+            size_t offset = ((y0 + y) * width + x0) * 4;
+            const unsigned char* current = m_Mapped + offset;
+            unsigned char* previous = m_Previous.data() + offset;
+            unsigned char* out = raw.data() + y * tileWidth * 3;
+            for (size_t x = 0; x < tileWidth; x++) {
+                out[x * 3 + 0] = current[x * 4 + 0] ^ previous[x * 4 + 0];
+                out[x * 3 + 1] = current[x * 4 + 1] ^ previous[x * 4 + 1];
+                out[x * 3 + 2] = current[x * 4 + 2] ^ previous[x * 4 + 2];
+            }
+            std::memcpy(previous, current, rowBytes);
+        }
+
+        size_t rawSize = tileWidth * tileHeight * 3;
+        size_t size = Lz4Compress(raw.data(), rawSize, tile.Data.data(), rawSize - 1);
+        if (size == 0) {
+            std::memcpy(tile.Data.data(), raw.data(), rawSize);
+            size = rawSize;
+        }
+        tile.Header.X = static_cast<uint16_t>(column);
+        tile.Header.Y = static_cast<uint16_t>(row);
+        tile.Header.Size = static_cast<uint32_t>(size);
+        tile.Changed = true;
+    }
+}
+
+void FrameStreamer::FinishEncode(RenderBackend& backend) {
+    backend.UnmapBuffer(GL_PIXEL_PACK_BUFFER, m_Readbacks[m_EncodingReadback].Buffer.Get());
+    backend.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_Free.push_back(m_EncodingReadback);
+    m_Mapped = nullptr;
+    m_Encoding = false;
+
+    // m_Sending is clear: encodes only start while it is
+    m_Packet.resize(sizeof(StreamFrameHeader));
+    unsigned int tileCount = 0;
+    for (const EncodedTile& tile : m_Tiles) {
+        if (!tile.Changed)
+            continue;
+        size_t offset = m_Packet.size();
+        m_Packet.resize(offset + sizeof(StreamTileHeader) + tile.Header.Size);
+        std::memcpy(m_Packet.data() + offset, &tile.Header, sizeof(StreamTileHeader));
+        std::memcpy(m_Packet.data() + offset + sizeof(StreamTileHeader), tile.Data.data(), tile.Header.Size);
+        tileCount++;
+    }
+    double encodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_EncodeStart).count();
+
+    StreamFrameHeader header;
+    header.Magic = STREAM_MAGIC;
+    header.Frame = m_EncodingFrame;
+    header.Width = static_cast<uint16_t>(m_Width);
+    header.Height = static_cast<uint16_t>(m_Height);
+    header.TileSize = STREAM_TILE_SIZE;
+    header.TileCount = static_cast<uint16_t>(tileCount);
+    header.PayloadSize = static_cast<uint32_t>(m_Packet.size() - sizeof(header));
+    header.Flags = m_EncodeFlags;
+    header.EncodeMicros = static_cast<uint32_t>(encodeMs * 1000.0);
+    std::memcpy(m_Packet.data(), &header, sizeof(header));
+
+    m_FramesSent++;
+    m_BytesSent += m_Packet.size();
+    m_EncodeMsTotal += encodeMs;
+    m_EncodeMsMax = std::max(m_EncodeMsMax, encodeMs);
+    if (encodeMs > FRAME_STREAM_TARGET_MS)
+        m_OverTarget++;
+
+    m_SendOffset = 0;
+    m_Sending.store(true, std::memory_order_release);
+    uint64_t one = 1;
+    (void)write(m_WakeFd, &one, sizeof(one));
+}
+
+void FrameStreamer::Run() {
+    while (!m_Quit) {
+        bool sending = m_Sending.load(std::memory_order_acquire);
+        if (sending && m_ClientFd < 0) {
+            // The viewer left while the frame was encoded
+            m_Sending.store(false, std::memory_order_release);
+            sending = false;
+        }
+        pollfd fds[3] = {
+            { m_WakeFd, POLLIN, 0 },
+            { m_ListenFd, POLLIN, 0 },
+            { m_ClientFd, static_cast<short>(POLLIN | (sending ? POLLOUT : 0)), 0 },
+        };
+        if (poll(fds, m_ClientFd >= 0 ? 3 : 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            std::cout << "[Stream] poll: " << std::strerror(errno) << std::endl;
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            uint64_t count;
+            (void)read(m_WakeFd, &count, sizeof(count));
+        }
+        if (m_ClientFd >= 0 && (fds[2].revents & (POLLIN | POLLHUP | POLLERR)) && !ReadInput())
+            Disconnect();
+        if (m_ClientFd >= 0 && m_Sending.load(std::memory_order_acquire) && !SendPacket())
+            Disconnect();
+        if (fds[1].revents & POLLIN)
+            Accept();
+    }
+}
+
+void FrameStreamer::Accept() {
+    int fd = accept4(m_ListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+    // One viewer at a time; the newest one takes over
+    if (m_ClientFd >= 0)
+        Disconnect();
+    int bufferBytes = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferBytes, sizeof(bufferBytes));
+    if (m_Address.compare(0, 4, "tcp:") == 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    m_ClientFd = fd;
+    m_InputBytes = 0;
+    m_KeyframeRequested = true;
+    m_Connected.store(true, std::memory_order_release);
+    std::cout << "[Stream] viewer connected" << std::endl;
+}
+
+void FrameStreamer::Disconnect() {
+    if (m_ClientFd < 0)
+        return;
+    close(m_ClientFd);
+    m_ClientFd = -1;
+    m_Connected.store(false, std::memory_order_release);
+    // A partly sent packet is worthless to the next viewer
+    if (m_Sending.load(std::memory_order_acquire))
+        m_Sending.store(false, std::memory_order_release);
+    std::cout << "[Stream] viewer disconnected" << std::endl;
+}
+
+bool FrameStreamer::ReadInput() {
+    while (true) {
+        ssize_t n = read(m_ClientFd, reinterpret_cast<char*>(&m_InputPartial) + m_InputBytes, sizeof(m_InputPartial) - m_InputBytes);
+        if (n == 0)
+            return false;
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        m_InputBytes += static_cast<size_t>(n);
+        if (m_InputBytes == sizeof(m_InputPartial)) {
+            // A full queue means the render thread is far behind; dropping keys beats blocking
+            m_Input.Push(StreamInputEvent(m_InputPartial));
+            m_InputBytes = 0;
+        }
+    }
+}
+
+bool FrameStreamer::SendPacket() {
+    while (m_SendOffset < m_Packet.size()) {
+        ssize_t n = send(m_ClientFd, m_Packet.data() + m_SendOffset, m_Packet.size() - m_SendOffset, MSG_NOSIGNAL);
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        m_SendOffset += static_cast<size_t>(n);
+    }
+    m_Sending.store(false, std::memory_order_release);
+    return true;
+}
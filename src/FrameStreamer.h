@@ -0,0 +1,127 @@
+#pragma once
+
+#include "GLResource.h"
+#include "SpscQueue.h"
+#include "StreamProtocol.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+class RenderBackend;
+
+#define FRAME_STREAM_DEFAULT_ADDRESS "modernopengl-stream.sock"
+// Pixel pack buffers in flight; a readback is mapped this many frames later
+// at the latest, by which time the GPU has long finished it
+#define FRAME_STREAM_READBACK_BUFFERS 3
+// Encode latency the stats are reported against (one frame at 60 Hz)
+#define FRAME_STREAM_TARGET_MS 16.7
+
+// Streams the rendered frames to one viewer (tools/StreamViewer) over a
+// local socket and applies the input it sends back.
+//
+// Per frame, on the GL thread, EndFrame starts an asynchronous readback into
+// a pixel pack buffer and fences it. A later frame maps the oldest finished
+// readback and hands it to the job system: one job per row of tiles compares
+// each tile with the previous sent frame using SSE2 (skipping it after the
+// first differing row), XORs and LZ4-compresses the changed ones, and
+// refreshes the reference copy. The frame after that collects the tiles into
+// a packet for the network thread. Neither step waits: while an encode or a
+// send is still running, new readbacks are dropped rather than queued, so a
+// slow viewer lowers the stream's frame rate instead of the renderer's.
+class FrameStreamer {
+public:
+    FrameStreamer() = default;
+    ~FrameStreamer();
+
+    FrameStreamer(const FrameStreamer&) = delete;
+    FrameStreamer& operator=(const FrameStreamer&) = delete;
+
+    // `address` as for ListenStreamSocket. With no job system tiles are encoded inline.
+    bool Start(const std::string& address, JobSystem* jobs);
+    // Waits for the encode in flight and releases the readback buffers
+    void Stop(RenderBackend& backend);
+    bool IsRunning() const { return m_Thread.joinable(); }
+
+    // GL thread, after the frame is drawn and before it is presented
+    void EndFrame(RenderBackend& backend, int width, int height);
+    // GL thread. Next input event from the viewer; false when there is none.
+    bool PollInput(StreamInputEvent& event) { return m_Input.Pop(event); }
+
+private:
+    struct Readback {
+        BufferHandle Buffer;
+        void* Fence = nullptr;
+        unsigned int Frame = 0;
+    };
+    struct EncodedTile {
+        StreamTileHeader Header;
+        bool Changed;
+        std::vector<unsigned char> Data;
+    };
+
+    void Resize(RenderBackend& backend, int width, int height);
+    void DropReadbacks(RenderBackend& backend);
+    void BeginEncode(RenderBackend& backend, Readback& readback);
+    void FinishEncode(RenderBackend& backend);
+    void EncodeTileRow(unsigned int row);
+
+    void Run();
+    void Accept();
+    bool ReadInput();
+    bool SendPacket();
+    void Disconnect();
+
+    JobSystem* m_Jobs = nullptr;
+    std::string m_Address;
+
+    // GL thread
+    int m_Width = 0, m_Height = 0;
+    unsigned int m_TileColumns = 0, m_TileRows = 0;
+    unsigned int m_Frame = 0;
+    std::vector<Readback> m_Readbacks;
+    std::deque<unsigned int> m_Pending;      // readback indices in submission order
+    std::vector<unsigned int> m_Free;
+
+    // Encode in flight: the mapped readback, the previous sent frame (RGBA,
+    // bottom row first) and one slot per tile
+    bool m_Encoding = false;
+    unsigned int m_EncodingReadback = 0;
+    unsigned int m_EncodingFrame = 0;
+    const unsigned char* m_Mapped = nullptr;
+    std::vector<unsigned char> m_Previous;
+    std::vector<EncodedTile> m_Tiles;
+    std::atomic<unsigned int> m_RowsLeft = 0;
+    uint32_t m_EncodeFlags = 0;
+    std::chrono::steady_clock::time_point m_EncodeStart;
+
+    // Owned by the network thread while m_Sending is set
+    std::vector<unsigned char> m_Packet;
+    size_t m_SendOffset = 0;
+    std::atomic<bool> m_Sending = false;
+
+    // Network thread
+    int m_ListenFd = -1;
+    int m_ClientFd = -1;
+    int m_WakeFd = -1;
+    StreamInputEvent m_InputPartial = {};
+    size_t m_InputBytes = 0;
+    std::atomic<bool> m_Connected = false;
+    std::atomic<bool> m_KeyframeRequested = false;
+    SpscQueue<StreamInputEvent, 256> m_Input;
+
+    std::thread m_Thread;
+    std::atomic<bool> m_Quit = false;
+
+    // Stats, GL thread
+    unsigned long long m_FramesSent = 0;
+    unsigned long long m_FramesSkipped = 0;
+    unsigned long long m_BytesSent = 0;
+    double m_EncodeMsTotal = 0.0;
+    double m_EncodeMsMax = 0.0;
+    unsigned long long m_OverTarget = 0;
+};
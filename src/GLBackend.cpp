@@ -0,0 +1,469 @@
+#include "GLBackend.h"
+#include "Renderer.h"
+#include "Shader.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Linked program binaries are cached here, keyed by source and driver
+#define SHADER_CACHE_DIRECTORY "shader_cache"
+
+static std::string GetProgramCachePath(const ShaderProgramSource& source, const std::string& driver) {
+    // FNV-1a over everything that affects the binary
+    unsigned long long hash = 14695981039346656037ull;
+    for (const std::string* part : { &source.VertexSource, &source.FragmentSource, &driver }) {
+        for (unsigned char c : *part)
+            hash = (hash ^ c) * 1099511628211ull;
+        hash = (hash ^ 0xff) * 1099511628211ull;
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", hash);
+    return std::string(SHADER_CACHE_DIRECTORY) + "/" + name;
+}
+
+static bool LoadCachedProgram(const std::string& path, unsigned int& program) {
+    if (!GLEW_ARB_get_program_binary)
+        return false;
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return false;
+
+    GLenum format;
+    std::vector<char> binary;
+    stream.read(reinterpret_cast<char*>(&format), sizeof(format));
+    binary.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    if (!stream.eof() || binary.empty())
+        return false;
+
+    GLCall(program = glCreateProgram());
+    GLCall(glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size())));
+    int linked;
+    GLCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+    if (linked == GL_FALSE) {
+        // Driver updates invalidate binaries; fall back to compiling from source
+        GLCall(glDeleteProgram(program));
+        return false;
+    }
+    return true;
+}
+
+static void SaveCachedProgram(const std::string& path, unsigned int program) {
+    if (!GLEW_ARB_get_program_binary)
+        return;
+    int length = 0;
+    GLCall(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0)
+        return;
+
+    GLenum format;
+    std::vector<char> binary(length);
+    GLCall(glGetProgramBinary(program, length, nullptr, &format, binary.data()));
+
+    std::error_code error;
+    std::filesystem::create_directories(SHADER_CACHE_DIRECTORY, error);
+    std::ofstream stream(path, std::ios::binary);
+    stream.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    stream.write(binary.data(), length);
+}
+
+unsigned int GLBackend::CreateBuffer(unsigned int target, const void* data, size_t size, unsigned int usage) {
+    unsigned int buffer;
+    GLCall(glGenBuffers(1, &buffer));
+    GLCall(glBindBuffer(target, buffer));
+    GLCall(glBufferData(target, static_cast<GLsizeiptr>(size), data, usage));
+    CountCreate(size);
+    TrackBuffer(target, buffer, size);
+    return buffer;
+}
+
+void GLBackend::BindBuffer(unsigned int target, unsigned int buffer) {
+    GLCall(glBindBuffer(target, buffer));
+    CountStateChange();
+}
+
+void* GLBackend::MapBuffer(unsigned int target, unsigned int buffer, size_t offset, size_t size) {
+    GLCall(glBindBuffer(target, buffer));
+    GLbitfield access = target == GL_PIXEL_PACK_BUFFER ? GL_MAP_READ_BIT
+                                                       : GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    GLCall(void* data = glMapBufferRange(target, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), access));
+    return data;
+}
+
+void GLBackend::UnmapBuffer(unsigned int target, unsigned int buffer) {
+    GLCall(glBindBuffer(target, buffer));
+    GLCall(glUnmapBuffer(target));
+}
+
+void GLBackend::BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size) {
+    GLCall(glBindBufferRange(target, index, buffer, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size)));
+    CountStateChange();
+}
+
+size_t GLBackend::GetUniformBufferAlignment() {
+    if (m_UniformBufferAlignment == 0) {
+        GLCall(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_UniformBufferAlignment));
+    }
+    return static_cast<size_t>(m_UniformBufferAlignment);
+}
+
+unsigned int GLBackend::CreateVertexArray() {
+    unsigned int vao;
+    GLCall(glGenVertexArrays(1, &vao));
+    CountCreate();
+    return vao;
+}
+
+void GLBackend::BindVertexArray(unsigned int vao) {
+    GLCall(glBindVertexArray(vao));
+    CountStateChange();
+}
+
+void GLBackend::VertexAttribPointer(unsigned int index, int size, unsigned int type, int stride, size_t offset) {
+    GLCall(glEnableVertexAttribArray(index));
+    GLCall(glVertexAttribPointer(index, size, type, GL_FALSE, stride, reinterpret_cast<const void*>(offset)));
+}
+
+unsigned int GLBackend::CreateProgram(const ShaderProgramSource& source) {
+    unsigned int program;
+    CreatePrograms(&source, 1, &program);
+    return program;
+}
+
+void GLBackend::CreatePrograms(const ShaderProgramSource* sources, size_t count, unsigned int* programs) {
+    BeginPrograms(sources, count, programs);
+    FinishPrograms();
+}
+
+void GLBackend::BeginPrograms(const ShaderProgramSource* sources, size_t count, unsigned int* programs) {
+    // Let the driver use as many compiler threads as it likes; compiles and
+    // links then run in the background until their status is first queried
+    if (GLEW_KHR_parallel_shader_compile) {
+        GLCall(glMaxShaderCompilerThreadsKHR(0xFFFFFFFF));
+    }
+
+    std::string driver = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    driver += reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+    // Kick off everything that is not in the binary cache before waiting on anything
+    for (size_t i = 0; i < count; i++) {
+        size_t sourceBytes = sources[i].VertexSource.size() + sources[i].FragmentSource.size();
+        std::string cachePath = GetProgramCachePath(sources[i], driver);
+        if (LoadCachedProgram(cachePath, programs[i])) {
+            m_PendingPrograms.push_back({ programs[i], 0, 0, std::string(), sourceBytes });
+            continue;
+        }
+
+        GLCall(programs[i] = glCreateProgram());
+        PendingProgram p{ programs[i], glCreateShader(GL_VERTEX_SHADER), glCreateShader(GL_FRAGMENT_SHADER), cachePath, sourceBytes };
+        const char* vs = sources[i].VertexSource.c_str();
+        const char* fs = sources[i].FragmentSource.c_str();
+        GLCall(glShaderSource(p.Vs, 1, &vs, nullptr));
+        GLCall(glShaderSource(p.Fs, 1, &fs, nullptr));
+        GLCall(glCompileShader(p.Vs));
+        GLCall(glCompileShader(p.Fs));
+        GLCall(glAttachShader(programs[i], p.Vs));
+        GLCall(glAttachShader(programs[i], p.Fs));
+        if (GLEW_ARB_get_program_binary) {
+            GLCall(glProgramParameteri(programs[i], GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        }
+        GLCall(glLinkProgram(programs[i]));
+        m_PendingPrograms.push_back(std::move(p));
+    }
+}
+
+void GLBackend::FinishPrograms() {
+    // Only now block on the results, in submission order
+    for (const PendingProgram& p : m_PendingPrograms) {
+        unsigned int program = p.Program;
+        if (p.Vs != 0) {
+            int linked;
+            GLCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+            if (linked == GL_FALSE) {
+                for (unsigned int shader : { p.Vs, p.Fs }) {
+                    int compiled;
+                    GLCall(glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled));
+                    if (compiled == GL_FALSE) {
+                        char message[1024];
+                        GLCall(glGetShaderInfoLog(shader, sizeof(message), nullptr, message));
+                        std::cout << "Failed to compile " << (shader == p.Vs ? "vertex" : "fragment") << " shader!" << std::endl;
+                        std::cout << message << std::endl;
+                    }
+                }
+                char message[1024];
+                GLCall(glGetProgramInfoLog(program, sizeof(message), nullptr, message));
+                std::cout << "Failed to link program!" << std::endl << message << std::endl;
+            } else {
+                SaveCachedProgram(p.CachePath, program);
+            }
+            GLCall(glDetachShader(program, p.Vs));
+            GLCall(glDetachShader(program, p.Fs));
+            GLCall(glDeleteShader(p.Vs));
+            GLCall(glDeleteShader(p.Fs));
+        }
+
+        CountCreate();
+
+        // The linked binary is the closest thing GL exposes to a program's
+        // footprint; without the extension fall back to the source size
+        int binaryLength = 0;
+        if (GLEW_ARB_get_program_binary) {
+            GLCall(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength));
+        }
+        if (binaryLength <= 0)
+            binaryLength = static_cast<int>(p.SourceBytes);
+        m_Memory.TrackAllocation(GLObjectType::Program, program, GpuMemoryCategory::ProgramBinary, binaryLength);
+    }
+    m_PendingPrograms.clear();
+}
+
+void GLBackend::UseProgram(unsigned int program) {
+    GLCall(glUseProgram(program));
+    CountStateChange();
+}
+
+int GLBackend::GetUniformLocation(unsigned int program, const char* name) {
+    GLCall(int location = glGetUniformLocation(program, name));
+    return location;
+}
+
+void GLBackend::BindUniformBlock(unsigned int program, const char* name, unsigned int binding) {
+    GLCall(unsigned int index = glGetUniformBlockIndex(program, name));
+    if (index != GL_INVALID_INDEX) {
+        GLCall(glUniformBlockBinding(program, index, binding));
+    }
+}
+
+void GLBackend::SetUniformMat4(int location, const float* value) {
+    GLCall(glUniformMatrix4fv(location, 1, GL_FALSE, value));
+    CountUniform();
+}
+
+void GLBackend::SetUniform4f(int location, float x, float y, float z, float w) {
+    GLCall(glUniform4f(location, x, y, z, w));
+    CountUniform();
+}
+
+void GLBackend::SetUniform1i(int location, int value) {
+    GLCall(glUniform1i(location, value));
+    CountUniform();
+}
+
+// Client format and type of the data CreateTexture takes for internalFormat
+static void GetTextureClientFormat(unsigned int internalFormat, GLenum& format, GLenum& type) {
+    switch (internalFormat) {
+        case GL_R32F:     format = GL_RED;          type = GL_FLOAT; break;
+        case GL_RGBA16F:
+        case GL_RGBA32F:  format = GL_RGBA;         type = GL_FLOAT; break;
+        case GL_R32UI:    format = GL_RED_INTEGER;  type = GL_UNSIGNED_INT; break;
+        case GL_RGBA32UI: format = GL_RGBA_INTEGER; type = GL_UNSIGNED_INT; break;
+        case GL_DEPTH_COMPONENT32F: format = GL_DEPTH_COMPONENT; type = GL_FLOAT; break;
+        case GL_R8:       format = GL_RED;          type = GL_UNSIGNED_BYTE; break;
+        case GL_R16:      format = GL_RED;          type = GL_UNSIGNED_SHORT; break;
+        case GL_RGBA8UI:  format = GL_RGBA_INTEGER; type = GL_UNSIGNED_BYTE; break;
+        default:          format = GL_RGBA;         type = GL_UNSIGNED_BYTE; break;
+    }
+}
+
+unsigned int GLBackend::CreateTexture(unsigned int internalFormat, int width, int height, const void* data) {
+    GLenum format, type;
+    GetTextureClientFormat(internalFormat, format, type);
+    unsigned int id;
+    GLCall(glGenTextures(1, &id));
+    GLCall(glBindTexture(GL_TEXTURE_2D, id));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    GLCall(glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, data));
+    CountCreate(data ? GetBytesPerPixel(internalFormat) * width * height : 0);
+    TrackTexture(id, internalFormat, width, height);
+    return id;
+}
+
+void GLBackend::BindTexture(unsigned int unit, unsigned int texture) {
+    GLCall(glActiveTexture(GL_TEXTURE0 + unit));
+    GLCall(glBindTexture(GL_TEXTURE_2D, texture));
+    CountStateChange();
+}
+
+unsigned int GLBackend::CreateTexture3D(unsigned int internalFormat, int width, int height, int depth, const void* data) {
+    GLenum format, type;
+    GetTextureClientFormat(internalFormat, format, type);
+    // Integer textures are incomplete with linear filtering
+    GLint filter = internalFormat == GL_RGBA8UI ? GL_NEAREST : GL_LINEAR;
+    unsigned int id;
+    GLCall(glGenTextures(1, &id));
+    GLCall(glBindTexture(GL_TEXTURE_3D, id));
+    GLCall(glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, filter));
+    GLCall(glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, filter));
+    GLCall(glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCall(glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GLCall(glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
+    GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    GLCall(glTexImage3D(GL_TEXTURE_3D, 0, internalFormat, width, height, depth, 0, format, type, data));
+    size_t texels = static_cast<size_t>(width) * height * depth;
+    CountCreate(data ? GetBytesPerPixel(internalFormat) * texels : 0);
+    TrackTexture(id, internalFormat, width, height, depth);
+    m_TextureFormats[id] = internalFormat;
+    return id;
+}
+
+void GLBackend::UpdateTexture3D(unsigned int texture, int x, int y, int z, int width, int height, int depth, const void* data) {
+    unsigned int internalFormat = m_TextureFormats[texture];
+    GLenum format, type;
+    GetTextureClientFormat(internalFormat, format, type);
+    GLCall(glBindTexture(GL_TEXTURE_3D, texture));
+    GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    GLCall(glTexSubImage3D(GL_TEXTURE_3D, 0, x, y, z, width, height, depth, format, type, data));
+    CountUpload(GetBytesPerPixel(internalFormat) * static_cast<size_t>(width) * height * depth);
+}
+
+void GLBackend::BindTexture3D(unsigned int unit, unsigned int texture) {
+    GLCall(glActiveTexture(GL_TEXTURE0 + unit));
+    GLCall(glBindTexture(GL_TEXTURE_3D, texture));
+    CountStateChange();
+}
+
+unsigned int GLBackend::CreateRenderbuffer(unsigned int internalFormat, int width, int height) {
+    unsigned int id;
+    GLCall(glGenRenderbuffers(1, &id));
+    GLCall(glBindRenderbuffer(GL_RENDERBUFFER, id));
+    GLCall(glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height));
+    CountCreate();
+    TrackRenderbuffer(id, internalFormat, width, height);
+    return id;
+}
+
+unsigned int GLBackend::CreateFramebuffer() {
+    unsigned int id;
+    GLCall(glGenFramebuffers(1, &id));
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, id));
+    CountCreate();
+    return id;
+}
+
+void GLBackend::FramebufferRenderbuffer(unsigned int attachment, unsigned int renderbuffer) {
+    GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, renderbuffer));
+    GLCall(GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    if (status != GL_FRAMEBUFFER_COMPLETE && status != GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT)
+        std::cout << "[GL Backend] framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+}
+
+void GLBackend::FramebufferTexture(unsigned int attachment, unsigned int texture) {
+    GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0));
+    GLCall(GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    if (status != GL_FRAMEBUFFER_COMPLETE && status != GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT)
+        std::cout << "[GL Backend] framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+}
+
+void GLBackend::BindFramebuffer(unsigned int framebuffer) {
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+    CountStateChange();
+}
+
+void GLBackend::SetViewport(int x, int y, int width, int height) {
+    GLCall(glViewport(x, y, width, height));
+    CountStateChange();
+}
+
+void GLBackend::Finish() {
+    GLCall(glFinish());
+}
+
+void GLBackend::ReadPixels(int x, int y, int width, int height, void* rgba) {
+    GLCall(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    GLCall(glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba));
+}
+
+void GLBackend::Clear() {
+    GLCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+}
+
+void GLBackend::DrawElements(unsigned int mode, int count, size_t offset) {
+    GLCall(glDrawElements(mode, count, GL_UNSIGNED_INT, reinterpret_cast<const void*>(offset)));
+    CountDraw(mode, count);
+}
+
+void GLBackend::DrawArrays(unsigned int mode, int first, int count) {
+    GLCall(glDrawArrays(mode, first, count));
+    CountDraw(mode, count);
+}
+
+unsigned int GLBackend::CreateQuery() {
+    unsigned int id;
+    GLCall(glGenQueries(1, &id));
+    CountCreate();
+    return id;
+}
+
+void GLBackend::BeginQuery(unsigned int target, unsigned int query) {
+    GLCall(glBeginQuery(target, query));
+}
+
+void GLBackend::EndQuery(unsigned int target) {
+    GLCall(glEndQuery(target));
+}
+
+bool GLBackend::GetQueryResult(unsigned int query, unsigned long long& result) {
+    int available = 0;
+    GLCall(glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available));
+    if (!available)
+        return false;
+    GLuint64 value = 0;
+    GLCall(glGetQueryObjectui64v(query, GL_QUERY_RESULT, &value));
+    result = value;
+    return true;
+}
+
+void GLBackend::DeleteObject(GLObjectType type, unsigned int id) {
+    switch (type) {
+        case GLObjectType::Buffer:       GLCall(glDeleteBuffers(1, &id)); break;
+        case GLObjectType::VertexArray:  GLCall(glDeleteVertexArrays(1, &id)); break;
+        case GLObjectType::Program:      GLCall(glDeleteProgram(id)); break;
+        case GLObjectType::Shader:       GLCall(glDeleteShader(id)); break;
+        case GLObjectType::Texture:      GLCall(glDeleteTextures(1, &id)); m_TextureFormats.erase(id); break;
+        case GLObjectType::Framebuffer:  GLCall(glDeleteFramebuffers(1, &id)); break;
+        case GLObjectType::Renderbuffer: GLCall(glDeleteRenderbuffers(1, &id)); break;
+        case GLObjectType::Sampler:      GLCall(glDeleteSamplers(1, &id)); break;
+        case GLObjectType::Query:        GLCall(glDeleteQueries(1, &id)); break;
+    }
+    CountDelete(type, id);
+}
+
+void* GLBackend::InsertFence() {
+    GLCall(GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    return fence;
+}
+
+bool GLBackend::WaitFence(void* fence, unsigned long long timeoutNs) {
+    // Flush on blocking waits so the fence is guaranteed to reach the GPU
+    GLbitfield flags = timeoutNs ? GL_SYNC_FLUSH_COMMANDS_BIT : 0;
+    GLCall(GLenum result = glClientWaitSync(static_cast<GLsync>(fence), flags, timeoutNs));
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+void GLBackend::DeleteFence(void* fence) {
+    GLCall(glDeleteSync(static_cast<GLsync>(fence)));
+}
+
+GpuDriverMemory GLBackend::QueryDriverMemory() {
+    // Both extensions report kilobytes
+    GpuDriverMemory memory;
+    if (GLEW_NVX_gpu_memory_info) {
+        int total = 0, available = 0;
+        GLCall(glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &total));
+        GLCall(glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &available));
+        memory = { true, "GL_NVX_gpu_memory_info", static_cast<size_t>(total) * 1024, static_cast<size_t>(available) * 1024 };
+    } else if (GLEW_ATI_meminfo) {
+        // [0] is the total free memory in the pool, the rest describe the largest free block
+        int info[4] = {};
+        GLCall(glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, info));
+        memory = { true, "GL_ATI_meminfo", 0, static_cast<size_t>(info[0]) * 1024 };
+    }
+    return memory;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "RenderBackend.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class GLBackend : public RenderBackend {
+public:
+    const char* GetName() const override { return "OpenGL"; }
+
+    unsigned int CreateBuffer(unsigned int target, const void* data, size_t size, unsigned int usage) override;
+    void BindBuffer(unsigned int target, unsigned int buffer) override;
+    void* MapBuffer(unsigned int target, unsigned int buffer, size_t offset, size_t size) override;
+    void UnmapBuffer(unsigned int target, unsigned int buffer) override;
+    void BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size) override;
+    size_t GetUniformBufferAlignment() override;
+
+    unsigned int CreateVertexArray() override;
+    void BindVertexArray(unsigned int vao) override;
+    void VertexAttribPointer(unsigned int index, int size, unsigned int type, int stride, size_t offset) override;
+
+    unsigned int CreateProgram(const ShaderProgramSource& source) override;
+    // Compiles uncached programs in parallel and fills the binary cache
+    void CreatePrograms(const ShaderProgramSource* sources, size_t count, unsigned int* programs) override;
+    void BeginPrograms(const ShaderProgramSource* sources, size_t count, unsigned int* programs) override;
+    void FinishPrograms() override;
+    void UseProgram(unsigned int program) override;
+    int GetUniformLocation(unsigned int program, const char* name) override;
+    void BindUniformBlock(unsigned int program, const char* name, unsigned int binding) override;
+    void SetUniformMat4(int location, const float* value) override;
+    void SetUniform4f(int location, float x, float y, float z, float w) override;
+    void SetUniform1i(int location, int value) override;
+
+    unsigned int CreateTexture(unsigned int internalFormat, int width, int height, const void* data) override;
+    void BindTexture(unsigned int unit, unsigned int texture) override;
+    unsigned int CreateTexture3D(unsigned int internalFormat, int width, int height, int depth, const void* data) override;
+    void UpdateTexture3D(unsigned int texture, int x, int y, int z, int width, int height, int depth, const void* data) override;
+    void BindTexture3D(unsigned int unit, unsigned int texture) override;
+
+    unsigned int CreateRenderbuffer(unsigned int internalFormat, int width, int height) override;
+    unsigned int CreateFramebuffer() override;
+    void FramebufferRenderbuffer(unsigned int attachment, unsigned int renderbuffer) override;
+    void FramebufferTexture(unsigned int attachment, unsigned int texture) override;
+    void BindFramebuffer(unsigned int framebuffer) override;
+    void SetViewport(int x, int y, int width, int height) override;
+    void Finish() override;
+    void ReadPixels(int x, int y, int width, int height, void* rgba) override;
+
+    void Clear() override;
+    void DrawElements(unsigned int mode, int count, size_t offset) override;
+    void DrawArrays(unsigned int mode, int first, int count) override;
+
+    unsigned int CreateQuery() override;
+    void BeginQuery(unsigned int target, unsigned int query) override;
+    void EndQuery(unsigned int target) override;
+    bool GetQueryResult(unsigned int query, unsigned long long& result) override;
+
+    void DeleteObject(GLObjectType type, unsigned int id) override;
+
+    void* InsertFence() override;
+    bool WaitFence(void* fence, unsigned long long timeoutNs) override;
+    void DeleteFence(void* fence) override;
+
+    GpuDriverMemory QueryDriverMemory() override;
+
+private:
+    struct PendingProgram {
+        unsigned int Program;
+        unsigned int Vs, Fs;           // 0 when the program came from the binary cache
+        std::string CachePath;
+        size_t SourceBytes;
+    };
+
+    int m_UniformBufferAlignment = 0;
+    std::vector<PendingProgram> m_PendingPrograms;
+    std::unordered_map<unsigned int, unsigned int> m_TextureFormats;  // 3D texture -> internal format, for updates
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <utility>
+
+class RenderBackend;
+
+enum class GLObjectType {
+    Buffer, VertexArray, Program, Shader, Texture, Framebuffer, Renderbuffer, Sampler, Query
+};
+
+// Hands the object to backend's DeletionQueue
+void DeleteDeferred(RenderBackend& backend, GLObjectType type, unsigned int id);
+
+// Move-only owner of one GL object. Destruction does not delete the object
+// right away: it is handed to the backend's DeletionQueue and released once
+// every frame that could still reference it has retired on the GPU.
+template<GLObjectType Type>
+class GLHandle {
+public:
+    GLHandle() = default;
+    GLHandle(RenderBackend& backend, unsigned int id) : m_Backend(&backend), m_Id(id) {}
+    ~GLHandle() { Reset(); }
+
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+
+    GLHandle(GLHandle&& other) noexcept
+        : m_Backend(other.m_Backend), m_Id(std::exchange(other.m_Id, 0)) {}
+
+    GLHandle& operator=(GLHandle&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            m_Backend = other.m_Backend;
+            m_Id = std::exchange(other.m_Id, 0);
+        }
+        return *this;
+    }
+
+    unsigned int Get() const { return m_Id; }
+    explicit operator bool() const { return m_Id != 0; }
+
+    // Gives up ownership without deleting
+    unsigned int Release() { return std::exchange(m_Id, 0); }
+    void Reset() {
+        if (m_Id != 0)
+            DeleteDeferred(*m_Backend, Type, m_Id);
+        m_Id = 0;
+    }
+
+private:
+    RenderBackend* m_Backend = nullptr;
+    unsigned int m_Id = 0;
+};
+
+using BufferHandle = GLHandle<GLObjectType::Buffer>;
+using VertexArrayHandle = GLHandle<GLObjectType::VertexArray>;
+using ProgramHandle = GLHandle<GLObjectType::Program>;
+using ShaderHandle = GLHandle<GLObjectType::Shader>;
+using TextureHandle = GLHandle<GLObjectType::Texture>;
+using FramebufferHandle = GLHandle<GLObjectType::Framebuffer>;
+using RenderbufferHandle = GLHandle<GLObjectType::Renderbuffer>;
+using SamplerHandle = GLHandle<GLObjectType::Sampler>;
+using QueryHandle = GLHandle<GLObjectType::Query>;
@@ -0,0 +1,108 @@
+#include "GpuMemory.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+const char* GetCategoryName(GpuMemoryCategory category) {
+    switch (category) {
+        case GpuMemoryCategory::VertexBuffer:  return "vertex buffers";
+        case GpuMemoryCategory::IndexBuffer:   return "index buffers";
+        case GpuMemoryCategory::UniformBuffer: return "uniform buffers";
+        case GpuMemoryCategory::Texture:       return "textures";
+        case GpuMemoryCategory::RenderTarget:  return "render targets";
+        case GpuMemoryCategory::ProgramBinary: return "program binaries";
+        case GpuMemoryCategory::Other:         return "other";
+        case GpuMemoryCategory::Count:         break;
+    }
+    return "unknown";
+}
+
+void GpuMemoryTracker::TrackAllocation(GLObjectType type, unsigned int id, GpuMemoryCategory category, size_t bytes) {
+    // Re-specifying storage (glBufferData on a live buffer) replaces the old size
+    TrackFree(type, id);
+    m_Allocations[Key(type, id)] = { category, bytes };
+
+    CategoryTotals& totals = m_Categories[static_cast<int>(category)];
+    totals.Bytes += bytes;
+    totals.Count++;
+    totals.Peak = std::max(totals.Peak, totals.Bytes);
+    m_Total += bytes;
+    m_Peak = std::max(m_Peak, m_Total);
+}
+
+void GpuMemoryTracker::TrackFree(GLObjectType type, unsigned int id) {
+    auto it = m_Allocations.find(Key(type, id));
+    if (it == m_Allocations.end())
+        return;
+
+    CategoryTotals& totals = m_Categories[static_cast<int>(it->second.Category)];
+    totals.Bytes -= it->second.Bytes;
+    totals.Count--;
+    m_Total -= it->second.Bytes;
+    m_Allocations.erase(it);
+}
+
+void GpuMemoryTracker::TrackUpload(size_t bytes) {
+    m_FrameUpload += bytes;
+}
+
+void GpuMemoryTracker::EndFrame(const GpuDriverMemory& driver) {
+    m_LastFrameUpload = m_FrameUpload;
+    m_PeakFrameUpload = std::max(m_PeakFrameUpload, m_FrameUpload);
+    m_WindowUpload += m_FrameUpload;
+    m_FrameUpload = 0;
+
+    // Upload bandwidth is averaged over one-second windows
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - m_WindowStart).count();
+    if (elapsed >= 1.0) {
+        m_UploadRate = m_WindowUpload / elapsed;
+        m_WindowUpload = 0;
+        m_WindowStart = now;
+    }
+
+    // Warn once per crossing; re-arm only after dropping well below the budget
+    bool driverLow = driver.Valid && driver.TotalBytes > 0 && driver.AvailableBytes < driver.TotalBytes / 10;
+    bool over = (m_Budget > 0 && m_Total > m_Budget) || driverLow;
+    if (over && !m_OverBudget) {
+        std::cout << "[GPU Memory] Warning: ";
+        if (m_Budget > 0 && m_Total > m_Budget)
+            std::cout << m_Total / 1024 << " KB tracked exceeds budget of " << m_Budget / 1024 << " KB";
+        else
+            std::cout << "driver reports only " << driver.AvailableBytes / (1024 * 1024) << " MB available";
+        std::cout << std::endl;
+        m_OverBudget = true;
+    } else if (m_OverBudget && !driverLow && (m_Budget == 0 || m_Total < m_Budget - m_Budget / 10)) {
+        m_OverBudget = false;
+    }
+}
+
+void GpuMemoryTracker::Dump(std::ostream& out, const GpuDriverMemory& driver) const {
+    out << "[GPU Memory] " << m_Total / 1024.0 << " KB tracked in " << m_Allocations.size()
+        << " allocation(s), peak " << m_Peak / 1024.0 << " KB";
+    if (m_Budget > 0)
+        out << ", budget " << m_Budget / 1024.0 << " KB (" << std::fixed << std::setprecision(1)
+            << 100.0 * m_Total / m_Budget << "% used)" << std::defaultfloat;
+    out << std::endl;
+
+    for (int i = 0; i < static_cast<int>(GpuMemoryCategory::Count); i++) {
+        const CategoryTotals& totals = m_Categories[i];
+        if (totals.Peak == 0)
+            continue;
+        out << "  " << std::left << std::setw(18) << GetCategoryName(static_cast<GpuMemoryCategory>(i)) << std::right
+            << std::setw(12) << totals.Bytes << " bytes in " << totals.Count << " object(s), peak " << totals.Peak << std::endl;
+    }
+
+    out << "  uploads: " << m_LastFrameUpload << " bytes last frame, peak " << m_PeakFrameUpload
+        << " bytes/frame, " << m_UploadRate / (1024.0 * 1024.0) << " MB/s" << std::endl;
+
+    if (driver.Valid) {
+        out << "  driver (" << driver.Source << "): " << driver.AvailableBytes / (1024 * 1024) << " MB available";
+        if (driver.TotalBytes > 0)
+            out << " of " << driver.TotalBytes / (1024 * 1024) << " MB";
+        out << std::endl;
+    } else {
+        out << "  driver: no memory info extension, figures above are estimates" << std::endl;
+    }
+}
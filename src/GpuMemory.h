@@ -0,0 +1,76 @@
+#pragma once
+
+#include "GLResource.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+
+enum class GpuMemoryCategory {
+    VertexBuffer, IndexBuffer, UniformBuffer, Texture, RenderTarget, ProgramBinary, Other, Count
+};
+
+const char* GetCategoryName(GpuMemoryCategory category);
+
+// What the driver itself reports, in bytes; Valid is false when neither
+// GL_NVX_gpu_memory_info nor GL_ATI_meminfo is available
+struct GpuDriverMemory {
+    bool Valid = false;
+    const char* Source = "";
+    size_t TotalBytes = 0;          // 0 when the extension does not report it (ATI)
+    size_t AvailableBytes = 0;
+};
+
+// Accounts every GPU allocation the renderer makes, by category. Sizes are
+// what we asked for, which underestimates driver padding but is available on
+// every implementation; driver figures are shown alongside when exposed.
+class GpuMemoryTracker {
+public:
+    void TrackAllocation(GLObjectType type, unsigned int id, GpuMemoryCategory category, size_t bytes);
+    // No-op for objects that were never tracked
+    void TrackFree(GLObjectType type, unsigned int id);
+    void TrackUpload(size_t bytes);
+
+    // 0 disables the budget warning
+    void SetBudget(size_t bytes) { m_Budget = bytes; }
+    size_t GetBudget() const { return m_Budget; }
+
+    size_t GetTotalBytes() const { return m_Total; }
+    size_t GetCategoryBytes(GpuMemoryCategory category) const { return m_Categories[static_cast<int>(category)].Bytes; }
+    size_t GetFrameUploadBytes() const { return m_LastFrameUpload; }
+
+    // Closes the frame's upload window and checks the budget
+    void EndFrame(const GpuDriverMemory& driver);
+    void Dump(std::ostream& out, const GpuDriverMemory& driver) const;
+
+private:
+    struct Allocation {
+        GpuMemoryCategory Category;
+        size_t Bytes;
+    };
+    struct CategoryTotals {
+        size_t Bytes = 0;
+        size_t Peak = 0;
+        unsigned int Count = 0;
+    };
+
+    static uint64_t Key(GLObjectType type, unsigned int id) {
+        return (static_cast<uint64_t>(type) << 32) | id;
+    }
+
+    std::unordered_map<uint64_t, Allocation> m_Allocations;
+    CategoryTotals m_Categories[static_cast<int>(GpuMemoryCategory::Count)];
+    size_t m_Total = 0;
+    size_t m_Peak = 0;
+    size_t m_Budget = 0;
+    bool m_OverBudget = false;
+
+    size_t m_FrameUpload = 0;
+    size_t m_LastFrameUpload = 0;
+    size_t m_PeakFrameUpload = 0;
+    size_t m_WindowUpload = 0;      // bytes uploaded since the window started
+    double m_UploadRate = 0.0;      // bytes per second over the last full window
+    std::chrono::steady_clock::time_point m_WindowStart = std::chrono::steady_clock::now();
+};
@@ -0,0 +1,221 @@
+#include "Hlod.h"
+#include "Scene.h"
+#include "StaticBatcher.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+int GetPrimitiveVertices(unsigned int mode) {
+    switch (mode) {
+        case GL_TRIANGLES: return 3;
+        case GL_LINES:     return 2;
+        case GL_POINTS:    return 1;
+        default:           return 0;
+    }
+}
+
+BatchGeometry SimplifyBatchGeometry(const BatchGeometry& geometry, unsigned int mode, int cells) {
+    BatchGeometry result;
+    int primitive = GetPrimitiveVertices(mode);
+    size_t vertexCount = geometry.Vertices.size() / STATIC_BATCH_VERTEX_FLOATS;
+    if (primitive == 0 || vertexCount == 0)
+        return result;
+
+    glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float* vertex = &geometry.Vertices[v * STATIC_BATCH_VERTEX_FLOATS];
+        glm::vec3 position(vertex[0], vertex[1], vertex[2]);
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
+    }
+    glm::vec3 extent = boundsMax - boundsMin;
+    float cell = std::max(std::max(extent.x, std::max(extent.y, extent.z)) / static_cast<float>(cells), 1e-6f);
+
+    // Sum the attributes of every vertex in a cell, then average them
+    std::unordered_map<uint64_t, unsigned int> cellVertices;
+    std::vector<float> sums;
+    std::vector<unsigned int> weights;
+    std::vector<unsigned int> remap(vertexCount);
+    uint64_t side = static_cast<uint64_t>(cells) + 1;
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float* vertex = &geometry.Vertices[v * STATIC_BATCH_VERTEX_FLOATS];
+        glm::vec3 position(vertex[0], vertex[1], vertex[2]);
+        glm::vec3 coordinate = glm::min((position - boundsMin) / cell, glm::vec3(static_cast<float>(cells)));
+        uint64_t key = (static_cast<uint64_t>(coordinate.x) * side + static_cast<uint64_t>(coordinate.y)) * side +
+                       static_cast<uint64_t>(coordinate.z);
+        auto [it, added] = cellVertices.try_emplace(key, static_cast<unsigned int>(weights.size()));
+        if (added) {
+            sums.resize(sums.size() + STATIC_BATCH_VERTEX_FLOATS, 0.0f);
+            weights.push_back(0);
+        }
+        float* sum = &sums[it->second * STATIC_BATCH_VERTEX_FLOATS];
+        for (int i = 0; i < STATIC_BATCH_VERTEX_FLOATS; i++)
+            sum[i] += vertex[i];
+        weights[it->second]++;
+        remap[v] = it->second;
+    }
+
+    // Primitives between distinct cells, each once; triangles keep their winding
+    std::vector<std::array<unsigned int, 3>> primitives;
+    for (size_t i = 0; i + primitive <= geometry.Indices.size(); i += primitive) {
+        std::array<unsigned int, 3> corners = { 0, 0, 0 };
+        for (int c = 0; c < primitive; c++)
+            corners[c] = remap[geometry.Indices[i + c]];
+        if (primitive == 3) {
+            if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0])
+                continue;
+            std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+        } else if (primitive == 2) {
+            if (corners[0] == corners[1])
+                continue;
+            if (corners[1] < corners[0])
+                std::swap(corners[0], corners[1]);
+        }
+        primitives.push_back(corners);
+    }
+    std::sort(primitives.begin(), primitives.end());
+    primitives.erase(std::unique(primitives.begin(), primitives.end()), primitives.end());
+
+    // Only the cells something still uses become vertices
+    std::vector<unsigned int> used(weights.size(), UINT_MAX);
+    for (const std::array<unsigned int, 3>& corners : primitives) {
+        for (int c = 0; c < primitive; c++) {
+            unsigned int& index = used[corners[c]];
+            if (index == UINT_MAX) {
+                index = static_cast<unsigned int>(result.Vertices.size() / STATIC_BATCH_VERTEX_FLOATS);
+                const float* sum = &sums[corners[c] * STATIC_BATCH_VERTEX_FLOATS];
+                for (int f = 0; f < STATIC_BATCH_VERTEX_FLOATS; f++)
+                    result.Vertices.push_back(sum[f] / static_cast<float>(weights[corners[c]]));
+            }
+            result.Indices.push_back(index);
+        }
+    }
+    return result;
+}
+
+struct HlodCandidate {
+    float Pixels;                  // projected diameter
+    unsigned int Node;
+};
+
+static float GetProjectedPixels(const BatchNode& node, const glm::vec3& eye, float pixelsPerUnit) {
+    glm::vec3 center = (node.BoundsMin + node.BoundsMax) * 0.5f;
+    float radius = glm::length(node.BoundsMax - node.BoundsMin) * 0.5f;
+    float distance = glm::length(center - eye);
+    if (distance <= radius)
+        return FLT_MAX;
+    return 2.0f * radius * pixelsPerUnit / distance;
+}
+
+static size_t GetNodePrimitives(const Scene& scene, const BatchNode& node) {
+    if (node.Batch < 0)
+        return 0;
+    const StaticBatch& batch = scene.Batches[node.Batch];
+    return static_cast<size_t>(batch.Count) / std::max(GetPrimitiveVertices(batch.Mode), 1);
+}
+
+// The visibility set first: a cluster with none of its objects in it is
+// culled, proxy and all, before its box is looked at
+static bool IsNodeVisible(const Scene& scene, const Frustum& frustum, int index) {
+    const std::vector<unsigned char>& sets = scene.Visibility.Nodes;
+    if (!sets.empty() && !sets[index])
+        return false;
+    const BatchNode& node = scene.BatchNodes[index];
+    return IsBoxVisible(frustum, node.BoundsMin, node.BoundsMax);
+}
+
+static bool IsLeaf(const BatchNode& node) {
+    return node.Children[0] < 0 && node.Children[1] < 0;
+}
+
+void SelectBatches(const Scene& scene, const glm::mat4& view, const glm::mat4& proj, int viewportHeight,
+                   std::pmr::vector<unsigned int>& batches, HlodStats& stats) {
+    stats = {};
+    if (scene.BatchRoots.empty())
+        return;
+    Frustum frustum = ExtractFrustum(proj * view);
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    float pixelsPerUnit = 0.5f * static_cast<float>(viewportHeight) * proj[1][1];
+    size_t draws = 0, primitives = 0;
+
+    // Max-heap on projected size: the largest cluster is refined first
+    std::pmr::vector<HlodCandidate> open(batches.get_allocator().resource());
+    auto smaller = [](const HlodCandidate& a, const HlodCandidate& b) { return a.Pixels < b.Pixels; };
+    // Takes a visible node; one that cannot stand in for its subtree is
+    // replaced by its visible children right away, whatever the budget
+    auto push = [&](auto& self, unsigned int index) -> void {
+        const BatchNode& node = scene.BatchNodes[index];
+        if (!IsLeaf(node) && node.Batch < 0 && !node.Proxy) {
+            for (int child : node.Children) {
+                stats.Nodes++;
+                if (child >= 0 && IsNodeVisible(scene, frustum, child))
+                    self(self, static_cast<unsigned int>(child));
+            }
+            return;
+        }
+        draws += node.Batch >= 0 ? 1 : 0;
+        primitives += GetNodePrimitives(scene, node);
+        open.push_back({ GetProjectedPixels(node, eye, pixelsPerUnit), index });
+        std::push_heap(open.begin(), open.end(), smaller);
+    };
+    auto draw = [&](const BatchNode& node) {
+        if (node.Batch < 0)
+            return;
+        batches.push_back(static_cast<unsigned int>(node.Batch));
+        (IsLeaf(node) ? stats.BatchDraws : stats.ProxyDraws)++;
+        stats.Primitives += GetNodePrimitives(scene, node);
+    };
+
+    for (unsigned int root : scene.BatchRoots) {
+        stats.Nodes++;
+        if (IsNodeVisible(scene, frustum, static_cast<int>(root)))
+            push(push, root);
+    }
+    while (!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), smaller);
+        HlodCandidate candidate = open.back();
+        open.pop_back();
+        const BatchNode& node = scene.BatchNodes[candidate.Node];
+        if (IsLeaf(node) || candidate.Pixels <= HLOD_SWITCH_PIXELS) {
+            draw(node);
+            continue;
+        }
+
+        bool visible[2] = { false, false };
+        size_t childDraws = 0, childPrimitives = 0;
+        for (int c = 0; c < 2; c++) {
+            int child = node.Children[c];
+            if (child < 0)
+                continue;
+            stats.Nodes++;
+            const BatchNode& childNode = scene.BatchNodes[child];
+            visible[c] = IsNodeVisible(scene, frustum, child);
+            if (visible[c] && childNode.Batch >= 0) {
+                childDraws++;
+                childPrimitives += GetNodePrimitives(scene, childNode);
+            }
+        }
+        size_t ownDraws = node.Batch >= 0 ? 1 : 0;
+        size_t ownPrimitives = GetNodePrimitives(scene, node);
+        if (draws - ownDraws + childDraws > HLOD_DRAW_BUDGET ||
+            primitives - ownPrimitives + childPrimitives > HLOD_PRIMITIVE_BUDGET) {
+            stats.OverBudget = true;
+            draw(node);
+            continue;
+        }
+        draws -= ownDraws;
+        primitives -= ownPrimitives;
+        for (int c = 0; c < 2; c++) {
+            if (visible[c])
+                push(push, static_cast<unsigned int>(node.Children[c]));
+        }
+    }
+    std::sort(batches.begin(), batches.end());
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+struct Scene;
+
+// A cluster smaller than this on screen (its bounding sphere's diameter)
+// draws its proxy instead of its children
+#define HLOD_SWITCH_PIXELS 64.0f
+// Vertex clustering grid of a proxy: cells along the longest side of its
+// cluster. At the switch size a cell covers about two pixels.
+#define HLOD_PROXY_CELLS 32
+// Per frame, over all static batch groups. Clusters are refined largest on
+// screen first until the next refinement would go over either budget.
+#define HLOD_DRAW_BUDGET 256
+#define HLOD_PRIMITIVE_BUDGET 1000000
+
+// Interleaved static batch vertices (STATIC_BATCH_VERTEX_FLOATS each) and indices
+struct BatchGeometry {
+    std::vector<float> Vertices;
+    std::vector<unsigned int> Indices;
+};
+
+struct HlodStats {
+    size_t Nodes = 0;              // visited
+    size_t BatchDraws = 0;         // leaf batches at full detail
+    size_t ProxyDraws = 0;
+    size_t Primitives = 0;
+    bool OverBudget = false;       // some cluster above the switch size kept its proxy
+};
+
+// Vertex clustering (Rossignac and Borrel): every vertex snaps to a grid of
+// `cells` cells along the longest side of the geometry's bounds, vertices
+// sharing a cell merge into one with their attributes averaged, and
+// primitives that collapse or come out twice are dropped. `mode` is
+// GL_TRIANGLES, GL_LINES or GL_POINTS.
+BatchGeometry SimplifyBatchGeometry(const BatchGeometry& geometry, unsigned int mode, int cells = HLOD_PROXY_CELLS);
+
+// Vertices per primitive of the modes batches can merge; 0 for strips, fans
+// and loops, whose index lists cannot simply be concatenated
+int GetPrimitiveVertices(unsigned int mode);
+
+// Picks the static batches to draw this frame, culled against the scene's
+// visibility set and the view:
+// walks each group's cluster tree from the root, and replaces a cluster by
+// its children only while it is larger than HLOD_SWITCH_PIXELS on screen
+// (or has no proxy) and the draw and primitive budgets allow it. The result
+// is sorted, so batches of one material stay together.
+void SelectBatches(const Scene& scene, const glm::mat4& view, const glm::mat4& proj, int viewportHeight,
+                   std::pmr::vector<unsigned int>& batches, HlodStats& stats);
@@ -0,0 +1,352 @@
+#include "HostMemory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <string>
+
+#if __has_include(<execinfo.h>) && __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#include <execinfo.h>
+#define HOST_MEMORY_BACKTRACE 1
+#endif
+
+// Frames kept per captured stack, after skipping the allocator's own
+#define ALLOCATION_STACK_DEPTH 12
+#define ALLOCATION_STACK_SKIP 3
+// Distinct stacks tracked; once full, further stacks are not attributed
+#define ALLOCATION_STACK_SLOTS 4096
+
+// Sits directly in front of every pointer operator new returns
+struct AllocationHeader {
+    uint64_t Size;
+    uint32_t Stack;                // slot + 1 in s_Stacks, 0 when not captured
+    uint8_t Tag;
+    uint8_t Reserved;
+    uint16_t Offset;               // from the start of the underlying block to the user pointer
+};
+static_assert(sizeof(AllocationHeader) == 16, "header must keep 16-byte alignment");
+
+struct TagCounters {
+    std::atomic<size_t> Live = 0;
+    std::atomic<size_t> Peak = 0;
+    std::atomic<unsigned long long> Allocations = 0;
+    std::atomic<unsigned long long> Frees = 0;
+    std::atomic<unsigned long long> Bytes = 0;
+};
+
+struct FrameCounters {
+    unsigned long long StartAllocations = 0;
+    unsigned long long StartBytes = 0;
+    unsigned long long Allocations = 0;
+    size_t Bytes = 0;
+};
+
+struct StackSlot {
+    std::atomic<uint64_t> Hash = 0;
+    std::atomic<int> Depth = 0;    // set once Frames is filled in
+    void* Frames[ALLOCATION_STACK_DEPTH] = {};
+    uint8_t Tag = 0;
+    std::atomic<unsigned long long> Allocations = 0;
+    std::atomic<size_t> Bytes = 0;
+    std::atomic<size_t> Live = 0;
+};
+
+// Index Count holds the totals over every tag
+static constinit TagCounters s_Tags[static_cast<int>(MemoryTag::Count) + 1];
+static FrameCounters s_Frames[static_cast<int>(MemoryTag::Count) + 1];
+static constinit StackSlot s_Stacks[ALLOCATION_STACK_SLOTS];
+static constinit std::atomic<bool> s_StacksEnabled = false;
+
+static constinit thread_local MemoryTag t_Tag = MemoryTag::Untagged;
+static constinit thread_local bool t_Capturing = false;
+
+const char* GetMemoryTagName(MemoryTag tag) {
+    switch (tag) {
+        case MemoryTag::Untagged:  return "untagged";
+        case MemoryTag::Meshes:    return "meshes";
+        case MemoryTag::Shaders:   return "shaders";
+        case MemoryTag::Scene:     return "scene";
+        case MemoryTag::Rendering: return "rendering";
+        case MemoryTag::Streaming: return "streaming";
+        case MemoryTag::Logging:   return "logging";
+        case MemoryTag::Count:     break;
+    }
+    return "unknown";
+}
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag) : m_Previous(t_Tag) {
+    t_Tag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope() {
+    t_Tag = m_Previous;
+}
+
+MemoryTag GetCurrentMemoryTag() {
+    return t_Tag;
+}
+
+void* TaggedMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+    MemoryTagScope scope(m_Tag);
+    return m_Upstream->allocate(bytes, alignment);
+}
+
+void TaggedMemoryResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    m_Upstream->deallocate(p, bytes, alignment);
+}
+
+static void AddLive(TagCounters& counters, size_t size) {
+    size_t live = counters.Live.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = counters.Peak.load(std::memory_order_relaxed);
+    while (live > peak && !counters.Peak.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+    counters.Allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.Bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static uint32_t CaptureStack(size_t size, MemoryTag tag) {
+#ifdef HOST_MEMORY_BACKTRACE
+    void* frames[ALLOCATION_STACK_DEPTH + ALLOCATION_STACK_SKIP];
+    int depth = backtrace(frames, ALLOCATION_STACK_DEPTH + ALLOCATION_STACK_SKIP) - ALLOCATION_STACK_SKIP;
+    if (depth <= 0)
+        return 0;
+
+    // FNV-1a over the return addresses; 0 marks an empty slot
+    uint64_t hash = 14695981039346656037ull;
+    for (int i = 0; i < depth; i++)
+        hash = (hash ^ reinterpret_cast<uintptr_t>(frames[ALLOCATION_STACK_SKIP + i])) * 1099511628211ull;
+    hash |= 1;
+
+    for (uint32_t probe = 0; probe < 64; probe++) {
+        uint32_t index = static_cast<uint32_t>((hash + probe) % ALLOCATION_STACK_SLOTS);
+        StackSlot& slot = s_Stacks[index];
+        uint64_t expected = 0;
+        if (slot.Hash.load(std::memory_order_acquire) != hash) {
+            if (!slot.Hash.compare_exchange_strong(expected, hash, std::memory_order_acq_rel)) {
+                if (expected != hash)
+                    continue;
+            } else {
+                std::copy(frames + ALLOCATION_STACK_SKIP, frames + ALLOCATION_STACK_SKIP + depth, slot.Frames);
+                slot.Tag = static_cast<uint8_t>(tag);
+                slot.Depth.store(depth, std::memory_order_release);
+            }
+        }
+        slot.Allocations.fetch_add(1, std::memory_order_relaxed);
+        slot.Bytes.fetch_add(size, std::memory_order_relaxed);
+        slot.Live.fetch_add(size, std::memory_order_relaxed);
+        return index + 1;
+    }
+#endif
+    return 0;
+}
+
+static void* Allocate(size_t size, size_t alignment) {
+    // The header occupies the last 16 bytes of a prefix that keeps the user pointer aligned
+    size_t prefix = std::max<size_t>(alignment, sizeof(AllocationHeader));
+    unsigned char* block;
+    if (alignment > alignof(std::max_align_t))
+        block = static_cast<unsigned char*>(std::aligned_alloc(alignment, (size + prefix + alignment - 1) / alignment * alignment));
+    else
+        block = static_cast<unsigned char*>(std::malloc(size + prefix));
+    if (!block)
+        return nullptr;
+
+    MemoryTag tag = t_Tag;
+    uint32_t stack = 0;
+    if (s_StacksEnabled.load(std::memory_order_relaxed) && !t_Capturing) {
+        t_Capturing = true;
+        stack = CaptureStack(size, tag);
+        t_Capturing = false;
+    }
+
+    unsigned char* user = block + prefix;
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(user) - 1;
+    *header = { size, stack, static_cast<uint8_t>(tag), 0, static_cast<uint16_t>(prefix) };
+
+    AddLive(s_Tags[static_cast<int>(tag)], size);
+    AddLive(s_Tags[static_cast<int>(MemoryTag::Count)], size);
+    return user;
+}
+
+static void Free(void* pointer) {
+    if (!pointer)
+        return;
+    AllocationHeader* header = static_cast<AllocationHeader*>(pointer) - 1;
+    size_t size = header->Size;
+    for (int tag : { static_cast<int>(header->Tag), static_cast<int>(MemoryTag::Count) }) {
+        s_Tags[tag].Live.fetch_sub(size, std::memory_order_relaxed);
+        s_Tags[tag].Frees.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (header->Stack)
+        s_Stacks[header->Stack - 1].Live.fetch_sub(size, std::memory_order_relaxed);
+    std::free(static_cast<unsigned char*>(pointer) - header->Offset);
+}
+
+void* operator new(size_t size) {
+    if (void* p = Allocate(size, alignof(std::max_align_t)))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return Allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return Allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* p = Allocate(size, static_cast<size_t>(alignment)))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept { Free(p); }
+void operator delete[](void* p) noexcept { Free(p); }
+void operator delete(void* p, size_t) noexcept { Free(p); }
+void operator delete[](void* p, size_t) noexcept { Free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { Free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { Free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { Free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { Free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { Free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { Free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { Free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { Free(p); }
+
+static HostMemoryStats GetStats(int tag) {
+    const TagCounters& counters = s_Tags[tag];
+    HostMemoryStats stats;
+    stats.LiveBytes = counters.Live.load(std::memory_order_relaxed);
+    stats.PeakBytes = counters.Peak.load(std::memory_order_relaxed);
+    stats.Allocations = counters.Allocations.load(std::memory_order_relaxed);
+    stats.Frees = counters.Frees.load(std::memory_order_relaxed);
+    stats.FrameAllocations = s_Frames[tag].Allocations;
+    stats.FrameBytes = s_Frames[tag].Bytes;
+    return stats;
+}
+
+HostMemoryStats GetHostMemoryStats(MemoryTag tag) {
+    return GetStats(static_cast<int>(tag));
+}
+
+HostMemoryStats GetHostMemoryTotals() {
+    return GetStats(static_cast<int>(MemoryTag::Count));
+}
+
+void EndHostMemoryFrame() {
+    for (int tag = 0; tag <= static_cast<int>(MemoryTag::Count); tag++) {
+        FrameCounters& frame = s_Frames[tag];
+        unsigned long long allocations = s_Tags[tag].Allocations.load(std::memory_order_relaxed);
+        unsigned long long bytes = s_Tags[tag].Bytes.load(std::memory_order_relaxed);
+        frame.Allocations = allocations - frame.StartAllocations;
+        frame.Bytes = static_cast<size_t>(bytes - frame.StartBytes);
+        frame.StartAllocations = allocations;
+        frame.StartBytes = bytes;
+    }
+}
+
+void DumpHostMemory(std::ostream& out) {
+    MemoryTagScope scope(MemoryTag::Logging);
+    HostMemoryStats total = GetHostMemoryTotals();
+    out << "[Host Memory] " << total.LiveBytes / 1024.0 << " KB live in " << total.Allocations - total.Frees
+        << " allocation(s), peak " << total.PeakBytes / 1024.0 << " KB, " << total.FrameAllocations
+        << " allocation(s) / " << total.FrameBytes << " bytes last frame" << std::endl;
+
+    for (int i = 0; i < static_cast<int>(MemoryTag::Count); i++) {
+        HostMemoryStats stats = GetStats(i);
+        if (stats.PeakBytes == 0)
+            continue;
+        out << "  " << std::left << std::setw(18) << GetMemoryTagName(static_cast<MemoryTag>(i)) << std::right
+            << std::setw(12) << stats.LiveBytes << " bytes in " << stats.Allocations - stats.Frees
+            << " allocation(s), peak " << stats.PeakBytes << ", " << stats.FrameAllocations << " last frame" << std::endl;
+    }
+}
+
+void EnableAllocationStacks(bool enable) {
+#ifdef HOST_MEMORY_BACKTRACE
+    if (enable) {
+        // The first backtrace() loads the unwinder; do it here rather than inside an allocation
+        void* frame;
+        backtrace(&frame, 1);
+    }
+    s_StacksEnabled.store(enable, std::memory_order_relaxed);
+#else
+    (void)enable;
+#endif
+}
+
+bool AllocationStacksEnabled() {
+    return s_StacksEnabled.load(std::memory_order_relaxed);
+}
+
+#ifdef HOST_MEMORY_BACKTRACE
+// backtrace_symbols gives "binary(mangled+0x1f) [0x...]"; demangle the middle part
+static std::string Symbolize(char* symbol) {
+    std::string line = symbol;
+    size_t open = line.find('('), plus = line.find('+', open);
+    if (open == std::string::npos || plus == std::string::npos || plus == open + 1)
+        return line;
+    std::string mangled = line.substr(open + 1, plus - open - 1);
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status);
+    if (status != 0 || !demangled)
+        return line;
+    std::string result = demangled;
+    std::free(demangled);
+    return result + line.substr(plus, line.find(')', plus) - plus);
+}
+#endif
+
+void DumpAllocationStacks(std::ostream& out, int count) {
+#ifdef HOST_MEMORY_BACKTRACE
+    // A static index array keeps the dump from allocating while it walks the table
+    static uint32_t order[ALLOCATION_STACK_SLOTS];
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < ALLOCATION_STACK_SLOTS; i++) {
+        if (s_Stacks[i].Depth.load(std::memory_order_acquire) > 0)
+            order[used++] = i;
+    }
+    count = std::min<int>(count, static_cast<int>(used));
+    std::partial_sort(order, order + count, order + used, [](uint32_t a, uint32_t b) {
+        return s_Stacks[a].Bytes.load(std::memory_order_relaxed) > s_Stacks[b].Bytes.load(std::memory_order_relaxed);
+    });
+
+    bool wasEnabled = s_StacksEnabled.exchange(false);
+    MemoryTagScope scope(MemoryTag::Logging);
+    out << "[Host Memory] top " << count << " of " << used << " allocation stack(s) by bytes allocated" << std::endl;
+    for (int i = 0; i < count; i++) {
+        StackSlot& slot = s_Stacks[order[i]];
+        out << "  #" << i + 1 << ": " << slot.Bytes.load() << " bytes in " << slot.Allocations.load()
+            << " allocation(s), " << slot.Live.load() << " live, " << GetMemoryTagName(static_cast<MemoryTag>(slot.Tag)) << std::endl;
+        int depth = slot.Depth.load(std::memory_order_acquire);
+        char** symbols = backtrace_symbols(slot.Frames, depth);
+        for (int frame = 0; frame < depth; frame++)
+            out << "      " << (symbols ? Symbolize(symbols[frame]) : "?") << std::endl;
+        std::free(symbols);
+    }
+    s_StacksEnabled.store(wasEnabled);
+#else
+    out << "[Host Memory] allocation stacks are not supported on this platform" << std::endl;
+#endif
+}
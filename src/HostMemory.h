@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <ostream>
+
+// Subsystems host allocations are attributed to. Allocations made while no
+// MemoryTagScope is active count as Untagged.
+enum class MemoryTag : unsigned char {
+    Untagged, Meshes, Shaders, Scene, Rendering, Streaming, Logging, Count
+};
+
+const char* GetMemoryTagName(MemoryTag tag);
+
+struct HostMemoryStats {
+    size_t LiveBytes = 0;
+    size_t PeakBytes = 0;
+    unsigned long long Allocations = 0;     // since startup
+    unsigned long long Frees = 0;
+    unsigned long long FrameAllocations = 0; // during the last closed frame
+    size_t FrameBytes = 0;
+};
+
+// Attributes every operator new on this thread to `tag` until destroyed.
+// Scopes nest; the innermost wins.
+class MemoryTagScope {
+public:
+    explicit MemoryTagScope(MemoryTag tag);
+    ~MemoryTagScope();
+
+    MemoryTagScope(const MemoryTagScope&) = delete;
+    MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+private:
+    MemoryTag m_Previous;
+};
+
+MemoryTag GetCurrentMemoryTag();
+
+// Tagged allocator for pmr containers: allocations through it are charged to
+// `tag` regardless of the calling thread's scope
+class TaggedMemoryResource : public std::pmr::memory_resource {
+public:
+    explicit TaggedMemoryResource(MemoryTag tag, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : m_Tag(tag), m_Upstream(upstream) {}
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    MemoryTag m_Tag;
+    std::pmr::memory_resource* m_Upstream;
+};
+
+// Totals are maintained by the global operator new/delete replacements and
+// are always on; they cost a few relaxed atomics per allocation
+HostMemoryStats GetHostMemoryStats(MemoryTag tag);
+HostMemoryStats GetHostMemoryTotals();
+// GL thread, once per frame: closes the per-frame allocation counts
+void EndHostMemoryFrame();
+void DumpHostMemory(std::ostream& out);
+
+// Allocation call stacks, off by default. While enabled every allocation
+// captures a backtrace, which is far slower; stacks are aggregated in a
+// fixed table so capturing itself never allocates.
+void EnableAllocationStacks(bool enable);
+bool AllocationStacksEnabled();
+// Prints the `count` stacks with the most bytes allocated, with symbols
+void DumpAllocationStacks(std::ostream& out, int count);
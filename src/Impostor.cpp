@@ -0,0 +1,384 @@
+#include "Impostor.h"
+#include "RenderBackend.h"
+#include "Scene.h"
+#include "UniformRing.h"
+#include "HostMemory.h"
+#include "ShaderLayouts.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <utility>
+
+#define IMPOSTOR_TILE_TEXELS (IMPOSTOR_VIEWS_PER_SIDE * IMPOSTOR_VIEW_TEXELS)
+
+// Axes of the view from `direction` (pointing at the eye). Impostor.shader
+// rebuilds the same ones, so both sides must agree on the fallback.
+static void GetViewBasis(const glm::vec3& direction, glm::vec3& right, glm::vec3& up) {
+    right = glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), direction);
+    float length = glm::length(right);
+    right = length > 1e-4f ? right / length : glm::vec3(1.0f, 0.0f, 0.0f);
+    up = glm::cross(direction, right);
+}
+
+// View (x, y) of the grid: the square folds onto the upper half of an
+// octahedron, corners to the horizon and the centre straight above
+static glm::vec3 GetViewDirection(int x, int y) {
+    float a = static_cast<float>(x) / (IMPOSTOR_VIEWS_PER_SIDE - 1) * 2.0f - 1.0f;
+    float b = static_cast<float>(y) / (IMPOSTOR_VIEWS_PER_SIDE - 1) * 2.0f - 1.0f;
+    glm::vec3 direction(0.5f * (a + b), 0.0f, 0.5f * (a - b));
+    direction.y = 1.0f - std::abs(direction.x) - std::abs(direction.z);
+    return glm::normalize(direction);
+}
+
+// Orthographic view of a sphere of `radius` around the origin from
+// `direction`: x and y span the sphere, depth runs from its near side (0)
+// to its far side (1)
+static glm::mat4 GetBakeProjection(const glm::vec3& direction, float radius) {
+    glm::vec3 right, up;
+    GetViewBasis(direction, right, up);
+    glm::mat4 projection(1.0f);
+    for (int axis = 0; axis < 3; axis++) {
+        projection[axis][0] = right[axis] / radius;
+        projection[axis][1] = up[axis] / radius;
+        projection[axis][2] = -direction[axis] / radius;
+    }
+    return projection;
+}
+
+// Scale and yaw of a model that is a uniform scale, a rotation about y and
+// a translation; false for anything else
+static bool GetScaleAndYaw(const glm::mat4& model, float& scale, float& yaw) {
+    glm::vec3 x(model[0]), y(model[1]), z(model[2]);
+    scale = glm::length(x);
+    if (scale <= 0.0f || model[0][3] != 0.0f || model[1][3] != 0.0f || model[2][3] != 0.0f || model[3][3] != 1.0f)
+        return false;
+    yaw = std::atan2(-x.z, x.x);
+    glm::vec3 expectedX = glm::vec3(std::cos(yaw), 0.0f, -std::sin(yaw)) * scale;
+    glm::vec3 expectedZ = glm::vec3(std::sin(yaw), 0.0f, std::cos(yaw)) * scale;
+    float tolerance = 1e-3f * scale;
+    return glm::length(x - expectedX) <= tolerance && glm::length(y - glm::vec3(0.0f, scale, 0.0f)) <= tolerance &&
+           glm::length(z - expectedZ) <= tolerance;
+}
+
+// Interleaves the low 10 bits of v with two zero bits each
+static uint32_t SpreadBits(uint32_t v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+static bool IsTinted(const Scene& scene, const Material& material) {
+    const std::vector<std::string>& keywords = scene.Shaders[material.Shader]->GetSource().Keywords;
+    for (size_t i = 0; i < keywords.size(); i++) {
+        if (keywords[i] == IMPOSTOR_TINT_KEYWORD)
+            return (material.Variant >> i) & 1;
+    }
+    return false;
+}
+
+static bool IsLoaded(const ShaderVariantSet* shader) {
+    return shader && !shader->GetSource().VertexSource.empty() && !shader->GetSource().FragmentSource.empty();
+}
+
+bool ImpostorRenderer::Init(Scene& scene, RenderBackend& backend) {
+    ShaderVariantSet* shader = FindShader(scene, IMPOSTOR_SHADER_PATH);
+    ShaderVariantSet* bake = FindShader(scene, IMPOSTOR_BAKE_SHADER_PATH);
+    if (!IsLoaded(shader) || !IsLoaded(bake)) {
+        std::cout << "[Impostors] cannot load " << IMPOSTOR_SHADER_PATH << " and " << IMPOSTOR_BAKE_SHADER_PATH << std::endl;
+        return false;
+    }
+    shader->Request(0);
+    bake->Request(0);
+    CompileRequestedVariants(backend, { shader, bake });
+    unsigned int program = shader->Get(0), bakeProgram = bake->Get(0);
+    if (program == 0 || bakeProgram == 0)
+        return false;
+    m_Shader = shader;
+    m_BakeShader = bake;
+    backend.BindUniformBlock(program, ImpostorFrame::Name, ImpostorFrame::Binding);
+    backend.BindUniformBlock(bakeProgram, ObjectData::Name, ObjectData::Binding);
+    backend.UseProgram(program);
+    backend.SetUniform1i(backend.GetUniformLocation(program, "u_ColorAtlas"), 0);
+    backend.SetUniform1i(backend.GetUniformLocation(program, "u_NormalDepthAtlas"), 1);
+    backend.UseProgram(0);
+    return true;
+}
+
+void ImpostorRenderer::Clear(Scene& scene) {
+    m_Quads.Reset();
+    m_QuadBuffer.Reset();
+    m_IndexBuffer.Reset();
+    m_Color.Reset();
+    m_NormalDepth.Reset();
+    m_Clusters.clear();
+    m_ClusterObjects.clear();
+    m_Ranges.clear();
+    m_Stats = {};
+    scene.ImpostorObjects.clear();
+}
+
+ImpostorStats ImpostorRenderer::Build(Scene& scene, RenderBackend& backend, size_t objectCount) {
+    MemoryTagScope tag(MemoryTag::Scene);
+    auto start = std::chrono::steady_clock::now();
+    Clear(scene);
+
+    // One impostor per (mesh, material) pair
+    std::map<std::pair<unsigned int, unsigned int>, std::vector<unsigned int>> groups;
+    objectCount = std::min(objectCount, scene.Objects.size());
+    for (size_t i = 0; i < objectCount; i++) {
+        const SceneObject& object = scene.Objects[i];
+        const Mesh& mesh = scene.Meshes[object.MeshIndex];
+        float scale, yaw;
+        if (object.Batched || mesh.Mode != GL_TRIANGLES || mesh.Count == 0 ||
+            scene.Materials[object.MaterialIndex].Program == 0 || !GetScaleAndYaw(object.Model, scale, yaw))
+            continue;
+        groups[{ object.MeshIndex, object.MaterialIndex }].push_back(static_cast<unsigned int>(i));
+    }
+    std::erase_if(groups, [](const auto& group) { return group.second.size() < IMPOSTOR_MIN_OBJECTS; });
+    // Scenes with nothing to bake never compile the shaders
+    if (groups.empty() || (!m_Shader && !Init(scene, backend)))
+        return m_Stats;
+
+    const int tilesPerSide = IMPOSTOR_ATLAS_MAX_SIDE / IMPOSTOR_TILE_TEXELS;
+    size_t pairs = groups.size();
+    if (pairs > static_cast<size_t>(tilesPerSide * tilesPerSide)) {
+        std::cout << "[Impostors] the atlas holds " << tilesPerSide * tilesPerSide << " of " << pairs
+                  << " mesh and material pair(s); the rest stay meshes" << std::endl;
+        pairs = static_cast<size_t>(tilesPerSide * tilesPerSide);
+    }
+    int tilesPerRow = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(pairs))));
+    int tileRows = static_cast<int>((pairs + tilesPerRow - 1) / tilesPerRow);
+    glm::ivec2 atlas(tilesPerRow * IMPOSTOR_TILE_TEXELS, tileRows * IMPOSTOR_TILE_TEXELS);
+
+    // One ObjectData block per view of every pair; both passes read them
+    const int views = IMPOSTOR_VIEWS_PER_SIDE * IMPOSTOR_VIEWS_PER_SIDE;
+    size_t alignment = backend.GetUniformBufferAlignment();
+    size_t stride = (sizeof(ObjectData) + alignment - 1) / alignment * alignment;
+    std::vector<unsigned char> blocks(pairs * views * stride);
+    std::vector<std::pair<unsigned int, unsigned int>> keys;
+    for (const auto& [key, objects] : groups) {
+        if (keys.size() == pairs)
+            break;
+        const Mesh& mesh = scene.Meshes[key.first];
+        glm::vec3 center = (mesh.BoundsMin + mesh.BoundsMax) * 0.5f;
+        float radius = std::max(0.5f * glm::length(mesh.BoundsMax - mesh.BoundsMin), 1e-6f);
+        glm::mat4 toCenter(1.0f);
+        toCenter[3] = glm::vec4(-center, 1.0f);
+        for (int view = 0; view < views; view++) {
+            ObjectData data;
+            data.u_MVP = GetBakeProjection(GetViewDirection(view % IMPOSTOR_VIEWS_PER_SIDE, view / IMPOSTOR_VIEWS_PER_SIDE), radius) * toCenter;
+            data.u_Color = glm::vec4(1.0f);
+            std::memcpy(blocks.data() + (keys.size() * views + view) * stride, &data, sizeof(data));
+        }
+        keys.push_back(key);
+    }
+    BufferHandle bakeData(backend, backend.CreateBuffer(GL_UNIFORM_BUFFER, blocks.data(), blocks.size(), GL_STATIC_DRAW));
+
+    // The color pass draws with each material's own program, the second with
+    // the bake shader; they share the depth buffer, cleared by each
+    m_Color = TextureHandle(backend, backend.CreateTexture(GL_RGBA8, atlas.x, atlas.y, nullptr));
+    m_NormalDepth = TextureHandle(backend, backend.CreateTexture(GL_RGBA8, atlas.x, atlas.y, nullptr));
+    RenderbufferHandle depth(backend, backend.CreateRenderbuffer(GL_DEPTH_COMPONENT24, atlas.x, atlas.y));
+    FramebufferHandle targets[2];
+    for (int pass = 0; pass < 2; pass++) {
+        targets[pass] = FramebufferHandle(backend, backend.CreateFramebuffer());
+        backend.FramebufferTexture(GL_COLOR_ATTACHMENT0, pass == 0 ? m_Color.Get() : m_NormalDepth.Get());
+        backend.FramebufferRenderbuffer(GL_DEPTH_ATTACHMENT, depth.Get());
+        backend.SetViewport(0, 0, atlas.x, atlas.y);
+        backend.Clear();
+        for (size_t pair = 0; pair < keys.size(); pair++) {
+            const Mesh& mesh = scene.Meshes[keys[pair].first];
+            backend.UseProgram(pass == 0 ? scene.Materials[keys[pair].second].Program : m_BakeShader->Get(0));
+            backend.BindVertexArray(mesh.Vao);
+            int tileX = static_cast<int>(pair % tilesPerRow) * IMPOSTOR_TILE_TEXELS;
+            int tileY = static_cast<int>(pair / tilesPerRow) * IMPOSTOR_TILE_TEXELS;
+            for (int view = 0; view < views; view++) {
+                backend.SetViewport(tileX + view % IMPOSTOR_VIEWS_PER_SIDE * IMPOSTOR_VIEW_TEXELS,
+                                    tileY + view / IMPOSTOR_VIEWS_PER_SIDE * IMPOSTOR_VIEW_TEXELS,
+                                    IMPOSTOR_VIEW_TEXELS, IMPOSTOR_VIEW_TEXELS);
+                backend.BindBufferRange(GL_UNIFORM_BUFFER, ObjectData::Binding, bakeData.Get(),
+                                        (pair * views + view) * stride, sizeof(ObjectData));
+                if (mesh.Ibo != 0)
+                    backend.DrawElements(mesh.Mode, mesh.Count, mesh.First * sizeof(unsigned int));
+                else
+                    backend.DrawArrays(mesh.Mode, mesh.First, mesh.Count);
+            }
+        }
+    }
+    backend.BindFramebuffer(0);
+    backend.BindVertexArray(0);
+    backend.UseProgram(0);
+
+    // Each pair's objects in Morton order of their centres, cut into clusters
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+    scene.ImpostorObjects.assign(objectCount, 0);
+    for (size_t pair = 0; pair < keys.size(); pair++) {
+        const Mesh& mesh = scene.Meshes[keys[pair].first];
+        const Material& material = scene.Materials[keys[pair].second];
+        bool tinted = IsTinted(scene, material);
+        glm::vec3 meshCenter = (mesh.BoundsMin + mesh.BoundsMax) * 0.5f;
+        float meshRadius = std::max(0.5f * glm::length(mesh.BoundsMax - mesh.BoundsMin), 1e-6f);
+        float tileX = static_cast<float>(pair % tilesPerRow) * IMPOSTOR_TILE_TEXELS;
+        float tileY = static_cast<float>(pair / tilesPerRow) * IMPOSTOR_TILE_TEXELS;
+
+        std::vector<unsigned int>& objects = groups[keys[pair]];
+        glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+        for (size_t i = 0; i < objects.size(); i++) {
+            glm::vec3 center(scene.Objects[objects[i]].Model[3]);
+            boundsMin = i == 0 ? center : glm::min(boundsMin, center);
+            boundsMax = i == 0 ? center : glm::max(boundsMax, center);
+        }
+        glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+        std::vector<std::pair<uint32_t, unsigned int>> order;
+        for (unsigned int index : objects) {
+            glm::vec3 cell = (glm::vec3(scene.Objects[index].Model[3]) - boundsMin) / extent * 1023.0f;
+            uint32_t code = SpreadBits(static_cast<uint32_t>(cell.x)) | SpreadBits(static_cast<uint32_t>(cell.y)) << 1 |
+                            SpreadBits(static_cast<uint32_t>(cell.z)) << 2;
+            order.push_back({ code, index });
+        }
+        std::sort(order.begin(), order.end());
+
+        for (size_t i = 0; i < order.size(); i++) {
+            if (i % IMPOSTOR_CLUSTER_OBJECTS == 0) {
+                Cluster cluster;
+                cluster.FirstObject = static_cast<unsigned int>(m_ClusterObjects.size());
+                m_Clusters.push_back(cluster);
+            }
+            Cluster& cluster = m_Clusters.back();
+            const SceneObject& object = scene.Objects[order[i].second];
+            float scale, yaw;
+            GetScaleAndYaw(object.Model, scale, yaw);
+            glm::vec3 center = glm::vec3(object.Model * glm::vec4(meshCenter, 1.0f));
+            float radius = meshRadius * scale;
+            glm::vec4 color = tinted ? object.Color : glm::vec4(1.0f);
+            unsigned int first = static_cast<unsigned int>(vertices.size() / IMPOSTOR_VERTEX_FLOATS);
+            for (const float* corner : corners) {
+                const float vertex[IMPOSTOR_VERTEX_FLOATS] = {
+                    center.x, center.y, center.z, corner[0], corner[1], radius, yaw,
+                    color.x, color.y, color.z, color.w, tileX, tileY
+                };
+                vertices.insert(vertices.end(), vertex, vertex + IMPOSTOR_VERTEX_FLOATS);
+            }
+            for (unsigned int corner : { 0u, 1u, 2u, 2u, 3u, 0u })
+                indices.push_back(first + corner);
+
+            glm::vec3 sphereMin = center - glm::vec3(radius), sphereMax = center + glm::vec3(radius);
+            cluster.BoundsMin = cluster.ObjectCount == 0 ? sphereMin : glm::min(cluster.BoundsMin, sphereMin);
+            cluster.BoundsMax = cluster.ObjectCount == 0 ? sphereMax : glm::max(cluster.BoundsMax, sphereMax);
+            cluster.Radius = std::max(cluster.Radius, radius);
+            cluster.ObjectCount++;
+            m_ClusterObjects.push_back(order[i].second);
+        }
+    }
+
+    m_Quads = VertexArrayHandle(backend, backend.CreateVertexArray());
+    backend.BindVertexArray(m_Quads.Get());
+    m_QuadBuffer = BufferHandle(backend, backend.CreateBuffer(GL_ARRAY_BUFFER, vertices.data(), vertices.size() * sizeof(float),
+                                                              GL_STATIC_DRAW));
+    int vertexStride = IMPOSTOR_VERTEX_FLOATS * sizeof(float);
+    backend.VertexAttribPointer(0, 3, GL_FLOAT, vertexStride, 0);
+    backend.VertexAttribPointer(1, 2, GL_FLOAT, vertexStride, 3 * sizeof(float));
+    backend.VertexAttribPointer(2, 2, GL_FLOAT, vertexStride, 5 * sizeof(float));
+    backend.VertexAttribPointer(3, 4, GL_FLOAT, vertexStride, 7 * sizeof(float));
+    backend.VertexAttribPointer(4, 2, GL_FLOAT, vertexStride, 11 * sizeof(float));
+    m_IndexBuffer = BufferHandle(backend, backend.CreateBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.data(),
+                                                               indices.size() * sizeof(unsigned int), GL_STATIC_DRAW));
+    backend.BindVertexArray(0);
+
+    m_Stats.Impostors = keys.size();
+    m_Stats.Objects = m_ClusterObjects.size();
+    m_Stats.Clusters = m_Clusters.size();
+    m_Stats.AtlasSize = atlas;
+    m_Stats.Bytes = 2 * static_cast<size_t>(atlas.x) * atlas.y * 4 + vertices.size() * sizeof(float) +
+                    indices.size() * sizeof(unsigned int);
+    m_Stats.BakeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return m_Stats;
+}
+
+void ImpostorRenderer::Select(Scene& scene, const glm::mat4& view, const glm::mat4& proj, int viewportHeight) {
+    m_Ranges.clear();
+    m_Stats.FarClusters = m_Stats.ReplacedObjects = m_Stats.Quads = m_Stats.Draws = 0;
+    if (m_Clusters.empty() || scene.ImpostorObjects.empty())
+        return;
+    Frustum frustum = ExtractFrustum(proj * view);
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    float pixelsPerUnit = 0.5f * static_cast<float>(viewportHeight) * proj[1][1];
+
+    for (Cluster& cluster : m_Clusters) {
+        float distance = glm::length(glm::clamp(eye, cluster.BoundsMin, cluster.BoundsMax) - eye);
+        bool far = 2.0f * cluster.Radius * pixelsPerUnit < IMPOSTOR_SWITCH_PIXELS * distance;
+        // Objects only change hands when their cluster switches
+        if (far != cluster.Far) {
+            cluster.Far = far;
+            for (unsigned int i = 0; i < cluster.ObjectCount; i++)
+                scene.ImpostorObjects[m_ClusterObjects[cluster.FirstObject + i]] = far;
+        }
+        if (!far)
+            continue;
+        m_Stats.FarClusters++;
+        m_Stats.ReplacedObjects += cluster.ObjectCount;
+        if (!IsBoxVisible(frustum, cluster.BoundsMin, cluster.BoundsMax))
+            continue;
+        // Six indices per object, in cluster order. The camera cell's set
+        // gates quads like the meshes they replace, object by object, since
+        // clusters are grouped by distance and may span cells.
+        for (unsigned int i = 0; i < cluster.ObjectCount; i++) {
+            unsigned int object = cluster.FirstObject + i;
+            if (!IsObjectPotentiallyVisible(scene.Visibility, m_ClusterObjects[object]))
+                continue;
+            int first = static_cast<int>(object) * 6;
+            if (!m_Ranges.empty() && m_Ranges.back().First + m_Ranges.back().Count == first)
+                m_Ranges.back().Count += 6;
+            else
+                m_Ranges.push_back({ first, 6 });
+            m_Stats.Quads++;
+        }
+    }
+    m_Stats.Draws = m_Ranges.size();
+}
+
+size_t ImpostorRenderer::WriteFrameData(UniformRing& uniforms, const glm::mat4& view, const glm::mat4& proj) {
+    size_t offset = uniforms.Allocate();
+    ImpostorFrame& frame = *uniforms.GetSlot<ImpostorFrame>(offset);
+    frame.u_ViewProj = proj * view;
+    frame.u_Eye = glm::vec4(glm::vec3(glm::inverse(view)[3]), 1.0f);
+    frame.u_Atlas = glm::ivec4(IMPOSTOR_VIEWS_PER_SIDE, IMPOSTOR_VIEW_TEXELS, 0, 0);
+    return offset;
+}
+
+void ImpostorRenderer::Draw(RenderBackend& backend, const UniformRing& uniforms, size_t offset) {
+    if (m_Ranges.empty())
+        return;
+    backend.UseProgram(m_Shader->Get(0));
+    backend.BindVertexArray(m_Quads.Get());
+    backend.BindTexture(0, m_Color.Get());
+    backend.BindTexture(1, m_NormalDepth.Get());
+    backend.BindBufferRange(GL_UNIFORM_BUFFER, ImpostorFrame::Binding, uniforms.GetBuffer(), offset, sizeof(ImpostorFrame));
+    for (const Range& range : m_Ranges)
+        backend.DrawElements(GL_TRIANGLES, range.Count, range.First * sizeof(unsigned int));
+}
+
+void ImpostorRenderer::Release() {
+    m_Quads.Reset();
+    m_QuadBuffer.Reset();
+    m_IndexBuffer.Reset();
+    m_Color.Reset();
+    m_NormalDepth.Reset();
+    m_Clusters.clear();
+    m_ClusterObjects.clear();
+    m_Ranges.clear();
+    m_Shader = nullptr;
+    m_BakeShader = nullptr;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "GLResource.h"
+#include "ShaderVariants.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+class RenderBackend;
+class UniformRing;
+struct Scene;
+
+#define IMPOSTOR_SHADER_PATH "res/shaders/Impostor.shader"
+#define IMPOSTOR_BAKE_SHADER_PATH "res/shaders/ImpostorBake.shader"
+// Views per side of the hemi-octahedral grid each mesh is baked from, and
+// texels per side of one view; a mesh takes a square of 8 x 64 = 512 texels
+#define IMPOSTOR_VIEWS_PER_SIDE 8
+#define IMPOSTOR_VIEW_TEXELS 64
+#define IMPOSTOR_ATLAS_MAX_SIDE 4096
+// A mesh and material pair needs this many objects to be worth baking
+#define IMPOSTOR_MIN_OBJECTS 16
+// Objects are switched per cluster of this many neighbours, so a far
+// cluster draws all of its quads in one range
+#define IMPOSTOR_CLUSTER_OBJECTS 64
+// A cluster whose largest object's bounding sphere is smaller than this on
+// screen, at the cluster's nearest point, draws as impostors
+#define IMPOSTOR_SWITCH_PIXELS 48.0f
+// Materials whose variant has this keyword take their color per object.
+// Their views are baked in white and the quads multiply in each object's color.
+#define IMPOSTOR_TINT_KEYWORD "UNIFORM_COLOR"
+// Center, corner, radius and yaw, color, atlas origin of the mesh's views
+#define IMPOSTOR_VERTEX_FLOATS 13
+
+struct ImpostorStats {
+    size_t Impostors = 0;          // mesh and material pairs baked into the atlas
+    size_t Objects = 0;            // that can draw as impostors
+    size_t Clusters = 0;
+    glm::ivec2 AtlasSize = glm::ivec2(0, 0);
+    size_t Bytes = 0;              // atlas, vertices and indices
+    double BakeMilliseconds = 0.0;
+    size_t FarClusters = 0;        // last frame
+    size_t ReplacedObjects = 0;    // last frame: objects of the far clusters
+    size_t Quads = 0;              // last frame: drawn, after culling
+    size_t Draws = 0;              // last frame
+};
+
+// Far objects drawn as one camera-facing quad each instead of their meshes.
+//
+// Every mesh and material pair with enough static objects is rendered at
+// load time from a hemisphere of directions laid out on an octahedral grid
+// (Brucks' hemi-octahedral impostors), each view an orthographic square
+// around the mesh's bounding sphere, into two atlases: the material's own
+// color, and the surface normal in mesh space with the view's depth. At
+// runtime a quad facing the eye samples the three views nearest to it,
+// steps along the ray to the depth each one stored so they line up, blends
+// them (favouring views whose surface faces the eye) and writes that depth,
+// so impostors intersect the rest of the scene. Whole clusters switch at
+// once and far ones draw with a single range, so large instance counts cost
+// fill rate rather than vertices and draw calls. The camera cell's visibility
+// set (Pvs.h) gates the quads just as it does the meshes.
+//
+// Only objects drawn on their own are taken: static batches have their HLOD
+// proxies instead. Models must be a uniform scale, a rotation about y and a
+// translation, as vegetation and props scattered over terrain are.
+class ImpostorRenderer {
+public:
+    // Replaces the impostors with ones over scene.Objects[0, objectCount),
+    // compiling the shaders on first use. The scene must have loaded
+    // IMPOSTOR_SHADER_PATH and IMPOSTOR_BAKE_SHADER_PATH (see FindShader).
+    // Leaves the default framebuffer bound.
+    ImpostorStats Build(Scene& scene, RenderBackend& backend, size_t objectCount);
+    // Before the frame is built, after UpdateVisibility: switches clusters
+    // between impostors and meshes for this view (marking their objects in
+    // scene.ImpostorObjects) and culls the far ones' quads
+    void Select(Scene& scene, const glm::mat4& view, const glm::mat4& proj, int viewportHeight);
+    // Between the uniform ring's BeginFrame and FinishWrites: writes the
+    // frame's ImpostorFrame block and returns its offset
+    size_t WriteFrameData(UniformRing& uniforms, const glm::mat4& view, const glm::mat4& proj);
+    // Draws the quads of the clusters Select kept into the bound framebuffer
+    void Draw(RenderBackend& backend, const UniformRing& uniforms, size_t offset);
+    // Drops the GL objects; call before the context goes away
+    void Release();
+
+    bool HasImpostors() const { return !m_Clusters.empty(); }
+    // What Draw uses, for pipeline warm-up; zero before the first Build
+    unsigned int GetProgram() const { return m_Shader ? m_Shader->Get(0) : 0; }
+    unsigned int GetVertexArray() const { return m_Quads.Get(); }
+    std::vector<unsigned int> GetTextures() const { return { m_Color.Get(), m_NormalDepth.Get() }; }
+    const ImpostorStats& GetStats() const { return m_Stats; }
+
+private:
+    struct Cluster {
+        unsigned int FirstObject = 0;  // into m_ClusterObjects
+        unsigned int ObjectCount = 0;
+        glm::vec3 BoundsMin = glm::vec3(0.0f);     // world space, around the objects' spheres
+        glm::vec3 BoundsMax = glm::vec3(0.0f);
+        float Radius = 0.0f;           // largest object's, world space
+        bool Far = false;
+    };
+    struct Range {
+        int First = 0;                 // index
+        int Count = 0;
+    };
+
+    // Compiles the scene's sets for the two shader paths, loaded with its own
+    bool Init(Scene& scene, RenderBackend& backend);
+    void Clear(Scene& scene);
+
+    ShaderVariantSet* m_Shader = nullptr;      // owned by the scene
+    ShaderVariantSet* m_BakeShader = nullptr;
+    VertexArrayHandle m_Quads;
+    BufferHandle m_QuadBuffer;
+    BufferHandle m_IndexBuffer;
+    TextureHandle m_Color;
+    TextureHandle m_NormalDepth;
+
+    std::vector<Cluster> m_Clusters;           // each pair's together, in index buffer order
+    std::vector<unsigned int> m_ClusterObjects;    // indices into Scene::Objects
+    std::vector<Range> m_Ranges;               // last Select: far clusters in view, adjacent ones merged
+    ImpostorStats m_Stats;
+};
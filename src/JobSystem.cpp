@@ -0,0 +1,114 @@
+#include "JobSystem.h"
+
+JobSystem::JobSystem(unsigned int workerCount) {
+    // hardware_concurrency() may report 0, which wraps the default to a huge count
+    if (workerCount > 64)
+        workerCount = 0;
+    for (unsigned int i = 0; i < workerCount; i++)
+        m_Workers.emplace_back(&JobSystem::WorkerLoop, this);
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_Wake.notify_all();
+    for (std::thread& worker : m_Workers)
+        worker.join();
+}
+
+void JobSystem::Enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Queue.push_back(std::move(job));
+        m_Pending++;
+    }
+    m_Wake.notify_one();
+}
+
+void JobSystem::Wait() {
+    while (RunOne());
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Idle.wait(lock, [this] { return m_Pending == 0; });
+}
+
+void JobSystem::DispatchBatch(unsigned int count, void (*function)(void*, unsigned int), void* context) {
+    if (count == 0)
+        return;
+
+    std::lock_guard<std::mutex> dispatchLock(m_DispatchMutex);
+    Batch batch;
+    batch.Function = function;
+    batch.Context = context;
+    batch.Count = count;
+    batch.Tag = GetCurrentMemoryTag();
+    batch.Next = 0;
+    batch.Done = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Batch = &batch;
+    }
+    m_Wake.notify_all();
+
+    RunBatch(batch);
+
+    // The batch lives on this stack frame, so wait for every worker to leave it
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Idle.wait(lock, [&] { return batch.Done.load() == count && m_BatchUsers == 0; });
+    m_Batch = nullptr;
+}
+
+void JobSystem::RunBatch(Batch& batch) {
+    MemoryTagScope scope(batch.Tag);
+    unsigned int index;
+    while ((index = batch.Next.fetch_add(1)) < batch.Count) {
+        batch.Function(batch.Context, index);
+        batch.Done.fetch_add(1);
+    }
+}
+
+bool JobSystem::RunOne() {
+    std::function<void()> job;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Queue.empty())
+            return false;
+        job = std::move(m_Queue.front());
+        m_Queue.pop_front();
+    }
+    job();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (--m_Pending == 0)
+            m_Idle.notify_all();
+    }
+    return true;
+}
+
+void JobSystem::WorkerLoop() {
+    while (true) {
+        Batch* batch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Wake.wait(lock, [this] {
+                return m_Quit || !m_Queue.empty() || (m_Batch && m_Batch->Next.load() < m_Batch->Count);
+            });
+            if (m_Batch && m_Batch->Next.load() < m_Batch->Count) {
+                batch = m_Batch;
+                m_BatchUsers++;
+            } else if (m_Quit && m_Queue.empty()) {
+                return;
+            }
+        }
+
+        if (batch) {
+            RunBatch(*batch);
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_BatchUsers--;
+            m_Idle.notify_all();
+        } else {
+            RunOne();
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "HostMemory.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads. The calling thread also runs jobs while it
+// waits, so a pool with zero workers degrades to running everything inline.
+class JobSystem {
+public:
+    explicit JobSystem(unsigned int workerCount = std::thread::hardware_concurrency() - 1);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int GetWorkerCount() const { return static_cast<unsigned int>(m_Workers.size()); }
+
+    void Enqueue(std::function<void()> job);
+    // Blocks until every enqueued job has finished
+    void Wait();
+    // Runs one queued job on the calling thread; false if the queue was empty
+    bool RunOne();
+
+    // Runs job(0) .. job(count - 1) across the pool and returns once all are
+    // done. Does not allocate, so it is safe to call every frame. Workers
+    // charge their allocations to the caller's memory tag.
+    template<typename F>
+    void Dispatch(unsigned int count, F&& job) {
+        DispatchBatch(count, [](void* context, unsigned int index) {
+            (*static_cast<std::remove_reference_t<F>*>(context))(index);
+        }, &job);
+    }
+
+private:
+    struct Batch {
+        void (*Function)(void*, unsigned int);
+        void* Context;
+        unsigned int Count;
+        MemoryTag Tag;
+        std::atomic<unsigned int> Next;
+        std::atomic<unsigned int> Done;
+    };
+
+    void DispatchBatch(unsigned int count, void (*function)(void*, unsigned int), void* context);
+    void RunBatch(Batch& batch);
+    void WorkerLoop();
+
+    std::vector<std::thread> m_Workers;
+    std::deque<std::function<void()>> m_Queue;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Idle;
+    unsigned int m_Pending = 0;
+    bool m_Quit = false;
+
+    // Only one batch runs at a time; m_BatchUsers counts workers still inside it
+    std::mutex m_DispatchMutex;
+    Batch* m_Batch = nullptr;
+    unsigned int m_BatchUsers = 0;
+};
@@ -0,0 +1,509 @@
+#include "Json.h"
+
+#include <charconv>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define JSON_SSE2 1
+#endif
+
+struct JsonBlockMasks {
+    uint64_t Quote;
+    uint64_t Backslash;
+    uint64_t Operator;             // { } [ ] : ,
+    uint64_t Whitespace;
+};
+
+#ifdef JSON_SSE2
+static uint64_t MatchByte(const __m128i chunks[4], char c) {
+    __m128i value = _mm_set1_epi8(c);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; i++)
+        mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], value)))) << (16 * i);
+    return mask;
+}
+
+static JsonBlockMasks Classify(const char* block) {
+    __m128i chunks[4];
+    for (int i = 0; i < 4; i++)
+        chunks[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+
+    JsonBlockMasks masks;
+    masks.Quote = MatchByte(chunks, '"');
+    masks.Backslash = MatchByte(chunks, '\\');
+    masks.Operator = MatchByte(chunks, '{') | MatchByte(chunks, '}') | MatchByte(chunks, '[') |
+                     MatchByte(chunks, ']') | MatchByte(chunks, ':') | MatchByte(chunks, ',');
+    masks.Whitespace = MatchByte(chunks, ' ') | MatchByte(chunks, '\n') | MatchByte(chunks, '\r') | MatchByte(chunks, '\t');
+    return masks;
+}
+#else
+static JsonBlockMasks Classify(const char* block) {
+    JsonBlockMasks masks = {};
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = uint64_t(1) << i;
+        switch (block[i]) {
+            case '"':  masks.Quote |= bit; break;
+            case '\\': masks.Backslash |= bit; break;
+            case '{': case '}': case '[': case ']': case ':': case ',': masks.Operator |= bit; break;
+            case ' ': case '\n': case '\r': case '\t': masks.Whitespace |= bit; break;
+            default: break;
+        }
+    }
+    return masks;
+}
+#endif
+
+// Bit i of the result is the parity of bits 0..i
+static uint64_t PrefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+bool JsonReader::Parse() {
+    m_Tokens.clear();
+    m_Next = 0;
+    m_Error.clear();
+    if (m_Size > UINT32_MAX)
+        return Fail("document larger than 4 GB");
+    // Roughly one token per six bytes of typical data. The index is written
+    // through a raw pointer with room for a whole block of tokens, and grown
+    // when a block could overflow it.
+    m_Tokens.resize(m_Size / 6 + 64);
+    size_t count = 0;
+
+    const uint64_t oddBits = 0xAAAAAAAAAAAAAAAAull;
+    uint64_t nextIsEscaped = 0;    // the previous block ended in an unpaired backslash
+    uint64_t previousInString = 0; // all ones when the previous block ended inside a string
+    uint64_t previousScalar = 0;   // the previous block ended inside a scalar
+
+    char tail[64];
+    for (size_t offset = 0; offset < m_Size; offset += 64) {
+        const char* block = m_Text + offset;
+        if (m_Size - offset < 64) {
+            // Pad the last block with whitespace so it classifies like the rest
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, m_Size - offset);
+            block = tail;
+        }
+        JsonBlockMasks masks = Classify(block);
+
+        // A character is escaped when an odd-length run of backslashes precedes it
+        uint64_t escaped;
+        if (masks.Backslash == 0) {
+            escaped = nextIsEscaped;
+            nextIsEscaped = 0;
+        } else {
+            uint64_t potentialEscape = masks.Backslash & ~nextIsEscaped;
+            uint64_t maybeEscaped = potentialEscape << 1;
+            uint64_t evenSeriesAndOddBits = (maybeEscaped | oddBits) - potentialEscape;
+            uint64_t escapeAndTerminal = evenSeriesAndOddBits ^ oddBits;
+            escaped = escapeAndTerminal ^ (masks.Backslash | nextIsEscaped);
+            nextIsEscaped = (escapeAndTerminal & masks.Backslash) >> 63;
+        }
+
+        uint64_t quotes = masks.Quote & ~escaped;
+        // Set from each opening quote up to (not including) its closing quote
+        uint64_t inString = PrefixXor(quotes) ^ previousInString;
+        previousInString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+
+        uint64_t openingQuotes = quotes & inString;
+        uint64_t operators = masks.Operator & ~inString;
+        uint64_t scalar = ~(masks.Operator | masks.Whitespace | quotes) & ~inString;
+        uint64_t scalarStarts = scalar & ~((scalar << 1) | previousScalar);
+        previousScalar = scalar >> 63;
+
+        // The whitespace padding past the end never starts a token
+        uint64_t tokens = operators | openingQuotes | scalarStarts;
+        if (count + 64 > m_Tokens.size())
+            m_Tokens.resize(m_Tokens.size() * 2);
+        uint32_t* out = m_Tokens.data() + count;
+        uint32_t base = static_cast<uint32_t>(offset);
+        count += static_cast<size_t>(__builtin_popcountll(tokens));
+        while (tokens) {
+            *out++ = base + static_cast<uint32_t>(__builtin_ctzll(tokens));
+            tokens &= tokens - 1;
+        }
+    }
+    m_Tokens.resize(count);
+
+    if (previousInString)
+        return Fail("unterminated string");
+    if (m_Tokens.empty())
+        return Fail("empty document");
+    return true;
+}
+
+bool JsonReader::Fail(const char* message) {
+    if (m_Error.empty()) {
+        size_t offset = m_Next < m_Tokens.size() ? m_Tokens[m_Next] : m_Size;
+        m_Error = std::string(message) + " at byte " + std::to_string(offset);
+    }
+    return false;
+}
+
+char JsonReader::Peek() const {
+    return Failed() || m_Next >= m_Tokens.size() ? '\0' : m_Text[m_Tokens[m_Next]];
+}
+
+bool JsonReader::Expect(char c) {
+    if (Peek() != c) {
+        char message[] = "expected ' '";
+        message[10] = c;
+        return Fail(message);
+    }
+    m_Next++;
+    return true;
+}
+
+// Between members and elements: none before the first, one before each of the rest
+bool JsonReader::ExpectSeparator(char open) {
+    bool first = m_Next > 0 && m_Text[m_Tokens[m_Next - 1]] == open;
+    if (Peek() == ',') {
+        if (first)
+            return Fail("unexpected ','");
+        m_Next++;
+        return true;
+    }
+    return first ? !Failed() : Fail("expected ','");
+}
+
+bool JsonReader::BeginObject() {
+    return Expect('{');
+}
+
+bool JsonReader::NextMember(std::string_view& key) {
+    char c = Peek();
+    if (c == '}') {
+        m_Next++;
+        return false;
+    }
+    if (!ExpectSeparator('{'))
+        return false;
+    static thread_local std::string scratch;
+    return ReadString(key, scratch) && Expect(':');
+}
+
+bool JsonReader::BeginArray() {
+    return Expect('[');
+}
+
+bool JsonReader::NextElement() {
+    char c = Peek();
+    if (c == ']') {
+        m_Next++;
+        return false;
+    }
+    return ExpectSeparator('[');
+}
+
+static void AppendUtf8(std::string& out, uint32_t codepoint) {
+    if (codepoint < 0x80) {
+        out += static_cast<char>(codepoint);
+    } else if (codepoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else if (codepoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codepoint >> 18));
+        out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+}
+
+static bool ParseHex4(const char* p, const char* end, uint32_t& value) {
+    if (end - p < 4)
+        return false;
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+bool JsonReader::ReadString(std::string_view& value, std::string& scratch) {
+    if (Peek() != '"')
+        return Fail("expected a string");
+    const char* begin = m_Text + m_Tokens[m_Next] + 1;
+    const char* end = m_Text + m_Size;
+
+    // Stage 1 guarantees a closing quote; find it, skipping escaped ones
+    const char* p = begin;
+    bool hasEscapes = false;
+    while (true) {
+        const char* quote = static_cast<const char*>(std::memchr(p, '"', end - p));
+        size_t backslashes = 0;
+        for (const char* q = quote; q > begin && q[-1] == '\\'; q--)
+            backslashes++;
+        hasEscapes |= std::memchr(p, '\\', quote - p) != nullptr;
+        p = quote + 1;
+        if (backslashes % 2 == 0)
+            break;
+    }
+    const char* close = p - 1;
+    m_Next++;
+
+    if (!hasEscapes) {
+        value = std::string_view(begin, close - begin);
+        return true;
+    }
+
+    scratch.clear();
+    for (const char* c = begin; c < close; c++) {
+        if (*c != '\\') {
+            scratch += *c;
+            continue;
+        }
+        c++;
+        switch (*c) {
+            case '"': scratch += '"'; break;
+            case '\\': scratch += '\\'; break;
+            case '/': scratch += '/'; break;
+            case 'b': scratch += '\b'; break;
+            case 'f': scratch += '\f'; break;
+            case 'n': scratch += '\n'; break;
+            case 'r': scratch += '\r'; break;
+            case 't': scratch += '\t'; break;
+            case 'u': {
+                uint32_t codepoint;
+                if (!ParseHex4(c + 1, close, codepoint))
+                    return Fail("bad \\u escape");
+                c += 4;
+                // Surrogate pairs encode code points above the BMP
+                uint32_t low;
+                if (codepoint >= 0xD800 && codepoint < 0xDC00 && close - c > 6 && c[1] == '\\' && c[2] == 'u' &&
+                    ParseHex4(c + 3, close, low) && low >= 0xDC00 && low < 0xE000) {
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    c += 6;
+                }
+                AppendUtf8(scratch, codepoint);
+                break;
+            }
+            default:
+                return Fail("bad escape");
+        }
+    }
+    value = scratch;
+    return true;
+}
+
+bool JsonReader::ReadString(std::string& value) {
+    std::string_view view;
+    std::string scratch;
+    if (!ReadString(view, scratch))
+        return false;
+    value.assign(view);
+    return true;
+}
+
+bool JsonReader::ScalarView(std::string_view& scalar) {
+    char c = Peek();
+    if (c == '\0' || c == '"' || c == '{' || c == '[' || c == '}' || c == ']' || c == ':' || c == ',')
+        return Fail("expected a value");
+    const char* begin = m_Text + m_Tokens[m_Next];
+    const char* end = m_Text + m_Size;
+    const char* p = begin;
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ':' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+        p++;
+    scalar = std::string_view(begin, p - begin);
+    m_Next++;
+    return true;
+}
+
+// Exact powers of ten representable as doubles
+static const double s_Pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Clinger's fast path: a mantissa below 2^53 scaled by an exact power of ten
+// rounds correctly in one operation. Covers nearly all hand-written and
+// exported data; anything else goes through from_chars.
+static bool ParseDouble(std::string_view text, double& value) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    bool negative = p < end && *p == '-';
+    if (negative)
+        p++;
+    if (p == end)
+        return false;
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    const char* digitsStart = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        mantissa = mantissa * 10 + (*p++ - '0');
+        digits++;
+    }
+    if (p == digitsStart)
+        return false;
+    if (p < end && *p == '.') {
+        p++;
+        const char* fractionStart = p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            mantissa = mantissa * 10 + (*p++ - '0');
+            digits++;
+        }
+        if (p == fractionStart)
+            return false;
+        exponent -= static_cast<int>(p - fractionStart);
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+'))
+            p++;
+        int explicitExponent = 0;
+        const char* exponentStart = p;
+        while (p < end && *p >= '0' && *p <= '9' && explicitExponent < 100000)
+            explicitExponent = explicitExponent * 10 + (*p++ - '0');
+        if (p == exponentStart)
+            return false;
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+    if (p != end)
+        return false;
+
+    if (digits <= 19 && mantissa < (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        double result = static_cast<double>(mantissa);
+        result = exponent < 0 ? result / s_Pow10[-exponent] : result * s_Pow10[exponent];
+        value = negative ? -result : result;
+        return true;
+    }
+    const char* begin = text.data();
+    auto [last, error] = std::from_chars(begin, end, value);
+    return error == std::errc() && last == end;
+}
+
+bool JsonReader::ReadNumber(double& value) {
+    std::string_view scalar;
+    if (!ScalarView(scalar))
+        return false;
+    if (!ParseDouble(scalar, value)) {
+        m_Next--;
+        return Fail("expected a number");
+    }
+    return true;
+}
+
+bool JsonReader::ReadFloat(float& value) {
+    double number;
+    if (!ReadNumber(number))
+        return false;
+    value = static_cast<float>(number);
+    return true;
+}
+
+bool JsonReader::ReadUInt(uint32_t& value) {
+    std::string_view scalar;
+    if (!ScalarView(scalar))
+        return false;
+    auto [last, error] = std::from_chars(scalar.data(), scalar.data() + scalar.size(), value);
+    if (error != std::errc() || last != scalar.data() + scalar.size()) {
+        m_Next--;
+        return Fail("expected an unsigned integer");
+    }
+    return true;
+}
+
+bool JsonReader::ReadInt(int& value) {
+    std::string_view scalar;
+    if (!ScalarView(scalar))
+        return false;
+    auto [last, error] = std::from_chars(scalar.data(), scalar.data() + scalar.size(), value);
+    if (error != std::errc() || last != scalar.data() + scalar.size()) {
+        m_Next--;
+        return Fail("expected an integer");
+    }
+    return true;
+}
+
+bool JsonReader::ReadBool(bool& value) {
+    std::string_view scalar;
+    if (!ScalarView(scalar))
+        return false;
+    if (scalar == "true" || scalar == "false") {
+        value = scalar == "true";
+        return true;
+    }
+    m_Next--;
+    return Fail("expected true or false");
+}
+
+bool JsonReader::ReadFloats(float* values, size_t count) {
+    if (!BeginArray())
+        return false;
+    size_t read = 0;
+    while (NextElement()) {
+        if (read == count)
+            return Fail("too many elements");
+        if (!ReadFloat(values[read++]))
+            return false;
+    }
+    if (!Failed() && read != count)
+        return Fail("too few elements");
+    return !Failed();
+}
+
+bool JsonReader::ReadFloatArray(std::vector<float>& values) {
+    if (!BeginArray())
+        return false;
+    while (NextElement()) {
+        float value;
+        if (!ReadFloat(value))
+            return false;
+        values.push_back(value);
+    }
+    return !Failed();
+}
+
+bool JsonReader::ReadUIntArray(std::vector<unsigned int>& values) {
+    if (!BeginArray())
+        return false;
+    while (NextElement()) {
+        uint32_t value;
+        if (!ReadUInt(value))
+            return false;
+        values.push_back(value);
+    }
+    return !Failed();
+}
+
+bool JsonReader::Skip() {
+    char c = Peek();
+    if (c == '"') {
+        std::string_view value;
+        std::string scratch;
+        return ReadString(value, scratch);
+    }
+    if (c != '{' && c != '[') {
+        std::string_view scalar;
+        return ScalarView(scalar);
+    }
+    // Containers: only brackets matter, and stage 1 already excluded the ones inside strings
+    int depth = 0;
+    do {
+        if (m_Next >= m_Tokens.size())
+            return Fail("unbalanced brackets");
+        char token = m_Text[m_Tokens[m_Next++]];
+        if (token == '{' || token == '[')
+            depth++;
+        else if (token == '}' || token == ']')
+            depth--;
+    } while (depth > 0);
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Pull-style JSON reader in two passes. Parse() first indexes the document:
+// 64 bytes at a time, SSE2 compares classify quotes, backslashes, structural
+// characters and whitespace into bitmasks, escaped quotes and string interiors
+// are masked out with carry-less bit arithmetic, and the position of every
+// structural character, string and scalar is appended to a token list. The
+// reader then walks the token list, so skipping whitespace and finding the
+// next value never touches the text byte by byte. Nothing is allocated per
+// value; strings without escapes are returned as views into the text.
+//
+//     JsonReader json(text, size);
+//     std::string_view key;
+//     if (json.Parse() && json.BeginObject())
+//         while (json.NextMember(key))
+//             if (key == "count") json.ReadUInt(count); else json.Skip();
+//     if (json.Failed()) std::cout << json.GetError();
+//
+// Every read returns false and records the first error (with its byte
+// offset) on malformed or unexpected input; later reads then fail too.
+class JsonReader {
+public:
+    JsonReader(const char* text, size_t size) : m_Text(text), m_Size(size) {}
+
+    // Builds the token index; false on unterminated strings or an empty document
+    bool Parse();
+
+    // First character of the next token ('{', '[', '"', a digit, ...), '\0' at the end
+    char Peek() const;
+    bool Failed() const { return !m_Error.empty(); }
+    const std::string& GetError() const { return m_Error; }
+    size_t GetTokenCount() const { return m_Tokens.size(); }
+
+    bool BeginObject();
+    // Reads the next member's key and its ':'; false (without an error) at the closing '}'
+    bool NextMember(std::string_view& key);
+    bool BeginArray();
+    // True when another element follows; false (without an error) at the closing ']'
+    bool NextElement();
+
+    // Unescapes into a view of `scratch` when the string has escapes
+    bool ReadString(std::string_view& value, std::string& scratch);
+    bool ReadString(std::string& value);
+    bool ReadNumber(double& value);
+    bool ReadFloat(float& value);
+    bool ReadUInt(uint32_t& value);
+    bool ReadInt(int& value);
+    bool ReadBool(bool& value);
+    // Reads `count` numbers from an array of exactly that length
+    bool ReadFloats(float* values, size_t count);
+    // Appends every number of an array
+    bool ReadFloatArray(std::vector<float>& values);
+    bool ReadUIntArray(std::vector<unsigned int>& values);
+    // Skips one value of any type
+    bool Skip();
+
+    bool Fail(const char* message);
+
+private:
+    bool Expect(char c);
+    bool ExpectSeparator(char open);
+    bool ScalarView(std::string_view& scalar);
+
+    const char* m_Text;
+    size_t m_Size;
+    std::vector<uint32_t> m_Tokens;
+    size_t m_Next = 0;
+    std::string m_Error;
+};
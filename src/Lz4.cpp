@@ -0,0 +1,170 @@
+#include "Lz4.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#define LZ4_MIN_MATCH 4
+// The format requires the last 5 bytes to be literals and the last match to
+// start at least 12 bytes before the end of the block
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MF_LIMIT 12
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_LOG 14
+
+static uint32_t Read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t Hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+static uint8_t* WriteLength(uint8_t* out, size_t length) {
+    for (; length >= 255; length -= 255)
+        *out++ = 255;
+    *out++ = static_cast<uint8_t>(length);
+    return out;
+}
+
+size_t Lz4CompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t Lz4Compress(const void* source, size_t size, void* destination, size_t capacity) {
+    const uint8_t* in = static_cast<const uint8_t*>(source);
+    const uint8_t* end = in + size;
+    const uint8_t* ip = in;
+    const uint8_t* anchor = in;
+    uint8_t* out = static_cast<uint8_t*>(destination);
+    uint8_t* outEnd = out + capacity;
+
+    if (size > LZ4_MF_LIMIT) {
+        const uint8_t* matchLimit = end - LZ4_LAST_LITERALS;
+        const uint8_t* mfLimit = end - LZ4_MF_LIMIT;
+        // Positions are stored +1 so that 0 means empty
+        std::vector<uint32_t> table(1u << LZ4_HASH_LOG, 0);
+
+        while (ip < mfLimit) {
+            uint32_t sequence = Read32(ip);
+            uint32_t& slot = table[Hash(sequence)];
+            const uint8_t* ref = slot ? in + slot - 1 : nullptr;
+            slot = static_cast<uint32_t>(ip - in) + 1;
+            if (!ref || ip - ref > LZ4_MAX_OFFSET || Read32(ref) != sequence) {
+                ip++;
+                continue;
+            }
+
+            while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t* matchEnd = ip + LZ4_MIN_MATCH;
+            const uint8_t* refEnd = ref + LZ4_MIN_MATCH;
+            while (matchEnd < matchLimit && *matchEnd == *refEnd) {
+                matchEnd++;
+                refEnd++;
+            }
+
+            size_t literals = static_cast<size_t>(ip - anchor);
+            size_t matchLength = static_cast<size_t>(matchEnd - ip) - LZ4_MIN_MATCH;
+            if (static_cast<size_t>(outEnd - out) < 1 + literals / 255 + 1 + literals + 2 + matchLength / 255 + 1)
+                return 0;
+
+            uint8_t* token = out++;
+            *token = static_cast<uint8_t>((literals >= 15 ? 15 : literals) << 4);
+            if (literals >= 15)
+                out = WriteLength(out, literals - 15);
+            std::memcpy(out, anchor, literals);
+            out += literals;
+
+            uint16_t offset = static_cast<uint16_t>(ip - ref);
+            *out++ = static_cast<uint8_t>(offset);
+            *out++ = static_cast<uint8_t>(offset >> 8);
+            *token |= static_cast<uint8_t>(matchLength >= 15 ? 15 : matchLength);
+            if (matchLength >= 15)
+                out = WriteLength(out, matchLength - 15);
+
+            ip = anchor = matchEnd;
+            // Seeding the position just before the match end improves the ratio for little cost
+            if (ip - 2 >= in && ip < mfLimit)
+                table[Hash(Read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - in) + 1;
+        }
+    }
+
+    size_t literals = static_cast<size_t>(end - anchor);
+    if (static_cast<size_t>(outEnd - out) < 1 + literals / 255 + 1 + literals)
+        return 0;
+    uint8_t* token = out++;
+    *token = static_cast<uint8_t>((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15)
+        out = WriteLength(out, literals - 15);
+    std::memcpy(out, anchor, literals);
+    out += literals;
+    return static_cast<size_t>(out - static_cast<uint8_t*>(destination));
+}
+
+long long Lz4Decompress(const void* source, size_t size, void* destination, size_t capacity) {
+    const uint8_t* ip = static_cast<const uint8_t*>(source);
+    const uint8_t* end = ip + size;
+    uint8_t* begin = static_cast<uint8_t*>(destination);
+    uint8_t* op = begin;
+    uint8_t* outEnd = op + capacity;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            uint8_t byte;
+            do {
+                if (ip >= end)
+                    return -1;
+                byte = *ip++;
+                literals += byte;
+            } while (byte == 255);
+        }
+        if (literals > static_cast<size_t>(end - ip) || literals > static_cast<size_t>(outEnd - op))
+            return -1;
+        std::memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+        // The last sequence is literals only
+        if (ip == end)
+            break;
+
+        if (end - ip < 2)
+            return -1;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - begin))
+            return -1;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15) {
+            uint8_t byte;
+            do {
+                if (ip >= end)
+                    return -1;
+                byte = *ip++;
+                matchLength += byte;
+            } while (byte == 255);
+        }
+        matchLength += LZ4_MIN_MATCH;
+        if (matchLength > static_cast<size_t>(outEnd - op))
+            return -1;
+
+        const uint8_t* match = op - offset;
+        if (offset >= matchLength) {
+            std::memcpy(op, match, matchLength);
+            op += matchLength;
+        } else {
+            // Overlapping copy repeats the last `offset` bytes
+            for (size_t i = 0; i < matchLength; i++)
+                *op++ = match[i];
+        }
+    }
+    return op - begin;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+// LZ4 block format (no frame header), interchangeable with the reference
+// LZ4_compress_default / LZ4_decompress_safe
+
+// Worst-case compressed size of `size` input bytes
+size_t Lz4CompressBound(size_t size);
+// Returns the compressed size, or 0 if it does not fit in `capacity`
+size_t Lz4Compress(const void* source, size_t size, void* destination, size_t capacity);
+// Returns the decompressed size, or -1 for malformed input or output that
+// would not fit in `capacity`. Never reads or writes out of bounds.
+long long Lz4Decompress(const void* source, size_t size, void* destination, size_t capacity);
@@ -0,0 +1,648 @@
+#include "NullBackend.h"
+#include "Shader.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+NullBackend::~NullBackend() {
+    size_t live = m_Buffers.size() + m_VertexArrays.size() + m_Programs.size()
+                + m_Renderbuffers.size() + m_Textures.size() + m_Framebuffers.size() + m_Queries.size();
+    if (live > 0 || m_OpenFences > 0)
+        std::cout << "[Null Backend] leaked " << live << " object(s) and " << m_OpenFences << " fence(s)" << std::endl;
+}
+
+void NullBackend::Error(const char* call, const std::string& message) {
+    // Only the first few are printed; a broken frame loop would otherwise flood the log
+    if (m_Stats.ValidationErrors < 32)
+        std::cout << "[Null Backend] " << call << ": " << message << std::endl;
+    CountValidationError();
+}
+
+unsigned int NullBackend::CreateBuffer(unsigned int target, const void* data, size_t size, unsigned int usage) {
+    if (target != GL_ARRAY_BUFFER && target != GL_ELEMENT_ARRAY_BUFFER && target != GL_UNIFORM_BUFFER &&
+        target != GL_PIXEL_PACK_BUFFER)
+        Error("CreateBuffer", "unsupported target " + std::to_string(target));
+    if (usage != GL_STATIC_DRAW && usage != GL_DYNAMIC_DRAW && usage != GL_STREAM_DRAW && usage != GL_STREAM_READ)
+        Error("CreateBuffer", "unsupported usage " + std::to_string(usage));
+    if (size > 0 && !data && usage == GL_STATIC_DRAW)
+        Error("CreateBuffer", "static buffer created without data");
+
+    unsigned int id = m_NextId++;
+    m_Buffers[id].Size = size;
+    CountCreate(size);
+    TrackBuffer(target, id, size);
+    BindBuffer(target, id);
+    return id;
+}
+
+void NullBackend::BindBuffer(unsigned int target, unsigned int buffer) {
+    if (buffer != 0 && !m_Buffers.contains(buffer)) {
+        Error("BindBuffer", "unknown buffer " + std::to_string(buffer));
+        return;
+    }
+    if (target == GL_ARRAY_BUFFER) {
+        m_ArrayBuffer = buffer;
+    } else if (target == GL_PIXEL_PACK_BUFFER) {
+        m_PixelPackBuffer = buffer;
+    } else if (target == GL_ELEMENT_ARRAY_BUFFER) {
+        // Like GL, the element buffer binding is part of the VAO state
+        if (m_BoundVao == 0)
+            Error("BindBuffer", "element buffer bound without a vertex array");
+        else
+            m_VertexArrays[m_BoundVao].ElementBuffer = buffer;
+    }
+    CountStateChange();
+}
+
+void* NullBackend::MapBuffer(unsigned int target, unsigned int buffer, size_t offset, size_t size) {
+    auto it = m_Buffers.find(buffer);
+    if (it == m_Buffers.end()) {
+        Error("MapBuffer", "unknown buffer " + std::to_string(buffer));
+        return nullptr;
+    }
+    Buffer& mapped = it->second;
+    if (mapped.Mapped) {
+        Error("MapBuffer", "buffer " + std::to_string(buffer) + " is already mapped");
+        return nullptr;
+    }
+    if (offset + size > mapped.Size) {
+        Error("MapBuffer", "range exceeds buffer size");
+        return nullptr;
+    }
+    mapped.Shadow.resize(mapped.Size);
+    mapped.Mapped = true;
+    BindBuffer(target, buffer);
+    return mapped.Shadow.data() + offset;
+}
+
+void NullBackend::UnmapBuffer(unsigned int target, unsigned int buffer) {
+    auto it = m_Buffers.find(buffer);
+    if (it == m_Buffers.end() || !it->second.Mapped) {
+        Error("UnmapBuffer", "buffer " + std::to_string(buffer) + " is not mapped");
+        return;
+    }
+    it->second.Mapped = false;
+    BindBuffer(target, buffer);
+}
+
+void NullBackend::BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size) {
+    auto it = m_Buffers.find(buffer);
+    if (target != GL_UNIFORM_BUFFER || index >= std::size(m_UniformBindings))
+        Error("BindBufferRange", "unsupported binding point");
+    else if (it == m_Buffers.end())
+        Error("BindBufferRange", "unknown buffer " + std::to_string(buffer));
+    else if (offset % GetUniformBufferAlignment() != 0)
+        Error("BindBufferRange", "offset " + std::to_string(offset) + " is not aligned");
+    else if (size == 0 || offset + size > it->second.Size)
+        Error("BindBufferRange", "range exceeds buffer size");
+    else
+        m_UniformBindings[index] = { buffer, offset, size };
+    CountStateChange();
+}
+
+size_t NullBackend::GetUniformBufferAlignment() {
+    // The largest alignment common drivers report, so offsets valid here are valid everywhere
+    return 256;
+}
+
+unsigned int NullBackend::CreateVertexArray() {
+    unsigned int id = m_NextId++;
+    m_VertexArrays[id] = {};
+    CountCreate();
+    return id;
+}
+
+void NullBackend::BindVertexArray(unsigned int vao) {
+    if (vao != 0 && !m_VertexArrays.contains(vao)) {
+        Error("BindVertexArray", "unknown vertex array " + std::to_string(vao));
+        return;
+    }
+    m_BoundVao = vao;
+    CountStateChange();
+}
+
+void NullBackend::VertexAttribPointer(unsigned int index, int size, unsigned int type, int stride, size_t offset) {
+    if (m_BoundVao == 0) {
+        Error("VertexAttribPointer", "no vertex array bound");
+        return;
+    }
+    if (m_ArrayBuffer == 0) {
+        Error("VertexAttribPointer", "no array buffer bound");
+        return;
+    }
+    if (index >= 16 || size < 1 || size > 4 || type != GL_FLOAT || stride < 0) {
+        Error("VertexAttribPointer", "invalid attribute description");
+        return;
+    }
+
+    VertexArray& vao = m_VertexArrays[m_BoundVao];
+    vao.EnabledAttribs |= 1u << index;
+    if (index == 0) {
+        size_t elementSize = size * sizeof(float);
+        size_t step = stride ? stride : elementSize;
+        size_t bufferSize = m_Buffers[m_ArrayBuffer].Size;
+        vao.VertexCount = bufferSize >= offset + elementSize ? (bufferSize - offset - elementSize) / step + 1 : 0;
+    }
+}
+
+unsigned int NullBackend::CreateProgram(const ShaderProgramSource& source) {
+    if (source.VertexSource.empty() || source.FragmentSource.empty())
+        Error("CreateProgram", "missing vertex or fragment stage");
+
+    // Assign locations to every `uniform <type> <name>;` declaration and note
+    // every `uniform <Block> {`, which is all GetUniformLocation and
+    // BindUniformBlock need to behave like a linked program
+    Program program;
+    for (const std::string* stage : { &source.VertexSource, &source.FragmentSource }) {
+        std::istringstream stream(*stage);
+        std::string token;
+        while (stream >> token) {
+            if (token != "uniform")
+                continue;
+            std::string type, name;
+            stream >> type >> name;
+            if (name == "{") {
+                program.Blocks.emplace(type, -1);
+                continue;
+            }
+            name = name.substr(0, name.find_first_of(";["));
+            if (!program.Uniforms.contains(name)) {
+                int location = static_cast<int>(program.Uniforms.size());
+                program.Uniforms[name] = location;
+                // sampler2D, usampler2D, ...: read texture unit 0 until told otherwise
+                if (type.find("sampler") != std::string::npos)
+                    program.Samplers[location] = { 0, type.find("3D") != std::string::npos };
+            }
+        }
+    }
+
+    unsigned int id = m_NextId++;
+    m_Programs[id] = std::move(program);
+    CountCreate();
+    m_Memory.TrackAllocation(GLObjectType::Program, id, GpuMemoryCategory::ProgramBinary,
+                             source.VertexSource.size() + source.FragmentSource.size());
+    return id;
+}
+
+void NullBackend::UseProgram(unsigned int program) {
+    if (program != 0 && !m_Programs.contains(program)) {
+        Error("UseProgram", "unknown program " + std::to_string(program));
+        return;
+    }
+    m_CurrentProgram = program;
+    CountStateChange();
+}
+
+int NullBackend::GetUniformLocation(unsigned int program, const char* name) {
+    auto it = m_Programs.find(program);
+    if (it == m_Programs.end()) {
+        Error("GetUniformLocation", "unknown program " + std::to_string(program));
+        return -1;
+    }
+    auto uniform = it->second.Uniforms.find(name);
+    return uniform != it->second.Uniforms.end() ? uniform->second : -1;
+}
+
+void NullBackend::BindUniformBlock(unsigned int program, const char* name, unsigned int binding) {
+    auto it = m_Programs.find(program);
+    if (it == m_Programs.end()) {
+        Error("BindUniformBlock", "unknown program " + std::to_string(program));
+        return;
+    }
+    if (binding >= std::size(m_UniformBindings)) {
+        Error("BindUniformBlock", "binding " + std::to_string(binding) + " out of range");
+        return;
+    }
+    auto block = it->second.Blocks.find(name);
+    if (block != it->second.Blocks.end())
+        block->second = static_cast<int>(binding);
+}
+
+void NullBackend::SetUniformMat4(int location, const float* value) {
+    if (m_CurrentProgram == 0)
+        Error("SetUniformMat4", "no program in use");
+    else if (location >= static_cast<int>(m_Programs[m_CurrentProgram].Uniforms.size()))
+        Error("SetUniformMat4", "location " + std::to_string(location) + " out of range");
+    else if (!value)
+        Error("SetUniformMat4", "null value");
+    CountUniform();
+}
+
+void NullBackend::SetUniform4f(int location, float, float, float, float) {
+    if (m_CurrentProgram == 0)
+        Error("SetUniform4f", "no program in use");
+    else if (location >= static_cast<int>(m_Programs[m_CurrentProgram].Uniforms.size()))
+        Error("SetUniform4f", "location " + std::to_string(location) + " out of range");
+    CountUniform();
+}
+
+void NullBackend::SetUniform1i(int location, int value) {
+    if (m_CurrentProgram == 0) {
+        Error("SetUniform1i", "no program in use");
+    } else if (location >= static_cast<int>(m_Programs[m_CurrentProgram].Uniforms.size())) {
+        Error("SetUniform1i", "location " + std::to_string(location) + " out of range");
+    } else {
+        auto sampler = m_Programs[m_CurrentProgram].Samplers.find(location);
+        if (sampler != m_Programs[m_CurrentProgram].Samplers.end()) {
+            if (value < 0 || value >= static_cast<int>(std::size(m_TextureUnits)))
+                Error("SetUniform1i", "texture unit " + std::to_string(value) + " out of range");
+            else
+                sampler->second.Unit = value;
+        }
+    }
+    CountUniform();
+}
+
+unsigned int NullBackend::CreateTexture(unsigned int internalFormat, int width, int height, const void* data) {
+    if (width <= 0 || height <= 0)
+        Error("CreateTexture", "empty size " + std::to_string(width) + "x" + std::to_string(height));
+    if (internalFormat != GL_R32F && internalFormat != GL_RGBA32F && internalFormat != GL_RGBA16F &&
+        internalFormat != GL_R32UI && internalFormat != GL_RGBA32UI && internalFormat != GL_RGBA8 &&
+        internalFormat != GL_DEPTH_COMPONENT32F)
+        Error("CreateTexture", "unsupported format " + std::to_string(internalFormat));
+
+    unsigned int id = m_NextId++;
+    m_Textures[id] = { internalFormat, width, height, 1, false };
+    CountCreate(data ? GetBytesPerPixel(internalFormat) * width * height : 0);
+    TrackTexture(id, internalFormat, width, height);
+    m_TextureUnits[m_ActiveTextureUnit] = id;
+    return id;
+}
+
+void NullBackend::BindTexture(unsigned int unit, unsigned int texture) {
+    if (unit >= std::size(m_TextureUnits)) {
+        Error("BindTexture", "texture unit " + std::to_string(unit) + " out of range");
+        return;
+    }
+    auto it = m_Textures.find(texture);
+    if (texture != 0 && (it == m_Textures.end() || it->second.Volume)) {
+        Error("BindTexture", "unknown 2D texture " + std::to_string(texture));
+        return;
+    }
+    m_ActiveTextureUnit = unit;
+    m_TextureUnits[unit] = texture;
+    CountStateChange();
+}
+
+unsigned int NullBackend::CreateTexture3D(unsigned int internalFormat, int width, int height, int depth, const void* data) {
+    if (width <= 0 || height <= 0 || depth <= 0)
+        Error("CreateTexture3D", "empty size " + std::to_string(width) + "x" + std::to_string(height) + "x" + std::to_string(depth));
+    if (internalFormat != GL_R8 && internalFormat != GL_R16 && internalFormat != GL_RGBA8UI)
+        Error("CreateTexture3D", "unsupported format " + std::to_string(internalFormat));
+
+    unsigned int id = m_NextId++;
+    m_Textures[id] = { internalFormat, width, height, depth, true };
+    size_t texels = static_cast<size_t>(width) * height * depth;
+    CountCreate(data ? GetBytesPerPixel(internalFormat) * texels : 0);
+    TrackTexture(id, internalFormat, width, height, depth);
+    m_TextureUnits3D[m_ActiveTextureUnit] = id;
+    return id;
+}
+
+void NullBackend::UpdateTexture3D(unsigned int texture, int x, int y, int z, int width, int height, int depth, const void* data) {
+    auto it = m_Textures.find(texture);
+    if (it == m_Textures.end() || !it->second.Volume) {
+        Error("UpdateTexture3D", "unknown 3D texture " + std::to_string(texture));
+        return;
+    }
+    const Texture& target = it->second;
+    if (x < 0 || y < 0 || z < 0 || width < 0 || height < 0 || depth < 0 ||
+        x + width > target.Width || y + height > target.Height || z + depth > target.Depth) {
+        Error("UpdateTexture3D", "box exceeds texture " + std::to_string(texture));
+        return;
+    }
+    if (!data)
+        Error("UpdateTexture3D", "null data");
+    m_TextureUnits3D[m_ActiveTextureUnit] = texture;
+    CountUpload(GetBytesPerPixel(target.InternalFormat) * static_cast<size_t>(width) * height * depth);
+}
+
+void NullBackend::BindTexture3D(unsigned int unit, unsigned int texture) {
+    if (unit >= std::size(m_TextureUnits3D)) {
+        Error("BindTexture3D", "texture unit " + std::to_string(unit) + " out of range");
+        return;
+    }
+    auto it = m_Textures.find(texture);
+    if (texture != 0 && (it == m_Textures.end() || !it->second.Volume)) {
+        Error("BindTexture3D", "unknown 3D texture " + std::to_string(texture));
+        return;
+    }
+    m_ActiveTextureUnit = unit;
+    m_TextureUnits3D[unit] = texture;
+    CountStateChange();
+}
+
+unsigned int NullBackend::CreateRenderbuffer(unsigned int internalFormat, int width, int height) {
+    if (width <= 0 || height <= 0)
+        Error("CreateRenderbuffer", "empty size " + std::to_string(width) + "x" + std::to_string(height));
+    unsigned int id = m_NextId++;
+    m_Renderbuffers[id] = internalFormat;
+    CountCreate();
+    TrackRenderbuffer(id, internalFormat, width, height);
+    return id;
+}
+
+unsigned int NullBackend::CreateFramebuffer() {
+    unsigned int id = m_NextId++;
+    m_Framebuffers[id] = {};
+    CountCreate();
+    BindFramebuffer(id);
+    return id;
+}
+
+void NullBackend::FramebufferRenderbuffer(unsigned int attachment, unsigned int renderbuffer) {
+    if (m_BoundFramebuffer == 0) {
+        Error("FramebufferRenderbuffer", "default framebuffer cannot take attachments");
+        return;
+    }
+    auto it = m_Renderbuffers.find(renderbuffer);
+    if (it == m_Renderbuffers.end()) {
+        Error("FramebufferRenderbuffer", "unknown renderbuffer " + std::to_string(renderbuffer));
+        return;
+    }
+    bool depthFormat = it->second == GL_DEPTH_COMPONENT16 || it->second == GL_DEPTH_COMPONENT24 ||
+                       it->second == GL_DEPTH_COMPONENT32F || it->second == GL_DEPTH24_STENCIL8;
+    Framebuffer& framebuffer = m_Framebuffers[m_BoundFramebuffer];
+    if (attachment == GL_COLOR_ATTACHMENT0 && !depthFormat)
+        framebuffer.Color = renderbuffer;
+    else if ((attachment == GL_DEPTH_ATTACHMENT || attachment == GL_DEPTH_STENCIL_ATTACHMENT) && depthFormat)
+        framebuffer.Depth = renderbuffer;
+    else
+        Error("FramebufferRenderbuffer", "format " + std::to_string(it->second) + " does not fit attachment " + std::to_string(attachment));
+}
+
+void NullBackend::FramebufferTexture(unsigned int attachment, unsigned int texture) {
+    if (m_BoundFramebuffer == 0) {
+        Error("FramebufferTexture", "default framebuffer cannot take attachments");
+        return;
+    }
+    auto it = m_Textures.find(texture);
+    if (it == m_Textures.end() || it->second.Volume) {
+        Error("FramebufferTexture", "unknown 2D texture " + std::to_string(texture));
+        return;
+    }
+    bool depthFormat = it->second.InternalFormat == GL_DEPTH_COMPONENT32F;
+    if (attachment == GL_COLOR_ATTACHMENT0 && !depthFormat)
+        m_Framebuffers[m_BoundFramebuffer].Color = texture;
+    else if (attachment == GL_DEPTH_ATTACHMENT && depthFormat)
+        m_Framebuffers[m_BoundFramebuffer].Depth = texture;
+    else
+        Error("FramebufferTexture", "format " + std::to_string(it->second.InternalFormat) + " does not fit attachment " + std::to_string(attachment));
+}
+
+void NullBackend::BindFramebuffer(unsigned int framebuffer) {
+    if (framebuffer != 0 && !m_Framebuffers.contains(framebuffer)) {
+        Error("BindFramebuffer", "unknown framebuffer " + std::to_string(framebuffer));
+        return;
+    }
+    m_BoundFramebuffer = framebuffer;
+    CountStateChange();
+}
+
+void NullBackend::SetViewport(int, int, int width, int height) {
+    if (width < 0 || height < 0)
+        Error("SetViewport", "negative size");
+    CountStateChange();
+}
+
+void NullBackend::Finish() {
+}
+
+void NullBackend::ReadPixels(int, int, int width, int height, void* rgba) {
+    if (width < 0 || height < 0) {
+        Error("ReadPixels", "negative size");
+        return;
+    }
+    // Nothing is rasterized; the framebuffer reads back as cleared
+    size_t size = static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+    if (m_PixelPackBuffer == 0) {
+        std::memset(rgba, 0, size);
+        return;
+    }
+    Buffer& buffer = m_Buffers[m_PixelPackBuffer];
+    size_t offset = reinterpret_cast<size_t>(rgba);
+    if (buffer.Mapped)
+        Error("ReadPixels", "pack buffer " + std::to_string(m_PixelPackBuffer) + " is mapped");
+    else if (offset + size > buffer.Size)
+        Error("ReadPixels", "range exceeds pack buffer size");
+    else {
+        buffer.Shadow.resize(buffer.Size);
+        std::memset(buffer.Shadow.data() + offset, 0, size);
+    }
+}
+
+void NullBackend::Clear() {
+}
+
+bool NullBackend::ValidateDraw(const char* call, unsigned int mode) {
+    if (mode != GL_TRIANGLES && mode != GL_LINES && mode != GL_POINTS && mode != GL_TRIANGLE_STRIP) {
+        Error(call, "unsupported primitive mode " + std::to_string(mode));
+        return false;
+    }
+    if (m_CurrentProgram == 0) {
+        Error(call, "no program in use");
+        return false;
+    }
+    if (m_BoundVao == 0) {
+        Error(call, "no vertex array bound");
+        return false;
+    }
+    if ((m_VertexArrays[m_BoundVao].EnabledAttribs & 1u) == 0) {
+        Error(call, "attribute 0 is not enabled");
+        return false;
+    }
+    if (m_BoundFramebuffer != 0 && m_Framebuffers[m_BoundFramebuffer].Color == 0) {
+        Error(call, "framebuffer " + std::to_string(m_BoundFramebuffer) + " has no color attachment");
+        return false;
+    }
+    for (const auto& [location, sampler] : m_Programs[m_CurrentProgram].Samplers) {
+        unsigned int texture = sampler.Volume ? m_TextureUnits3D[sampler.Unit] : m_TextureUnits[sampler.Unit];
+        if (texture == 0) {
+            Error(call, "sampler reads texture unit " + std::to_string(sampler.Unit) + " with no " +
+                        (sampler.Volume ? "3D" : "2D") + " texture bound");
+            return false;
+        }
+        // Reading the texture being rendered into is undefined in GL
+        const Framebuffer* target = m_BoundFramebuffer != 0 ? &m_Framebuffers[m_BoundFramebuffer] : nullptr;
+        if (target && (target->Color == texture || target->Depth == texture)) {
+            Error(call, "texture " + std::to_string(texture) + " is sampled while attached to the framebuffer");
+            return false;
+        }
+    }
+    for (const auto& [name, binding] : m_Programs[m_CurrentProgram].Blocks) {
+        if (binding < 0) {
+            Error(call, "uniform block " + name + " has no binding");
+            return false;
+        }
+        auto buffer = m_Buffers.find(m_UniformBindings[binding].Buffer);
+        if (buffer == m_Buffers.end()) {
+            Error(call, "uniform block " + name + " has no buffer bound");
+            return false;
+        }
+        if (buffer->second.Mapped) {
+            Error(call, "uniform block " + name + " reads a mapped buffer");
+            return false;
+        }
+    }
+    return true;
+}
+
+void NullBackend::DrawElements(unsigned int mode, int count, size_t offset) {
+    if (ValidateDraw("DrawElements", mode)) {
+        const VertexArray& vao = m_VertexArrays[m_BoundVao];
+        if (vao.ElementBuffer == 0)
+            Error("DrawElements", "no element buffer bound to vertex array");
+        else if (offset + count * sizeof(unsigned int) > m_Buffers[vao.ElementBuffer].Size)
+            Error("DrawElements", "index range exceeds element buffer");
+    }
+    CountDraw(mode, count);
+}
+
+void NullBackend::DrawArrays(unsigned int mode, int first, int count) {
+    if (ValidateDraw("DrawArrays", mode)) {
+        if (first < 0 || count < 0 || static_cast<size_t>(first + count) > m_VertexArrays[m_BoundVao].VertexCount)
+            Error("DrawArrays", "vertex range exceeds array buffer");
+    }
+    CountDraw(mode, count);
+}
+
+unsigned int NullBackend::CreateQuery() {
+    unsigned int id = m_NextId++;
+    m_Queries[id] = false;
+    CountCreate();
+    return id;
+}
+
+void NullBackend::BeginQuery(unsigned int target, unsigned int query) {
+    auto it = m_Queries.find(query);
+    if (it == m_Queries.end()) {
+        Error("BeginQuery", "unknown query " + std::to_string(query));
+        return;
+    }
+    if (m_ActiveQuery != 0) {
+        Error("BeginQuery", "query " + std::to_string(m_ActiveQuery) + " is still active");
+        return;
+    }
+    it->second = false;
+    m_ActiveQuery = query;
+    m_ActiveQueryTarget = target;
+}
+
+void NullBackend::EndQuery(unsigned int target) {
+    if (m_ActiveQuery == 0 || m_ActiveQueryTarget != target) {
+        Error("EndQuery", "no active query for target " + std::to_string(target));
+        return;
+    }
+    // Nothing executes, so results are available (and zero) immediately
+    m_Queries[m_ActiveQuery] = true;
+    m_ActiveQuery = 0;
+}
+
+bool NullBackend::GetQueryResult(unsigned int query, unsigned long long& result) {
+    auto it = m_Queries.find(query);
+    if (it == m_Queries.end()) {
+        Error("GetQueryResult", "unknown query " + std::to_string(query));
+        return false;
+    }
+    if (query == m_ActiveQuery) {
+        Error("GetQueryResult", "query " + std::to_string(query) + " is still active");
+        return false;
+    }
+    result = 0;
+    return it->second;
+}
+
+void NullBackend::DeleteObject(GLObjectType type, unsigned int id) {
+    bool known = true;
+    switch (type) {
+        case GLObjectType::Buffer:
+            known = m_Buffers.erase(id) != 0;
+            if (m_ArrayBuffer == id)
+                m_ArrayBuffer = 0;
+            if (m_PixelPackBuffer == id)
+                m_PixelPackBuffer = 0;
+            for (auto& [vaoId, vao] : m_VertexArrays) {
+                if (vao.ElementBuffer == id)
+                    vao.ElementBuffer = 0;
+            }
+            break;
+        case GLObjectType::VertexArray:
+            known = m_VertexArrays.erase(id) != 0;
+            if (m_BoundVao == id)
+                m_BoundVao = 0;
+            break;
+        case GLObjectType::Program:
+            known = m_Programs.erase(id) != 0;
+            if (m_CurrentProgram == id)
+                m_CurrentProgram = 0;
+            break;
+        case GLObjectType::Renderbuffer:
+            known = m_Renderbuffers.erase(id) != 0;
+            for (auto& [framebufferId, framebuffer] : m_Framebuffers) {
+                if (framebuffer.Color == id)
+                    framebuffer.Color = 0;
+                if (framebuffer.Depth == id)
+                    framebuffer.Depth = 0;
+            }
+            break;
+        case GLObjectType::Texture:
+            known = m_Textures.erase(id) != 0;
+            for (unsigned int& unit : m_TextureUnits) {
+                if (unit == id)
+                    unit = 0;
+            }
+            for (unsigned int& unit : m_TextureUnits3D) {
+                if (unit == id)
+                    unit = 0;
+            }
+            for (auto& [framebufferId, framebuffer] : m_Framebuffers) {
+                if (framebuffer.Color == id)
+                    framebuffer.Color = 0;
+                if (framebuffer.Depth == id)
+                    framebuffer.Depth = 0;
+            }
+            break;
+        case GLObjectType::Framebuffer:
+            known = m_Framebuffers.erase(id) != 0;
+            if (m_BoundFramebuffer == id)
+                m_BoundFramebuffer = 0;
+            break;
+        case GLObjectType::Query:
+            known = m_Queries.erase(id) != 0;
+            if (m_ActiveQuery == id)
+                m_ActiveQuery = 0;
+            break;
+        default:
+            // Object kinds the null backend never creates
+            known = false;
+            break;
+    }
+    if (!known) {
+        Error("DeleteObject", "unknown object " + std::to_string(id));
+        return;
+    }
+    CountDelete(type, id);
+}
+
+void* NullBackend::InsertFence() {
+    m_OpenFences++;
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(m_NextFence++));
+}
+
+bool NullBackend::WaitFence(void* fence, unsigned long long) {
+    // There is no GPU, so work is complete as soon as it is submitted
+    if (!fence)
+        Error("WaitFence", "null fence");
+    return true;
+}
+
+void NullBackend::DeleteFence(void* fence) {
+    if (!fence || m_OpenFences == 0)
+        Error("DeleteFence", "fence was never inserted");
+    else
+        m_OpenFences--;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "RenderBackend.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Accepts every call without touching a driver. Object lifetimes, bindings,
+// attribute setup, index ranges and uniform locations are checked the way GL
+// would, and every violation is logged and counted, so the null backend is a
+// faithful stand-in for profiling the CPU side of the frame.
+class NullBackend : public RenderBackend {
+public:
+    ~NullBackend() override;
+
+    const char* GetName() const override { return "Null"; }
+
+    unsigned int CreateBuffer(unsigned int target, const void* data, size_t size, unsigned int usage) override;
+    void BindBuffer(unsigned int target, unsigned int buffer) override;
+    void* MapBuffer(unsigned int target, unsigned int buffer, size_t offset, size_t size) override;
+    void UnmapBuffer(unsigned int target, unsigned int buffer) override;
+    void BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size) override;
+    size_t GetUniformBufferAlignment() override;
+
+    unsigned int CreateVertexArray() override;
+    void BindVertexArray(unsigned int vao) override;
+    void VertexAttribPointer(unsigned int index, int size, unsigned int type, int stride, size_t offset) override;
+
+    unsigned int CreateProgram(const ShaderProgramSource& source) override;
+    void UseProgram(unsigned int program) override;
+    int GetUniformLocation(unsigned int program, const char* name) override;
+    void BindUniformBlock(unsigned int program, const char* name, unsigned int binding) override;
+    void SetUniformMat4(int location, const float* value) override;
+    void SetUniform4f(int location, float x, float y, float z, float w) override;
+    void SetUniform1i(int location, int value) override;
+
+    unsigned int CreateTexture(unsigned int internalFormat, int width, int height, const void* data) override;
+    void BindTexture(unsigned int unit, unsigned int texture) override;
+    unsigned int CreateTexture3D(unsigned int internalFormat, int width, int height, int depth, const void* data) override;
+    void UpdateTexture3D(unsigned int texture, int x, int y, int z, int width, int height, int depth, const void* data) override;
+    void BindTexture3D(unsigned int unit, unsigned int texture) override;
+
+    unsigned int CreateRenderbuffer(unsigned int internalFormat, int width, int height) override;
+    unsigned int CreateFramebuffer() override;
+    void FramebufferRenderbuffer(unsigned int attachment, unsigned int renderbuffer) override;
+    void FramebufferTexture(unsigned int attachment, unsigned int texture) override;
+    void BindFramebuffer(unsigned int framebuffer) override;
+    void SetViewport(int x, int y, int width, int height) override;
+    void Finish() override;
+    void ReadPixels(int x, int y, int width, int height, void* rgba) override;
+
+    void Clear() override;
+    void DrawElements(unsigned int mode, int count, size_t offset) override;
+    void DrawArrays(unsigned int mode, int first, int count) override;
+
+    unsigned int CreateQuery() override;
+    void BeginQuery(unsigned int target, unsigned int query) override;
+    void EndQuery(unsigned int target) override;
+    bool GetQueryResult(unsigned int query, unsigned long long& result) override;
+
+    void DeleteObject(GLObjectType type, unsigned int id) override;
+
+    void* InsertFence() override;
+    bool WaitFence(void* fence, unsigned long long timeoutNs) override;
+    void DeleteFence(void* fence) override;
+
+private:
+    struct Buffer {
+        size_t Size = 0;
+        bool Mapped = false;
+        std::vector<unsigned char> Shadow;  // backing store handed out by MapBuffer
+    };
+    struct VertexArray {
+        unsigned int ElementBuffer = 0;
+        unsigned int EnabledAttribs = 0;
+        // Vertices addressable through attribute 0, used to range-check draws
+        size_t VertexCount = 0;
+    };
+    struct Sampler {
+        int Unit = 0;
+        bool Volume = false;       // sampler3D: reads the unit's 3D binding
+    };
+    struct Program {
+        std::unordered_map<std::string, int> Uniforms;
+        std::unordered_map<std::string, int> Blocks;    // block name -> binding, -1 until bound
+        std::unordered_map<int, Sampler> Samplers;      // by location
+    };
+    struct Texture {
+        unsigned int InternalFormat = 0;
+        int Width = 0, Height = 0, Depth = 1;
+        bool Volume = false;
+    };
+    struct Framebuffer {
+        unsigned int Color = 0;    // renderbuffer or texture
+        unsigned int Depth = 0;    // renderbuffer or texture
+    };
+    struct BufferRange {
+        unsigned int Buffer = 0;
+        size_t Offset = 0;
+        size_t Size = 0;
+    };
+
+    void Error(const char* call, const std::string& message);
+    bool ValidateDraw(const char* call, unsigned int mode);
+
+    unsigned int m_NextId = 1;
+    std::unordered_map<unsigned int, Buffer> m_Buffers;
+    std::unordered_map<unsigned int, VertexArray> m_VertexArrays;
+    std::unordered_map<unsigned int, Program> m_Programs;
+    std::unordered_map<unsigned int, unsigned int> m_Renderbuffers;   // id -> internal format
+    std::unordered_map<unsigned int, Texture> m_Textures;
+    std::unordered_map<unsigned int, Framebuffer> m_Framebuffers;
+    std::unordered_map<unsigned int, bool> m_Queries;                 // id -> has a result
+
+    unsigned int m_ArrayBuffer = 0;
+    unsigned int m_PixelPackBuffer = 0;
+    unsigned int m_BoundVao = 0;
+    unsigned int m_CurrentProgram = 0;
+    unsigned int m_BoundFramebuffer = 0;
+    unsigned int m_ActiveQuery = 0;
+    unsigned int m_ActiveQueryTarget = 0;
+    BufferRange m_UniformBindings[16];
+    unsigned int m_TextureUnits[16] = {};      // 2D bindings
+    unsigned int m_TextureUnits3D[16] = {};
+    unsigned int m_ActiveTextureUnit = 0;
+
+    unsigned long long m_NextFence = 1;
+    unsigned long long m_OpenFences = 0;
+};
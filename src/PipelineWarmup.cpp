@@ -0,0 +1,146 @@
+#include "PipelineWarmup.h"
+#include "RenderBackend.h"
+#include "Scene.h"
+#include "ShaderLayouts.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+
+struct PipelineKey {
+    unsigned int Program;
+    unsigned int Vao;
+    unsigned int Mode;
+    bool Indexed;
+    int First;                     // where the first mesh using the key starts
+    const PipelineWarmupDraw* Extra;   // textures to bind, for extra draws
+
+    auto Tie() const { return std::tie(Program, Vao, Mode, Indexed); }
+};
+
+static int GetMinimumCount(unsigned int mode) {
+    if (mode == GL_LINES)
+        return 2;
+    if (mode == GL_POINTS)
+        return 1;
+    return 3;
+}
+
+PipelineWarmupStats WarmUpPipelines(RenderBackend& backend, const Scene& scene, int viewportWidth, int viewportHeight,
+                                    const std::vector<PipelineWarmupDraw>& extraDraws) {
+    std::vector<PipelineKey> keys;
+    for (const SceneObject& object : scene.Objects) {
+        const Mesh& mesh = scene.Meshes[object.MeshIndex];
+        const Material& material = scene.Materials[object.MaterialIndex];
+        if (object.Batched || material.Program == 0 || mesh.Count < GetMinimumCount(mesh.Mode))
+            continue;
+        keys.push_back({ material.Program, mesh.Vao, mesh.Mode, mesh.Ibo != 0, mesh.First, nullptr });
+    }
+    for (const StaticBatch& batch : scene.Batches) {
+        const Material& material = scene.Materials[batch.MaterialIndex];
+        if (material.Program != 0 && batch.Count >= GetMinimumCount(batch.Mode))
+            keys.push_back({ material.Program, batch.Vao, batch.Mode, true, 0, nullptr });
+    }
+    for (const PipelineWarmupDraw& draw : extraDraws) {
+        if (draw.Program != 0)
+            keys.push_back({ draw.Program, draw.Vao, draw.Mode, draw.Indexed, 0, &draw });
+    }
+    std::sort(keys.begin(), keys.end(), [](const PipelineKey& a, const PipelineKey& b) { return a.Tie() < b.Tie(); });
+    keys.erase(std::unique(keys.begin(), keys.end(), [](const PipelineKey& a, const PipelineKey& b) { return a.Tie() == b.Tie(); }),
+               keys.end());
+
+    PipelineWarmupStats stats;
+    stats.Combinations = keys.size();
+    if (keys.empty())
+        return stats;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Depth is attached so the draws run with the same depth state as the frame
+    RenderbufferHandle color(backend, backend.CreateRenderbuffer(GL_RGBA8, 1, 1));
+    RenderbufferHandle depth(backend, backend.CreateRenderbuffer(GL_DEPTH_COMPONENT24, 1, 1));
+    FramebufferHandle target(backend, backend.CreateFramebuffer());
+    backend.FramebufferRenderbuffer(GL_COLOR_ATTACHMENT0, color.Get());
+    backend.FramebufferRenderbuffer(GL_DEPTH_ATTACHMENT, depth.Get());
+    backend.SetViewport(0, 0, 1, 1);
+
+    // Zeroed blocks collapse every vertex, so the draws cost the driver work but rasterize nothing
+    size_t blockBytes = 0;
+    for (const ShaderBlockInfo& block : g_ShaderBlocks) {
+        if (block.Name && !block.Storage)
+            blockBytes = std::max(blockBytes, block.Size);
+    }
+    std::vector<unsigned char> zeros(std::max<size_t>(blockBytes, 16));
+    BufferHandle blocks(backend, backend.CreateBuffer(GL_UNIFORM_BUFFER, zeros.data(), zeros.size(), GL_STATIC_DRAW));
+    for (const ShaderBlockInfo& block : g_ShaderBlocks) {
+        if (block.Name && !block.Storage)
+            backend.BindBufferRange(GL_UNIFORM_BUFFER, block.Binding, blocks.Get(), 0, block.Size);
+    }
+
+    for (const PipelineKey& key : keys) {
+        auto drawStart = std::chrono::steady_clock::now();
+        backend.UseProgram(key.Program);
+        backend.BindVertexArray(key.Vao);
+        if (key.Extra) {
+            for (size_t unit = 0; unit < key.Extra->Textures.size(); unit++)
+                backend.BindTexture(static_cast<unsigned int>(unit), key.Extra->Textures[unit]);
+        }
+        if (key.Indexed)
+            backend.DrawElements(key.Mode, GetMinimumCount(key.Mode), key.First * sizeof(unsigned int));
+        else
+            backend.DrawArrays(key.Mode, key.First, GetMinimumCount(key.Mode));
+        // Waiting per draw keeps the cost attributable and guarantees the
+        // driver has actually built the pipeline before the next one
+        backend.Finish();
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - drawStart).count();
+        if (ms > stats.SlowestMilliseconds) {
+            stats.SlowestMilliseconds = ms;
+            stats.SlowestProgram = key.Program;
+        }
+    }
+
+    backend.BindFramebuffer(0);
+    backend.SetViewport(0, 0, viewportWidth, viewportHeight);
+    stats.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+void HitchMonitor::Start() {
+    m_Started = true;
+    m_Last = std::chrono::steady_clock::now();
+}
+
+void HitchMonitor::FrameFinished() {
+    if (m_Reported)
+        return;
+    auto now = std::chrono::steady_clock::now();
+    if (m_Started)
+        m_FrameMs.push_back(std::chrono::duration<double, std::milli>(now - m_Last).count());
+    m_Started = true;
+    m_Last = now;
+
+    if (static_cast<int>(m_FrameMs.size()) >= m_Frames)
+        Report();
+}
+
+void HitchMonitor::Report() {
+    m_Reported = true;
+    if (m_FrameMs.empty())
+        return;
+
+    std::vector<double> sorted = m_FrameMs;
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    double median = sorted[sorted.size() / 2];
+
+    int hitches = 0;
+    for (size_t i = 0; i < m_FrameMs.size(); i++) {
+        if (m_FrameMs[i] <= median * PIPELINE_HITCH_FACTOR)
+            continue;
+        if (hitches++ < 8)
+            std::cout << "[Hitch] frame " << i + 1 << ": " << m_FrameMs[i] << " ms (median " << median << " ms)" << std::endl;
+    }
+    std::cout << "[Hitch] " << hitches << " hitch(es) in the first " << m_FrameMs.size() << " frames" << std::endl;
+}
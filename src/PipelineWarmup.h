@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+class RenderBackend;
+struct Scene;
+
+// Frames after warm-up that HitchMonitor watches
+#define PIPELINE_HITCH_FRAMES 120
+// A watched frame is a hitch when it takes this many times the median frame
+#define PIPELINE_HITCH_FACTOR 2.0
+
+struct PipelineWarmupStats {
+    size_t Combinations = 0;
+    double Milliseconds = 0.0;
+    double SlowestMilliseconds = 0.0;
+    unsigned int SlowestProgram = 0;
+};
+
+// A draw that no scene object or batch makes, such as a renderer's own
+// program over its own vertex array
+struct PipelineWarmupDraw {
+    unsigned int Program = 0;
+    unsigned int Vao = 0;
+    unsigned int Mode = 0;
+    bool Indexed = false;
+    std::vector<unsigned int> Textures;    // 2D textures for units 0, 1, ... that the program samples
+};
+
+// Drivers finish compiling a program lazily, for the vertex format and state
+// of its first draw. This issues one tiny draw into a 1x1 offscreen target for
+// every program x vertex array x primitive mode x indexed combination the
+// scene uses, plus extraDraws, and waits for each, so that work happens here
+// rather than in the first frames. Call after CompileMaterials; the default
+// framebuffer and the given viewport are restored afterwards.
+PipelineWarmupStats WarmUpPipelines(RenderBackend& backend, const Scene& scene, int viewportWidth, int viewportHeight,
+                                    const std::vector<PipelineWarmupDraw>& extraDraws = {});
+
+// Times the first frames after warm-up and reports any that still spike
+// well above the median
+class HitchMonitor {
+public:
+    explicit HitchMonitor(int frames = PIPELINE_HITCH_FRAMES) : m_Frames(frames) { m_FrameMs.reserve(frames); }
+
+    // Call right before the first frame, so that frame is timed too
+    void Start();
+    // Call once per frame at the same point of the loop; prints the report
+    // once the watched frames are in
+    void FrameFinished();
+    bool IsDone() const { return m_Reported; }
+
+private:
+    void Report();
+
+    int m_Frames;
+    std::vector<double> m_FrameMs;
+    std::chrono::steady_clock::time_point m_Last;
+    bool m_Started = false;
+    bool m_Reported = false;
+};
@@ -0,0 +1,65 @@
+#include "Pvs.h"
+#include "Scene.h"
+#include "SceneBinding.h"
+#include "SceneFile.h"
+
+#include <bit>
+#include <cstdint>
+
+// Nodes come after their parent (the batcher numbers them depth first), so
+// one backwards pass sees both children before the node
+static size_t BuildNodeVisibility(Scene& scene) {
+    SceneVisibility& visibility = scene.Visibility;
+    visibility.Nodes.assign(scene.BatchNodes.size(), 0);
+    size_t hidden = 0;
+    for (size_t i = scene.BatchNodes.size(); i-- > 0;) {
+        const BatchNode& node = scene.BatchNodes[i];
+        bool visible = false;
+        if (node.Children[0] >= 0 || node.Children[1] >= 0) {
+            for (int child : node.Children)
+                visible = visible || (child >= 0 && visibility.Nodes[child]);
+        } else {
+            for (unsigned int j = node.FirstObject; j < node.FirstObject + node.ObjectCount && !visible; j++)
+                visible = IsObjectPotentiallyVisible(visibility, scene.BatchObjects[j]);
+        }
+        visibility.Nodes[i] = visible ? 1 : 0;
+        hidden += visible ? 0 : 1;
+    }
+    return hidden;
+}
+
+void UpdateVisibility(Scene& scene, const SceneDesc& desc, const SceneBinding& binding, const glm::vec3& eye,
+                      PvsStats& stats) {
+    stats.Cells = desc.Cells.size();
+    int cell = desc.HasPvs() && binding.ObjectCount == desc.Objects.size() ? desc.FindCell(eye) : -1;
+    if (cell < 0) {
+        ClearVisibility(scene, stats);
+        return;
+    }
+    SceneVisibility& visibility = scene.Visibility;
+    const uint64_t* objects = desc.GetCellPvs(cell);
+    // A reload replaces the desc and a rebuild the trees, so more than the cell can change
+    if (cell == visibility.Cell && objects == visibility.Objects && visibility.FirstObject == binding.FirstObject &&
+        visibility.ObjectCount == binding.ObjectCount && visibility.Nodes.size() == scene.BatchNodes.size())
+        return;
+
+    if (cell != visibility.Cell)
+        stats.Changes++;
+    visibility.Objects = objects;
+    visibility.FirstObject = binding.FirstObject;
+    visibility.ObjectCount = binding.ObjectCount;
+    visibility.Cell = cell;
+    stats.Cell = cell;
+    size_t visible = 0;
+    for (size_t i = 0; i < desc.GetPvsWords(); i++)
+        visible += static_cast<size_t>(std::popcount(objects[i]));
+    stats.HiddenObjects = desc.Objects.size() - visible;
+    stats.HiddenNodes = BuildNodeVisibility(scene);
+}
+
+void ClearVisibility(Scene& scene, PvsStats& stats) {
+    scene.Visibility = SceneVisibility();
+    stats.Cell = -1;
+    stats.HiddenObjects = 0;
+    stats.HiddenNodes = 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+struct Scene;
+struct SceneDesc;
+struct SceneBinding;
+
+struct PvsStats {
+    int Cell = -1;                 // the camera's; -1 when nothing is gated
+    size_t Cells = 0;              // in the scene file
+    size_t HiddenObjects = 0;      // of the scene file's, by the cell's set
+    size_t HiddenNodes = 0;        // batch cluster nodes with no object in the set
+    size_t Changes = 0;            // cells entered so far
+};
+
+// Cell and portal visibility for indoor scenes. The scene file splits the
+// walkable space into cells (boxes); PvsBake precomputes, for each, the
+// objects that can be seen from anywhere in it and writes the sets to a
+// sidecar of the scene file, which asset packs carry along. At runtime the
+// camera's cell picks its set, which gates objects and static batch clusters
+// with one bit test before any frustum culling, so whole rooms behind walls
+// cost nothing.
+//
+// Points scene.Visibility at the set of the cell containing `eye`, over the
+// scene file's objects as `binding` placed them. Outside every cell, or when
+// the file has no baked sets (never baked, or edited since), nothing is
+// gated. The per-node sets of the batch trees are only remade when the cell
+// or the trees change.
+void UpdateVisibility(Scene& scene, const SceneDesc& desc, const SceneBinding& binding, const glm::vec3& eye,
+                      PvsStats& stats);
+// Stops gating, e.g. when the sets are turned off
+void ClearVisibility(Scene& scene, PvsStats& stats);
@@ -0,0 +1,462 @@
+#include "RayQuery.h"
+#include "JobSystem.h"
+#include "Scene.h"
+#include "SceneBinding.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+// Objects per job when updating the top level
+#define RAY_QUERY_UPDATE_CHUNK 4096
+
+static BvhBounds TransformBounds(const glm::mat4& model, const BvhBounds& bounds) {
+    // Center moves with the matrix; the half extent grows by |M| per axis
+    glm::vec3 center = glm::vec3(model * glm::vec4(bounds.Center(), 1.0f));
+    glm::vec3 half = (bounds.Max - bounds.Min) * 0.5f;
+    glm::vec3 extent(0.0f);
+    for (int column = 0; column < 3; column++)
+        extent += glm::abs(glm::vec3(model[column])) * half[column];
+    BvhBounds result;
+    result.Min = center - extent;
+    result.Max = center + extent;
+    return result;
+}
+
+static BvhRay ToObjectSpace(const glm::mat4& worldToObject, const RayDesc& ray) {
+    return BvhRay(glm::vec3(worldToObject * glm::vec4(ray.Origin, 1.0f)),
+                  glm::vec3(worldToObject * glm::vec4(ray.Direction, 0.0f)));
+}
+
+static bool SameSigns(const RayDesc* rays) {
+    for (int i = 1; i < 4; i++) {
+        if (std::signbit(rays[i].Direction.x) != std::signbit(rays[0].Direction.x) ||
+            std::signbit(rays[i].Direction.y) != std::signbit(rays[0].Direction.y) ||
+            std::signbit(rays[i].Direction.z) != std::signbit(rays[0].Direction.z))
+            return false;
+    }
+    return true;
+}
+
+// Splits `count` rays into batches for the job system; batches stay a
+// multiple of four so packets never straddle two of them
+template <typename F>
+static void ForEachBatch(size_t count, JobSystem* jobs, F&& batch) {
+    if (jobs == nullptr || count <= RAY_QUERY_BATCH) {
+        batch(0, count);
+        return;
+    }
+    unsigned int batches = static_cast<unsigned int>((count + RAY_QUERY_BATCH - 1) / RAY_QUERY_BATCH);
+    jobs->Dispatch(batches, [&](unsigned int index) {
+        size_t first = static_cast<size_t>(index) * RAY_QUERY_BATCH;
+        batch(first, std::min<size_t>(RAY_QUERY_BATCH, count - first));
+    });
+}
+
+void RayQuery::BuildMeshes(const SceneDesc& desc, const SceneBinding& binding) {
+    Clear();
+    for (size_t i = 0; i < desc.Meshes.size(); i++) {
+        const SceneMeshDesc& mesh = desc.Meshes[i];
+        const SceneMeshDesc& source = mesh.Parent >= 0 ? desc.Meshes[mesh.Parent] : mesh;
+        if (mesh.Mode != GL_TRIANGLES || i >= binding.Meshes.size())
+            continue;
+
+        MeshLevel level;
+        size_t vertexCount = source.Positions.size() / 3;
+        bool indexed = !source.Indices.empty();
+        size_t first = mesh.Parent >= 0 ? mesh.First : 0;
+        size_t count = mesh.Parent >= 0 ? mesh.Count : (indexed ? source.Indices.size() : vertexCount);
+        std::vector<BvhBounds> bounds;
+        for (size_t t = 0; t + 2 < count; t += 3) {
+            glm::vec3 corners[3];
+            bool valid = true;
+            for (int c = 0; c < 3; c++) {
+                size_t index = indexed ? source.Indices[first + t + c] : first + t + c;
+                valid &= index < vertexCount;
+                if (valid)
+                    corners[c] = glm::vec3(source.Positions[index * 3], source.Positions[index * 3 + 1], source.Positions[index * 3 + 2]);
+            }
+            if (!valid)
+                continue;
+            // Degenerate triangles stay so Triangle ids match the mesh's; they are never hit
+            level.Triangles.push_back({ corners[0], corners[1] - corners[0], corners[2] - corners[0] });
+            BvhBounds box;
+            for (const glm::vec3& corner : corners)
+                box.Grow(corner);
+            bounds.push_back(box);
+            level.Bounds.Grow(box);
+        }
+        if (level.Triangles.empty())
+            continue;
+        level.Bvh.Build(bounds);
+
+        unsigned int sceneMesh = binding.Meshes[i];
+        if (m_SceneMeshes.size() <= sceneMesh)
+            m_SceneMeshes.resize(sceneMesh + 1, RAY_QUERY_MISS);
+        m_SceneMeshes[sceneMesh] = static_cast<uint32_t>(m_Meshes.size());
+        m_Stats.Triangles += level.Triangles.size();
+        m_Stats.MemoryBytes += level.Bvh.GetMemorySize() + level.Triangles.size() * sizeof(Triangle);
+        m_Meshes.push_back(std::move(level));
+    }
+    m_Stats.Meshes = m_Meshes.size();
+}
+
+void RayQuery::BuildMeshes(const SceneDesc& desc) {
+    SceneBinding binding;
+    binding.Meshes.resize(desc.Meshes.size());
+    for (size_t i = 0; i < desc.Meshes.size(); i++)
+        binding.Meshes[i] = static_cast<unsigned int>(i);
+    BuildMeshes(desc, binding);
+}
+
+void RayQuery::Clear() {
+    m_Meshes.clear();
+    m_SceneMeshes.clear();
+    m_Instances.clear();
+    m_InstanceBounds.clear();
+    m_TopObjects.clear();
+    m_TopBounds.clear();
+    m_Top = Bvh4();
+    m_Stats = RayQueryStats();
+}
+
+template <typename Object>
+void RayQuery::UpdateInstances(size_t count, JobSystem* jobs, Object&& object) {
+    bool added = count != m_Instances.size();
+    if (added) {
+        m_Instances.resize(count, { glm::mat4(0.0f), glm::mat4(1.0f), RAY_QUERY_MISS });
+        m_InstanceBounds.resize(count);
+    }
+
+    // Inverse matrices only for objects that moved; they are most of the cost
+    std::atomic<bool> moved = false, remeshed = false;
+    auto update = [&](unsigned int chunk) {
+        size_t first = static_cast<size_t>(chunk) * RAY_QUERY_UPDATE_CHUNK;
+        size_t last = std::min(count, first + RAY_QUERY_UPDATE_CHUNK);
+        bool chunkMoved = false, chunkRemeshed = false;
+        for (size_t i = first; i < last; i++) {
+            const glm::mat4* model;
+            unsigned int sceneMesh;
+            object(i, model, sceneMesh);
+            Instance& instance = m_Instances[i];
+            uint32_t mesh = sceneMesh < m_SceneMeshes.size() ? m_SceneMeshes[sceneMesh] : RAY_QUERY_MISS;
+            if (mesh != instance.Mesh) {
+                instance.Mesh = mesh;
+                chunkRemeshed = true;
+            } else if (*model == instance.Model) {
+                continue;
+            }
+            instance.Model = *model;
+            instance.WorldToObject = glm::inverse(*model);
+            if (mesh != RAY_QUERY_MISS)
+                m_InstanceBounds[i] = TransformBounds(*model, m_Meshes[mesh].Bounds);
+            chunkMoved = true;
+        }
+        if (chunkMoved)
+            moved.store(true, std::memory_order_relaxed);
+        if (chunkRemeshed)
+            remeshed.store(true, std::memory_order_relaxed);
+    };
+    unsigned int chunks = static_cast<unsigned int>((count + RAY_QUERY_UPDATE_CHUNK - 1) / RAY_QUERY_UPDATE_CHUNK);
+    if (jobs != nullptr && chunks > 1) {
+        jobs->Dispatch(chunks, update);
+    } else {
+        for (unsigned int chunk = 0; chunk < chunks; chunk++)
+            update(chunk);
+    }
+
+    if (added || remeshed) {
+        m_TopObjects.clear();
+        for (size_t i = 0; i < count; i++)
+            if (m_Instances[i].Mesh != RAY_QUERY_MISS)
+                m_TopObjects.push_back(static_cast<uint32_t>(i));
+    } else if (!moved) {
+        return;
+    }
+    m_TopBounds.resize(m_TopObjects.size());
+    for (size_t i = 0; i < m_TopObjects.size(); i++)
+        m_TopBounds[i] = m_InstanceBounds[m_TopObjects[i]];
+
+    if (added || remeshed || m_Top.Refit(m_TopBounds) > RAY_QUERY_REBUILD_COST) {
+        m_Top.Build(m_TopBounds);
+        m_Stats.Rebuilds++;
+    } else {
+        m_Stats.Refits++;
+    }
+    m_Stats.Instances = m_TopObjects.size();
+}
+
+void RayQuery::Update(const Scene& scene, JobSystem* jobs) {
+    UpdateInstances(scene.Objects.size(), jobs, [&](size_t i, const glm::mat4*& model, unsigned int& mesh) {
+        model = &scene.Objects[i].Model;
+        mesh = scene.Objects[i].MeshIndex;
+    });
+}
+
+void RayQuery::Update(const SceneDesc& desc, JobSystem* jobs) {
+    UpdateInstances(desc.Objects.size(), jobs, [&](size_t i, const glm::mat4*& model, unsigned int& mesh) {
+        model = &desc.Objects[i].Model;
+        mesh = desc.Objects[i].Mesh;
+    });
+}
+
+// Möller-Trumbore with t in (tMin, tMax)
+static bool IntersectTriangle(const glm::vec3& v0, const glm::vec3& edge1, const glm::vec3& edge2,
+                              const BvhRay& ray, float tMin, float& tMax) {
+    glm::vec3 p = glm::cross(ray.Direction, edge2);
+    float determinant = glm::dot(edge1, p);
+    if (std::fabs(determinant) < 1e-20f)
+        return false;
+    float inverse = 1.0f / determinant;
+    glm::vec3 s = ray.Origin - v0;
+    float u = glm::dot(s, p) * inverse;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(ray.Direction, q) * inverse;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+    float t = glm::dot(edge2, q) * inverse;
+    if (t <= tMin || t >= tMax)
+        return false;
+    tMax = t;
+    return true;
+}
+
+void RayQuery::ClosestRay(const RayDesc& ray, RayHit& hit) const {
+    hit.T = ray.TMax;
+    hit.Object = RAY_QUERY_MISS;
+    hit.Triangle = 0;
+    BvhRay worldRay(ray.Origin, ray.Direction);
+    m_Top.Intersect(worldRay, hit.T, [&](uint32_t primitive, float& tMax) {
+        uint32_t object = m_TopObjects[primitive];
+        const Instance& instance = m_Instances[object];
+        const MeshLevel& mesh = m_Meshes[instance.Mesh];
+        BvhRay local = ToObjectSpace(instance.WorldToObject, ray);
+        return mesh.Bvh.Intersect(local, tMax, [&](uint32_t triangle, float& t) {
+            const Triangle& tri = mesh.Triangles[triangle];
+            if (!IntersectTriangle(tri.V0, tri.Edge1, tri.Edge2, local, ray.TMin, t))
+                return false;
+            hit.Object = object;
+            hit.Triangle = triangle;
+            return true;
+        });
+    });
+}
+
+bool RayQuery::AnyRay(const RayDesc& ray) const {
+    BvhRay worldRay(ray.Origin, ray.Direction);
+    return m_Top.Occluded(worldRay, ray.TMax, [&](uint32_t primitive, float& tMax) {
+        const Instance& instance = m_Instances[m_TopObjects[primitive]];
+        const MeshLevel& mesh = m_Meshes[instance.Mesh];
+        BvhRay local = ToObjectSpace(instance.WorldToObject, ray);
+        return mesh.Bvh.Occluded(local, tMax, [&](uint32_t triangle, float& t) {
+            const Triangle& tri = mesh.Triangles[triangle];
+            return IntersectTriangle(tri.V0, tri.Edge1, tri.Edge2, local, ray.TMin, t);
+        });
+    });
+}
+
+// Packet helpers: the matrix applied to four points (w = 1) or directions (w = 0)
+static void TransformPacket(const glm::mat4& m, const BvhRayPacket& in, BvhRayPacket& out) {
+    __m128 directions[3] = { in.DirectionX, in.DirectionY, in.DirectionZ };
+    __m128 origins[3] = { in.OriginX, in.OriginY, in.OriginZ };
+    __m128 resultOrigin[3], resultDirection[3];
+    for (int row = 0; row < 3; row++) {
+        __m128 column0 = _mm_set1_ps(m[0][row]), column1 = _mm_set1_ps(m[1][row]), column2 = _mm_set1_ps(m[2][row]);
+        resultDirection[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(column0, directions[0]), _mm_mul_ps(column1, directions[1])),
+                                          _mm_mul_ps(column2, directions[2]));
+        resultOrigin[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(column0, origins[0]), _mm_mul_ps(column1, origins[1])),
+                                       _mm_add_ps(_mm_mul_ps(column2, origins[2]), _mm_set1_ps(m[3][row])));
+    }
+    // Same guard as BvhRay against 0 * inf in the slab test
+    const __m128 sign = _mm_set1_ps(-0.0f), tiny = _mm_set1_ps(1e-20f);
+    __m128* inverses[3] = { &out.InvDirectionX, &out.InvDirectionY, &out.InvDirectionZ };
+    for (int axis = 0; axis < 3; axis++) {
+        __m128 d = resultDirection[axis];
+        __m128 small = _mm_cmplt_ps(_mm_andnot_ps(sign, d), tiny);
+        d = _mm_or_ps(_mm_andnot_ps(small, d), _mm_and_ps(small, _mm_or_ps(_mm_and_ps(sign, d), tiny)));
+        *inverses[axis] = _mm_div_ps(_mm_set1_ps(1.0f), d);
+    }
+    out.OriginX = resultOrigin[0]; out.OriginY = resultOrigin[1]; out.OriginZ = resultOrigin[2];
+    out.DirectionX = resultDirection[0]; out.DirectionY = resultDirection[1]; out.DirectionZ = resultDirection[2];
+}
+
+// Möller-Trumbore for four rays against one triangle; returns the lanes of
+// `active` that hit between their tMin and tMax and moves tMax to the hits
+static int IntersectTrianglePacket(const glm::vec3& v0, const glm::vec3& edge1, const glm::vec3& edge2,
+                                   const BvhRayPacket& packet, __m128 tMin, __m128& tMax, int active) {
+    __m128 e1x = _mm_set1_ps(edge1.x), e1y = _mm_set1_ps(edge1.y), e1z = _mm_set1_ps(edge1.z);
+    __m128 e2x = _mm_set1_ps(edge2.x), e2y = _mm_set1_ps(edge2.y), e2z = _mm_set1_ps(edge2.z);
+    // p = d x e2
+    __m128 px = _mm_sub_ps(_mm_mul_ps(packet.DirectionY, e2z), _mm_mul_ps(packet.DirectionZ, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(packet.DirectionZ, e2x), _mm_mul_ps(packet.DirectionX, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(packet.DirectionX, e2y), _mm_mul_ps(packet.DirectionY, e2x));
+    __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+    // s = o - v0
+    __m128 sx = _mm_sub_ps(packet.OriginX, _mm_set1_ps(v0.x));
+    __m128 sy = _mm_sub_ps(packet.OriginY, _mm_set1_ps(v0.y));
+    __m128 sz = _mm_sub_ps(packet.OriginZ, _mm_set1_ps(v0.z));
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverse);
+    // q = s x e1
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(packet.DirectionX, qx), _mm_mul_ps(packet.DirectionY, qy)),
+                                     _mm_mul_ps(packet.DirectionZ, qz)), inverse);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverse);
+
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    __m128 valid = _mm_cmpgt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), determinant), _mm_set1_ps(1e-20f));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+    valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), one));
+    valid = _mm_and_ps(valid, _mm_cmpgt_ps(t, tMin));
+    valid = _mm_and_ps(valid, _mm_cmplt_ps(t, tMax));
+    int mask = _mm_movemask_ps(valid) & active;
+    if (mask != 0)
+        tMax = _mm_or_ps(_mm_and_ps(valid, t), _mm_andnot_ps(valid, tMax));
+    return mask;
+}
+
+static __m128 LoadTMin(const RayDesc* rays) {
+    return _mm_setr_ps(rays[0].TMin, rays[1].TMin, rays[2].TMin, rays[3].TMin);
+}
+
+static __m128 LoadTMax(const RayDesc* rays) {
+    return _mm_setr_ps(rays[0].TMax, rays[1].TMax, rays[2].TMax, rays[3].TMax);
+}
+
+static BvhRayPacket MakePacket(const RayDesc* rays) {
+    BvhRay bvhRays[4] = { BvhRay(rays[0].Origin, rays[0].Direction), BvhRay(rays[1].Origin, rays[1].Direction),
+                          BvhRay(rays[2].Origin, rays[2].Direction), BvhRay(rays[3].Origin, rays[3].Direction) };
+    return BvhRayPacket(bvhRays);
+}
+
+void RayQuery::ClosestPacket(const RayDesc* rays, RayHit* hits) const {
+    BvhRayPacket packet = MakePacket(rays);
+    __m128 tMin = LoadTMin(rays), tMax = LoadTMax(rays);
+    uint32_t objects[4] = { RAY_QUERY_MISS, RAY_QUERY_MISS, RAY_QUERY_MISS, RAY_QUERY_MISS };
+    uint32_t triangles[4] = {};
+    m_Top.IntersectPacket(packet, tMax, 0xF, [&](uint32_t primitive, __m128& t, int active) {
+        uint32_t object = m_TopObjects[primitive];
+        const Instance& instance = m_Instances[object];
+        const MeshLevel& mesh = m_Meshes[instance.Mesh];
+        BvhRayPacket local;
+        TransformPacket(instance.WorldToObject, packet, local);
+        int hit = 0;
+        mesh.Bvh.IntersectPacket(local, t, active, [&](uint32_t triangle, __m128& tLocal, int lanes) {
+            const Triangle& tri = mesh.Triangles[triangle];
+            int mask = IntersectTrianglePacket(tri.V0, tri.Edge1, tri.Edge2, local, tMin, tLocal, lanes);
+            for (int lane = 0; lane < 4; lane++) {
+                if (mask & (1 << lane)) {
+                    objects[lane] = object;
+                    triangles[lane] = triangle;
+                }
+            }
+            hit |= mask;
+            return mask;
+        });
+        return hit;
+    });
+
+    alignas(16) float t[4];
+    _mm_store_ps(t, tMax);
+    for (int lane = 0; lane < 4; lane++) {
+        hits[lane].T = t[lane];
+        hits[lane].Object = objects[lane];
+        hits[lane].Triangle = triangles[lane];
+    }
+}
+
+int RayQuery::AnyPacket(const RayDesc* rays) const {
+    BvhRayPacket packet = MakePacket(rays);
+    __m128 tMin = LoadTMin(rays);
+    return m_Top.OccludedPacket(packet, LoadTMax(rays), 0xF, [&](uint32_t primitive, __m128& t, int active) {
+        const Instance& instance = m_Instances[m_TopObjects[primitive]];
+        const MeshLevel& mesh = m_Meshes[instance.Mesh];
+        BvhRayPacket local;
+        TransformPacket(instance.WorldToObject, packet, local);
+        return mesh.Bvh.OccludedPacket(local, t, active, [&](uint32_t triangle, __m128& tLocal, int lanes) {
+            const Triangle& tri = mesh.Triangles[triangle];
+            return IntersectTrianglePacket(tri.V0, tri.Edge1, tri.Edge2, local, tMin, tLocal, lanes);
+        });
+    });
+}
+
+void RayQuery::TraceClosestRange(const RayDesc* rays, size_t count, RayHit* hits) const {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        if (SameSigns(rays + i)) {
+            ClosestPacket(rays + i, hits + i);
+        } else {
+            for (size_t j = i; j < i + 4; j++)
+                ClosestRay(rays[j], hits[j]);
+        }
+    }
+    for (; i < count; i++)
+        ClosestRay(rays[i], hits[i]);
+
+    // Geometric normal in world space: the inverse transpose of the model matrix
+    for (i = 0; i < count; i++) {
+        RayHit& hit = hits[i];
+        if (hit.Object == RAY_QUERY_MISS) {
+            hit.Normal = glm::vec3(0.0f);
+            continue;
+        }
+        const Instance& instance = m_Instances[hit.Object];
+        const Triangle& tri = m_Meshes[instance.Mesh].Triangles[hit.Triangle];
+        glm::vec3 local = glm::cross(tri.Edge1, tri.Edge2);
+        const glm::mat4& m = instance.WorldToObject;
+        hit.Normal = glm::vec3(glm::dot(glm::vec3(m[0]), local), glm::dot(glm::vec3(m[1]), local), glm::dot(glm::vec3(m[2]), local));
+        if (glm::dot(hit.Normal, rays[i].Direction) > 0.0f)
+            hit.Normal = -hit.Normal;
+    }
+}
+
+void RayQuery::TraceAnyRange(const RayDesc* rays, size_t count, uint8_t* occluded) const {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        if (SameSigns(rays + i)) {
+            int mask = AnyPacket(rays + i);
+            for (int lane = 0; lane < 4; lane++)
+                occluded[i + lane] = (mask >> lane) & 1;
+        } else {
+            for (size_t j = i; j < i + 4; j++)
+                occluded[j] = AnyRay(rays[j]);
+        }
+    }
+    for (; i < count; i++)
+        occluded[i] = AnyRay(rays[i]);
+}
+
+void RayQuery::TraceClosest(const RayDesc* rays, size_t count, RayHit* hits, JobSystem* jobs) const {
+    ForEachBatch(count, jobs, [&](size_t first, size_t size) {
+        TraceClosestRange(rays + first, size, hits + first);
+    });
+}
+
+void RayQuery::TraceAny(const RayDesc* rays, size_t count, uint8_t* occluded, JobSystem* jobs) const {
+    ForEachBatch(count, jobs, [&](size_t first, size_t size) {
+        TraceAnyRange(rays + first, size, occluded + first);
+    });
+}
+
+RayHit RayQuery::TraceClosest(const RayDesc& ray) const {
+    RayHit hit;
+    TraceClosestRange(&ray, 1, &hit);
+    return hit;
+}
+
+bool RayQuery::IsVisible(const glm::vec3& from, const glm::vec3& to, float epsilon) const {
+    glm::vec3 delta = to - from;
+    float length = glm::length(delta);
+    if (length <= 2.0f * epsilon)
+        return true;
+    RayDesc ray;
+    ray.Direction = delta / length;
+    ray.Origin = from + ray.Direction * epsilon;
+    ray.TMax = length - 2.0f * epsilon;
+    return !AnyRay(ray);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Bvh.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+struct Scene;
+struct SceneDesc;
+struct SceneBinding;
+
+// RayHit::Object of a ray that hit nothing
+#define RAY_QUERY_MISS 0xFFFFFFFFu
+// A refit whose tree has got this much worse than at its build is rebuilt
+#define RAY_QUERY_REBUILD_COST 1.5f
+// Rays per job in the batched calls; smaller batches run on the calling thread
+#define RAY_QUERY_BATCH 256
+
+struct RayDesc {
+    glm::vec3 Origin;
+    glm::vec3 Direction;           // need not be normalized; T is in its units
+    float TMin = 0.0f;             // hits count past TMin and before TMax
+    float TMax = 3.402823466e+38f;
+};
+
+struct RayHit {
+    float T;
+    uint32_t Object;               // index into Scene::Objects, or RAY_QUERY_MISS
+    uint32_t Triangle;             // within the object's mesh
+    glm::vec3 Normal;              // world space, unnormalized, facing the ray
+};
+
+struct RayQueryStats {
+    size_t Meshes = 0;
+    size_t Triangles = 0;
+    size_t Instances = 0;
+    size_t MemoryBytes = 0;
+    unsigned long long Refits = 0;
+    unsigned long long Rebuilds = 0;
+};
+
+// Ray casts against the scene on the CPU, for picking, visibility checks and
+// baking. Two levels: every triangle mesh gets a bottom-level BVH over its
+// triangles in mesh space, built once; the top-level BVH holds one box per
+// object and is refit as objects move, or rebuilt when objects come and go
+// or refitting has degraded it. Rays reach a mesh's triangles through the
+// object's inverse model matrix, so moving an object never touches its mesh.
+//
+// Batched calls take rays in groups of four; a group whose rays point the
+// same way traverses both levels as one SSE packet, anything else goes ray
+// by ray.
+class RayQuery {
+public:
+    // Bottom level for every triangle mesh of the scene file (lines and
+    // points are never hit); `binding` maps them to the scene's meshes
+    void BuildMeshes(const SceneDesc& desc, const SceneBinding& binding);
+    // The same without a Scene, for tools: meshes keep their desc indices
+    void BuildMeshes(const SceneDesc& desc);
+    void Clear();
+    bool HasMeshes() const { return !m_Meshes.empty(); }
+
+    // Top level from the scene's current objects. Cheap when nothing moved.
+    void Update(const Scene& scene, JobSystem* jobs = nullptr);
+    // Top level from the desc's objects, after BuildMeshes(desc); hits name
+    // indices into desc.Objects
+    void Update(const SceneDesc& desc, JobSystem* jobs = nullptr);
+
+    void TraceClosest(const RayDesc* rays, size_t count, RayHit* hits, JobSystem* jobs = nullptr) const;
+    // occluded[i] is 1 when ray i hits anything before its TMax
+    void TraceAny(const RayDesc* rays, size_t count, uint8_t* occluded, JobSystem* jobs = nullptr) const;
+
+    RayHit TraceClosest(const RayDesc& ray) const;
+    // Line of sight between two points, ignoring hits within `epsilon` of either end
+    bool IsVisible(const glm::vec3& from, const glm::vec3& to, float epsilon = 1e-3f) const;
+
+    const RayQueryStats& GetStats() const { return m_Stats; }
+
+private:
+    struct Triangle {
+        glm::vec3 V0, Edge1, Edge2;
+    };
+    struct MeshLevel {
+        Bvh4 Bvh;
+        std::vector<Triangle> Triangles;
+        BvhBounds Bounds;
+    };
+    struct Instance {
+        glm::mat4 Model;
+        glm::mat4 WorldToObject;
+        uint32_t Mesh;             // index into m_Meshes, or RAY_QUERY_MISS for objects never hit
+    };
+
+    // Shared by both Updates: object(i, model, mesh) gives object i's model
+    // matrix and the index its mesh was built under
+    template <typename Object>
+    void UpdateInstances(size_t count, JobSystem* jobs, Object&& object);
+    void TraceClosestRange(const RayDesc* rays, size_t count, RayHit* hits) const;
+    void TraceAnyRange(const RayDesc* rays, size_t count, uint8_t* occluded) const;
+    void ClosestRay(const RayDesc& ray, RayHit& hit) const;
+    bool AnyRay(const RayDesc& ray) const;
+    void ClosestPacket(const RayDesc* rays, RayHit* hits) const;
+    int AnyPacket(const RayDesc* rays) const;
+
+    std::vector<MeshLevel> m_Meshes;
+    std::vector<uint32_t> m_SceneMeshes;       // Scene::Meshes index -> m_Meshes index
+    std::vector<Instance> m_Instances;         // one per Scene::Objects entry
+    std::vector<BvhBounds> m_InstanceBounds;   // world space, per object
+    std::vector<uint32_t> m_TopObjects;        // top-level primitive -> object, hittable ones only
+    std::vector<BvhBounds> m_TopBounds;
+    Bvh4 m_Top;
+    RayQueryStats m_Stats;
+};
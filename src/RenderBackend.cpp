@@ -0,0 +1,85 @@
+#include "RenderBackend.h"
+#include "Shader.h"
+
+#include <GL/glew.h>
+
+void RenderBackend::CreatePrograms(const ShaderProgramSource* sources, size_t count, unsigned int* programs) {
+    for (size_t i = 0; i < count; i++)
+        programs[i] = CreateProgram(sources[i]);
+}
+
+void RenderBackend::BeginPrograms(const ShaderProgramSource* sources, size_t count, unsigned int* programs) {
+    CreatePrograms(sources, count, programs);
+}
+
+void RenderBackend::CountDraw(unsigned int mode, int count) {
+    unsigned long long triangles = mode == GL_TRIANGLES ? count / 3 : 0;
+    m_Stats.DrawCalls++;
+    m_Stats.Triangles += triangles;
+    m_FrameStats.DrawCalls++;
+    m_FrameStats.Triangles += triangles;
+}
+
+void RenderBackend::CountCreate(size_t bytes) {
+    m_Stats.ResourcesCreated++;
+    m_FrameStats.ResourcesCreated++;
+    CountUpload(bytes);
+}
+
+void RenderBackend::CountUpload(size_t bytes) {
+    m_Stats.BytesUploaded += bytes;
+    m_FrameStats.BytesUploaded += bytes;
+    m_Memory.TrackUpload(bytes);
+}
+
+void RenderBackend::CountDelete(GLObjectType type, unsigned int id) {
+    m_Stats.ResourcesDeleted++;
+    m_FrameStats.ResourcesDeleted++;
+    m_Memory.TrackFree(type, id);
+}
+
+size_t RenderBackend::GetBytesPerPixel(unsigned int internalFormat) {
+    if (internalFormat == GL_R8)
+        return 1;
+    if (internalFormat == GL_R16)
+        return 2;
+    if (internalFormat == GL_RGBA16F || internalFormat == GL_DEPTH32F_STENCIL8)
+        return 8;
+    if (internalFormat == GL_RGBA32F || internalFormat == GL_RGBA32UI)
+        return 16;
+    return 4;
+}
+
+void RenderBackend::TrackRenderbuffer(unsigned int renderbuffer, unsigned int internalFormat, int width, int height) {
+    m_Memory.TrackAllocation(GLObjectType::Renderbuffer, renderbuffer, GpuMemoryCategory::RenderTarget,
+                             GetBytesPerPixel(internalFormat) * width * height);
+}
+
+void RenderBackend::TrackTexture(unsigned int texture, unsigned int internalFormat, int width, int height, int depth) {
+    m_Memory.TrackAllocation(GLObjectType::Texture, texture, GpuMemoryCategory::Texture,
+                             GetBytesPerPixel(internalFormat) * width * height * depth);
+}
+
+void RenderBackend::TrackBuffer(unsigned int target, unsigned int buffer, size_t size) {
+    GpuMemoryCategory category = GpuMemoryCategory::Other;
+    if (target == GL_ARRAY_BUFFER)
+        category = GpuMemoryCategory::VertexBuffer;
+    else if (target == GL_ELEMENT_ARRAY_BUFFER)
+        category = GpuMemoryCategory::IndexBuffer;
+    else if (target == GL_UNIFORM_BUFFER)
+        category = GpuMemoryCategory::UniformBuffer;
+    m_Memory.TrackAllocation(GLObjectType::Buffer, buffer, category, size);
+}
+
+void RenderBackend::EndFrame() {
+    m_DeletionQueue.EndFrame();
+
+    // Driver queries can stall on some implementations, so poll them rarely
+    if (m_FrameCount++ % 60 == 0)
+        m_DriverMemory = QueryDriverMemory();
+    m_Memory.EndFrame(m_DriverMemory);
+}
+
+void DeleteDeferred(RenderBackend& backend, GLObjectType type, unsigned int id) {
+    backend.GetDeletionQueue().Enqueue(type, id);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "DeletionQueue.h"
+#include "GpuMemory.h"
+
+#include <cstddef>
+#include <ostream>
+
+struct ShaderProgramSource;
+
+struct RenderStats {
+    unsigned long long DrawCalls = 0;
+    unsigned long long Triangles = 0;
+    unsigned long long StateChanges = 0;
+    unsigned long long UniformUpdates = 0;
+    unsigned long long ResourcesCreated = 0;
+    unsigned long long ResourcesDeleted = 0;
+    unsigned long long BytesUploaded = 0;
+    unsigned long long ValidationErrors = 0;
+};
+
+// Everything the frame loop submits goes through this interface, so the same
+// scene update, culling and draw-packet code can run against the real GL driver
+// or against the null backend for CPU-only benchmarks.
+class RenderBackend {
+public:
+    RenderBackend() : m_DeletionQueue(*this) {}
+    virtual ~RenderBackend() = default;
+
+    RenderBackend(const RenderBackend&) = delete;
+    RenderBackend& operator=(const RenderBackend&) = delete;
+
+    virtual const char* GetName() const = 0;
+
+    // target is GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER or GL_UNIFORM_BUFFER; the buffer is left bound
+    virtual unsigned int CreateBuffer(unsigned int target, const void* data, size_t size, unsigned int usage) = 0;
+    virtual void BindBuffer(unsigned int target, unsigned int buffer) = 0;
+    // Write-only, unsynchronized mapping: the caller guarantees (with fences)
+    // that the GPU is no longer reading the range. GL_PIXEL_PACK_BUFFER is
+    // mapped read-only instead, for readbacks the caller has fenced.
+    virtual void* MapBuffer(unsigned int target, unsigned int buffer, size_t offset, size_t size) = 0;
+    virtual void UnmapBuffer(unsigned int target, unsigned int buffer) = 0;
+    // Attaches [offset, offset + size) of buffer to indexed binding point `index` of target
+    virtual void BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size) = 0;
+    // Required alignment of BindBufferRange offsets for GL_UNIFORM_BUFFER
+    virtual size_t GetUniformBufferAlignment() = 0;
+
+    virtual unsigned int CreateVertexArray() = 0;
+    virtual void BindVertexArray(unsigned int vao) = 0;
+    // Describes and enables attribute `index` from the currently bound GL_ARRAY_BUFFER
+    virtual void VertexAttribPointer(unsigned int index, int size, unsigned int type, int stride, size_t offset) = 0;
+
+    virtual unsigned int CreateProgram(const ShaderProgramSource& source) = 0;
+    // Batch form; backends that can compile concurrently override it
+    virtual void CreatePrograms(const ShaderProgramSource* sources, size_t count, unsigned int* programs);
+    // Split form of CreatePrograms: returns once the compiles are issued so the
+    // caller can do other work while the driver compiles, and FinishPrograms
+    // waits for and reports every program begun since. Programs must not be
+    // used in between.
+    virtual void BeginPrograms(const ShaderProgramSource* sources, size_t count, unsigned int* programs);
+    virtual void FinishPrograms() {}
+    virtual void UseProgram(unsigned int program) = 0;
+    virtual int GetUniformLocation(unsigned int program, const char* name) = 0;
+    // Points the program's uniform block `name` at a binding; no-op if the
+    // program has no such (active) block
+    virtual void BindUniformBlock(unsigned int program, const char* name, unsigned int binding) = 0;
+    virtual void SetUniformMat4(int location, const float* value) = 0;
+    virtual void SetUniform4f(int location, float x, float y, float z, float w) = 0;
+    // Samplers take the texture unit they read
+    virtual void SetUniform1i(int location, int value) = 0;
+
+    // 2D texture with nearest filtering and clamped edges, read with texelFetch
+    // or rendered into. `data` may be null; otherwise it holds the format's
+    // client type: floats for GL_R32F and GL_RGBA32F, 32-bit unsigned ints for
+    // GL_R32UI and GL_RGBA32UI, bytes for GL_RGBA8. The texture is left bound
+    // to the unit last passed to BindTexture.
+    // GL_DEPTH_COMPONENT32F (floats) also works, as a depth attachment that
+    // can be sampled afterwards.
+    virtual unsigned int CreateTexture(unsigned int internalFormat, int width, int height, const void* data) = 0;
+    virtual void BindTexture(unsigned int unit, unsigned int texture) = 0;
+    // 3D texture with clamped edges. GL_R8 and GL_R16 (bytes, 16-bit unsigned
+    // ints) filter linearly; GL_RGBA8UI (bytes) is nearest and read with
+    // texelFetch. Left bound like CreateTexture.
+    virtual unsigned int CreateTexture3D(unsigned int internalFormat, int width, int height, int depth, const void* data) = 0;
+    // Overwrites a box of texels, in the texture's client format; leaves the
+    // texture bound like CreateTexture3D
+    virtual void UpdateTexture3D(unsigned int texture, int x, int y, int z, int width, int height, int depth, const void* data) = 0;
+    virtual void BindTexture3D(unsigned int unit, unsigned int texture) = 0;
+
+    // internalFormat is a renderable format such as GL_RGBA8 or GL_DEPTH_COMPONENT24
+    virtual unsigned int CreateRenderbuffer(unsigned int internalFormat, int width, int height) = 0;
+    // The new framebuffer is left bound; attach renderbuffers with FramebufferRenderbuffer
+    virtual unsigned int CreateFramebuffer() = 0;
+    virtual void FramebufferRenderbuffer(unsigned int attachment, unsigned int renderbuffer) = 0;
+    virtual void FramebufferTexture(unsigned int attachment, unsigned int texture) = 0;
+    // 0 binds the default framebuffer
+    virtual void BindFramebuffer(unsigned int framebuffer) = 0;
+    virtual void SetViewport(int x, int y, int width, int height) = 0;
+    // Blocks until every submitted command has executed
+    virtual void Finish() = 0;
+    // Reads RGBA8 pixels of the bound framebuffer, bottom row first; waits for
+    // the commands that draw them. With a GL_PIXEL_PACK_BUFFER bound, `rgba`
+    // is a byte offset into that buffer and the copy happens asynchronously.
+    virtual void ReadPixels(int x, int y, int width, int height, void* rgba) = 0;
+
+    virtual void Clear() = 0;
+    // Indices are always GL_UNSIGNED_INT; offset is in bytes into the bound element buffer
+    virtual void DrawElements(unsigned int mode, int count, size_t offset) = 0;
+    virtual void DrawArrays(unsigned int mode, int first, int count) = 0;
+
+    // Queries, e.g. GL_TIME_ELAPSED. Only one query per target may be active.
+    virtual unsigned int CreateQuery() = 0;
+    virtual void BeginQuery(unsigned int target, unsigned int query) = 0;
+    virtual void EndQuery(unsigned int target) = 0;
+    // Never blocks: returns false while the result is not available yet
+    virtual bool GetQueryResult(unsigned int query, unsigned long long& result) = 0;
+
+    // Deletes immediately. Owners should normally go through GLHandle, which
+    // defers deletion until the GPU is done with the object.
+    virtual void DeleteObject(GLObjectType type, unsigned int id) = 0;
+
+    // Fences mark a point in the command stream; WaitFence returns true once
+    // the GPU has passed it, giving up after timeoutNs (0 only polls)
+    virtual void* InsertFence() = 0;
+    virtual bool WaitFence(void* fence, unsigned long long timeoutNs) = 0;
+    virtual void DeleteFence(void* fence) = 0;
+
+    DeletionQueue& GetDeletionQueue() { return m_DeletionQueue; }
+
+    // Driver-reported memory, when the implementation exposes it
+    virtual GpuDriverMemory QueryDriverMemory() { return {}; }
+    GpuMemoryTracker& GetMemoryTracker() { return m_Memory; }
+    void DumpMemory(std::ostream& out) { m_Memory.Dump(out, QueryDriverMemory()); }
+
+    const RenderStats& GetStats() const { return m_Stats; }
+    const RenderStats& GetFrameStats() const { return m_FrameStats; }
+    void BeginFrame() { m_FrameStats = {}; }
+    // Retires deferred deletions whose frames the GPU has finished and closes
+    // the frame's memory accounting
+    void EndFrame();
+
+protected:
+    void CountDraw(unsigned int mode, int count);
+    void CountStateChange() { m_Stats.StateChanges++; m_FrameStats.StateChanges++; }
+    void CountUniform() { m_Stats.UniformUpdates++; m_FrameStats.UniformUpdates++; }
+    void CountCreate(size_t bytes = 0);
+    void CountUpload(size_t bytes);
+    void CountDelete(GLObjectType type, unsigned int id);
+    // Records a new buffer under the category its target implies
+    void TrackBuffer(unsigned int target, unsigned int buffer, size_t size);
+    void TrackRenderbuffer(unsigned int renderbuffer, unsigned int internalFormat, int width, int height);
+    void TrackTexture(unsigned int texture, unsigned int internalFormat, int width, int height, int depth = 1);
+    static size_t GetBytesPerPixel(unsigned int internalFormat);
+    void CountValidationError() { m_Stats.ValidationErrors++; m_FrameStats.ValidationErrors++; }
+
+    RenderStats m_Stats;
+    RenderStats m_FrameStats;
+    DeletionQueue m_DeletionQueue;
+    GpuMemoryTracker m_Memory;
+    GpuDriverMemory m_DriverMemory;
+    unsigned long long m_FrameCount = 0;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <csignal>
+
+#ifdef __linux__
+    #define debugBreak() raise(SIGTRAP)
+#elif _WIN32
+    #define debugBreak() __debugbreak()
+#endif
+
+#define ASSERT(x) if (!(x)) debugBreak();
+#define GLCall(x) GLClearError();\
+    x;\
+    ASSERT(GLLogCall(#x, __FILE__, __LINE__));
+
+void GLClearError();
+bool GLLogCall(const char* function, const char* file, int line);
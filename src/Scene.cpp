@@ -0,0 +1,336 @@
+#include "Scene.h"
+#include "CommandBuffer.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "UniformRing.h"
+#include "ShaderLayouts.h"
+#include "RenderBackend.h"
+#include "Shader.h"
+#include "HostMemory.h"
+
+#include <algorithm>
+#include <cmath>
+
+unsigned int AddMesh(Scene& scene, RenderBackend& backend, unsigned int mode,
+                     const float* positions, size_t floatCount,
+                     const unsigned int* indices, size_t indexCount) {
+    MemoryTagScope tag(MemoryTag::Meshes);
+    Mesh mesh;
+    mesh.Mode = mode;
+    mesh.Vao = backend.CreateVertexArray();
+    scene.VertexArrays.emplace_back(backend, mesh.Vao);
+    backend.BindVertexArray(mesh.Vao);
+
+    mesh.Vbo = backend.CreateBuffer(GL_ARRAY_BUFFER, positions, floatCount * sizeof(float), GL_STATIC_DRAW);
+    scene.Buffers.emplace_back(backend, mesh.Vbo);
+    backend.VertexAttribPointer(0, 3, GL_FLOAT, 3 * sizeof(float), 0);
+
+    if (indices) {
+        mesh.Ibo = backend.CreateBuffer(GL_ELEMENT_ARRAY_BUFFER, indices, indexCount * sizeof(unsigned int), GL_STATIC_DRAW);
+        scene.Buffers.emplace_back(backend, mesh.Ibo);
+        mesh.Count = static_cast<int>(indexCount);
+    } else {
+        mesh.Count = static_cast<int>(floatCount / 3);
+    }
+
+    if (floatCount >= 3) {
+        mesh.BoundsMin = mesh.BoundsMax = glm::vec3(positions[0], positions[1], positions[2]);
+        for (size_t i = 3; i + 2 < floatCount; i += 3) {
+            glm::vec3 p(positions[i], positions[i + 1], positions[i + 2]);
+            mesh.BoundsMin = glm::min(mesh.BoundsMin, p);
+            mesh.BoundsMax = glm::max(mesh.BoundsMax, p);
+        }
+    }
+
+    scene.Meshes.push_back(mesh);
+    return static_cast<unsigned int>(scene.Meshes.size() - 1);
+}
+
+void ReplaceMesh(Scene& scene, RenderBackend& backend, unsigned int mesh, unsigned int mode,
+                 const float* positions, size_t floatCount,
+                 const unsigned int* indices, size_t indexCount) {
+    Mesh old = scene.Meshes[mesh];
+    unsigned int uploaded = AddMesh(scene, backend, mode, positions, floatCount, indices, indexCount);
+    scene.Meshes[mesh] = scene.Meshes[uploaded];
+    scene.Meshes.pop_back();
+
+    // Dropping the owning handles queues the old objects for deletion
+    scene.VertexArrays.erase(std::remove_if(scene.VertexArrays.begin(), scene.VertexArrays.end(),
+                                            [&old](const VertexArrayHandle& handle) { return handle.Get() == old.Vao; }),
+                             scene.VertexArrays.end());
+    scene.Buffers.erase(std::remove_if(scene.Buffers.begin(), scene.Buffers.end(),
+                                       [&old](const BufferHandle& handle) { return handle.Get() == old.Vbo || (old.Ibo && handle.Get() == old.Ibo); }),
+                        scene.Buffers.end());
+}
+
+unsigned int AddSubMesh(Scene& scene, unsigned int mesh, int first, int count) {
+    Mesh subMesh = scene.Meshes[mesh];
+    subMesh.First = first;
+    subMesh.Count = count;
+    scene.Meshes.push_back(subMesh);
+    return static_cast<unsigned int>(scene.Meshes.size() - 1);
+}
+
+unsigned int AddShader(Scene& scene, const std::string& path, ShaderProgramSource source) {
+    MemoryTagScope tag(MemoryTag::Shaders);
+    for (unsigned int shader = 0; shader < scene.Shaders.size(); shader++) {
+        if (scene.Shaders[shader]->GetPath() == path)
+            return shader;
+    }
+    scene.Shaders.push_back(std::make_unique<ShaderVariantSet>(path, std::move(source)));
+    return static_cast<unsigned int>(scene.Shaders.size() - 1);
+}
+
+ShaderVariantSet* FindShader(Scene& scene, const std::string& path) {
+    for (auto& shader : scene.Shaders) {
+        if (shader->GetPath() == path)
+            return shader.get();
+    }
+    return nullptr;
+}
+
+unsigned int AddMaterial(Scene& scene, const std::string& shaderPath, const std::vector<std::string>& keywords) {
+    for (unsigned int shader = 0; shader < scene.Shaders.size(); shader++) {
+        if (scene.Shaders[shader]->GetPath() == shaderPath)
+            return AddMaterial(scene, shader, keywords);
+    }
+    return AddMaterial(scene, AddShader(scene, shaderPath, ParseShader(shaderPath)), keywords);
+}
+
+unsigned int AddMaterial(Scene& scene, unsigned int shader, const std::vector<std::string>& keywords) {
+    MemoryTagScope tag(MemoryTag::Shaders);
+    Material material;
+    material.Shader = shader;
+    material.Variant = scene.Shaders[shader]->GetKeywordMask(keywords);
+    scene.Shaders[shader]->Request(material.Variant);
+
+    scene.Materials.push_back(material);
+    return static_cast<unsigned int>(scene.Materials.size() - 1);
+}
+
+static void ResolveMaterial(const Scene& scene, RenderBackend& backend, Material& material) {
+    material.Program = scene.Shaders[material.Shader]->Get(material.Variant);
+    // Blocks get the binding indices ShaderReflect assigned at build time
+    for (const ShaderBlockInfo& block : g_ShaderBlocks) {
+        if (block.Name && !block.Storage)
+            backend.BindUniformBlock(material.Program, block.Name, block.Binding);
+    }
+}
+
+void CompileMaterials(Scene& scene, RenderBackend& backend) {
+    BeginCompileMaterials(scene, backend);
+    FinishCompileMaterials(scene, backend);
+}
+
+void BeginCompileMaterials(Scene& scene, RenderBackend& backend) {
+    MemoryTagScope tag(MemoryTag::Shaders);
+    std::vector<ShaderVariantSet*> sets;
+    for (auto& shader : scene.Shaders)
+        sets.push_back(shader.get());
+    BeginRequestedVariants(backend, sets);
+}
+
+void FinishCompileMaterials(Scene& scene, RenderBackend& backend) {
+    MemoryTagScope tag(MemoryTag::Shaders);
+    backend.FinishPrograms();
+    for (Material& material : scene.Materials)
+        ResolveMaterial(scene, backend, material);
+}
+
+void SetMaterialVariant(Scene& scene, RenderBackend& backend, unsigned int material, unsigned int mask) {
+    MemoryTagScope tag(MemoryTag::Shaders);
+    Material& target = scene.Materials[material];
+    ShaderVariantSet& shader = *scene.Shaders[target.Shader];
+    if (mask >= shader.GetVariantCount())
+        return;
+    if (!shader.Get(mask)) {
+        shader.Request(mask);
+        CompileRequestedVariants(backend, { &shader });
+    }
+    target.Variant = mask;
+    ResolveMaterial(scene, backend, target);
+}
+
+void AddObject(Scene& scene, unsigned int mesh, unsigned int material, const glm::mat4& model, const glm::vec4& color) {
+    scene.Objects.push_back({ mesh, material, model, color });
+}
+
+void DestroyScene(Scene& scene) {
+    scene = {};
+}
+
+Frustum ExtractFrustum(const glm::mat4& viewProj) {
+    // Gribb/Hartmann: each plane is the 4th row of the matrix plus or minus another row
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+        row[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+
+    Frustum frustum;
+    frustum.Planes[0] = row[3] + row[0];
+    frustum.Planes[1] = row[3] - row[0];
+    frustum.Planes[2] = row[3] + row[1];
+    frustum.Planes[3] = row[3] - row[1];
+    frustum.Planes[4] = row[3] + row[2];
+    frustum.Planes[5] = row[3] - row[2];
+    return frustum;
+}
+
+bool IsBoxVisible(const Frustum& frustum, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    for (const glm::vec4& plane : frustum.Planes) {
+        // Test the corner furthest along the plane normal
+        glm::vec3 p(
+            plane.x >= 0.0f ? boundsMax.x : boundsMin.x,
+            plane.y >= 0.0f ? boundsMax.y : boundsMin.y,
+            plane.z >= 0.0f ? boundsMax.z : boundsMin.z
+        );
+        if (plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+static void TransformBounds(const glm::mat4& model, const glm::vec3& localMin, const glm::vec3& localMax,
+                            glm::vec3& worldMin, glm::vec3& worldMax) {
+    // Arvo's method: project the box extents onto each world axis
+    glm::vec3 center = (localMin + localMax) * 0.5f;
+    glm::vec3 extent = (localMax - localMin) * 0.5f;
+    glm::vec3 worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+    glm::vec3 worldExtent(0.0f);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++)
+            worldExtent[i] += std::abs(model[j][i]) * extent[j];
+    }
+    worldMin = worldCenter - worldExtent;
+    worldMax = worldCenter + worldExtent;
+}
+
+bool IsObjectPotentiallyVisible(const SceneVisibility& visibility, size_t object) {
+    if (!visibility.Objects || object < visibility.FirstObject || object - visibility.FirstObject >= visibility.ObjectCount)
+        return true;
+    size_t bit = object - visibility.FirstObject;
+    return (visibility.Objects[bit / 64] >> (bit % 64)) & 1;
+}
+
+// The impostor flag and the set are one lookup each, so they go before the box transform
+static bool IsObjectVisible(const Scene& scene, const Frustum& frustum, size_t index) {
+    if (index < scene.ImpostorObjects.size() && scene.ImpostorObjects[index])
+        return false;
+    if (!IsObjectPotentiallyVisible(scene.Visibility, index))
+        return false;
+    const SceneObject& object = scene.Objects[index];
+    const Mesh& mesh = scene.Meshes[object.MeshIndex];
+    glm::vec3 worldMin, worldMax;
+    TransformBounds(object.Model, mesh.BoundsMin, mesh.BoundsMax, worldMin, worldMax);
+    return IsBoxVisible(frustum, worldMin, worldMax);
+}
+
+static void WriteObjectData(UniformRing& uniforms, size_t offset, const glm::mat4& viewProj, const SceneObject& object) {
+    ObjectData* data = uniforms.GetSlot<ObjectData>(offset);
+    data->u_MVP = viewProj * object.Model;
+    data->u_Color = object.Color;
+}
+
+// Batch vertices are in world space and carry their objects' colors
+static void WriteBatchData(UniformRing& uniforms, size_t offset, const glm::mat4& viewProj) {
+    ObjectData* data = uniforms.GetSlot<ObjectData>(offset);
+    data->u_MVP = viewProj;
+    data->u_Color = glm::vec4(1.0f);
+}
+
+void BuildDrawPackets(const Scene& scene, const glm::mat4& viewProj, const std::pmr::vector<unsigned int>& batches,
+                      UniformRing& uniforms, std::pmr::vector<DrawPacket>& packets) {
+    Frustum frustum = ExtractFrustum(viewProj);
+    packets.reserve(packets.size() + scene.Objects.size() + batches.size());
+    for (size_t i = 0; i < scene.Objects.size(); i++) {
+        const SceneObject& object = scene.Objects[i];
+        if (object.Batched || !IsObjectVisible(scene, frustum, i))
+            continue;
+
+        const Mesh& mesh = scene.Meshes[object.MeshIndex];
+        const Material& material = scene.Materials[object.MaterialIndex];
+        size_t offset = uniforms.Allocate();
+        WriteObjectData(uniforms, offset, viewProj, object);
+        packets.push_back({
+            material.Program, mesh.Vao, mesh.Mode, mesh.First, mesh.Count, mesh.Ibo != 0, offset
+        });
+    }
+    for (unsigned int index : batches) {
+        const StaticBatch& batch = scene.Batches[index];
+        size_t offset = uniforms.Allocate();
+        WriteBatchData(uniforms, offset, viewProj);
+        packets.push_back({
+            scene.Materials[batch.MaterialIndex].Program, batch.Vao, batch.Mode, 0, batch.Count, true, offset
+        });
+    }
+}
+
+void RecordDrawCommands(const Scene& scene, const glm::mat4& viewProj, const std::pmr::vector<unsigned int>& batches,
+                        UniformRing& uniforms, JobSystem& jobs, FrameArena& arena, std::pmr::vector<CommandBuffer>& chunks) {
+    Frustum frustum = ExtractFrustum(viewProj);
+    size_t objectChunks = (scene.Objects.size() + SCENE_CHUNK_SIZE - 1) / SCENE_CHUNK_SIZE;
+    size_t chunkCount = objectChunks + (batches.size() + SCENE_CHUNK_SIZE - 1) / SCENE_CHUNK_SIZE;
+    if (chunks.size() < chunkCount)
+        chunks.resize(chunkCount);
+
+    jobs.Dispatch(static_cast<unsigned int>(chunks.size()), [&](unsigned int chunk) {
+        CommandBuffer& commands = chunks[chunk];
+        commands.Reset(arena.GetResource());
+
+        if (chunk >= objectChunks) {
+            size_t begin = (chunk - objectChunks) * SCENE_CHUNK_SIZE;
+            size_t end = std::min(begin + SCENE_CHUNK_SIZE, batches.size());
+            for (size_t i = begin; i < end; i++) {
+                const StaticBatch& batch = scene.Batches[batches[i]];
+                size_t offset = uniforms.Allocate();
+                WriteBatchData(uniforms, offset, viewProj);
+                commands.UseProgram(scene.Materials[batch.MaterialIndex].Program);
+                commands.BindVertexArray(batch.Vao);
+                commands.BindBufferRange(GL_UNIFORM_BUFFER, ObjectData::Binding, uniforms.GetBuffer(), offset, sizeof(ObjectData));
+                commands.DrawElements(batch.Mode, batch.Count, 0);
+            }
+            return;
+        }
+
+        size_t begin = chunk * SCENE_CHUNK_SIZE;
+        size_t end = std::min(begin + SCENE_CHUNK_SIZE, scene.Objects.size());
+        for (size_t i = begin; i < end; i++) {
+            const SceneObject& object = scene.Objects[i];
+            if (object.Batched || !IsObjectVisible(scene, frustum, i))
+                continue;
+
+            const Mesh& mesh = scene.Meshes[object.MeshIndex];
+            const Material& material = scene.Materials[object.MaterialIndex];
+            size_t offset = uniforms.Allocate();
+            WriteObjectData(uniforms, offset, viewProj, object);
+
+            commands.UseProgram(material.Program);
+            commands.BindVertexArray(mesh.Vao);
+            commands.BindBufferRange(GL_UNIFORM_BUFFER, ObjectData::Binding, uniforms.GetBuffer(), offset, sizeof(ObjectData));
+            if (mesh.Ibo != 0)
+                commands.DrawElements(mesh.Mode, mesh.Count, mesh.First * sizeof(unsigned int));
+            else
+                commands.DrawArrays(mesh.Mode, mesh.First, mesh.Count);
+        }
+    });
+}
+
+void SubmitDrawPackets(RenderBackend& backend, const UniformRing& uniforms, const std::pmr::vector<DrawPacket>& packets) {
+    unsigned int program = 0, vao = 0;
+    for (const DrawPacket& packet : packets) {
+        if (packet.Program != program) {
+            backend.UseProgram(packet.Program);
+            program = packet.Program;
+        }
+        if (packet.Vao != vao) {
+            backend.BindVertexArray(packet.Vao);
+            vao = packet.Vao;
+        }
+        backend.BindBufferRange(GL_UNIFORM_BUFFER, ObjectData::Binding, uniforms.GetBuffer(),
+                                packet.UniformOffset, sizeof(ObjectData));
+
+        if (packet.Indexed)
+            backend.DrawElements(packet.Mode, packet.Count, packet.First * sizeof(unsigned int));
+        else
+            backend.DrawArrays(packet.Mode, packet.First, packet.Count);
+    }
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "GLResource.h"
+#include "ShaderVariants.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+class RenderBackend;
+class CommandBuffer;
+class JobSystem;
+class FrameArena;
+class UniformRing;
+
+// Objects culled and recorded per job by RecordDrawCommands
+#define SCENE_CHUNK_SIZE 256
+
+struct Mesh {
+    unsigned int Vao = 0;
+    unsigned int Vbo = 0;
+    unsigned int Ibo = 0;          // 0 for non-indexed meshes
+    unsigned int Mode = GL_TRIANGLES;
+    int First = 0;                 // first vertex, or first index when indexed
+    int Count = 0;
+    glm::vec3 BoundsMin = glm::vec3(0.0f);
+    glm::vec3 BoundsMax = glm::vec3(0.0f);
+};
+
+struct Material {
+    unsigned int Shader = 0;       // index into Scene::Shaders
+    unsigned int Variant = 0;      // keyword bitmask of the shader variant
+    unsigned int Program = 0;      // resolved by CompileMaterials
+};
+
+struct SceneObject {
+    unsigned int MeshIndex = 0;
+    unsigned int MaterialIndex = 0;
+    glm::mat4 Model = glm::mat4(1.0f);
+    glm::vec4 Color = glm::vec4(1.0f);
+    bool Batched = false;          // drawn as part of a StaticBatch, not on its own
+};
+
+// Static objects of one material merged into a single indexed draw. Vertices
+// are already in world space, so the batch draws with the view-projection as
+// its u_MVP. Made by BuildStaticBatches.
+struct StaticBatch {
+    unsigned int Vao = 0;
+    unsigned int Mode = GL_TRIANGLES;
+    int Count = 0;                 // indices
+    unsigned int MaterialIndex = 0;    // the STATIC_BATCH variant of its objects' material
+    glm::vec3 BoundsMin = glm::vec3(0.0f);     // world space
+    glm::vec3 BoundsMax = glm::vec3(0.0f);
+};
+
+// Node of the cluster tree BuildStaticBatches makes per group of batches.
+// Leaves draw their batch; an inner node may have a proxy, its children's
+// geometry merged and simplified into one batch, which stands in for the
+// whole subtree while it is small on screen (see SelectBatches).
+struct BatchNode {
+    int Batch = -1;                // leaf batch or proxy; -1 when there is nothing to draw here
+    int Children[2] = { -1, -1 };  // -1 for leaves
+    // Inner nodes: a proxy was built. It may still have no batch when the
+    // whole cluster simplified away, being too small for any of it to show.
+    bool Proxy = false;
+    glm::vec3 BoundsMin = glm::vec3(0.0f);     // world space
+    glm::vec3 BoundsMax = glm::vec3(0.0f);
+    // The objects of the subtree: Scene::BatchObjects[FirstObject, FirstObject + ObjectCount)
+    unsigned int FirstObject = 0;
+    unsigned int ObjectCount = 0;
+};
+
+// Potentially visible set of the camera's cell, tested before the frustum
+// (see Pvs.h). Objects [FirstObject, FirstObject + ObjectCount) draw only when
+// their bit is set; objects outside that range are never gated.
+struct SceneVisibility {
+    const uint64_t* Objects = nullptr;     // null: nothing is gated
+    size_t FirstObject = 0;
+    size_t ObjectCount = 0;
+    int Cell = -1;                 // the set's cell in the scene file
+    // Per BatchNode: some object of its subtree is in the set. Empty draws them all.
+    std::vector<unsigned char> Nodes;
+};
+
+struct Scene {
+    std::vector<Mesh> Meshes;
+    std::vector<Material> Materials;
+    std::vector<SceneObject> Objects;
+    std::vector<StaticBatch> Batches;
+    std::vector<BatchNode> BatchNodes;
+    std::vector<unsigned int> BatchRoots;      // one tree per group
+    std::vector<unsigned int> BatchObjects;    // indices into Objects, each subtree's contiguous
+    SceneVisibility Visibility;
+    // Per object: drawn this frame by an impostor quad, not on its own (see
+    // Impostor.h). Objects past its end never are.
+    std::vector<unsigned char> ImpostorObjects;
+
+    // Owning handles for everything above; Mesh and Material keep plain ids
+    // so draw submission never touches ownership
+    std::vector<VertexArrayHandle> VertexArrays;
+    std::vector<BufferHandle> Buffers;
+    // Kept apart so a rebuild of the batches drops only their buffers
+    std::vector<VertexArrayHandle> BatchVertexArrays;
+    std::vector<BufferHandle> BatchBuffers;
+    // One entry per .shader file; each owns the programs of its variants
+    std::vector<std::unique_ptr<ShaderVariantSet>> Shaders;
+};
+
+// Everything needed to issue one draw, resolved ahead of submission so the
+// submit loop does no lookups. The object's ObjectData block has already been
+// written to the uniform ring at UniformOffset.
+struct DrawPacket {
+    unsigned int Program;
+    unsigned int Vao;
+    unsigned int Mode;
+    int First;
+    int Count;
+    bool Indexed;
+    size_t UniformOffset;
+};
+
+struct Frustum {
+    glm::vec4 Planes[6];
+};
+
+unsigned int AddMesh(Scene& scene, RenderBackend& backend, unsigned int mode,
+                     const float* positions, size_t floatCount,
+                     const unsigned int* indices = nullptr, size_t indexCount = 0);
+// Uploads new data for an existing mesh index and releases its old GL objects
+// through the deletion queue. Sub-meshes made from it still point at the old
+// vertex array; the caller re-points them.
+void ReplaceMesh(Scene& scene, RenderBackend& backend, unsigned int mesh, unsigned int mode,
+                 const float* positions, size_t floatCount,
+                 const unsigned int* indices = nullptr, size_t indexCount = 0);
+// Shares the vertex array of `mesh` but draws only [first, first + count)
+unsigned int AddSubMesh(Scene& scene, unsigned int mesh, int first, int count);
+// Registers a parsed .shader file; a path already in the scene returns the existing index
+unsigned int AddShader(Scene& scene, const std::string& path, ShaderProgramSource source);
+// The set registered for `path`, or null. Renderers that draw without
+// materials take their programs from here, so their sources load with the
+// scene's (from the asset pack when there is one).
+ShaderVariantSet* FindShader(Scene& scene, const std::string& path);
+// Materials are only registered here; CompileMaterials builds every variant
+// they need in one batch and resolves their programs. The path overload
+// parses the file synchronously if the scene does not have it yet.
+unsigned int AddMaterial(Scene& scene, const std::string& shaderPath, const std::vector<std::string>& keywords = {});
+unsigned int AddMaterial(Scene& scene, unsigned int shader, const std::vector<std::string>& keywords = {});
+void CompileMaterials(Scene& scene, RenderBackend& backend);
+// CompileMaterials in two halves, so other GL work (mesh uploads) can run
+// while the driver compiles. Nothing may draw with the materials in between.
+void BeginCompileMaterials(Scene& scene, RenderBackend& backend);
+void FinishCompileMaterials(Scene& scene, RenderBackend& backend);
+// Switches a material to another variant, compiling it on first use
+void SetMaterialVariant(Scene& scene, RenderBackend& backend, unsigned int material, unsigned int mask);
+void AddObject(Scene& scene, unsigned int mesh, unsigned int material,
+               const glm::mat4& model, const glm::vec4& color = glm::vec4(1.0f));
+// Releases the scene's GL objects through the backend's deletion queue
+void DestroyScene(Scene& scene);
+
+Frustum ExtractFrustum(const glm::mat4& viewProj);
+bool IsBoxVisible(const Frustum& frustum, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+// False only when the visibility set gates scene.Objects[object] out
+bool IsObjectPotentiallyVisible(const SceneVisibility& visibility, size_t object);
+
+// Culls the scene against its visibility set and viewProj and appends one
+// packet per visible object that is not batched or drawn as an impostor,
+// then one per entry of `batches`, which SelectBatches has already culled
+void BuildDrawPackets(const Scene& scene, const glm::mat4& viewProj, const std::pmr::vector<unsigned int>& batches,
+                      UniformRing& uniforms, std::pmr::vector<DrawPacket>& packets);
+void SubmitDrawPackets(RenderBackend& backend, const UniformRing& uniforms, const std::pmr::vector<DrawPacket>& packets);
+
+// Parallel alternative to BuildDrawPackets: every SCENE_CHUNK_SIZE objects,
+// then every SCENE_CHUNK_SIZE entries of `batches`, are recorded by one job
+// into chunks[i]. Replaying the chunks in order reproduces the
+// single-threaded draw order. Command storage comes from each worker's
+// sub-arena of `arena`.
+void RecordDrawCommands(const Scene& scene, const glm::mat4& viewProj, const std::pmr::vector<unsigned int>& batches,
+                        UniformRing& uniforms, JobSystem& jobs, FrameArena& arena, std::pmr::vector<CommandBuffer>& chunks);
@@ -0,0 +1,182 @@
+#include "SceneBinding.h"
+#include "HostMemory.h"
+#include "RenderBackend.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+static void UploadSceneMesh(Scene& scene, RenderBackend& backend, const SceneMeshDesc& mesh, unsigned int* replace) {
+    const unsigned int* indices = mesh.Indices.empty() ? nullptr : mesh.Indices.data();
+    if (replace)
+        ReplaceMesh(scene, backend, *replace, mesh.Mode, mesh.Positions.data(), mesh.Positions.size(), indices, mesh.Indices.size());
+    else
+        AddMesh(scene, backend, mesh.Mode, mesh.Positions.data(), mesh.Positions.size(), indices, mesh.Indices.size());
+}
+
+void AddSceneMaterials(Scene& scene, const SceneDesc& desc, SceneBinding& binding) {
+    binding.Materials.clear();
+    for (const SceneMaterialDesc& material : desc.Materials)
+        binding.Materials.push_back(AddMaterial(scene, material.Shader, material.Keywords));
+}
+
+void AddSceneMeshes(Scene& scene, RenderBackend& backend, const SceneDesc& desc, SceneBinding& binding) {
+    binding.Meshes.clear();
+    for (const SceneMeshDesc& mesh : desc.Meshes) {
+        if (mesh.Parent >= 0) {
+            binding.Meshes.push_back(AddSubMesh(scene, binding.Meshes[mesh.Parent], mesh.First, mesh.Count));
+        } else {
+            UploadSceneMesh(scene, backend, mesh, nullptr);
+            binding.Meshes.push_back(static_cast<unsigned int>(scene.Meshes.size() - 1));
+        }
+    }
+}
+
+void AddSceneObjects(Scene& scene, const SceneDesc& desc, SceneBinding& binding) {
+    MemoryTagScope tag(MemoryTag::Scene);
+    binding.FirstObject = scene.Objects.size();
+    binding.ObjectCount = desc.Objects.size();
+    scene.Objects.reserve(scene.Objects.size() + desc.Objects.size());
+    for (const SceneObjectDesc& object : desc.Objects)
+        AddObject(scene, binding.Meshes[object.Mesh], binding.Materials[object.Material], object.Model, object.Color);
+}
+
+// Names rather than indices, which differ between the two descs; with
+// `contents`, also the object's exact transform and color
+static std::string GetObjectKey(const SceneDesc& desc, const SceneObjectDesc& object, bool contents) {
+    std::string key = desc.Meshes[object.Mesh].Name;
+    key += '\0';
+    key += desc.Materials[object.Material].Name;
+    if (contents) {
+        key += '\0';
+        key.append(reinterpret_cast<const char*>(&object.Model), sizeof(object.Model));
+        key.append(reinterpret_cast<const char*>(&object.Color), sizeof(object.Color));
+    }
+    return key;
+}
+
+static bool SameMeshData(const SceneMeshDesc& a, const SceneMeshDesc& b) {
+    return a.Mode == b.Mode && a.Positions == b.Positions && a.Indices == b.Indices;
+}
+
+SceneReloadStats ApplySceneDesc(Scene& scene, RenderBackend& backend, const SceneDesc& current,
+                                const SceneDesc& next, SceneBinding& binding) {
+    MemoryTagScope tag(MemoryTag::Scene);
+    SceneReloadStats stats;
+
+    // Meshes: whole meshes are only uploaded when their data changed; parts
+    // are re-pointed at their (possibly new) parent every time, which is free
+    std::vector<unsigned int> meshes(next.Meshes.size());
+    for (size_t i = 0; i < next.Meshes.size(); i++) {
+        const SceneMeshDesc& mesh = next.Meshes[i];
+        int previous = current.FindMesh(mesh.Name);
+        bool wasPart = previous >= 0 && current.Meshes[previous].Parent >= 0;
+        if (mesh.Parent >= 0) {
+            Mesh part = scene.Meshes[meshes[mesh.Parent]];
+            part.First = mesh.First;
+            part.Count = mesh.Count;
+            if (previous >= 0 && wasPart) {
+                meshes[i] = binding.Meshes[previous];
+                scene.Meshes[meshes[i]] = part;
+            } else {
+                meshes[i] = AddSubMesh(scene, meshes[mesh.Parent], mesh.First, mesh.Count);
+            }
+        } else if (previous >= 0 && !wasPart) {
+            meshes[i] = binding.Meshes[previous];
+            if (!SameMeshData(current.Meshes[previous], mesh)) {
+                UploadSceneMesh(scene, backend, mesh, &meshes[i]);
+                stats.MeshesUploaded++;
+            }
+        } else {
+            UploadSceneMesh(scene, backend, mesh, nullptr);
+            meshes[i] = static_cast<unsigned int>(scene.Meshes.size() - 1);
+            stats.MeshesUploaded++;
+        }
+    }
+
+    // Materials: unchanged ones keep their index; anything else is added and compiled
+    std::vector<unsigned int> materials(next.Materials.size());
+    for (size_t i = 0; i < next.Materials.size(); i++) {
+        const SceneMaterialDesc& material = next.Materials[i];
+        int previous = current.FindMaterial(material.Name);
+        if (previous >= 0 && current.Materials[previous].Shader == material.Shader &&
+            current.Materials[previous].Keywords == material.Keywords) {
+            materials[i] = binding.Materials[previous];
+        } else {
+            materials[i] = AddMaterial(scene, material.Shader, material.Keywords);
+            stats.MaterialsAdded++;
+        }
+    }
+    if (stats.MaterialsAdded > 0)
+        CompileMaterials(scene, backend);
+
+    // Objects: the file has no ids for them, so each new object takes an
+    // old one with the same mesh and material names, preferring one that is
+    // otherwise identical too; inserting or removing an object then leaves
+    // the others untouched. Only new objects and ones whose resolved
+    // contents differ are rewritten.
+    std::unordered_map<std::string, std::vector<size_t>> identical, similar;
+    for (size_t i = binding.ObjectCount; i-- > 0;) {
+        identical[GetObjectKey(current, current.Objects[i], true)].push_back(i);
+        similar[GetObjectKey(current, current.Objects[i], false)].push_back(i);
+    }
+    std::vector<size_t> previous(next.Objects.size(), SIZE_MAX);
+    std::vector<bool> taken(binding.ObjectCount, false);
+    for (size_t i = 0; i < next.Objects.size(); i++) {
+        auto match = identical.find(GetObjectKey(next, next.Objects[i], true));
+        if (match == identical.end() || match->second.empty())
+            continue;
+        previous[i] = match->second.back();
+        taken[previous[i]] = true;
+        match->second.pop_back();
+    }
+    for (size_t i = 0; i < next.Objects.size(); i++) {
+        if (previous[i] != SIZE_MAX)
+            continue;
+        auto match = similar.find(GetObjectKey(next, next.Objects[i], false));
+        if (match == similar.end())
+            continue;
+        // Lists are in reverse, so the earliest old object left goes first
+        std::vector<size_t>& candidates = match->second;
+        while (!candidates.empty() && taken[candidates.back()])
+            candidates.pop_back();
+        if (candidates.empty())
+            continue;
+        previous[i] = candidates.back();
+        taken[previous[i]] = true;
+        candidates.pop_back();
+    }
+
+    std::vector<SceneObject> objects(next.Objects.size());
+    for (size_t i = 0; i < next.Objects.size(); i++) {
+        const SceneObjectDesc& object = next.Objects[i];
+        unsigned int mesh = meshes[object.Mesh];
+        unsigned int material = materials[object.Material];
+        if (previous[i] != SIZE_MAX) {
+            objects[i] = scene.Objects[binding.FirstObject + previous[i]];
+            stats.ObjectsMoved |= previous[i] != i;
+            if (objects[i].MeshIndex == mesh && objects[i].MaterialIndex == material &&
+                objects[i].Model == object.Model && objects[i].Color == object.Color)
+                continue;
+        }
+        objects[i] = { mesh, material, object.Model, object.Color };
+        stats.ObjectsUpdated++;
+    }
+    stats.ObjectsRemoved = binding.ObjectCount - (next.Objects.size() - static_cast<size_t>(std::count(previous.begin(), previous.end(), SIZE_MAX)));
+    auto first = scene.Objects.begin() + static_cast<std::ptrdiff_t>(binding.FirstObject);
+    scene.Objects.erase(first, first + static_cast<std::ptrdiff_t>(binding.ObjectCount));
+    scene.Objects.insert(scene.Objects.begin() + static_cast<std::ptrdiff_t>(binding.FirstObject), objects.begin(), objects.end());
+
+    const SceneCameraDesc& from = current.Camera;
+    const SceneCameraDesc& to = next.Camera;
+    stats.CameraChanged = from.Eye != to.Eye || from.Target != to.Target || from.Up != to.Up ||
+                          from.FovDegrees != to.FovDegrees || from.Near != to.Near || from.Far != to.Far;
+
+    binding.Meshes = std::move(meshes);
+    binding.Materials = std::move(materials);
+    binding.ObjectCount = next.Objects.size();
+    return stats;
+}
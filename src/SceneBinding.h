@@ -0,0 +1,43 @@
+#pragma once
+
+#include "SceneFile.h"
+
+#include <cstddef>
+#include <vector>
+
+class RenderBackend;
+struct Scene;
+
+// Scene indices each desc entry was instantiated as
+struct SceneBinding {
+    std::vector<unsigned int> Meshes;
+    std::vector<unsigned int> Materials;
+    size_t FirstObject = 0;
+    size_t ObjectCount = 0;
+};
+
+// Instantiation in the three halves the startup graph runs: materials (before
+// BeginCompileMaterials), meshes (GL uploads) and objects (after both)
+void AddSceneMaterials(Scene& scene, const SceneDesc& desc, SceneBinding& binding);
+void AddSceneMeshes(Scene& scene, RenderBackend& backend, const SceneDesc& desc, SceneBinding& binding);
+void AddSceneObjects(Scene& scene, const SceneDesc& desc, SceneBinding& binding);
+
+struct SceneReloadStats {
+    size_t MeshesUploaded = 0;
+    size_t MaterialsAdded = 0;
+    size_t ObjectsUpdated = 0;     // added, or matched to an old object that differed
+    size_t ObjectsRemoved = 0;
+    bool ObjectsMoved = false;     // some kept their contents but not their index
+    bool CameraChanged = false;
+};
+
+// Moves a scene instantiated from `current` to `next`, matching meshes and
+// materials by name: only meshes whose data changed are uploaded again, only
+// new material variants compile, and only objects that differ are rewritten.
+// Objects have no names, so an old one is matched to a new one with the same
+// mesh and material names, an identical one first, then in file order: edits,
+// inserts and removals rewrite just the objects concerned. The object range
+// keeps the new file's order.
+// Entries removed from the file stay allocated until the scene is destroyed.
+SceneReloadStats ApplySceneDesc(Scene& scene, RenderBackend& backend, const SceneDesc& current,
+                                const SceneDesc& next, SceneBinding& binding);
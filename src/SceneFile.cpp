@@ -0,0 +1,745 @@
+#include "SceneFile.h"
+#include "AssetPack.h"
+#include "HostMemory.h"
+#include "Json.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+
+#define SCENE_BINARY_MAGIC "MGLSCNB1"
+#define SCENE_BINARY_VERSION 4
+#define SCENE_PVS_MAGIC "MGLSPVS1"
+#define SCENE_PVS_VERSION 1
+
+int SceneDesc::FindMesh(const std::string& name) const {
+    for (size_t i = 0; i < Meshes.size(); i++) {
+        if (Meshes[i].Name == name)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+int SceneDesc::FindMaterial(const std::string& name) const {
+    for (size_t i = 0; i < Materials.size(); i++) {
+        if (Materials[i].Name == name)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+int SceneDesc::FindCell(const glm::vec3& point) const {
+    for (size_t i = 0; i < Cells.size(); i++) {
+        const SceneCellDesc& cell = Cells[i];
+        if (point.x >= cell.Min.x && point.y >= cell.Min.y && point.z >= cell.Min.z &&
+            point.x <= cell.Max.x && point.y <= cell.Max.y && point.z <= cell.Max.z)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// Heterogeneous lookup, so per-object name references hash a view of the text
+struct SceneNameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+};
+using SceneNameTable = std::unordered_map<std::string, uint32_t, SceneNameHash, std::equal_to<>>;
+
+// Objects may come before the meshes and materials they name, so references
+// are collected as ids into a table and resolved once the document is read
+static uint32_t ReferenceName(SceneNameTable& table, std::vector<std::string>& names, std::string_view name) {
+    auto it = table.find(name);
+    if (it != table.end())
+        return it->second;
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.emplace_back(name);
+    table.emplace(names.back(), id);
+    return id;
+}
+
+static bool ParseMode(JsonReader& json, unsigned int& mode) {
+    std::string name;
+    if (!json.ReadString(name))
+        return false;
+    if (name == "triangles") mode = GL_TRIANGLES;
+    else if (name == "lines") mode = GL_LINES;
+    else if (name == "line_strip") mode = GL_LINE_STRIP;
+    else if (name == "points") mode = GL_POINTS;
+    else return json.Fail(("unknown primitive mode " + name).c_str());
+    return true;
+}
+
+static bool ParseCamera(JsonReader& json, SceneCameraDesc& camera) {
+    if (!json.BeginObject())
+        return false;
+    std::string_view key;
+    while (json.NextMember(key)) {
+        bool ok;
+        if (key == "eye") ok = json.ReadFloats(&camera.Eye.x, 3);
+        else if (key == "target") ok = json.ReadFloats(&camera.Target.x, 3);
+        else if (key == "up") ok = json.ReadFloats(&camera.Up.x, 3);
+        else if (key == "fov") ok = json.ReadFloat(camera.FovDegrees);
+        else if (key == "near") ok = json.ReadFloat(camera.Near);
+        else if (key == "far") ok = json.ReadFloat(camera.Far);
+        else ok = json.Skip();
+        if (!ok)
+            return false;
+    }
+    return !json.Failed();
+}
+
+static bool ParseMesh(JsonReader& json, SceneDesc& desc) {
+    SceneMeshDesc mesh;
+    std::vector<SceneMeshDesc> parts;
+    if (!json.BeginObject())
+        return false;
+    std::string_view key;
+    while (json.NextMember(key)) {
+        bool ok;
+        if (key == "name") {
+            ok = json.ReadString(mesh.Name);
+        } else if (key == "mode") {
+            ok = ParseMode(json, mesh.Mode);
+        } else if (key == "positions") {
+            ok = json.ReadFloatArray(mesh.Positions);
+        } else if (key == "indices") {
+            ok = json.ReadUIntArray(mesh.Indices);
+        } else if (key == "parts") {
+            ok = json.BeginArray();
+            while (ok && json.NextElement()) {
+                SceneMeshDesc part;
+                ok = json.BeginObject();
+                std::string_view partKey;
+                while (ok && json.NextMember(partKey)) {
+                    if (partKey == "name") ok = json.ReadString(part.Name);
+                    else if (partKey == "first") ok = json.ReadInt(part.First);
+                    else if (partKey == "count") ok = json.ReadInt(part.Count);
+                    else ok = json.Skip();
+                }
+                parts.push_back(std::move(part));
+            }
+            ok = ok && !json.Failed();
+        } else {
+            ok = json.Skip();
+        }
+        if (!ok)
+            return false;
+    }
+    if (json.Failed())
+        return false;
+
+    if (mesh.Name.empty())
+        return json.Fail("mesh without a name");
+    if (mesh.Positions.empty() || mesh.Positions.size() % 3 != 0)
+        return json.Fail(("mesh " + mesh.Name + " needs positions in groups of three").c_str());
+    size_t vertices = mesh.Positions.size() / 3;
+    for (unsigned int index : mesh.Indices) {
+        if (index >= vertices)
+            return json.Fail(("mesh " + mesh.Name + " indexes past its positions").c_str());
+    }
+    size_t elements = mesh.Indices.empty() ? vertices : mesh.Indices.size();
+    for (SceneMeshDesc& part : parts) {
+        if (part.Name.empty() || part.First < 0 || part.Count <= 0 || static_cast<size_t>(part.First) + part.Count > elements)
+            return json.Fail(("part " + part.Name + " of mesh " + mesh.Name + " is out of range").c_str());
+    }
+
+    int parent = static_cast<int>(desc.Meshes.size());
+    unsigned int mode = mesh.Mode;
+    desc.Meshes.push_back(std::move(mesh));
+    for (SceneMeshDesc& part : parts) {
+        part.Parent = parent;
+        part.Mode = mode;
+        desc.Meshes.push_back(std::move(part));
+    }
+    return true;
+}
+
+static bool ParseMaterial(JsonReader& json, SceneDesc& desc) {
+    SceneMaterialDesc material;
+    if (!json.BeginObject())
+        return false;
+    std::string_view key;
+    while (json.NextMember(key)) {
+        bool ok;
+        if (key == "name") {
+            ok = json.ReadString(material.Name);
+        } else if (key == "shader") {
+            ok = json.ReadString(material.Shader);
+        } else if (key == "keywords") {
+            ok = json.BeginArray();
+            while (ok && json.NextElement()) {
+                std::string keyword;
+                ok = json.ReadString(keyword);
+                material.Keywords.push_back(std::move(keyword));
+            }
+            ok = ok && !json.Failed();
+        } else {
+            ok = json.Skip();
+        }
+        if (!ok)
+            return false;
+    }
+    if (json.Failed())
+        return false;
+    if (material.Name.empty() || material.Shader.empty())
+        return json.Fail("material needs a name and a shader");
+    desc.Materials.push_back(std::move(material));
+    return true;
+}
+
+static bool ParseCell(JsonReader& json, SceneDesc& desc) {
+    SceneCellDesc cell;
+    if (!json.BeginObject())
+        return false;
+    std::string_view key;
+    while (json.NextMember(key)) {
+        bool ok;
+        if (key == "name") ok = json.ReadString(cell.Name);
+        else if (key == "min") ok = json.ReadFloats(&cell.Min.x, 3);
+        else if (key == "max") ok = json.ReadFloats(&cell.Max.x, 3);
+        else ok = json.Skip();
+        if (!ok)
+            return false;
+    }
+    if (json.Failed())
+        return false;
+    if (cell.Min.x > cell.Max.x || cell.Min.y > cell.Max.y || cell.Min.z > cell.Max.z)
+        return json.Fail(("cell " + cell.Name + " has min above max").c_str());
+    desc.Cells.push_back(std::move(cell));
+    return true;
+}
+
+glm::mat4 CameraProjection(const SceneCameraDesc& camera, float aspect) {
+    return glm::perspective(glm::radians(camera.FovDegrees), aspect, camera.Near, camera.Far);
+}
+
+glm::mat4 ComposeTransform(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale) {
+    if (rotation == glm::vec3(0.0f) && scale == glm::vec3(1.0f)) {
+        // The common case for instance data: skip the matrix products
+        glm::mat4 model(1.0f);
+        model[3] = glm::vec4(position, 1.0f);
+        return model;
+    }
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+    model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    return glm::scale(model, scale);
+}
+
+struct SceneObjectRefs {
+    SceneNameTable MeshTable, MaterialTable;
+    std::vector<std::string> MeshNames, MaterialNames;
+};
+
+static bool ParseObject(JsonReader& json, SceneObjectRefs& refs, SceneDesc& desc) {
+    SceneObjectDesc object;
+    object.Mesh = object.Material = UINT32_MAX;
+    object.Color = glm::vec4(1.0f);
+    glm::vec3 position(0.0f), rotation(0.0f), scale(1.0f);
+    glm::mat4 matrix(1.0f);
+    bool hasMatrix = false;
+
+    if (!json.BeginObject())
+        return false;
+    std::string_view key;
+    std::string scratch;
+    while (json.NextMember(key)) {
+        bool ok;
+        if (key == "mesh" || key == "material") {
+            bool isMesh = key == "mesh";
+            std::string_view name;
+            ok = json.ReadString(name, scratch);
+            if (ok && isMesh)
+                object.Mesh = ReferenceName(refs.MeshTable, refs.MeshNames, name);
+            else if (ok)
+                object.Material = ReferenceName(refs.MaterialTable, refs.MaterialNames, name);
+        } else if (key == "position") {
+            ok = json.ReadFloats(&position.x, 3);
+        } else if (key == "rotation") {
+            ok = json.ReadFloats(&rotation.x, 3);
+        } else if (key == "scale") {
+            if (json.Peek() == '[') {
+                ok = json.ReadFloats(&scale.x, 3);
+            } else {
+                float uniform = 1.0f;
+                ok = json.ReadFloat(uniform);
+                scale = glm::vec3(uniform);
+            }
+        } else if (key == "matrix") {
+            ok = json.ReadFloats(&matrix[0][0], 16);
+            hasMatrix = true;
+        } else if (key == "color") {
+            ok = json.ReadFloats(&object.Color.x, 4);
+        } else {
+            ok = json.Skip();
+        }
+        if (!ok)
+            return false;
+    }
+    if (json.Failed())
+        return false;
+    if (object.Mesh == UINT32_MAX || object.Material == UINT32_MAX)
+        return json.Fail("object needs a mesh and a material");
+
+    object.Model = hasMatrix ? matrix : ComposeTransform(position, rotation, scale);
+    desc.Objects.push_back(object);
+    return true;
+}
+
+static bool ParseArray(JsonReader& json, const std::function<bool()>& element) {
+    if (!json.BeginArray())
+        return false;
+    while (json.NextElement()) {
+        if (!element())
+            return false;
+    }
+    return !json.Failed();
+}
+
+bool ParseSceneJson(const char* text, size_t size, SceneDesc& desc, std::string& error) {
+    desc = SceneDesc();
+    JsonReader json(text, size);
+    SceneObjectRefs refs;
+    bool ok = json.Parse() && json.BeginObject();
+    std::string_view key;
+    while (ok && json.NextMember(key)) {
+        if (key == "camera")
+            ok = ParseCamera(json, desc.Camera);
+        else if (key == "meshes")
+            ok = ParseArray(json, [&] { return ParseMesh(json, desc); });
+        else if (key == "materials")
+            ok = ParseArray(json, [&] { return ParseMaterial(json, desc); });
+        else if (key == "objects") {
+            // A rough guess from the remaining text saves most regrowth for huge scenes
+            if (desc.Objects.empty())
+                desc.Objects.reserve(json.GetTokenCount() / 24);
+            ok = ParseArray(json, [&] { return ParseObject(json, refs, desc); });
+        } else if (key == "cells")
+            ok = ParseArray(json, [&] { return ParseCell(json, desc); });
+        else
+            ok = json.Skip();
+    }
+    if (ok && !json.Failed() && json.Peek() != '\0')
+        json.Fail("trailing data after the scene");
+    if (json.Failed()) {
+        error = json.GetError();
+        return false;
+    }
+
+    // Resolve the name references now that every mesh and material is known
+    std::vector<uint32_t> meshes, materials;
+    for (const std::string& name : refs.MeshNames) {
+        int mesh = desc.FindMesh(name);
+        if (mesh < 0) {
+            error = "unknown mesh " + name;
+            return false;
+        }
+        meshes.push_back(static_cast<uint32_t>(mesh));
+    }
+    for (const std::string& name : refs.MaterialNames) {
+        int material = desc.FindMaterial(name);
+        if (material < 0) {
+            error = "unknown material " + name;
+            return false;
+        }
+        materials.push_back(static_cast<uint32_t>(material));
+    }
+    for (SceneObjectDesc& object : desc.Objects) {
+        object.Mesh = meshes[object.Mesh];
+        object.Material = materials[object.Material];
+    }
+    return true;
+}
+
+struct SceneBinaryHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t ObjectSize;           // sizeof(SceneObjectDesc) of the writer
+    uint64_t SourceSize;
+    int64_t SourceModified;
+    uint32_t MeshCount;
+    uint32_t MaterialCount;
+    uint64_t ObjectCount;
+    uint32_t CellCount;
+    SceneCameraDesc Camera;
+};
+
+struct ScenePvsHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t CellCount;
+    uint64_t ObjectCount;
+    uint64_t Fingerprint;          // GetSceneFingerprint of the scene the sets were baked for
+};
+
+static std::string GetSceneCachePath(const std::string& path) {
+    // FNV-1a of the path: one twin per source file
+    unsigned long long hash = 14695981039346656037ull;
+    for (unsigned char c : path)
+        hash = (hash ^ c) * 1099511628211ull;
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", hash);
+    return std::string(SCENE_CACHE_DIRECTORY) + "/" + name;
+}
+
+static void WriteBytes(std::ofstream& out, const void* data, size_t size) {
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+}
+
+static void WriteString(std::ofstream& out, const std::string& value) {
+    uint32_t length = static_cast<uint32_t>(value.size());
+    WriteBytes(out, &length, sizeof(length));
+    WriteBytes(out, value.data(), value.size());
+}
+
+static bool WriteSceneBinary(const std::string& path, const SceneDesc& desc, uint64_t sourceSize, int64_t sourceModified) {
+    std::error_code error;
+    std::filesystem::create_directories(SCENE_CACHE_DIRECTORY, error);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    SceneBinaryHeader header = {};
+    std::memcpy(header.Magic, SCENE_BINARY_MAGIC, sizeof(header.Magic));
+    header.Version = SCENE_BINARY_VERSION;
+    header.ObjectSize = sizeof(SceneObjectDesc);
+    header.SourceSize = sourceSize;
+    header.SourceModified = sourceModified;
+    header.MeshCount = static_cast<uint32_t>(desc.Meshes.size());
+    header.MaterialCount = static_cast<uint32_t>(desc.Materials.size());
+    header.ObjectCount = desc.Objects.size();
+    header.CellCount = static_cast<uint32_t>(desc.Cells.size());
+    header.Camera = desc.Camera;
+    WriteBytes(out, &header, sizeof(header));
+
+    for (const SceneMeshDesc& mesh : desc.Meshes) {
+        WriteString(out, mesh.Name);
+        int32_t fields[4] = { static_cast<int32_t>(mesh.Mode), mesh.Parent, mesh.First, mesh.Count };
+        WriteBytes(out, fields, sizeof(fields));
+        uint64_t counts[2] = { mesh.Positions.size(), mesh.Indices.size() };
+        WriteBytes(out, counts, sizeof(counts));
+        WriteBytes(out, mesh.Positions.data(), mesh.Positions.size() * sizeof(float));
+        WriteBytes(out, mesh.Indices.data(), mesh.Indices.size() * sizeof(unsigned int));
+    }
+    for (const SceneMaterialDesc& material : desc.Materials) {
+        WriteString(out, material.Name);
+        WriteString(out, material.Shader);
+        uint32_t keywords = static_cast<uint32_t>(material.Keywords.size());
+        WriteBytes(out, &keywords, sizeof(keywords));
+        for (const std::string& keyword : material.Keywords)
+            WriteString(out, keyword);
+    }
+    WriteBytes(out, desc.Objects.data(), desc.Objects.size() * sizeof(SceneObjectDesc));
+    for (const SceneCellDesc& cell : desc.Cells) {
+        WriteString(out, cell.Name);
+        WriteBytes(out, &cell.Min.x, 3 * sizeof(float));
+        WriteBytes(out, &cell.Max.x, 3 * sizeof(float));
+    }
+    return static_cast<bool>(out);
+}
+
+// Bounds-checked cursor over the twin's bytes
+struct SceneBinaryReader {
+    const char* Data;
+    size_t Size;
+    size_t Offset = 0;
+
+    bool Read(void* out, size_t size) {
+        if (Size - Offset < size)
+            return false;
+        // Empty vectors have no storage to copy into
+        if (size == 0)
+            return true;
+        std::memcpy(out, Data + Offset, size);
+        Offset += size;
+        return true;
+    }
+    bool ReadString(std::string& out) {
+        uint32_t length;
+        if (!Read(&length, sizeof(length)) || Size - Offset < length)
+            return false;
+        out.assign(Data + Offset, length);
+        Offset += length;
+        return true;
+    }
+    template<typename T>
+    bool ReadVector(std::vector<T>& out, uint64_t count) {
+        if ((Size - Offset) / sizeof(T) < count)
+            return false;
+        out.resize(count);
+        return Read(out.data(), count * sizeof(T));
+    }
+};
+
+// What ParseMesh guarantees about meshes[index], for meshes read from the twin:
+// everything downstream indexes parents, parts and positions without checks
+static bool IsValidMesh(const std::vector<SceneMeshDesc>& meshes, size_t index) {
+    const SceneMeshDesc& mesh = meshes[index];
+    if (mesh.Mode != GL_TRIANGLES && mesh.Mode != GL_LINES && mesh.Mode != GL_LINE_STRIP && mesh.Mode != GL_POINTS)
+        return false;
+    if (mesh.Parent < 0) {
+        if (mesh.Parent != -1 || mesh.Name.empty() || mesh.Positions.empty() || mesh.Positions.size() % 3 != 0)
+            return false;
+        size_t vertices = mesh.Positions.size() / 3;
+        for (unsigned int i : mesh.Indices) {
+            if (i >= vertices)
+                return false;
+        }
+        return true;
+    }
+    // Parts come after their parent, which is a whole mesh
+    if (static_cast<size_t>(mesh.Parent) >= index || !mesh.Positions.empty() || !mesh.Indices.empty())
+        return false;
+    const SceneMeshDesc& parent = meshes[mesh.Parent];
+    size_t elements = parent.Indices.empty() ? parent.Positions.size() / 3 : parent.Indices.size();
+    return parent.Parent == -1 && parent.Mode == mesh.Mode && !mesh.Name.empty() && mesh.First >= 0 && mesh.Count > 0 &&
+           static_cast<size_t>(mesh.First) + static_cast<size_t>(mesh.Count) <= elements;
+}
+
+// Anything that does not check out makes the twin stale, and the JSON is read instead
+static bool ReadSceneBinary(const std::string& path, uint64_t sourceSize, int64_t sourceModified, SceneDesc& desc) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        return false;
+    std::string data(static_cast<size_t>(in.tellg()), '\0');
+    in.seekg(0);
+    if (!in.read(data.data(), static_cast<std::streamsize>(data.size())))
+        return false;
+
+    SceneBinaryReader reader{ data.data(), data.size() };
+    SceneBinaryHeader header;
+    if (!reader.Read(&header, sizeof(header)) || std::memcmp(header.Magic, SCENE_BINARY_MAGIC, sizeof(header.Magic)) != 0 ||
+        header.Version != SCENE_BINARY_VERSION || header.ObjectSize != sizeof(SceneObjectDesc) ||
+        header.SourceSize != sourceSize || header.SourceModified != sourceModified)
+        return false;
+
+    desc = SceneDesc();
+    desc.Camera = header.Camera;
+    // Counts are clamped to what the remaining bytes could hold before anything is allocated
+    desc.Meshes.resize(std::min<size_t>(header.MeshCount, reader.Size - reader.Offset));
+    for (SceneMeshDesc& mesh : desc.Meshes) {
+        int32_t fields[4];
+        uint64_t counts[2];
+        if (!reader.ReadString(mesh.Name) || !reader.Read(fields, sizeof(fields)) || !reader.Read(counts, sizeof(counts)) ||
+            !reader.ReadVector(mesh.Positions, counts[0]) || !reader.ReadVector(mesh.Indices, counts[1]))
+            return false;
+        mesh.Mode = static_cast<unsigned int>(fields[0]);
+        mesh.Parent = fields[1];
+        mesh.First = fields[2];
+        mesh.Count = fields[3];
+        if (!IsValidMesh(desc.Meshes, static_cast<size_t>(&mesh - desc.Meshes.data())))
+            return false;
+    }
+    desc.Materials.resize(std::min<size_t>(header.MaterialCount, reader.Size - reader.Offset));
+    for (SceneMaterialDesc& material : desc.Materials) {
+        uint32_t keywords;
+        if (!reader.ReadString(material.Name) || !reader.ReadString(material.Shader) || !reader.Read(&keywords, sizeof(keywords)) ||
+            material.Name.empty() || material.Shader.empty())
+            return false;
+        material.Keywords.resize(std::min<size_t>(keywords, reader.Size - reader.Offset));
+        for (std::string& keyword : material.Keywords) {
+            if (!reader.ReadString(keyword))
+                return false;
+        }
+    }
+    if (!reader.ReadVector(desc.Objects, header.ObjectCount))
+        return false;
+    desc.Cells.resize(std::min<size_t>(header.CellCount, reader.Size - reader.Offset));
+    for (SceneCellDesc& cell : desc.Cells) {
+        if (!reader.ReadString(cell.Name) || !reader.Read(&cell.Min.x, 3 * sizeof(float)) ||
+            !reader.Read(&cell.Max.x, 3 * sizeof(float)) ||
+            cell.Min.x > cell.Max.x || cell.Min.y > cell.Max.y || cell.Min.z > cell.Max.z)
+            return false;
+    }
+    if (reader.Offset != reader.Size || desc.Meshes.size() != header.MeshCount || desc.Materials.size() != header.MaterialCount ||
+        desc.Cells.size() != header.CellCount)
+        return false;
+    for (const SceneObjectDesc& object : desc.Objects) {
+        if (object.Mesh >= desc.Meshes.size() || object.Material >= desc.Materials.size())
+            return false;
+    }
+    return true;
+}
+
+// FNV-1a over 64-bit words, for fingerprints of whole arrays
+static uint64_t HashWords(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (; size >= 8; bytes += 8, size -= 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    for (; size > 0; bytes++, size--)
+        hash = (hash ^ *bytes) * 1099511628211ull;
+    return hash;
+}
+
+// Everything visibility depends on: the geometry, where each object puts
+// its mesh, and the cells. Colors, materials and the camera may change
+// without a new bake.
+static uint64_t GetSceneFingerprint(const SceneDesc& desc) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const SceneMeshDesc& mesh : desc.Meshes) {
+        int32_t fields[4] = { static_cast<int32_t>(mesh.Mode), mesh.Parent, mesh.First, mesh.Count };
+        hash = HashWords(hash, fields, sizeof(fields));
+        hash = HashWords(hash, mesh.Positions.data(), mesh.Positions.size() * sizeof(float));
+        hash = HashWords(hash, mesh.Indices.data(), mesh.Indices.size() * sizeof(unsigned int));
+    }
+    for (const SceneObjectDesc& object : desc.Objects) {
+        hash = HashWords(hash, &object.Mesh, sizeof(object.Mesh));
+        hash = HashWords(hash, &object.Model, sizeof(object.Model));
+    }
+    for (const SceneCellDesc& cell : desc.Cells) {
+        hash = HashWords(hash, &cell.Min.x, 3 * sizeof(float));
+        hash = HashWords(hash, &cell.Max.x, 3 * sizeof(float));
+    }
+    return hash;
+}
+
+static std::string GetScenePvsPath(const std::string& path) {
+    return path + SCENE_PVS_EXTENSION;
+}
+
+// Fills desc.Pvs from the scene's sidecar when there is one baked for exactly this scene
+static void LoadScenePvs(const std::string& path, const AssetPack* pack, SceneDesc& desc) {
+    desc.Pvs.clear();
+    if (desc.Cells.empty())
+        return;
+    std::string pvsPath = GetScenePvsPath(path);
+    std::string data;
+    if (pack && pack->Find(pvsPath)) {
+        if (!pack->Read(pvsPath, data, nullptr))
+            return;
+    } else {
+        std::ifstream in(pvsPath, std::ios::binary | std::ios::ate);
+        if (!in)
+            return;
+        data.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        if (!in.read(data.data(), static_cast<std::streamsize>(data.size())))
+            return;
+    }
+
+    SceneBinaryReader reader{ data.data(), data.size() };
+    ScenePvsHeader header;
+    if (!reader.Read(&header, sizeof(header)) || std::memcmp(header.Magic, SCENE_PVS_MAGIC, sizeof(header.Magic)) != 0 ||
+        header.Version != SCENE_PVS_VERSION) {
+        std::cout << "[Scene File] " << pvsPath << " is not a visibility file" << std::endl;
+        return;
+    }
+    if (header.CellCount != desc.Cells.size() || header.ObjectCount != desc.Objects.size() ||
+        header.Fingerprint != GetSceneFingerprint(desc)) {
+        std::cout << "[Scene File] " << pvsPath << " was baked for an older " << path << "; run PvsBake" << std::endl;
+        return;
+    }
+    if (!reader.ReadVector(desc.Pvs, desc.Cells.size() * desc.GetPvsWords()) || reader.Offset != reader.Size)
+        desc.Pvs.clear();
+}
+
+bool LoadSceneDesc(const std::string& path, const AssetPack* pack, SceneDesc& desc) {
+    MemoryTagScope tag(MemoryTag::Scene);
+    auto start = std::chrono::steady_clock::now();
+    std::string text;
+    std::string error;
+    const char* source = "json";
+
+    if (pack && pack->Find(path)) {
+        // Packs are rebuilt offline and already compact; no twin. The
+        // visibility sidecar is packed with the scene.
+        source = "pack";
+        if (!pack->Read(path, text, nullptr))
+            return false;
+        if (!ParseSceneJson(text.data(), text.size(), desc, error)) {
+            std::cout << "[Scene File] " << path << ": " << error << std::endl;
+            return false;
+        }
+    } else {
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(path, ec);
+        int64_t modified = ec ? 0 : static_cast<int64_t>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+        if (ec) {
+            std::cout << "[Scene File] cannot read " << path << std::endl;
+            return false;
+        }
+
+        std::string cachePath = GetSceneCachePath(path);
+        if (ReadSceneBinary(cachePath, size, modified, desc)) {
+            source = "binary twin";
+        } else {
+            std::ifstream in(path, std::ios::binary);
+            text.resize(size);
+            if (!in.read(text.data(), static_cast<std::streamsize>(size))) {
+                std::cout << "[Scene File] cannot read " << path << std::endl;
+                return false;
+            }
+            if (!ParseSceneJson(text.data(), text.size(), desc, error)) {
+                std::cout << "[Scene File] " << path << ": " << error << std::endl;
+                return false;
+            }
+            WriteSceneBinary(cachePath, desc, size, modified);
+        }
+    }
+
+    LoadScenePvs(path, pack, desc);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[Scene File] " << path << " (" << source << "): " << desc.Meshes.size() << " mesh(es), "
+              << desc.Materials.size() << " material(s), " << desc.Objects.size() << " object(s)";
+    if (!desc.Cells.empty())
+        std::cout << ", " << desc.Cells.size() << " cell(s)" << (desc.HasPvs() ? " with visibility" : "");
+    std::cout << " in " << ms << " ms" << std::endl;
+    return true;
+}
+
+bool WriteScenePvs(const std::string& path, const SceneDesc& desc) {
+    std::string pvsPath = GetScenePvsPath(path);
+    std::ofstream out(pvsPath, std::ios::binary | std::ios::trunc);
+    if (!desc.HasPvs() || !out) {
+        std::cout << "[Scene File] cannot write " << pvsPath << std::endl;
+        return false;
+    }
+    ScenePvsHeader header = {};
+    std::memcpy(header.Magic, SCENE_PVS_MAGIC, sizeof(header.Magic));
+    header.Version = SCENE_PVS_VERSION;
+    header.CellCount = static_cast<uint32_t>(desc.Cells.size());
+    header.ObjectCount = desc.Objects.size();
+    header.Fingerprint = GetSceneFingerprint(desc);
+    WriteBytes(out, &header, sizeof(header));
+    // One bit per object and cell: a few KB even for thousands of each
+    WriteBytes(out, desc.Pvs.data(), desc.Pvs.size() * sizeof(uint64_t));
+    return static_cast<bool>(out);
+}
+
+SceneFileWatcher::SceneFileWatcher(std::string path)
+    : m_Path(std::move(path)), m_NextPoll(std::chrono::steady_clock::now()) {
+    std::error_code error;
+    m_Size = std::filesystem::file_size(m_Path, error);
+    if (!error)
+        m_ModifiedNs = static_cast<int64_t>(std::filesystem::last_write_time(m_Path, error).time_since_epoch().count());
+}
+
+bool SceneFileWatcher::Poll() {
+    auto now = std::chrono::steady_clock::now();
+    if (now < m_NextPoll)
+        return false;
+    m_NextPoll = now + std::chrono::milliseconds(SCENE_RELOAD_POLL_MS);
+
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(m_Path, error);
+    if (error)
+        return false;
+    int64_t modified = static_cast<int64_t>(std::filesystem::last_write_time(m_Path, error).time_since_epoch().count());
+    if (error || (modified == m_ModifiedNs && size == m_Size))
+        return false;
+    m_ModifiedNs = modified;
+    m_Size = size;
+    return true;
+}
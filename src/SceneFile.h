@@ -0,0 +1,138 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class AssetPack;
+
+// Loaded at startup when no --scene is given
+#define SCENE_DEFAULT_PATH "res/scenes/Default.scene"
+// Binary twins of loose scene files, rebuilt whenever the source changes
+#define SCENE_CACHE_DIRECTORY "scene_cache"
+// Baked visibility sets, next to their .scene file (Rooms.scene.pvs), so
+// asset packs built from the directory carry them
+#define SCENE_PVS_EXTENSION ".pvs"
+// How often SceneFileWatcher looks at the file's modification time
+#define SCENE_RELOAD_POLL_MS 250
+
+// In-memory form of a .scene file (JSON):
+//
+//     {
+//         "camera":    { "eye": [x, y, z], "target": [x, y, z], "up": [x, y, z],
+//                        "fov": degrees, "near": n, "far": f },
+//         "meshes":    [ { "name": "Cube", "mode": "triangles" | "lines",
+//                          "positions": [x, y, z, ...], "indices": [...],
+//                          "parts": [ { "name": "Edge", "first": 0, "count": 2 } ] } ],
+//         "materials": [ { "name": "Lit", "shader": "res/shaders/Cube.shader", "keywords": [...] } ],
+//         "objects":   [ { "mesh": "Cube", "material": "Lit", "position": [x, y, z],
+//                          "rotation": [x, y, z] (degrees), "scale": s | [x, y, z],
+//                          "matrix": [16 floats, column major], "color": [r, g, b, a] } ],
+//         "cells":     [ { "name": "Hall", "min": [x, y, z], "max": [x, y, z] } ]
+//     }
+//
+// Parts become sub-meshes drawing a range of their mesh; objects refer to
+// meshes, parts and materials by name. Unknown keys are ignored.
+//
+// Cells are boxes the camera can be in, for visibility: PvsBake computes
+// which objects can be seen from each and stores that in a sidecar file
+// (see SceneDesc::Pvs and SCENE_PVS_EXTENSION). The JSON itself never
+// carries the sets.
+struct SceneCameraDesc {
+    glm::vec3 Eye = glm::vec3(5.0f, 3.0f, 5.0f);
+    glm::vec3 Target = glm::vec3(0.0f);
+    glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
+    float FovDegrees = 45.0f;      // vertical
+    float Near = 0.1f;
+    float Far = 100.0f;
+};
+
+// The rasterizer's projection; the path tracer shoots its rays through the same one
+glm::mat4 CameraProjection(const SceneCameraDesc& camera, float aspect);
+
+struct SceneMeshDesc {
+    std::string Name;
+    unsigned int Mode = GL_TRIANGLES;
+    int Parent = -1;               // parts: the mesh whose buffers they draw from
+    int First = 0;                 // parts: first vertex, or first index when indexed
+    int Count = 0;                 // parts only
+    std::vector<float> Positions;
+    std::vector<unsigned int> Indices;
+};
+
+struct SceneMaterialDesc {
+    std::string Name;
+    std::string Shader;
+    std::vector<std::string> Keywords;
+};
+
+// Plain data so a million of them load from the binary twin in one read
+struct SceneObjectDesc {
+    uint32_t Mesh;                 // index into SceneDesc::Meshes
+    uint32_t Material;             // index into SceneDesc::Materials
+    glm::mat4 Model;
+    glm::vec4 Color;
+};
+
+struct SceneCellDesc {
+    std::string Name;
+    glm::vec3 Min = glm::vec3(0.0f);
+    glm::vec3 Max = glm::vec3(0.0f);
+};
+
+struct SceneDesc {
+    SceneCameraDesc Camera;
+    std::vector<SceneMeshDesc> Meshes;
+    std::vector<SceneMaterialDesc> Materials;
+    std::vector<SceneObjectDesc> Objects;
+    std::vector<SceneCellDesc> Cells;
+    // Potentially visible sets: GetPvsWords() words per cell, bit i of a
+    // cell's set for Objects[i]. Empty unless baked for exactly these cells,
+    // objects and meshes; then nothing is known and everything may be visible.
+    std::vector<uint64_t> Pvs;
+
+    // -1 when there is no such entry
+    int FindMesh(const std::string& name) const;
+    int FindMaterial(const std::string& name) const;
+    // First cell containing `point`; -1 when it is in none
+    int FindCell(const glm::vec3& point) const;
+
+    size_t GetPvsWords() const { return (Objects.size() + 63) / 64; }
+    bool HasPvs() const { return !Cells.empty() && Pvs.size() == Cells.size() * GetPvsWords(); }
+    // The set of `cell`, GetPvsWords() words; only when HasPvs()
+    const uint64_t* GetCellPvs(int cell) const { return Pvs.data() + static_cast<size_t>(cell) * GetPvsWords(); }
+};
+
+// Model matrix from an object's position, rotation (degrees; yaw, then pitch,
+// then roll) and scale
+glm::mat4 ComposeTransform(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale);
+
+bool ParseSceneJson(const char* text, size_t size, SceneDesc& desc, std::string& error);
+// Loads from the pack when it has `path`; loose files go through their binary
+// twin when it is current and refresh it when not. The visibility sidecar
+// comes from the same place as the scene, and is dropped (with a note) when
+// it was baked for different geometry. Logs and returns false on errors.
+bool LoadSceneDesc(const std::string& path, const AssetPack* pack, SceneDesc& desc);
+// Writes desc.Pvs to the visibility sidecar of the loose file `path`, for
+// PvsBake. Edits to the scene that move geometry or cells make it stale.
+bool WriteScenePvs(const std::string& path, const SceneDesc& desc);
+
+// Polls a file's modification time for hot reload
+class SceneFileWatcher {
+public:
+    explicit SceneFileWatcher(std::string path);
+
+    // True once per change; checks at most every SCENE_RELOAD_POLL_MS
+    bool Poll();
+    const std::string& GetPath() const { return m_Path; }
+
+private:
+    std::string m_Path;
+    int64_t m_ModifiedNs = 0;
+    uint64_t m_Size = 0;
+    std::chrono::steady_clock::time_point m_NextPoll;
+};
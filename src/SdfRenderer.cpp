@@ -0,0 +1,299 @@
+#include "SdfRenderer.h"
+#include "RenderBackend.h"
+#include "UniformRing.h"
+#include "ShaderLayouts.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+// Texels per primitive in the primitive texture: three world-to-local rows,
+// the shape, the material
+#define SDF_PRIMITIVE_TEXELS 5
+
+SdfPrimitive MakeSdfPrimitive(SdfShape shape, const glm::mat4& model, const glm::vec4& color, float blend) {
+    glm::vec3 scale(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])));
+    glm::mat4 rigid = model;
+    for (int axis = 0; axis < 3; axis++)
+        rigid[axis] = model[axis] / std::max(scale[axis], 1e-12f);
+
+    SdfPrimitive primitive;
+    primitive.Shape = shape;
+    primitive.WorldToLocal = glm::inverse(rigid);
+    primitive.Color = color;
+    primitive.Blend = blend;
+    if (shape == SdfShape::Box) {
+        primitive.Size = scale * 0.5f;
+    } else if (shape == SdfShape::Pyramid) {
+        float base = 0.5f * (scale.x + scale.z);
+        primitive.Size = glm::vec3(base, scale.y / base, 0.0f);
+    } else {
+        primitive.Size = glm::vec3(0.5f * std::max(scale.x, std::max(scale.y, scale.z)), 0.0f, 0.0f);
+    }
+    return primitive;
+}
+
+// World-space box around everything the primitive's surface can blend into
+static void GetPrimitiveBounds(const SdfPrimitive& primitive, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+    glm::vec3 localMin, localMax;
+    if (primitive.Shape == SdfShape::Box) {
+        localMin = -primitive.Size;
+        localMax = primitive.Size;
+    } else if (primitive.Shape == SdfShape::Pyramid) {
+        float half = 0.5f * primitive.Size.x;
+        localMin = glm::vec3(-half, 0.0f, -half);
+        localMax = glm::vec3(half, primitive.Size.x * primitive.Size.y, half);
+    } else {
+        localMin = glm::vec3(-primitive.Size.x);
+        localMax = glm::vec3(primitive.Size.x);
+    }
+
+    glm::mat4 localToWorld = glm::inverse(primitive.WorldToLocal);
+    glm::vec3 center = glm::vec3(localToWorld * glm::vec4((localMin + localMax) * 0.5f, 1.0f));
+    glm::vec3 half = (localMax - localMin) * 0.5f;
+    glm::vec3 extent(0.0f);
+    for (int axis = 0; axis < 3; axis++)
+        extent += glm::abs(glm::vec3(localToWorld[axis])) * half[axis];
+    extent += glm::vec3(primitive.Blend);
+    boundsMin = center - extent;
+    boundsMax = center + extent;
+}
+
+// Texture of SDF_TEXTURE_WIDTH-wide rows holding `texels` texels; never empty,
+// so samplers always have something to read
+template<typename T>
+static TextureHandle CreateDataTexture(RenderBackend& backend, unsigned int internalFormat, int channels,
+                                       std::vector<T>& data, size_t& bytes) {
+    size_t texels = std::max<size_t>(data.size() / channels, 1);
+    int height = static_cast<int>((texels + SDF_TEXTURE_WIDTH - 1) / SDF_TEXTURE_WIDTH);
+    data.resize(static_cast<size_t>(SDF_TEXTURE_WIDTH) * height * channels);
+    bytes += data.size() * sizeof(T);
+    return TextureHandle(backend, backend.CreateTexture(internalFormat, SDF_TEXTURE_WIDTH, height, data.data()));
+}
+
+bool SdfRenderer::Init(RenderBackend& backend, ShaderVariantSet& shader) {
+    if (shader.GetSource().VertexSource.empty() || shader.GetSource().FragmentSource.empty()) {
+        std::cout << "[SDF] cannot load " << shader.GetPath() << std::endl;
+        return false;
+    }
+    m_Shader = &shader;
+    m_PrepassMask = m_Shader->GetKeywordMask({ "CONE_PREPASS" });
+    m_Shader->Request(0);
+    m_Shader->Request(m_PrepassMask);
+    CompileRequestedVariants(backend, { m_Shader });
+
+    unsigned int masks[2] = { 0, m_PrepassMask };
+    for (int i = 0; i < 2; i++) {
+        unsigned int program = m_Shader->Get(masks[i]);
+        if (program == 0)
+            return false;
+        backend.BindUniformBlock(program, SdfFrame::Name, SdfFrame::Binding);
+        backend.UseProgram(program);
+        backend.SetUniform1i(backend.GetUniformLocation(program, "u_Primitives"), 0);
+        backend.SetUniform1i(backend.GetUniformLocation(program, "u_Cells"), 1);
+        backend.SetUniform1i(backend.GetUniformLocation(program, "u_Entries"), 2);
+        backend.SetUniform1i(backend.GetUniformLocation(program, "u_Start"), 3);
+        m_PassLocation[i] = backend.GetUniformLocation(program, "u_Pass");
+    }
+    backend.UseProgram(0);
+
+    const float corners[] = { -1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f };
+    m_Triangle = VertexArrayHandle(backend, backend.CreateVertexArray());
+    backend.BindVertexArray(m_Triangle.Get());
+    m_TriangleBuffer = BufferHandle(backend, backend.CreateBuffer(GL_ARRAY_BUFFER, corners, sizeof(corners), GL_STATIC_DRAW));
+    backend.VertexAttribPointer(0, 2, GL_FLOAT, 0, 0);
+    backend.BindVertexArray(0);
+
+    std::vector<SdfPrimitive> none;
+    SetPrimitives(backend, none);
+    return true;
+}
+
+void SdfRenderer::SetPrimitives(RenderBackend& backend, const std::vector<SdfPrimitive>& primitives) {
+    auto start = std::chrono::steady_clock::now();
+    m_Stats = SdfStats();
+    m_Stats.Primitives = primitives.size();
+
+    std::vector<glm::vec3> mins(primitives.size()), maxs(primitives.size());
+    glm::vec3 sceneMin(1e30f), sceneMax(-1e30f);
+    for (size_t i = 0; i < primitives.size(); i++) {
+        GetPrimitiveBounds(primitives[i], mins[i], maxs[i]);
+        sceneMin = glm::min(sceneMin, mins[i]);
+        sceneMax = glm::max(sceneMax, maxs[i]);
+    }
+    if (primitives.empty()) {
+        sceneMin = glm::vec3(-1.0f);
+        sceneMax = glm::vec3(1.0f);
+    }
+
+    // Cubic cells sized for the target count; thin scenes end up with fewer
+    glm::vec3 extent = glm::max(sceneMax - sceneMin, glm::vec3(1e-3f));
+    size_t targetCells = std::clamp<size_t>(primitives.size() * SDF_GRID_CELLS_PER_PRIMITIVE, 1, SDF_GRID_MAX_CELLS);
+    float cellSize = std::cbrt(extent.x * extent.y * extent.z / static_cast<float>(targetCells));
+    cellSize = std::max(cellSize, std::max(extent.x, std::max(extent.y, extent.z)) / SDF_GRID_MAX_SIDE);
+    glm::ivec3 size(1, 1, 1);
+    for (int axis = 0; axis < 3; axis++)
+        size[axis] = std::clamp(static_cast<int>(std::ceil(extent[axis] / cellSize)), 1, SDF_GRID_MAX_SIDE);
+    // Flat scenes keep the cell count, not the cell size, in check
+    while (static_cast<size_t>(size.x) * size.y * size.z > SDF_GRID_MAX_CELLS) {
+        cellSize *= 1.25f;
+        for (int axis = 0; axis < 3; axis++)
+            size[axis] = std::max(static_cast<int>(std::ceil(extent[axis] / cellSize)), 1);
+    }
+    m_GridMin = sceneMin;
+    m_CellSize = cellSize;
+    m_GridSize = size;
+    size_t cellCount = static_cast<size_t>(size.x) * size.y * size.z;
+
+    // A primitive is listed in the cells its bounds overlap and, after those,
+    // in the ring of cells around them: the cone prepass needs every surface
+    // within a cell of where it evaluates
+    auto forCells = [&](size_t primitive, auto&& visit) {
+        glm::ivec3 lo, hi;
+        for (int axis = 0; axis < 3; axis++) {
+            lo[axis] = std::clamp(static_cast<int>(std::floor((mins[primitive][axis] - m_GridMin[axis]) / cellSize)), 0, size[axis] - 1);
+            hi[axis] = std::clamp(static_cast<int>(std::floor((maxs[primitive][axis] - m_GridMin[axis]) / cellSize)), 0, size[axis] - 1);
+        }
+        for (int z = std::max(lo.z - 1, 0); z <= std::min(hi.z + 1, size.z - 1); z++) {
+            for (int y = std::max(lo.y - 1, 0); y <= std::min(hi.y + 1, size.y - 1); y++) {
+                for (int x = std::max(lo.x - 1, 0); x <= std::min(hi.x + 1, size.x - 1); x++) {
+                    bool overlaps = x >= lo.x && x <= hi.x && y >= lo.y && y <= hi.y && z >= lo.z && z <= hi.z;
+                    visit((static_cast<size_t>(z) * size.y + y) * size.x + x, overlaps);
+                }
+            }
+        }
+    };
+    std::vector<uint32_t> inside(cellCount, 0), total(cellCount, 0);
+    for (size_t i = 0; i < primitives.size(); i++) {
+        forCells(i, [&](size_t cell, bool overlaps) {
+            inside[cell] += overlaps;
+            total[cell]++;
+        });
+    }
+
+    // Cell texels: first entry, entries inside, entries inside or next to it
+    std::vector<uint32_t> cells(cellCount * 4, 0);
+    std::vector<uint32_t> cursors(cellCount * 2);
+    uint32_t next = 0;
+    for (size_t cell = 0; cell < cellCount; cell++) {
+        cells[cell * 4 + 0] = next;
+        cells[cell * 4 + 1] = inside[cell];
+        cells[cell * 4 + 2] = total[cell];
+        cursors[cell * 2 + 0] = next;
+        cursors[cell * 2 + 1] = next + inside[cell];
+        next += total[cell];
+        m_Stats.OccupiedCells += inside[cell] > 0;
+    }
+    std::vector<uint32_t> entries(next);
+    for (size_t i = 0; i < primitives.size(); i++) {
+        forCells(i, [&](size_t cell, bool overlaps) {
+            entries[cursors[cell * 2 + (overlaps ? 0 : 1)]++] = static_cast<uint32_t>(i);
+        });
+    }
+    m_Stats.Entries = entries.size();
+
+    std::vector<float> data(primitives.size() * SDF_PRIMITIVE_TEXELS * 4);
+    for (size_t i = 0; i < primitives.size(); i++) {
+        const SdfPrimitive& primitive = primitives[i];
+        float* texels = data.data() + i * SDF_PRIMITIVE_TEXELS * 4;
+        for (int row = 0; row < 3; row++) {
+            for (int column = 0; column < 4; column++)
+                texels[row * 4 + column] = primitive.WorldToLocal[column][row];
+        }
+        texels[12] = primitive.Size.x;
+        texels[13] = primitive.Size.y;
+        texels[14] = primitive.Size.z;
+        texels[15] = static_cast<float>(primitive.Shape);
+        texels[16] = primitive.Color.x;
+        texels[17] = primitive.Color.y;
+        texels[18] = primitive.Color.z;
+        texels[19] = primitive.Blend;
+    }
+
+    m_Primitives = CreateDataTexture(backend, GL_RGBA32F, 4, data, m_Stats.Bytes);
+    m_Cells = CreateDataTexture(backend, GL_RGBA32UI, 4, cells, m_Stats.Bytes);
+    m_Entries = CreateDataTexture(backend, GL_R32UI, 1, entries, m_Stats.Bytes);
+    m_Stats.GridSize = size;
+    m_Stats.BuildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t SdfRenderer::WriteFrameData(UniformRing& uniforms, const glm::mat4& view, const glm::mat4& proj, int width, int height) {
+    // proj[1][1] is 1 / tan(fov / 2): the view is 2 / proj[1][1] tall at distance 1
+    m_PixelAngle = 2.0f / (proj[1][1] * static_cast<float>(height));
+
+    size_t offset = uniforms.Allocate();
+    SdfFrame& frame = *uniforms.GetSlot<SdfFrame>(offset);
+    frame.u_InverseViewProj = glm::inverse(proj * view);
+    frame.u_Eye = glm::vec4(glm::vec3(glm::inverse(view)[3]), 0.5f * m_PixelAngle);
+    frame.u_Viewport = glm::vec4(static_cast<float>(width), static_cast<float>(height), 0.0f, 0.0f);
+    frame.u_GridMin = glm::vec4(m_GridMin, m_CellSize);
+    frame.u_GridSize = glm::ivec4(m_GridSize.x, m_GridSize.y, m_GridSize.z, SDF_TEXTURE_WIDTH);
+    frame.u_SunDirection = glm::vec4(glm::normalize(glm::vec3(0.4f, 0.8f, 0.45f)), 0.0f);
+    return offset;
+}
+
+void SdfRenderer::ResizeLevels(RenderBackend& backend, int width, int height) {
+    int tile = 1;
+    for (int i = SDF_CONE_LEVELS - 1; i >= 0; i--) {
+        tile *= SDF_CONE_FACTOR;
+        ConeLevel& level = m_Levels[i];
+        int levelWidth = (width + tile - 1) / tile;
+        int levelHeight = (height + tile - 1) / tile;
+        if (level.Target && level.Width == levelWidth && level.Height == levelHeight)
+            continue;
+        level.Width = levelWidth;
+        level.Height = levelHeight;
+        level.Distance = TextureHandle(backend, backend.CreateTexture(GL_R32F, levelWidth, levelHeight, nullptr));
+        level.Target = FramebufferHandle(backend, backend.CreateFramebuffer());
+        backend.FramebufferTexture(GL_COLOR_ATTACHMENT0, level.Distance.Get());
+    }
+}
+
+void SdfRenderer::Draw(RenderBackend& backend, const UniformRing& uniforms, size_t offset, int width, int height) {
+    ResizeLevels(backend, width, height);
+    backend.BindBufferRange(GL_UNIFORM_BUFFER, SdfFrame::Binding, uniforms.GetBuffer(), offset, sizeof(SdfFrame));
+    backend.BindTexture(0, m_Primitives.Get());
+    backend.BindTexture(1, m_Cells.Get());
+    backend.BindTexture(2, m_Entries.Get());
+    backend.BindVertexArray(m_Triangle.Get());
+
+    unsigned int prepass = m_Shader->Get(m_PrepassMask);
+    backend.UseProgram(prepass);
+    int tile = 1;
+    for (int i = 0; i < SDF_CONE_LEVELS; i++)
+        tile *= SDF_CONE_FACTOR;
+    for (int i = 0; i < SDF_CONE_LEVELS; i++) {
+        const ConeLevel& level = m_Levels[i];
+        backend.BindFramebuffer(level.Target.Get());
+        backend.SetViewport(0, 0, level.Width, level.Height);
+        // The first level starts at the eye; its start sampler only needs some float texture
+        backend.BindTexture(3, i > 0 ? m_Levels[i - 1].Distance.Get() : m_Primitives.Get());
+        float coarser = i > 0 ? static_cast<float>(tile * SDF_CONE_FACTOR) : 0.0f;
+        backend.SetUniform4f(m_PassLocation[1], static_cast<float>(tile), GetConeSlope(tile), coarser, 0.0f);
+        backend.DrawArrays(GL_TRIANGLES, 0, 3);
+        tile /= SDF_CONE_FACTOR;
+    }
+
+    backend.BindFramebuffer(0);
+    backend.SetViewport(0, 0, width, height);
+    backend.BindTexture(3, m_Levels[SDF_CONE_LEVELS - 1].Distance.Get());
+    backend.UseProgram(m_Shader->Get(0));
+    backend.SetUniform4f(m_PassLocation[0], 1.0f, GetConeSlope(1), static_cast<float>(SDF_CONE_FACTOR), 0.0f);
+    backend.DrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void SdfRenderer::Release() {
+    for (ConeLevel& level : m_Levels) {
+        level.Target.Reset();
+        level.Distance.Reset();
+    }
+    m_Primitives.Reset();
+    m_Cells.Reset();
+    m_Entries.Reset();
+    m_Triangle.Reset();
+    m_TriangleBuffer.Reset();
+    m_Shader = nullptr;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "GLResource.h"
+#include "ShaderVariants.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class RenderBackend;
+class UniformRing;
+
+#define SDF_SHADER_PATH "res/shaders/Sdf.shader"
+// Texels per row of the primitive, cell and entry textures; every GL 3.3
+// implementation supports textures at least this wide
+#define SDF_TEXTURE_WIDTH 1024
+// The grid gets about this many cells per primitive, within the limits below
+#define SDF_GRID_CELLS_PER_PRIMITIVE 8
+#define SDF_GRID_MAX_CELLS (64 * 64 * 64)
+#define SDF_GRID_MAX_SIDE 128
+// Cone prepass levels run before the full-resolution pass, each this many
+// times finer than the one before it (16 and 4 pixel tiles)
+#define SDF_CONE_LEVELS 2
+#define SDF_CONE_FACTOR 4
+
+enum class SdfShape : uint32_t {
+    Box, Pyramid, Sphere
+};
+
+struct SdfPrimitive {
+    SdfShape Shape = SdfShape::Box;
+    glm::mat4 WorldToLocal = glm::mat4(1.0f);  // rotation and translation only
+    // Box: half extents. Pyramid: base width in x, height over base width in
+    // y (the base sits on y = 0). Sphere: radius in x.
+    glm::vec3 Size = glm::vec3(0.5f);
+    glm::vec4 Color = glm::vec4(1.0f);
+    // Radius over which it melts into the primitives before it; 0 is a hard union
+    float Blend = 0.0f;
+};
+
+// The shape of the scene file's unit Cube or Pyramid mesh (or a sphere of
+// diameter 1) under `model`. Scale is folded into the size, since a distance
+// field only stays a distance under rigid transforms; pyramids and spheres
+// keep their proportions.
+SdfPrimitive MakeSdfPrimitive(SdfShape shape, const glm::mat4& model, const glm::vec4& color, float blend = 0.0f);
+
+struct SdfStats {
+    size_t Primitives = 0;
+    glm::ivec3 GridSize = glm::ivec3(0, 0, 0);
+    size_t OccupiedCells = 0;      // cells with a surface reaching into them
+    size_t Entries = 0;            // primitive references over all cell lists
+    size_t Bytes = 0;
+    double BuildMilliseconds = 0.0;
+};
+
+// Renders analytic primitives (boxes, pyramids, spheres, smooth unions of
+// them) by raymarching their distance field in a full-screen pass, with no
+// mesh data at all. Primitives live in a float texture and a uniform grid
+// lists, per cell, the ones that can reach into it, so a ray only evaluates
+// what is near it and crosses empty space a cell at a time. Coarse cone
+// marching passes first find, per tile, how far every ray in the tile can
+// safely skip, and the full-resolution pass starts there.
+class SdfRenderer {
+public:
+    // Compiles the variants it needs of `shader` (loaded from SDF_SHADER_PATH),
+    // which must outlive the renderer; false when they do not build
+    bool Init(RenderBackend& backend, ShaderVariantSet& shader);
+    // Replaces the primitives and rebuilds the grid
+    void SetPrimitives(RenderBackend& backend, const std::vector<SdfPrimitive>& primitives);
+
+    // Between the uniform ring's BeginFrame and FinishWrites: writes the
+    // frame's SdfFrame block and returns its offset
+    size_t WriteFrameData(UniformRing& uniforms, const glm::mat4& view, const glm::mat4& proj, int width, int height);
+    // Cone passes into the coarse targets, then the full-resolution pass into
+    // the default framebuffer, which is left bound with a full viewport
+    void Draw(RenderBackend& backend, const UniformRing& uniforms, size_t offset, int width, int height);
+    // Drops the GL objects; call before the context goes away
+    void Release();
+
+    const SdfStats& GetStats() const { return m_Stats; }
+
+private:
+    struct ConeLevel {
+        TextureHandle Distance;    // R32F, per tile: how far its rays start
+        FramebufferHandle Target;
+        int Width = 0, Height = 0;
+    };
+
+    void ResizeLevels(RenderBackend& backend, int width, int height);
+    // Cone radius per unit distance that covers every pixel of a tile
+    float GetConeSlope(int tile) const { return 0.75f * tile * m_PixelAngle; }
+
+    ShaderVariantSet* m_Shader = nullptr;
+    unsigned int m_PrepassMask = 0;
+    int m_PassLocation[2] = { -1, -1 };        // full resolution, prepass
+    VertexArrayHandle m_Triangle;
+    BufferHandle m_TriangleBuffer;
+
+    TextureHandle m_Primitives;
+    TextureHandle m_Cells;
+    TextureHandle m_Entries;
+    glm::vec3 m_GridMin = glm::vec3(0.0f);
+    float m_CellSize = 1.0f;
+    glm::ivec3 m_GridSize = glm::ivec3(1, 1, 1);
+
+    ConeLevel m_Levels[SDF_CONE_LEVELS];
+    float m_PixelAngle = 0.0f;     // radians per pixel at the centre of the view
+    SdfStats m_Stats;
+};
@@ -0,0 +1,69 @@
+#include "Shader.h"
+
+#include <fstream>
+#include <sstream>
+
+static ShaderProgramSource ParseShaderStream(std::istream& stream) {
+    enum class ShaderType {
+        NONE = -1, VERTEX = 0, FRAGMENT = 1
+    };
+
+    std::string line;
+    std::stringstream ss[2];
+    ShaderType type = ShaderType::NONE;
+    std::vector<std::string> keywords;
+    while (getline(stream, line)) {
+        if (line.find("#shader") != std::string::npos) {
+            if (line.find("vertex") != std::string::npos)
+                type = ShaderType::VERTEX;
+            else if (line.find("fragment") != std::string::npos)
+                type = ShaderType::FRAGMENT;
+        } else if (line.rfind("#keywords", 0) == 0) {
+            std::stringstream names(line.substr(9));
+            std::string name;
+            while (names >> name)
+                keywords.push_back(name);
+        } else if (type != ShaderType::NONE) {
+            ss[static_cast<int>(type)] << line << '\n';
+        }
+    }
+    return {
+        ss[static_cast<int>(ShaderType::VERTEX)].str(),
+        ss[static_cast<int>(ShaderType::FRAGMENT)].str(),
+        keywords
+    };
+}
+
+ShaderProgramSource ParseShader(const std::string& filepath) {
+    std::ifstream stream(filepath);
+    return ParseShaderStream(stream);
+}
+
+ShaderProgramSource ParseShaderSource(const std::string& text) {
+    std::istringstream stream(text);
+    return ParseShaderStream(stream);
+}
+
+static std::string InjectDefines(const std::string& stage, const std::string& defines) {
+    // #version must stay the first statement, so defines go right after it
+    size_t version = stage.find("#version");
+    size_t insertAt = 0;
+    if (version != std::string::npos) {
+        insertAt = stage.find('\n', version);
+        insertAt = insertAt == std::string::npos ? stage.size() : insertAt + 1;
+    }
+    return stage.substr(0, insertAt) + defines + stage.substr(insertAt);
+}
+
+ShaderProgramSource ApplyKeywords(const ShaderProgramSource& source, unsigned int mask) {
+    std::string defines;
+    for (size_t i = 0; i < source.Keywords.size(); i++) {
+        if (mask & (1u << i))
+            defines += "#define " + source.Keywords[i] + " 1\n";
+    }
+    return {
+        InjectDefines(source.VertexSource, defines),
+        InjectDefines(source.FragmentSource, defines),
+        source.Keywords
+    };
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct ShaderProgramSource {
+    std::string VertexSource;
+    std::string FragmentSource;
+    // Feature switches declared with `#keywords A B ...`; each variant of the
+    // shader is compiled with a subset of them #defined
+    std::vector<std::string> Keywords;
+};
+
+ShaderProgramSource ParseShader(const std::string& filepath);
+// Same, for a .shader file already read into memory
+ShaderProgramSource ParseShaderSource(const std::string& text);
+// Source of the variant with keyword i defined for every set bit i of mask
+ShaderProgramSource ApplyKeywords(const ShaderProgramSource& source, unsigned int mask);
@@ -0,0 +1,60 @@
+#include "ShaderVariants.h"
+#include "RenderBackend.h"
+
+#include <iostream>
+
+ShaderVariantSet::ShaderVariantSet(std::string path, ShaderProgramSource source)
+    : m_Path(std::move(path)), m_Source(std::move(source)) {
+    if (m_Source.Keywords.size() > SHADER_MAX_KEYWORDS) {
+        std::cout << "[Shader] " << m_Path << " declares " << m_Source.Keywords.size()
+                  << " keywords, only the first " << SHADER_MAX_KEYWORDS << " are used" << std::endl;
+        m_Source.Keywords.resize(SHADER_MAX_KEYWORDS);
+    }
+    m_Programs.resize(1u << m_Source.Keywords.size());
+    m_Requested.resize(m_Programs.size());
+}
+
+unsigned int ShaderVariantSet::GetKeywordMask(const std::vector<std::string>& keywords) const {
+    unsigned int mask = 0;
+    for (const std::string& keyword : keywords) {
+        bool found = false;
+        for (size_t i = 0; i < m_Source.Keywords.size(); i++) {
+            if (m_Source.Keywords[i] == keyword) {
+                mask |= 1u << i;
+                found = true;
+            }
+        }
+        if (!found)
+            std::cout << "[Shader] " << m_Path << " has no keyword " << keyword << std::endl;
+    }
+    return mask;
+}
+
+void BeginRequestedVariants(RenderBackend& backend, std::vector<ShaderVariantSet*> sets) {
+    struct Variant {
+        ShaderVariantSet* Set;
+        unsigned int Mask;
+    };
+    std::vector<Variant> variants;
+    std::vector<ShaderProgramSource> sources;
+    for (ShaderVariantSet* set : sets) {
+        for (unsigned int mask = 0; mask < set->GetVariantCount(); mask++) {
+            if (set->IsPending(mask)) {
+                variants.push_back({ set, mask });
+                sources.push_back(ApplyKeywords(set->GetSource(), mask));
+            }
+        }
+    }
+    if (variants.empty())
+        return;
+
+    std::vector<unsigned int> programs(variants.size());
+    backend.BeginPrograms(sources.data(), sources.size(), programs.data());
+    for (size_t i = 0; i < variants.size(); i++)
+        variants[i].Set->SetProgram(variants[i].Mask, ProgramHandle(backend, programs[i]));
+}
+
+void CompileRequestedVariants(RenderBackend& backend, std::vector<ShaderVariantSet*> sets) {
+    BeginRequestedVariants(backend, std::move(sets));
+    backend.FinishPrograms();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "GLResource.h"
+#include "Shader.h"
+
+#include <string>
+#include <vector>
+
+// Keywords per shader; variants are indexed by bitmask, so this bounds the
+// lookup table at 1 << SHADER_MAX_KEYWORDS entries
+#define SHADER_MAX_KEYWORDS 8
+
+class RenderBackend;
+
+// All permutations of one .shader file. Variants are compiled only when
+// requested, and looked up by keyword bitmask with a single array index.
+class ShaderVariantSet {
+public:
+    ShaderVariantSet(std::string path, ShaderProgramSource source);
+
+    const std::string& GetPath() const { return m_Path; }
+    const ShaderProgramSource& GetSource() const { return m_Source; }
+
+    // Bitmask for a list of keyword names; unknown names are reported and ignored
+    unsigned int GetKeywordMask(const std::vector<std::string>& keywords) const;
+
+    void Request(unsigned int mask) { m_Requested[mask] = true; }
+    bool IsPending(unsigned int mask) const { return m_Requested[mask] && !m_Programs[mask]; }
+    unsigned int GetVariantCount() const { return static_cast<unsigned int>(m_Programs.size()); }
+    void SetProgram(unsigned int mask, ProgramHandle program) { m_Programs[mask] = std::move(program); }
+
+    // 0 when the variant has not been compiled
+    unsigned int Get(unsigned int mask) const { return m_Programs[mask].Get(); }
+
+private:
+    std::string m_Path;
+    ShaderProgramSource m_Source;
+    std::vector<ProgramHandle> m_Programs;
+    std::vector<bool> m_Requested;
+};
+
+// Compiles every requested but missing variant of every set in one backend
+// batch, so the driver can overlap all of the compiles
+void CompileRequestedVariants(RenderBackend& backend, std::vector<ShaderVariantSet*> sets);
+// Issues the same batch through RenderBackend::BeginPrograms; the programs are
+// usable after the backend's FinishPrograms
+void BeginRequestedVariants(RenderBackend& backend, std::vector<ShaderVariantSet*> sets);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded single-producer, single-consumer ring. Push and Pop never block or
+// lock: each side owns one index and only reads the other's with acquire
+// ordering, and caches it so the shared cache line is touched only when the
+// ring looks full (or empty). Exactly one thread may push and one may pop.
+template<typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // Producer. False when the ring is full; `value` is left untouched then.
+    bool Push(T&& value) {
+        size_t tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_HeadCache == Capacity) {
+            m_HeadCache = m_Head.load(std::memory_order_acquire);
+            if (tail - m_HeadCache == Capacity)
+                return false;
+        }
+        m_Slots[tail & (Capacity - 1)] = std::move(value);
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer. False when the ring is empty.
+    bool Pop(T& value) {
+        size_t head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_TailCache) {
+            m_TailCache = m_Tail.load(std::memory_order_acquire);
+            if (head == m_TailCache)
+                return false;
+        }
+        value = std::move(m_Slots[head & (Capacity - 1)]);
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T m_Slots[Capacity];
+    alignas(64) std::atomic<size_t> m_Head = 0;
+    size_t m_TailCache = 0;        // consumer's copy of m_Tail
+    alignas(64) std::atomic<size_t> m_Tail = 0;
+    size_t m_HeadCache = 0;        // producer's copy of m_Head
+};
@@ -0,0 +1,154 @@
+#include "Startup.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+void StartupTimeline::Record(std::string name, Clock::time_point start, Clock::time_point end) {
+    bool mainThread = std::this_thread::get_id() == m_MainThread;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Spans.push_back({ std::move(name), mainThread,
+                        std::chrono::duration<double, std::milli>(start - m_Origin).count(),
+                        std::chrono::duration<double, std::milli>(end - m_Origin).count() });
+}
+
+double StartupTimeline::GetElapsedMs() const {
+    return std::chrono::duration<double, std::milli>(Clock::now() - m_Origin).count();
+}
+
+void StartupTimeline::Print(std::ostream& out) const {
+    std::vector<Span> spans;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        spans = m_Spans;
+    }
+    std::stable_sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.StartMs < b.StartMs; });
+
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    double total = 0.0;
+    for (const Span& span : spans)
+        total = std::max(total, span.EndMs);
+    out << "[Startup] " << std::fixed << std::setprecision(1) << total << " ms to first frame, "
+        << (total > STARTUP_TARGET_MS ? "over" : "within") << " the " << STARTUP_TARGET_MS << " ms target" << std::endl;
+    for (const Span& span : spans) {
+        int first = total > 0.0 ? static_cast<int>(span.StartMs / total * STARTUP_TIMELINE_COLUMNS) : 0;
+        int last = total > 0.0 ? static_cast<int>(span.EndMs / total * STARTUP_TIMELINE_COLUMNS) : 0;
+        first = std::min(first, STARTUP_TIMELINE_COLUMNS - 1);
+        last = std::clamp(last, first + 1, STARTUP_TIMELINE_COLUMNS);
+        std::string bar(STARTUP_TIMELINE_COLUMNS, ' ');
+        std::fill(bar.begin() + first, bar.begin() + last, span.MainThread ? '#' : '=');
+
+        out << "  " << std::left << std::setw(24) << span.Name << std::right
+            << (span.MainThread ? " main  " : " worker")
+            << std::setw(8) << span.StartMs << std::setw(8) << span.EndMs - span.StartMs << " ms |" << bar << "|" << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+unsigned int StartupGraph::Add(std::string name, StartupThread thread, std::function<bool()> run,
+                               const std::vector<unsigned int>& dependsOn) {
+    unsigned int index = static_cast<unsigned int>(m_Steps.size());
+    Step step;
+    step.Name = std::move(name);
+    step.Thread = thread;
+    step.Function = std::move(run);
+    for (unsigned int dependency : dependsOn) {
+        m_Steps[dependency].Dependents.push_back(index);
+        step.Waiting++;
+    }
+    m_Steps.push_back(std::move(step));
+    return index;
+}
+
+void StartupGraph::Execute(unsigned int index) {
+    bool ok;
+    {
+        StartupStep span(m_Timeline, m_Steps[index].Name);
+        ok = m_Steps[index].Function();
+    }
+    std::vector<unsigned int> ready;
+    JobSystem* jobs = m_Jobs;
+    {
+        // Notify under the lock: Run may return, and the graph go away, as soon as it is released
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (ok) {
+            for (unsigned int dependent : m_Steps[index].Dependents)
+                m_Steps[dependent].Waiting--;
+        } else {
+            std::cout << "[Startup] " << m_Steps[index].Name << " failed" << std::endl;
+            m_Failed = true;
+            Skip(index);
+        }
+        CollectReadyWorkers(ready);
+        m_Finished++;
+        m_Wake.notify_all();
+    }
+    // Steps still to run keep the graph alive
+    for (unsigned int next : ready)
+        jobs->Enqueue([this, next] { Execute(next); });
+}
+
+void StartupGraph::Skip(unsigned int index) {
+    for (unsigned int dependent : m_Steps[index].Dependents) {
+        Step& step = m_Steps[dependent];
+        if (step.Started)
+            continue;
+        step.Started = true;
+        m_Finished++;
+        Skip(dependent);
+    }
+}
+
+void StartupGraph::CollectReadyWorkers(std::vector<unsigned int>& ready) {
+    // Without a pool, worker steps fall through to the main thread
+    if (!m_Jobs)
+        return;
+    for (unsigned int i = 0; i < m_Steps.size(); i++) {
+        Step& step = m_Steps[i];
+        if (step.Thread == StartupThread::Worker && !step.Started && step.Waiting == 0) {
+            step.Started = true;
+            ready.push_back(i);
+        }
+    }
+}
+
+bool StartupGraph::Run() {
+    std::vector<unsigned int> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        CollectReadyWorkers(ready);
+    }
+    for (unsigned int index : ready)
+        m_Jobs->Enqueue([this, index] { Execute(index); });
+
+    while (true) {
+        int next = -1;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_Finished == m_Steps.size())
+                return !m_Failed;
+            for (unsigned int i = 0; i < m_Steps.size() && next < 0; i++) {
+                Step& step = m_Steps[i];
+                if (!step.Started && step.Waiting == 0 && (step.Thread == StartupThread::Main || !m_Jobs)) {
+                    step.Started = true;
+                    next = static_cast<int>(i);
+                }
+            }
+        }
+        if (next >= 0) {
+            Execute(static_cast<unsigned int>(next));
+            continue;
+        }
+        // Pools without workers only make progress when someone runs their jobs
+        if (m_Jobs && m_Jobs->RunOne())
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        size_t finished = m_Finished;
+        // The timeout picks up jobs queued after RunOne found the queue empty
+        m_Wake.wait_for(lock, std::chrono::milliseconds(1), [&] { return m_Finished != finished; });
+    }
+}
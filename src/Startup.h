@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Width of the bar column in the printed startup timeline
+#define STARTUP_TIMELINE_COLUMNS 48
+// Time to first frame the timeline is judged against
+#define STARTUP_TARGET_MS 100.0
+
+// Start and end of every startup step, measured from construction (the top of main)
+class StartupTimeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    StartupTimeline() : m_Origin(Clock::now()), m_MainThread(std::this_thread::get_id()) {}
+
+    // Thread safe
+    void Record(std::string name, Clock::time_point start, Clock::time_point end);
+    double GetElapsedMs() const;
+    // One line per step in start order with a bar across the whole startup
+    void Print(std::ostream& out) const;
+
+private:
+    struct Span {
+        std::string Name;
+        bool MainThread;
+        double StartMs, EndMs;
+    };
+
+    Clock::time_point m_Origin;
+    std::thread::id m_MainThread;
+    mutable std::mutex m_Mutex;
+    std::vector<Span> m_Spans;
+};
+
+// RAII: records the enclosing scope as one step
+class StartupStep {
+public:
+    StartupStep(StartupTimeline& timeline, std::string name)
+        : m_Timeline(timeline), m_Name(std::move(name)), m_Start(StartupTimeline::Clock::now()) {}
+    ~StartupStep() { m_Timeline.Record(std::move(m_Name), m_Start, StartupTimeline::Clock::now()); }
+
+    StartupStep(const StartupStep&) = delete;
+    StartupStep& operator=(const StartupStep&) = delete;
+
+private:
+    StartupTimeline& m_Timeline;
+    std::string m_Name;
+    StartupTimeline::Clock::time_point m_Start;
+};
+
+enum class StartupThread {
+    Main,      // window, context and GL work; runs on the thread that calls Run
+    Worker     // anything else; runs on the job system
+};
+
+// Dependency graph of startup steps. Worker steps start on the pool as soon
+// as their dependencies finish; main-thread steps run on the caller, picking
+// the earliest-added one that is ready, so GL work never waits behind a step
+// that is still blocked on file I/O. While nothing is ready the caller runs jobs.
+// A step that returns false fails the graph and skips everything depending on it.
+class StartupGraph {
+public:
+    StartupGraph(JobSystem* jobs, StartupTimeline& timeline) : m_Jobs(jobs), m_Timeline(timeline) {}
+
+    // Dependencies are ids returned by earlier calls
+    unsigned int Add(std::string name, StartupThread thread, std::function<bool()> run,
+                     const std::vector<unsigned int>& dependsOn = {});
+    // Runs every step and returns once all have finished or been skipped;
+    // false if any step failed
+    bool Run();
+
+private:
+    struct Step {
+        std::string Name;
+        StartupThread Thread;
+        std::function<bool()> Function;
+        std::vector<unsigned int> Dependents;
+        unsigned int Waiting = 0;      // unfinished dependencies
+        bool Started = false;
+    };
+
+    void Execute(unsigned int index);
+    // Marks ready worker steps started; caller holds m_Mutex
+    void CollectReadyWorkers(std::vector<unsigned int>& ready);
+    // Marks every unstarted step downstream of `index` finished; caller holds m_Mutex
+    void Skip(unsigned int index);
+
+    JobSystem* m_Jobs;
+    StartupTimeline& m_Timeline;
+    std::vector<Step> m_Steps;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    size_t m_Finished = 0;
+    bool m_Failed = false;
+};
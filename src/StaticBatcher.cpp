@@ -0,0 +1,345 @@
+#include "StaticBatcher.h"
+#include "Hlod.h"
+#include "Scene.h"
+#include "SceneBinding.h"
+#include "RenderBackend.h"
+#include "HostMemory.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <map>
+#include <tuple>
+#include <vector>
+
+// The variant bit of the batch keyword, 0 when the shader has none
+static unsigned int GetBatchBit(const ShaderVariantSet& shader) {
+    const std::vector<std::string>& keywords = shader.GetSource().Keywords;
+    for (size_t i = 0; i < keywords.size(); i++) {
+        if (keywords[i] == STATIC_BATCH_KEYWORD)
+            return 1u << i;
+    }
+    return 0;
+}
+
+void RequestStaticBatchVariants(Scene& scene) {
+    MemoryTagScope tag(MemoryTag::Shaders);
+    for (const Material& material : scene.Materials) {
+        ShaderVariantSet& shader = *scene.Shaders[material.Shader];
+        if (unsigned int bit = GetBatchBit(shader))
+            shader.Request(material.Variant | bit);
+    }
+}
+
+// The vertices one scene file mesh or part actually draws, renumbered from 0
+struct SourceGeometry {
+    bool Built = false;
+    std::vector<glm::vec3> Positions;
+    std::vector<unsigned int> Indices;
+    glm::vec3 Center = glm::vec3(0.0f);
+};
+
+static void BuildSourceGeometry(const SceneDesc& desc, size_t meshIndex, SourceGeometry& geometry) {
+    geometry.Built = true;
+    const SceneMeshDesc& mesh = desc.Meshes[meshIndex];
+    const SceneMeshDesc& source = mesh.Parent >= 0 ? desc.Meshes[mesh.Parent] : mesh;
+    size_t vertexCount = source.Positions.size() / 3;
+    bool indexed = !source.Indices.empty();
+    size_t first = mesh.Parent >= 0 ? mesh.First : 0;
+    size_t count = mesh.Parent >= 0 ? mesh.Count : (indexed ? source.Indices.size() : vertexCount);
+    int primitive = GetPrimitiveVertices(source.Mode);
+    if (primitive == 0)
+        return;
+    // A trailing partial primitive is not drawn; merged, it would pair up with the next object's vertices
+    count -= count % primitive;
+
+    std::vector<unsigned int> remap(vertexCount, UINT_MAX);
+    glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+    for (size_t i = first; i < first + count; i++) {
+        size_t index = indexed ? (i < source.Indices.size() ? source.Indices[i] : vertexCount) : i;
+        if (index >= vertexCount) {
+            // Out of range: leave the mesh to draw on its own, as the file asked
+            geometry.Positions.clear();
+            geometry.Indices.clear();
+            return;
+        }
+        if (remap[index] == UINT_MAX) {
+            glm::vec3 position(source.Positions[index * 3], source.Positions[index * 3 + 1], source.Positions[index * 3 + 2]);
+            boundsMin = geometry.Positions.empty() ? position : glm::min(boundsMin, position);
+            boundsMax = geometry.Positions.empty() ? position : glm::max(boundsMax, position);
+            remap[index] = static_cast<unsigned int>(geometry.Positions.size());
+            geometry.Positions.push_back(position);
+        }
+        geometry.Indices.push_back(remap[index]);
+    }
+    geometry.Center = (boundsMin + boundsMax) * 0.5f;
+}
+
+struct BatchItem {
+    size_t Object;
+    const SourceGeometry* Geometry;
+    glm::vec3 Center;              // world space
+    int Cell;                      // scene file cell nearest to the center, -1 without cells
+    glm::vec3 Anchor;              // the cell's center, or Center; splits keep a cell's items together
+};
+
+// Cells only bound where the camera can be, so props on the floor and the
+// walls between rooms are usually in none; they go with the closest one
+static int FindNearestCell(const SceneDesc& desc, const glm::vec3& point) {
+    int nearest = -1;
+    float nearestDistance = 0.0f;
+    for (size_t i = 0; i < desc.Cells.size(); i++) {
+        glm::vec3 offset = glm::clamp(point, desc.Cells[i].Min, desc.Cells[i].Max) - point;
+        float distance = glm::dot(offset, offset);
+        if (nearest < 0 || distance < nearestDistance) {
+            nearest = static_cast<int>(i);
+            nearestDistance = distance;
+        }
+    }
+    return nearest;
+}
+
+// A material of `shader` at `mask`, made and compiled if the scene has none
+static unsigned int GetBatchMaterial(Scene& scene, RenderBackend& backend, unsigned int shader, unsigned int mask) {
+    for (unsigned int i = 0; i < scene.Materials.size(); i++) {
+        const Material& material = scene.Materials[i];
+        if (material.Shader == shader && material.Variant == mask && material.Program != 0)
+            return i;
+    }
+    scene.Materials.push_back({ shader, 0, 0 });
+    unsigned int material = static_cast<unsigned int>(scene.Materials.size() - 1);
+    SetMaterialVariant(scene, backend, material, mask);
+    return material;
+}
+
+// One group's tree: its objects, and what every batch of it draws with
+struct BatchGroup {
+    std::vector<BatchItem>& Items;
+    unsigned int Material;
+    unsigned int Mode;
+    bool Proxies;
+    size_t FirstObject;            // where the items go in Scene::BatchObjects
+};
+
+// World-space vertices of items [begin, end), which are flagged as batched
+static BatchGeometry GatherGeometry(Scene& scene, const std::vector<BatchItem>& items, size_t begin, size_t end) {
+    BatchGeometry geometry;
+    for (size_t i = begin; i < end; i++) {
+        SceneObject& object = scene.Objects[items[i].Object];
+        const SourceGeometry& source = *items[i].Geometry;
+        unsigned int base = static_cast<unsigned int>(geometry.Vertices.size() / STATIC_BATCH_VERTEX_FLOATS);
+        for (const glm::vec3& position : source.Positions) {
+            glm::vec3 world = glm::vec3(object.Model * glm::vec4(position, 1.0f));
+            geometry.Vertices.insert(geometry.Vertices.end(), {
+                world.x, world.y, world.z, position.x, position.y, position.z,
+                object.Color.x, object.Color.y, object.Color.z, object.Color.w
+            });
+        }
+        for (unsigned int index : source.Indices)
+            geometry.Indices.push_back(base + index);
+        object.Batched = true;
+    }
+    return geometry;
+}
+
+static int UploadBatch(Scene& scene, RenderBackend& backend, const BatchGroup& group, const BatchGeometry& geometry,
+                       StaticBatchStats& stats) {
+    MemoryTagScope tag(MemoryTag::Meshes);
+    StaticBatch batch;
+    batch.Mode = group.Mode;
+    batch.MaterialIndex = group.Material;
+    batch.Count = static_cast<int>(geometry.Indices.size());
+    for (size_t v = 0; v < geometry.Vertices.size(); v += STATIC_BATCH_VERTEX_FLOATS) {
+        glm::vec3 world(geometry.Vertices[v], geometry.Vertices[v + 1], geometry.Vertices[v + 2]);
+        batch.BoundsMin = v == 0 ? world : glm::min(batch.BoundsMin, world);
+        batch.BoundsMax = v == 0 ? world : glm::max(batch.BoundsMax, world);
+    }
+
+    batch.Vao = backend.CreateVertexArray();
+    scene.BatchVertexArrays.emplace_back(backend, batch.Vao);
+    backend.BindVertexArray(batch.Vao);
+    unsigned int vbo = backend.CreateBuffer(GL_ARRAY_BUFFER, geometry.Vertices.data(), geometry.Vertices.size() * sizeof(float),
+                                            GL_STATIC_DRAW);
+    scene.BatchBuffers.emplace_back(backend, vbo);
+    int stride = STATIC_BATCH_VERTEX_FLOATS * sizeof(float);
+    backend.VertexAttribPointer(0, 3, GL_FLOAT, stride, 0);
+    backend.VertexAttribPointer(1, 3, GL_FLOAT, stride, 3 * sizeof(float));
+    backend.VertexAttribPointer(2, 4, GL_FLOAT, stride, 6 * sizeof(float));
+    unsigned int ibo = backend.CreateBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.Indices.data(),
+                                            geometry.Indices.size() * sizeof(unsigned int), GL_STATIC_DRAW);
+    scene.BatchBuffers.emplace_back(backend, ibo);
+    scene.Batches.push_back(batch);
+
+    stats.Vertices += geometry.Vertices.size() / STATIC_BATCH_VERTEX_FLOATS;
+    stats.Indices += geometry.Indices.size();
+    stats.Bytes += geometry.Vertices.size() * sizeof(float) + geometry.Indices.size() * sizeof(unsigned int);
+    return static_cast<int>(scene.Batches.size() - 1);
+}
+
+// Median splits on the longest axis of the item centers, down to leaves
+// within the object and vertex limits; each leaf is one batch. Ranges that
+// span cells are split between cells first, so every leaf lies in one cell
+// and the cell's visibility set can usually hide it whole. With proxies,
+// every inner node gets its children's geometry merged and simplified, and
+// hands that up in `geometry` so each level simplifies the one below it
+// rather than all of the source.
+static unsigned int BuildNode(Scene& scene, RenderBackend& backend, const BatchGroup& group, size_t begin, size_t end,
+                              BatchGeometry* geometry, StaticBatchStats& stats) {
+    std::vector<BatchItem>& items = group.Items;
+    size_t vertices = 0;
+    bool oneCell = true;
+    for (size_t i = begin; i < end; i++) {
+        vertices += items[i].Geometry->Positions.size();
+        oneCell = oneCell && items[i].Cell == items[begin].Cell;
+    }
+    // Between cells by where the cells are, within one by where the items are
+    auto key = [oneCell](const BatchItem& item) { return oneCell ? item.Center : item.Anchor; };
+    glm::vec3 centerMin = key(items[begin]), centerMax = key(items[begin]);
+    for (size_t i = begin; i < end; i++) {
+        centerMin = glm::min(centerMin, key(items[i]));
+        centerMax = glm::max(centerMax, key(items[i]));
+    }
+    unsigned int index = static_cast<unsigned int>(scene.BatchNodes.size());
+    scene.BatchNodes.emplace_back();
+    unsigned int firstObject = static_cast<unsigned int>(group.FirstObject + begin);
+    unsigned int objectCount = static_cast<unsigned int>(end - begin);
+
+    if (end - begin == 1 || (oneCell && end - begin <= STATIC_BATCH_MAX_OBJECTS && vertices <= STATIC_BATCH_MAX_VERTICES)) {
+        BatchGeometry leaf = GatherGeometry(scene, items, begin, end);
+        int batch = UploadBatch(scene, backend, group, leaf, stats);
+        BatchNode& node = scene.BatchNodes[index];
+        node.Batch = batch;
+        node.BoundsMin = scene.Batches[batch].BoundsMin;
+        node.BoundsMax = scene.Batches[batch].BoundsMax;
+        node.FirstObject = firstObject;
+        node.ObjectCount = objectCount;
+        stats.Objects += end - begin;
+        stats.Batches++;
+        if (geometry)
+            *geometry = std::move(leaf);
+        return index;
+    }
+
+    glm::vec3 extent = centerMax - centerMin;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    size_t middle = begin + (end - begin) / 2;
+    auto first = items.begin() + static_cast<std::ptrdiff_t>(begin), last = items.begin() + static_cast<std::ptrdiff_t>(end);
+    if (oneCell) {
+        std::nth_element(first, items.begin() + static_cast<std::ptrdiff_t>(middle), last,
+                         [axis](const BatchItem& a, const BatchItem& b) { return a.Center[axis] < b.Center[axis]; });
+    } else {
+        // Cells in order along the axis, each one's items together; the
+        // split moves from the median to the nearest boundary between cells
+        std::sort(first, last, [axis](const BatchItem& a, const BatchItem& b) {
+            return a.Anchor[axis] != b.Anchor[axis] ? a.Anchor[axis] < b.Anchor[axis] : a.Cell < b.Cell;
+        });
+        for (size_t step = 0;; step++) {
+            if (middle - step > begin && items[middle - step - 1].Cell != items[middle - step].Cell) {
+                middle -= step;
+                break;
+            }
+            if (middle + step < end && items[middle + step - 1].Cell != items[middle + step].Cell) {
+                middle += step;
+                break;
+            }
+        }
+    }
+    BatchGeometry children[2];
+    unsigned int left = BuildNode(scene, backend, group, begin, middle, group.Proxies ? &children[0] : nullptr, stats);
+    unsigned int right = BuildNode(scene, backend, group, middle, end, group.Proxies ? &children[1] : nullptr, stats);
+
+    BatchNode node;
+    node.Children[0] = static_cast<int>(left);
+    node.Children[1] = static_cast<int>(right);
+    node.BoundsMin = glm::min(scene.BatchNodes[left].BoundsMin, scene.BatchNodes[right].BoundsMin);
+    node.BoundsMax = glm::max(scene.BatchNodes[left].BoundsMax, scene.BatchNodes[right].BoundsMax);
+    node.FirstObject = firstObject;
+    node.ObjectCount = objectCount;
+    if (group.Proxies) {
+        BatchGeometry& merged = children[0];
+        unsigned int base = static_cast<unsigned int>(merged.Vertices.size() / STATIC_BATCH_VERTEX_FLOATS);
+        merged.Vertices.insert(merged.Vertices.end(), children[1].Vertices.begin(), children[1].Vertices.end());
+        for (unsigned int childIndex : children[1].Indices)
+            merged.Indices.push_back(base + childIndex);
+        BatchGeometry proxy = SimplifyBatchGeometry(merged, group.Mode);
+        node.Proxy = true;
+        if (!proxy.Indices.empty()) {
+            node.Batch = UploadBatch(scene, backend, group, proxy, stats);
+            stats.Proxies++;
+        }
+        if (geometry)
+            *geometry = std::move(proxy);
+    }
+    scene.BatchNodes[index] = node;
+    return index;
+}
+
+StaticBatchStats BuildStaticBatches(Scene& scene, RenderBackend& backend, const SceneDesc& desc,
+                                    const SceneBinding& binding, size_t objectCount, bool proxies) {
+    MemoryTagScope tag(MemoryTag::Scene);
+    auto start = std::chrono::steady_clock::now();
+    ClearStaticBatches(scene);
+
+    // Scene file mesh each scene mesh was made from
+    std::vector<int> sources(scene.Meshes.size(), -1);
+    for (size_t i = 0; i < binding.Meshes.size() && i < desc.Meshes.size(); i++) {
+        if (binding.Meshes[i] < sources.size())
+            sources[binding.Meshes[i]] = static_cast<int>(i);
+    }
+    std::vector<SourceGeometry> geometry(desc.Meshes.size());
+
+    // Groups draw with one program and primitive type: (shader, batch variant, mode)
+    std::map<std::tuple<unsigned int, unsigned int, unsigned int>, std::vector<BatchItem>> groups;
+    for (size_t i = 0; i < std::min(objectCount, scene.Objects.size()); i++) {
+        const SceneObject& object = scene.Objects[i];
+        const Material& material = scene.Materials[object.MaterialIndex];
+        unsigned int bit = GetBatchBit(*scene.Shaders[material.Shader]);
+        int source = object.MeshIndex < sources.size() ? sources[object.MeshIndex] : -1;
+        // A material already on the batch variant expects world-space input it does not get here
+        if (bit == 0 || (material.Variant & bit) || source < 0)
+            continue;
+        SourceGeometry& mesh = geometry[source];
+        if (!mesh.Built)
+            BuildSourceGeometry(desc, source, mesh);
+        if (mesh.Indices.empty())
+            continue;
+        glm::vec3 center = glm::vec3(object.Model * glm::vec4(mesh.Center, 1.0f));
+        int cell = FindNearestCell(desc, center);
+        glm::vec3 anchor = cell >= 0 ? (desc.Cells[cell].Min + desc.Cells[cell].Max) * 0.5f : center;
+        groups[{ material.Shader, material.Variant | bit, scene.Meshes[object.MeshIndex].Mode }].push_back({ i, &mesh, center, cell, anchor });
+    }
+
+    StaticBatchStats stats;
+    for (auto& [key, items] : groups) {
+        // A lone object gains nothing from a copy of itself
+        if (items.size() < 2)
+            continue;
+        auto [shader, mask, mode] = key;
+        unsigned int material = GetBatchMaterial(scene, backend, shader, mask);
+        if (scene.Materials[material].Program == 0)
+            continue;
+        BatchGroup group = { items, material, mode, proxies, scene.BatchObjects.size() };
+        scene.BatchRoots.push_back(BuildNode(scene, backend, group, 0, items.size(), nullptr, stats));
+        // In the order the splits left them, so every subtree's objects are one range
+        for (const BatchItem& item : items)
+            scene.BatchObjects.push_back(static_cast<unsigned int>(item.Object));
+    }
+    stats.BuildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+void ClearStaticBatches(Scene& scene) {
+    for (SceneObject& object : scene.Objects)
+        object.Batched = false;
+    scene.Batches.clear();
+    scene.BatchNodes.clear();
+    scene.BatchRoots.clear();
+    scene.BatchObjects.clear();
+    // The per-node sets were made for the old trees
+    scene.Visibility.Nodes.clear();
+    // Dropping the owning handles queues the buffers for deletion
+    scene.BatchVertexArrays.clear();
+    scene.BatchBuffers.clear();
+}
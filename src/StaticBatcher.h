@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+
+class RenderBackend;
+struct Scene;
+struct SceneDesc;
+struct SceneBinding;
+
+// Shaders that can draw batches declare this keyword. Its variant reads the
+// world position at location 0, the object-space position at 1 and the
+// object's color at 2.
+#define STATIC_BATCH_KEYWORD "STATIC_BATCH"
+// Clusters are halved along their longest axis until they are within both
+// limits and within one of the scene file's cells; smaller batches cull
+// tighter, larger ones draw fewer times
+#define STATIC_BATCH_MAX_OBJECTS 256
+#define STATIC_BATCH_MAX_VERTICES 65536
+// World position, object-space position, color
+#define STATIC_BATCH_VERTEX_FLOATS 10
+
+struct StaticBatchStats {
+    size_t Objects = 0;            // merged into batches
+    size_t Batches = 0;            // leaves of the cluster trees
+    size_t Proxies = 0;            // HLOD proxies of their inner nodes
+    size_t Vertices = 0;
+    size_t Indices = 0;
+    size_t Bytes = 0;
+    double BuildMilliseconds = 0.0;
+};
+
+// Requests the STATIC_BATCH variant of every material whose shader has one,
+// so it compiles in the same batch as the materials' own variants. Call
+// between adding the materials and BeginCompileMaterials.
+void RequestStaticBatchVariants(Scene& scene);
+
+// Replaces the scene's batches with new ones over scene.Objects[0, objectCount),
+// which must not move afterwards; objects past that range always draw on
+// their own. Objects are grouped by material and primitive type, and each
+// group of two or more is split into a tree of spatial clusters whose leaves
+// become one batch each, with the vertices transformed to world space. Leaves
+// never mix objects of different cells (the one nearest to each object's
+// center), so a cell's visibility set can hide other rooms' batches. With
+// `proxies`, every inner cluster also gets an HLOD proxy (see Hlod.h).
+// Geometry comes from the scene file `desc`, whose meshes `binding` maps to
+// the scene's; objects on any other mesh, on strips, fans or loops, or with a
+// shader without the keyword stay as they are.
+StaticBatchStats BuildStaticBatches(Scene& scene, RenderBackend& backend, const SceneDesc& desc,
+                                    const SceneBinding& binding, size_t objectCount, bool proxies = true);
+// Drops every batch; their objects draw on their own again
+void ClearStaticBatches(Scene& scene);
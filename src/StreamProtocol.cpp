@@ -0,0 +1,130 @@
+#include "StreamProtocol.h"
+#include "Lz4.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Fills either address form; returns the socket family or -1
+static int ResolveStreamAddress(const std::string& address, sockaddr_storage& storage, socklen_t& length) {
+    std::memset(&storage, 0, sizeof(storage));
+    if (address.compare(0, 4, "tcp:") == 0) {
+        int port = std::atoi(address.c_str() + 4);
+        if (port <= 0 || port > 65535)
+            return -1;
+        sockaddr_in& in = reinterpret_cast<sockaddr_in&>(storage);
+        in.sin_family = AF_INET;
+        in.sin_port = htons(static_cast<uint16_t>(port));
+        in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        length = sizeof(sockaddr_in);
+        return AF_INET;
+    }
+    sockaddr_un& un = reinterpret_cast<sockaddr_un&>(storage);
+    if (address.empty() || address.size() >= sizeof(un.sun_path))
+        return -1;
+    un.sun_family = AF_UNIX;
+    std::memcpy(un.sun_path, address.c_str(), address.size() + 1);
+    length = sizeof(sockaddr_un);
+    return AF_UNIX;
+}
+
+int ListenStreamSocket(const std::string& address) {
+    sockaddr_storage storage;
+    socklen_t length;
+    int family = ResolveStreamAddress(address, storage, length);
+    if (family < 0) {
+        std::cout << "[Stream] bad address " << address << std::endl;
+        return -1;
+    }
+    int fd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (family == AF_UNIX) {
+        unlink(address.c_str());
+    } else {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (bind(fd, reinterpret_cast<sockaddr*>(&storage), length) < 0 || listen(fd, 1) < 0) {
+        std::cout << "[Stream] cannot listen on " << address << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int ConnectStreamSocket(const std::string& address) {
+    sockaddr_storage storage;
+    socklen_t length;
+    int family = ResolveStreamAddress(address, storage, length);
+    if (family < 0) {
+        std::cout << "[Stream] bad address " << address << std::endl;
+        return -1;
+    }
+    int fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&storage), length) < 0) {
+        std::cout << "[Stream] cannot connect to " << address << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    if (family == AF_INET) {
+        // Input events are tiny and latency-bound
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+bool ApplyStreamFrame(const StreamFrameHeader& header, const unsigned char* payload,
+                      std::vector<unsigned char>& rgb, std::vector<unsigned char>& scratch) {
+    if (header.Magic != STREAM_MAGIC || header.TileSize == 0)
+        return false;
+    size_t width = header.Width, height = header.Height, tileSize = header.TileSize;
+    if (header.Flags & STREAM_FRAME_KEY)
+        rgb.assign(width * height * 3, 0);
+    else if (rgb.size() != width * height * 3)
+        return false;                  // a delta needs the keyframe it builds on
+    scratch.resize(tileSize * tileSize * 3);
+
+    size_t offset = 0;
+    for (unsigned int i = 0; i < header.TileCount; i++) {
+        StreamTileHeader tile;
+        if (offset + sizeof(tile) > header.PayloadSize)
+            return false;
+        std::memcpy(&tile, payload + offset, sizeof(tile));
+        offset += sizeof(tile);
+
+        size_t x0 = tile.X * tileSize, y0 = tile.Y * tileSize;
+        if (x0 >= width || y0 >= height || offset + tile.Size > header.PayloadSize)
+            return false;
+        size_t tileWidth = std::min(tileSize, width - x0), tileHeight = std::min(tileSize, height - y0);
+        size_t rawSize = tileWidth * tileHeight * 3;
+
+        const unsigned char* data = payload + offset;
+        if (tile.Size != rawSize) {
+            if (Lz4Decompress(data, tile.Size, scratch.data(), rawSize) != static_cast<long long>(rawSize))
+                return false;
+            data = scratch.data();
+        }
+        offset += tile.Size;
+
+        for (size_t y = 0; y < tileHeight; y++) {
+            unsigned char* row = rgb.data() + ((y0 + y) * width + x0) * 3;
+            const unsigned char* delta = data + y * tileWidth * 3;
+            for (size_t x = 0; x < tileWidth * 3; x++)
+                row[x] ^= delta[x];
+        }
+    }
+    return offset == header.PayloadSize;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Wire format between FrameStreamer and tools/StreamViewer. Everything is
+// little-endian and both ends are this codebase, so structs go out as they
+// are laid out in memory.
+//
+// Server -> viewer, once per encoded frame:
+//     StreamFrameHeader, then TileCount x (StreamTileHeader, Size bytes)
+// Viewer -> server, at any time:
+//     StreamInputEvent
+//
+// Frames are cut into STREAM_TILE_SIZE square tiles (smaller at the right
+// and top edges). Only tiles that changed since the previous sent frame are
+// in a packet. A tile's data is its RGB pixels, bottom row first as GL reads
+// them, XORed with the same tile of the previous frame; unchanged pixels are
+// zero and compress to almost nothing. The data is LZ4-compressed unless that
+// does not make it smaller, in which case Size equals the raw size. Keyframes
+// are XORed against black, i.e. sent raw, and contain every tile.
+#define STREAM_MAGIC 0x464C474Du   // "MGLF"
+#define STREAM_TILE_SIZE 64
+#define STREAM_FRAME_KEY 1u
+
+struct StreamFrameHeader {
+    uint32_t Magic;
+    uint32_t Frame;
+    uint16_t Width;
+    uint16_t Height;
+    uint16_t TileSize;
+    uint16_t TileCount;
+    uint32_t PayloadSize;          // bytes after this header
+    uint32_t Flags;
+    uint32_t EncodeMicros;         // readback mapped to packet ready, on the server
+};
+
+struct StreamTileHeader {
+    uint16_t X;                    // tile column
+    uint16_t Y;                    // tile row, from the bottom
+    uint32_t Size;
+};
+
+// GLFW key and action codes
+struct StreamInputEvent {
+    int32_t Key;
+    int32_t Action;
+};
+
+// Opens the address a streamer listens on: "tcp:PORT" is TCP on the
+// loopback interface, anything else a Unix socket path. Returns -1 and logs
+// on failure.
+int ListenStreamSocket(const std::string& address);
+int ConnectStreamSocket(const std::string& address);
+
+// Applies one frame's tiles to `rgb` (Width x Height x 3, bottom row first),
+// resizing and clearing it on keyframes. False on malformed packets.
+bool ApplyStreamFrame(const StreamFrameHeader& header, const unsigned char* payload,
+                      std::vector<unsigned char>& rgb, std::vector<unsigned char>& scratch);
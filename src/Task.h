@@ -0,0 +1,101 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+template<typename T = void>
+class Task;
+
+// Lazily started; when the coroutine finishes it resumes whoever awaited it
+struct TaskPromiseBase {
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> continuation = handle.promise().Continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    // Loading code reports failures through its results, not exceptions
+    void unhandled_exception() const noexcept { std::terminate(); }
+
+    std::coroutine_handle<> Continuation;
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase {
+    Task<T> get_return_object() noexcept;
+    void return_value(T value) { Value.emplace(std::move(value)); }
+    T TakeResult() { return std::move(*Value); }
+
+    std::optional<T> Value;
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() const noexcept {}
+    void TakeResult() const noexcept {}
+};
+
+// Coroutine returning T. Nothing runs until the task is co_awaited; the
+// awaiting coroutine is resumed, on whatever thread the task finished on,
+// with the task's result. Tasks are move-only and own their frame.
+template<typename T>
+class Task {
+public:
+    using promise_type = TaskPromise<T>;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) : m_Handle(handle) {}
+    ~Task() {
+        if (m_Handle)
+            m_Handle.destroy();
+    }
+
+    Task(Task&& other) noexcept : m_Handle(std::exchange(other.m_Handle, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (m_Handle)
+                m_Handle.destroy();
+            m_Handle = std::exchange(other.m_Handle, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    bool IsDone() const { return !m_Handle || m_Handle.done(); }
+
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> Handle;
+
+            bool await_ready() const noexcept { return !Handle || Handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                Handle.promise().Continuation = awaiting;
+                return Handle;
+            }
+            T await_resume() { return Handle.promise().TakeResult(); }
+        };
+        return Awaiter{ m_Handle };
+    }
+
+private:
+    std::coroutine_handle<promise_type> m_Handle;
+};
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
@@ -0,0 +1,59 @@
+#include "UniformRing.h"
+#include "RenderBackend.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+
+void UniformRing::WaitForRegions(RenderBackend& backend) {
+    for (void*& fence : m_Fences) {
+        if (fence) {
+            backend.WaitFence(fence, ~0ull);
+            backend.DeleteFence(fence);
+            fence = nullptr;
+        }
+    }
+}
+
+void UniformRing::BeginFrame(RenderBackend& backend, unsigned long long frame, size_t slotBytes, size_t slots) {
+    size_t alignment = backend.GetUniformBufferAlignment();
+    size_t stride = (slotBytes + alignment - 1) / alignment * alignment;
+    slots = std::max<size_t>(slots, 1);
+
+    if (!m_Buffer || stride != m_SlotStride || slots > m_SlotsPerRegion) {
+        // Regions are about to move; the old buffer itself goes through the deletion queue
+        WaitForRegions(backend);
+        m_SlotStride = stride;
+        m_SlotsPerRegion = std::max(slots, m_SlotsPerRegion * 2);
+        size_t size = m_SlotStride * m_SlotsPerRegion * FRAME_ARENA_BUFFERS;
+        m_Buffer = BufferHandle(backend, backend.CreateBuffer(GL_UNIFORM_BUFFER, nullptr, size, GL_STREAM_DRAW));
+    }
+
+    m_Region = static_cast<unsigned int>(frame % FRAME_ARENA_BUFFERS);
+    if (void*& fence = m_Fences[m_Region]) {
+        backend.WaitFence(fence, ~0ull);
+        backend.DeleteFence(fence);
+        fence = nullptr;
+    }
+
+    m_RegionOffset = m_Region * m_SlotStride * m_SlotsPerRegion;
+    m_Mapped = static_cast<unsigned char*>(backend.MapBuffer(GL_UNIFORM_BUFFER, m_Buffer.Get(), m_RegionOffset,
+                                                             m_SlotStride * m_SlotsPerRegion));
+    m_Next = 0;
+}
+
+void UniformRing::FinishWrites(RenderBackend& backend) {
+    backend.UnmapBuffer(GL_UNIFORM_BUFFER, m_Buffer.Get());
+    backend.GetMemoryTracker().TrackUpload(GetUsedSlots() * m_SlotStride);
+    m_Mapped = nullptr;
+}
+
+void UniformRing::EndFrame(RenderBackend& backend) {
+    m_Fences[m_Region] = backend.InsertFence();
+}
+
+void UniformRing::Release(RenderBackend& backend) {
+    WaitForRegions(backend);
+    m_Buffer.Reset();
+    m_SlotsPerRegion = 0;
+}
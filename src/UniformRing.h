@@ -0,0 +1,51 @@
+#pragma once
+
+#include "FrameArena.h"
+#include "GLResource.h"
+
+#include <atomic>
+#include <cstddef>
+
+class RenderBackend;
+
+// Per-draw uniform data streamed through one GL_UNIFORM_BUFFER split into
+// FRAME_ARENA_BUFFERS regions. Each frame maps its region, any thread writes
+// slots straight into the mapping in the layout of the generated block
+// structs, and the region is fenced so it is only rewritten once the GPU has
+// finished reading it.
+class UniformRing {
+public:
+    // GL thread. Makes room for `slots` slots of `slotBytes` each (rounded up
+    // to the backend's offset alignment) and maps this frame's region.
+    void BeginFrame(RenderBackend& backend, unsigned long long frame, size_t slotBytes, size_t slots);
+    // GL thread, after all writes and before any draw that reads the data
+    void FinishWrites(RenderBackend& backend);
+    // GL thread, after the last draw of the frame
+    void EndFrame(RenderBackend& backend);
+    // Waits for outstanding regions and drops the buffer; call before the context goes away
+    void Release(RenderBackend& backend);
+
+    // Any thread, between BeginFrame and FinishWrites. Returns the slot's
+    // offset in the buffer, for BindBufferRange.
+    size_t Allocate() {
+        size_t slot = m_Next.fetch_add(1, std::memory_order_relaxed);
+        return m_RegionOffset + slot * m_SlotStride;
+    }
+    template<typename T>
+    T* GetSlot(size_t offset) { return reinterpret_cast<T*>(m_Mapped + (offset - m_RegionOffset)); }
+
+    unsigned int GetBuffer() const { return m_Buffer.Get(); }
+    size_t GetUsedSlots() const { return m_Next.load(std::memory_order_relaxed); }
+
+private:
+    void WaitForRegions(RenderBackend& backend);
+
+    BufferHandle m_Buffer;
+    size_t m_SlotStride = 0;
+    size_t m_SlotsPerRegion = 0;
+    unsigned int m_Region = 0;
+    size_t m_RegionOffset = 0;
+    unsigned char* m_Mapped = nullptr;
+    std::atomic<size_t> m_Next = 0;
+    void* m_Fences[FRAME_ARENA_BUFFERS] = {};
+};
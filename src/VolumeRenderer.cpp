@@ -0,0 +1,428 @@
+#include "VolumeRenderer.h"
+#include "RenderBackend.h"
+#include "Scene.h"
+#include "UniformRing.h"
+#include "ShaderLayouts.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Page table states, in the alpha channel of each brick's texel
+#define VOLUME_PAGE_EMPTY 0
+#define VOLUME_PAGE_RESIDENT 1
+#define VOLUME_PAGE_FALLBACK 2
+
+bool LoadRawVolume(const std::string& path, VolumeData& volume) {
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    int width = 0, height = 0, depth = 0, bits = 0;
+    // The last _WxHxD_uintN field wins; the name may have underscores of its own
+    size_t field = name.rfind('_');
+    while (field != std::string::npos &&
+           std::sscanf(name.c_str() + field, "_%dx%dx%d_uint%d", &width, &height, &depth, &bits) != 4)
+        field = field > 0 ? name.rfind('_', field - 1) : std::string::npos;
+    if (field == std::string::npos || width <= 0 || height <= 0 || depth <= 0 || (bits != 8 && bits != 16)) {
+        std::cout << "[Volume] cannot tell the size of " << path << ": name it like skull_256x256x256_uint8.raw" << std::endl;
+        return false;
+    }
+
+    volume.Size = glm::ivec3(width, height, depth);
+    volume.BytesPerVoxel = bits / 8;
+    size_t bytes = static_cast<size_t>(width) * height * depth * volume.BytesPerVoxel;
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in || static_cast<size_t>(in.tellg()) < bytes) {
+        std::cout << "[Volume] cannot read " << bytes << " bytes from " << path << std::endl;
+        return false;
+    }
+    volume.Voxels.resize(bytes);
+    in.seekg(0);
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(volume.Voxels.data()), static_cast<std::streamsize>(bytes)));
+}
+
+VolumeData MakeTestVolume(int size) {
+    VolumeData volume;
+    volume.Size = glm::ivec3(size, size, size);
+    volume.BytesPerVoxel = 1;
+    volume.Voxels.resize(static_cast<size_t>(size) * size * size);
+    const glm::vec3 radii(0.72f, 0.88f, 0.8f);
+    const glm::vec4 organs[] = {
+        { -0.25f, 0.15f, 0.45f, 0.14f }, { 0.25f, 0.15f, 0.45f, 0.14f }, { 0.0f, -0.3f, 0.0f, 0.25f }, { 0.1f, 0.3f, -0.2f, 0.2f }
+    };
+    size_t index = 0;
+    for (int z = 0; z < size; z++) {
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                glm::vec3 p = (glm::vec3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)) + 0.5f) /
+                              static_cast<float>(size) * 2.0f - 1.0f;
+                float r = glm::length(p / radii);
+                float value = 0.0f;
+                if (r <= 1.0f) {
+                    value = r > 0.9f ? 220.0f : 90.0f + 12.0f * std::sin(p.x * 9.0f) * std::sin(p.y * 7.0f);
+                    for (const glm::vec4& organ : organs) {
+                        if (r <= 0.9f && glm::length(p - glm::vec3(organ)) < organ.w)
+                            value = 145.0f;
+                    }
+                }
+                volume.Voxels[index++] = static_cast<unsigned char>(value);
+            }
+        }
+    }
+    return volume;
+}
+
+std::vector<TransferPoint> GetDefaultTransferFunction() {
+    return {
+        { 0.00f, glm::vec4(0.0f, 0.0f, 0.0f, 0.0f) },
+        { 0.28f, glm::vec4(0.0f, 0.0f, 0.0f, 0.0f) },
+        { 0.34f, glm::vec4(0.85f, 0.45f, 0.35f, 0.004f) },
+        { 0.45f, glm::vec4(0.85f, 0.45f, 0.35f, 0.004f) },
+        { 0.52f, glm::vec4(0.8f, 0.2f, 0.2f, 0.2f) },
+        { 0.60f, glm::vec4(0.8f, 0.2f, 0.2f, 0.2f) },
+        { 0.66f, glm::vec4(0.9f, 0.8f, 0.7f, 0.0f) },
+        { 0.80f, glm::vec4(0.95f, 0.93f, 0.88f, 0.05f) },
+        { 1.00f, glm::vec4(0.95f, 0.93f, 0.88f, 0.05f) },
+    };
+}
+
+static uint16_t ReadVoxel(const VolumeData& volume, size_t index) {
+    if (volume.BytesPerVoxel == 1)
+        return static_cast<uint16_t>(volume.Voxels[index] * 257);
+    uint16_t value;
+    std::memcpy(&value, volume.Voxels.data() + index * 2, 2);
+    return value;
+}
+
+// Average over `factor`-sided blocks, in the volume's own format
+static std::vector<unsigned char> Downsample(const VolumeData& volume, int factor, glm::ivec3& size) {
+    size = (volume.Size + factor - 1) / factor;
+    std::vector<unsigned char> result(static_cast<size_t>(size.x) * size.y * size.z * volume.BytesPerVoxel);
+    size_t out = 0;
+    for (int z = 0; z < size.z; z++) {
+        for (int y = 0; y < size.y; y++) {
+            for (int x = 0; x < size.x; x++) {
+                uint64_t sum = 0, count = 0;
+                for (int dz = z * factor; dz < std::min((z + 1) * factor, volume.Size.z); dz++) {
+                    for (int dy = y * factor; dy < std::min((y + 1) * factor, volume.Size.y); dy++) {
+                        size_t row = (static_cast<size_t>(dz) * volume.Size.y + dy) * volume.Size.x;
+                        for (int dx = x * factor; dx < std::min((x + 1) * factor, volume.Size.x); dx++, count++)
+                            sum += ReadVoxel(volume, row + dx);
+                    }
+                }
+                uint16_t value = static_cast<uint16_t>(sum / count);
+                if (volume.BytesPerVoxel == 1)
+                    result[out++] = static_cast<unsigned char>(value >> 8);
+                else {
+                    std::memcpy(result.data() + out, &value, 2);
+                    out += 2;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+bool VolumeRenderer::Init(RenderBackend& backend, ShaderVariantSet& shader, VolumeData volume, size_t poolBytes) {
+    if (volume.Voxels.empty())
+        return false;
+    if (shader.GetSource().VertexSource.empty() || shader.GetSource().FragmentSource.empty()) {
+        std::cout << "[Volume] cannot load " << shader.GetPath() << std::endl;
+        return false;
+    }
+    m_Shader = &shader;
+    m_Shader->Request(0);
+    CompileRequestedVariants(backend, { m_Shader });
+    unsigned int program = m_Shader->Get(0);
+    if (program == 0)
+        return false;
+    backend.BindUniformBlock(program, VolumeFrame::Name, VolumeFrame::Binding);
+    backend.UseProgram(program);
+    backend.SetUniform1i(backend.GetUniformLocation(program, "u_SceneColor"), 0);
+    backend.SetUniform1i(backend.GetUniformLocation(program, "u_SceneDepth"), 1);
+    backend.SetUniform1i(backend.GetUniformLocation(program, "u_Atlas"), 2);
+    backend.SetUniform1i(backend.GetUniformLocation(program, "u_Pages"), 3);
+    backend.SetUniform1i(backend.GetUniformLocation(program, "u_Fallback"), 4);
+    backend.SetUniform1i(backend.GetUniformLocation(program, "u_Transfer"), 5);
+    backend.UseProgram(0);
+
+    const float corners[] = { -1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f };
+    m_Triangle = VertexArrayHandle(backend, backend.CreateVertexArray());
+    backend.BindVertexArray(m_Triangle.Get());
+    m_TriangleBuffer = BufferHandle(backend, backend.CreateBuffer(GL_ARRAY_BUFFER, corners, sizeof(corners), GL_STATIC_DRAW));
+    backend.VertexAttribPointer(0, 2, GL_FLOAT, 0, 0);
+    backend.BindVertexArray(0);
+
+    m_Volume = std::move(volume);
+    m_Stats = VolumeStats();
+    m_BrickGrid = (m_Volume.Size + VOLUME_BRICK_SIZE - 1) / VOLUME_BRICK_SIZE;
+    m_Bricks.assign(static_cast<size_t>(m_BrickGrid.x) * m_BrickGrid.y * m_BrickGrid.z, Brick());
+    m_Stats.Bricks = m_Bricks.size();
+
+    // Min/max over each brick with its apron: everything a sample inside it can filter from
+    size_t brick = 0;
+    for (int bz = 0; bz < m_BrickGrid.z; bz++) {
+        for (int by = 0; by < m_BrickGrid.y; by++) {
+            for (int bx = 0; bx < m_BrickGrid.x; bx++, brick++) {
+                glm::ivec3 lo = glm::max(glm::ivec3(bx, by, bz) * VOLUME_BRICK_SIZE - VOLUME_BRICK_APRON, glm::ivec3(0, 0, 0));
+                glm::ivec3 hi = glm::min((glm::ivec3(bx, by, bz) + 1) * VOLUME_BRICK_SIZE + VOLUME_BRICK_APRON, m_Volume.Size);
+                uint16_t low = 0xFFFF, high = 0;
+                for (int z = lo.z; z < hi.z; z++) {
+                    for (int y = lo.y; y < hi.y; y++) {
+                        size_t row = (static_cast<size_t>(z) * m_Volume.Size.y + y) * m_Volume.Size.x;
+                        for (int x = lo.x; x < hi.x; x++) {
+                            uint16_t value = ReadVoxel(m_Volume, row + x);
+                            low = std::min(low, value);
+                            high = std::max(high, value);
+                        }
+                    }
+                }
+                m_Bricks[brick].Min = low;
+                m_Bricks[brick].Max = high;
+            }
+        }
+    }
+
+    // Pool slots packed into a roughly cubic atlas, never more than there are bricks
+    const int stored = VOLUME_BRICK_SIZE + 2 * VOLUME_BRICK_APRON;
+    unsigned int format = m_Volume.BytesPerVoxel == 1 ? GL_R8 : GL_R16;
+    size_t brickBytes = static_cast<size_t>(stored) * stored * stored * m_Volume.BytesPerVoxel;
+    int perSide = VOLUME_ATLAS_MAX_SIDE / stored;
+    size_t slots = std::clamp<size_t>(poolBytes / brickBytes, 1, std::min(m_Bricks.size(), static_cast<size_t>(perSide) * perSide * perSide));
+    int side = std::min(static_cast<int>(std::ceil(std::cbrt(static_cast<double>(slots)))), perSide);
+    m_AtlasSlots = glm::ivec3(side, side, static_cast<int>((slots + side * side - 1) / (side * side)));
+    m_SlotBricks.assign(slots, -1);
+    m_SlotUsed.assign(slots, 0);
+    m_Stats.Slots = slots;
+    m_Stats.PoolBytes = brickBytes * m_AtlasSlots.x * m_AtlasSlots.y * m_AtlasSlots.z;
+    m_Atlas = TextureHandle(backend, backend.CreateTexture3D(format, m_AtlasSlots.x * stored, m_AtlasSlots.y * stored,
+                                                             m_AtlasSlots.z * stored, nullptr));
+
+    std::vector<unsigned char> fallback = Downsample(m_Volume, VOLUME_FALLBACK_FACTOR, m_FallbackSize);
+    m_Fallback = TextureHandle(backend, backend.CreateTexture3D(format, m_FallbackSize.x, m_FallbackSize.y, m_FallbackSize.z,
+                                                                fallback.data()));
+    m_Pages.assign(m_Bricks.size() * 4, 0);
+    m_PageTable = TextureHandle(backend, backend.CreateTexture3D(GL_RGBA8UI, m_BrickGrid.x, m_BrickGrid.y, m_BrickGrid.z,
+                                                                 m_Pages.data()));
+    m_Staging.resize(brickBytes);
+    SetBounds(glm::vec3(-1.0f), glm::vec3(1.0f));
+    SetTransferFunction(backend, GetDefaultTransferFunction());
+    return true;
+}
+
+void VolumeRenderer::SetTransferFunction(RenderBackend& backend, const std::vector<TransferPoint>& points) {
+    std::vector<unsigned char> table(VOLUME_TRANSFER_ENTRIES * 4);
+    for (int i = 0; i < VOLUME_TRANSFER_ENTRIES; i++) {
+        float value = static_cast<float>(i) / (VOLUME_TRANSFER_ENTRIES - 1);
+        glm::vec4 color(0.0f);
+        for (size_t p = 0; p < points.size(); p++) {
+            if (points[p].Value >= value) {
+                if (p == 0) {
+                    color = points[0].Color;
+                } else {
+                    float span = std::max(points[p].Value - points[p - 1].Value, 1e-6f);
+                    float f = (value - points[p - 1].Value) / span;
+                    color = points[p - 1].Color * (1.0f - f) + points[p].Color * f;
+                }
+                break;
+            }
+            color = points[p].Color;
+        }
+        for (int c = 0; c < 4; c++)
+            table[i * 4 + c] = static_cast<unsigned char>(std::clamp(color[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+    m_Transfer = TextureHandle(backend, backend.CreateTexture(GL_RGBA8, VOLUME_TRANSFER_ENTRIES, 1, table.data()));
+
+    // A brick matters if any value between its min and max is not fully transparent
+    m_Stats.VisibleBricks = 0;
+    for (size_t i = 0; i < m_Bricks.size(); i++) {
+        Brick& brick = m_Bricks[i];
+        int first = brick.Min * (VOLUME_TRANSFER_ENTRIES - 1) / 0xFFFF;
+        int last = (brick.Max * (VOLUME_TRANSFER_ENTRIES - 1) + 0xFFFE) / 0xFFFF;
+        brick.Visible = false;
+        for (int entry = first; entry <= last && !brick.Visible; entry++)
+            brick.Visible = table[entry * 4 + 3] > 0;
+        m_Stats.VisibleBricks += brick.Visible;
+        if (!brick.Visible && brick.Slot >= 0) {
+            m_SlotBricks[brick.Slot] = -1;
+            brick.Slot = -1;
+        }
+        m_Pages[i * 4 + 3] = !brick.Visible ? VOLUME_PAGE_EMPTY : brick.Slot >= 0 ? VOLUME_PAGE_RESIDENT : VOLUME_PAGE_FALLBACK;
+    }
+    m_PagesDirty = true;
+}
+
+void VolumeRenderer::SetBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    m_BoundsMin = boundsMin;
+    m_BoundsMax = boundsMax;
+}
+
+void VolumeRenderer::ExtractBrick(size_t index) {
+    const int stored = VOLUME_BRICK_SIZE + 2 * VOLUME_BRICK_APRON;
+    const size_t bytes = m_Volume.BytesPerVoxel;
+    glm::ivec3 brick(static_cast<int>(index % m_BrickGrid.x), static_cast<int>(index / m_BrickGrid.x % m_BrickGrid.y),
+                     static_cast<int>(index / (static_cast<size_t>(m_BrickGrid.x) * m_BrickGrid.y)));
+    glm::ivec3 origin = brick * VOLUME_BRICK_SIZE - VOLUME_BRICK_APRON;
+    // Voxels outside the volume repeat its edge, as clamped sampling would
+    int x0 = std::max(origin.x, 0), x1 = std::min(origin.x + stored, m_Volume.Size.x);
+    unsigned char* out = m_Staging.data();
+    for (int z = 0; z < stored; z++) {
+        int sz = std::clamp(origin.z + z, 0, m_Volume.Size.z - 1);
+        for (int y = 0; y < stored; y++, out += stored * bytes) {
+            int sy = std::clamp(origin.y + y, 0, m_Volume.Size.y - 1);
+            const unsigned char* row = m_Volume.Voxels.data() + (static_cast<size_t>(sz) * m_Volume.Size.y + sy) * m_Volume.Size.x * bytes;
+            std::memcpy(out + (x0 - origin.x) * bytes, row + x0 * bytes, (x1 - x0) * bytes);
+            for (int x = 0; x < x0 - origin.x; x++)
+                std::memcpy(out + x * bytes, row, bytes);
+            for (int x = x1 - origin.x; x < stored; x++)
+                std::memcpy(out + x * bytes, row + (m_Volume.Size.x - 1) * bytes, bytes);
+        }
+    }
+}
+
+void VolumeRenderer::StreamBricks(RenderBackend& backend, const glm::mat4& viewProj, const glm::vec3& eye) {
+    m_Frame++;
+    Frustum frustum = ExtractFrustum(viewProj);
+    glm::vec3 brickWorld = (m_BoundsMax - m_BoundsMin) / glm::vec3(m_Volume.Size) * static_cast<float>(VOLUME_BRICK_SIZE);
+
+    // Visible bricks in the view, nearest first; resident ones are marked used
+    std::vector<std::pair<float, size_t>> missing;
+    m_Stats.WantedBricks = 0;
+    size_t index = 0;
+    for (int bz = 0; bz < m_BrickGrid.z; bz++) {
+        for (int by = 0; by < m_BrickGrid.y; by++) {
+            for (int bx = 0; bx < m_BrickGrid.x; bx++, index++) {
+                Brick& brick = m_Bricks[index];
+                if (!brick.Visible)
+                    continue;
+                glm::vec3 lo = m_BoundsMin + glm::vec3(static_cast<float>(bx), static_cast<float>(by), static_cast<float>(bz)) * brickWorld;
+                glm::vec3 hi = glm::min(lo + brickWorld, m_BoundsMax);
+                if (!IsBoxVisible(frustum, lo, hi))
+                    continue;
+                m_Stats.WantedBricks++;
+                if (brick.Slot >= 0) {
+                    m_SlotUsed[brick.Slot] = m_Frame;
+                    continue;
+                }
+                glm::vec3 offset = (lo + hi) * 0.5f - eye;
+                missing.emplace_back(glm::dot(offset, offset), index);
+            }
+        }
+    }
+    std::sort(missing.begin(), missing.end());
+
+    // Free slots first, then the least recently used that this view does not need
+    std::vector<size_t> candidates;
+    for (size_t slot = 0; slot < m_SlotBricks.size(); slot++) {
+        if (m_SlotUsed[slot] != m_Frame)
+            candidates.push_back(slot);
+    }
+    std::sort(candidates.begin(), candidates.end(), [this](size_t a, size_t b) {
+        bool freeA = m_SlotBricks[a] < 0, freeB = m_SlotBricks[b] < 0;
+        return freeA != freeB ? freeA : m_SlotUsed[a] < m_SlotUsed[b];
+    });
+
+    const int stored = VOLUME_BRICK_SIZE + 2 * VOLUME_BRICK_APRON;
+    size_t uploads = std::min({ missing.size(), candidates.size(), std::max<size_t>(VOLUME_UPLOAD_BYTES_PER_FRAME / m_Staging.size(), 1) });
+    for (size_t i = 0; i < uploads; i++) {
+        size_t slot = candidates[i];
+        if (m_SlotBricks[slot] >= 0) {
+            Brick& evicted = m_Bricks[m_SlotBricks[slot]];
+            evicted.Slot = -1;
+            m_Pages[m_SlotBricks[slot] * 4 + 3] = VOLUME_PAGE_FALLBACK;
+        }
+        size_t brick = missing[i].second;
+        glm::ivec3 coord(static_cast<int>(slot % m_AtlasSlots.x), static_cast<int>(slot / m_AtlasSlots.x % m_AtlasSlots.y),
+                         static_cast<int>(slot / (static_cast<size_t>(m_AtlasSlots.x) * m_AtlasSlots.y)));
+        ExtractBrick(brick);
+        backend.UpdateTexture3D(m_Atlas.Get(), coord.x * stored, coord.y * stored, coord.z * stored, stored, stored, stored,
+                                m_Staging.data());
+        m_Bricks[brick].Slot = static_cast<int>(slot);
+        m_SlotBricks[slot] = static_cast<int>(brick);
+        m_SlotUsed[slot] = m_Frame;
+        m_Pages[brick * 4 + 0] = static_cast<unsigned char>(coord.x);
+        m_Pages[brick * 4 + 1] = static_cast<unsigned char>(coord.y);
+        m_Pages[brick * 4 + 2] = static_cast<unsigned char>(coord.z);
+        m_Pages[brick * 4 + 3] = VOLUME_PAGE_RESIDENT;
+        m_PagesDirty = true;
+    }
+    m_Stats.UploadedBricks = uploads;
+    m_Stats.MissingBricks = missing.size() - uploads;
+    m_Stats.ResidentBricks = m_SlotBricks.size() - std::count(m_SlotBricks.begin(), m_SlotBricks.end(), -1);
+
+    if (m_PagesDirty) {
+        backend.UpdateTexture3D(m_PageTable.Get(), 0, 0, 0, m_BrickGrid.x, m_BrickGrid.y, m_BrickGrid.z, m_Pages.data());
+        m_PagesDirty = false;
+    }
+}
+
+void VolumeRenderer::BeginScene(RenderBackend& backend, int width, int height) {
+    if (!m_SceneTarget || width != m_SceneWidth || height != m_SceneHeight) {
+        m_SceneWidth = width;
+        m_SceneHeight = height;
+        m_SceneColor = TextureHandle(backend, backend.CreateTexture(GL_RGBA8, width, height, nullptr));
+        m_SceneDepth = TextureHandle(backend, backend.CreateTexture(GL_DEPTH_COMPONENT32F, width, height, nullptr));
+        m_SceneTarget = FramebufferHandle(backend, backend.CreateFramebuffer());
+        backend.FramebufferTexture(GL_COLOR_ATTACHMENT0, m_SceneColor.Get());
+        backend.FramebufferTexture(GL_DEPTH_ATTACHMENT, m_SceneDepth.Get());
+    }
+    backend.BindFramebuffer(m_SceneTarget.Get());
+    backend.SetViewport(0, 0, width, height);
+}
+
+size_t VolumeRenderer::WriteFrameData(RenderBackend& backend, UniformRing& uniforms, const glm::mat4& view, const glm::mat4& proj,
+                                      int width, int height) {
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    StreamBricks(backend, proj * view, eye);
+
+    // Two samples per voxel along the finest axis; the transfer function's
+    // opacities are per voxel, so each sample takes the matching fraction
+    glm::vec3 voxel = (m_BoundsMax - m_BoundsMin) / glm::vec3(m_Volume.Size);
+    float spacing = 0.5f * std::min(voxel.x, std::min(voxel.y, voxel.z));
+    const float stored = static_cast<float>(VOLUME_BRICK_SIZE + 2 * VOLUME_BRICK_APRON);
+
+    size_t offset = uniforms.Allocate();
+    VolumeFrame& frame = *uniforms.GetSlot<VolumeFrame>(offset);
+    frame.u_InverseViewProj = glm::inverse(proj * view);
+    frame.u_Eye = glm::vec4(eye, spacing);
+    frame.u_BoundsMin = glm::vec4(m_BoundsMin, spacing / std::min(voxel.x, std::min(voxel.y, voxel.z)));
+    frame.u_VoxelSize = glm::vec4(voxel, 0.0f);
+    frame.u_VolumeSize = glm::vec4(glm::vec3(m_Volume.Size), 0.0f);
+    frame.u_BrickGrid = glm::ivec4(m_BrickGrid.x, m_BrickGrid.y, m_BrickGrid.z, VOLUME_BRICK_SIZE);
+    frame.u_AtlasScale = glm::vec4(1.0f / (glm::vec3(m_AtlasSlots) * stored), stored);
+    frame.u_FallbackScale = glm::vec4(1.0f / (glm::vec3(m_FallbackSize) * static_cast<float>(VOLUME_FALLBACK_FACTOR)), 0.0f);
+    frame.u_Viewport = glm::vec4(static_cast<float>(width), static_cast<float>(height), 0.0f, 0.0f);
+    return offset;
+}
+
+void VolumeRenderer::Draw(RenderBackend& backend, const UniformRing& uniforms, size_t offset, int width, int height) {
+    backend.BindFramebuffer(0);
+    backend.SetViewport(0, 0, width, height);
+    backend.Clear();
+    backend.BindBufferRange(GL_UNIFORM_BUFFER, VolumeFrame::Binding, uniforms.GetBuffer(), offset, sizeof(VolumeFrame));
+    backend.BindTexture(0, m_SceneColor.Get());
+    backend.BindTexture(1, m_SceneDepth.Get());
+    backend.BindTexture3D(2, m_Atlas.Get());
+    backend.BindTexture3D(3, m_PageTable.Get());
+    backend.BindTexture3D(4, m_Fallback.Get());
+    backend.BindTexture(5, m_Transfer.Get());
+    backend.UseProgram(m_Shader->Get(0));
+    backend.BindVertexArray(m_Triangle.Get());
+    backend.DrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void VolumeRenderer::Release() {
+    m_SceneTarget.Reset();
+    m_SceneColor.Reset();
+    m_SceneDepth.Reset();
+    m_PageTable.Reset();
+    m_Atlas.Reset();
+    m_Fallback.Reset();
+    m_Transfer.Reset();
+    m_Triangle.Reset();
+    m_TriangleBuffer.Reset();
+    m_Shader = nullptr;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "GLResource.h"
+#include "ShaderVariants.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class RenderBackend;
+class UniformRing;
+
+#define VOLUME_SHADER_PATH "res/shaders/Volume.shader"
+// Voxels per brick side; bricks are stored with one more voxel of their
+// neighbours on every side so linear filtering never reads across slots
+#define VOLUME_BRICK_SIZE 32
+#define VOLUME_BRICK_APRON 1
+// GPU memory for resident bricks. Volumes that need more stream the bricks
+// in view through it and fall back to the low-resolution copy elsewhere.
+#define VOLUME_POOL_BYTES (256u * 1024 * 1024)
+// What current desktop drivers allow; GL 3.3 itself only promises 256
+#define VOLUME_ATLAS_MAX_SIDE 2048
+// Brick uploads per frame, nearest to the eye first
+#define VOLUME_UPLOAD_BYTES_PER_FRAME (8u * 1024 * 1024)
+// Voxels of the full volume per voxel of the always-resident fallback
+#define VOLUME_FALLBACK_FACTOR 4
+#define VOLUME_TRANSFER_ENTRIES 256
+
+// A scalar field on a regular grid, one or two bytes per voxel, x fastest
+struct VolumeData {
+    glm::ivec3 Size = glm::ivec3(0, 0, 0);
+    int BytesPerVoxel = 1;
+    std::vector<unsigned char> Voxels;
+};
+
+// Raw files carry no header, so the name does: skull_256x256x256_uint8.raw or
+// ..._uint16.raw (little endian), as the open scivis datasets are named
+bool LoadRawVolume(const std::string& path, VolumeData& volume);
+// A CT-like test volume: air, a head of soft tissue with denser organs
+// inside, and a skull shell
+VolumeData MakeTestVolume(int size);
+
+// Opacity and color at increasing normalized values, linear in between
+struct TransferPoint {
+    float Value = 0.0f;
+    glm::vec4 Color = glm::vec4(0.0f);
+};
+// Transparent air, faint reddish soft tissue, denser organs and bone
+std::vector<TransferPoint> GetDefaultTransferFunction();
+
+struct VolumeStats {
+    size_t Bricks = 0;
+    size_t VisibleBricks = 0;      // not fully transparent under the transfer function
+    size_t Slots = 0;              // bricks the pool holds
+    size_t ResidentBricks = 0;
+    size_t WantedBricks = 0;       // last frame: visible bricks inside the view
+    size_t MissingBricks = 0;      // last frame: of those, drawn from the fallback
+    size_t UploadedBricks = 0;     // last frame
+    size_t PoolBytes = 0;
+};
+
+// Raymarches a scalar volume through a transfer function over the scene
+// drawn before it. The scene renders into an offscreen color and depth
+// target; the full-screen composite pass stops each ray at the scene's depth
+// and blends what it gathered over the scene's color, so meshes inside the
+// volume show through it correctly.
+//
+// The volume is cut into bricks with a min/max each. Bricks the transfer
+// function maps to nothing are marked empty in a page table and rays skip
+// them whole, brick by brick; the others are uploaded on demand into a fixed
+// pool of slots in an atlas texture, least recently used out first. A ray
+// stops once it is practically opaque.
+class VolumeRenderer {
+public:
+    // Compiles `shader` (loaded from VOLUME_SHADER_PATH, and outliving the
+    // renderer) and makes the page table, atlas and fallback; false when the
+    // shader does not build or the volume is empty
+    bool Init(RenderBackend& backend, ShaderVariantSet& shader, VolumeData volume, size_t poolBytes = VOLUME_POOL_BYTES);
+    // Reclassifies the bricks; ones that become empty free their slots
+    void SetTransferFunction(RenderBackend& backend, const std::vector<TransferPoint>& points);
+    // World-space box the volume fills
+    void SetBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    // Binds the offscreen target the scene renders into before the frame's
+    // Clear, (re)making it at the view's size
+    void BeginScene(RenderBackend& backend, int width, int height);
+    // Between the uniform ring's BeginFrame and FinishWrites: streams in the
+    // bricks this view needs, writes the VolumeFrame block and returns its offset
+    size_t WriteFrameData(RenderBackend& backend, UniformRing& uniforms, const glm::mat4& view, const glm::mat4& proj,
+                          int width, int height);
+    // Composites into the default framebuffer, which is left bound with a full viewport
+    void Draw(RenderBackend& backend, const UniformRing& uniforms, size_t offset, int width, int height);
+    // Drops the GL objects; call before the context goes away
+    void Release();
+
+    const VolumeStats& GetStats() const { return m_Stats; }
+
+private:
+    struct Brick {
+        uint16_t Min = 0, Max = 0;     // over the brick and its apron
+        bool Visible = false;
+        int Slot = -1;
+    };
+
+    // Copies brick `index` with its apron into m_Staging, in the atlas format
+    void ExtractBrick(size_t index);
+    void StreamBricks(RenderBackend& backend, const glm::mat4& viewProj, const glm::vec3& eye);
+
+    ShaderVariantSet* m_Shader = nullptr;
+    VertexArrayHandle m_Triangle;
+    BufferHandle m_TriangleBuffer;
+
+    VolumeData m_Volume;
+    glm::vec3 m_BoundsMin = glm::vec3(-1.0f), m_BoundsMax = glm::vec3(1.0f);
+    glm::ivec3 m_BrickGrid = glm::ivec3(1, 1, 1);
+    std::vector<Brick> m_Bricks;
+    std::vector<unsigned char> m_Pages;        // RGBA8UI per brick: slot x, y, z, state
+    bool m_PagesDirty = false;
+    std::vector<int> m_SlotBricks;             // brick in each slot, -1 when free
+    std::vector<unsigned long long> m_SlotUsed;    // frame each slot was last wanted
+    std::vector<unsigned char> m_Staging;
+    glm::ivec3 m_AtlasSlots = glm::ivec3(1, 1, 1);
+    unsigned long long m_Frame = 0;
+
+    TextureHandle m_PageTable;
+    TextureHandle m_Atlas;
+    TextureHandle m_Fallback;
+    glm::ivec3 m_FallbackSize = glm::ivec3(1, 1, 1);
+    TextureHandle m_Transfer;
+
+    TextureHandle m_SceneColor;
+    TextureHandle m_SceneDepth;
+    FramebufferHandle m_SceneTarget;
+    int m_SceneWidth = 0, m_SceneHeight = 0;
+
+    VolumeStats m_Stats;
+};
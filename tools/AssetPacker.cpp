@@ -0,0 +1,188 @@
+// Builds an AssetPack from loose files. Assets are named by the path given on
+// the command line joined with their path below it, so packing `res` from
+// the working directory the app runs in yields the names it already opens
+// (res/shaders/Cube.shader). The pack is read back and compared against
+// the sources before the tool exits.
+//
+// Usage: AssetPacker <output.pack> <file or directory>... [--stored]
+
+#include "../src/AssetPack.h"
+#include "../src/JobSystem.h"
+#include "../src/Lz4.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+struct SourceAsset {
+    std::string Name;
+    std::string Data;
+    uint32_t FirstBlock = 0;
+};
+
+struct EncodedBlock {
+    const SourceAsset* Asset = nullptr;
+    uint64_t RawOffset = 0;
+    std::vector<char> Stored;
+    PackCompression Compression = PackCompression::Stored;
+};
+
+static bool ReadSource(const std::filesystem::path& path, std::vector<SourceAsset>& assets) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        std::cout << "Cannot read " << path.generic_string() << std::endl;
+        return false;
+    }
+    SourceAsset asset;
+    asset.Name = path.lexically_normal().generic_string();
+    asset.Data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    assets.push_back(std::move(asset));
+    return true;
+}
+
+static uint64_t AlignUp(uint64_t value) {
+    return (value + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cout << "Usage: AssetPacker <output.pack> <file or directory>... [--stored]" << std::endl;
+        return 1;
+    }
+    std::string output = argv[1];
+    bool compress = true;
+    std::vector<SourceAsset> assets;
+    for (int i = 2; i < argc; i++) {
+        if (std::strcmp(argv[i], "--stored") == 0) {
+            compress = false;
+            continue;
+        }
+        std::filesystem::path input = argv[i];
+        if (std::filesystem::is_directory(input)) {
+            for (const auto& file : std::filesystem::recursive_directory_iterator(input))
+                if (file.is_regular_file() && !ReadSource(file.path(), assets))
+                    return 1;
+        } else if (!ReadSource(input, assets)) {
+            return 1;
+        }
+    }
+
+    std::sort(assets.begin(), assets.end(), [](const SourceAsset& a, const SourceAsset& b) { return a.Name < b.Name; });
+    for (size_t i = 1; i < assets.size(); i++) {
+        if (assets[i].Name == assets[i - 1].Name) {
+            std::cout << "Duplicate asset " << assets[i].Name << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<EncodedBlock> blocks;
+    for (SourceAsset& asset : assets) {
+        asset.FirstBlock = static_cast<uint32_t>(blocks.size());
+        for (uint64_t offset = 0; offset < asset.Data.size(); offset += ASSET_PACK_BLOCK_SIZE) {
+            EncodedBlock block;
+            block.Asset = &asset;
+            block.RawOffset = offset;
+            blocks.push_back(std::move(block));
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    JobSystem jobs;
+    jobs.Dispatch(static_cast<unsigned int>(blocks.size()), [&](unsigned int index) {
+        EncodedBlock& block = blocks[index];
+        const char* raw = block.Asset->Data.data() + block.RawOffset;
+        size_t rawSize = std::min<size_t>(ASSET_PACK_BLOCK_SIZE, block.Asset->Data.size() - block.RawOffset);
+        if (compress) {
+            block.Stored.resize(Lz4CompressBound(rawSize));
+            size_t size = Lz4Compress(raw, rawSize, block.Stored.data(), block.Stored.size());
+            // Incompressible blocks are stored so reading them is a plain copy
+            if (size > 0 && size < rawSize) {
+                block.Stored.resize(size);
+                block.Compression = PackCompression::Lz4;
+                return;
+            }
+        }
+        block.Stored.assign(raw, raw + rawSize);
+    });
+
+    std::string names;
+    std::vector<PackEntry> entries;
+    for (const SourceAsset& asset : assets) {
+        PackEntry entry = {};
+        entry.NameOffset = static_cast<uint32_t>(names.size());
+        entry.NameLength = static_cast<uint32_t>(asset.Name.size());
+        entry.Size = asset.Data.size();
+        entry.FirstBlock = asset.FirstBlock;
+        entry.BlockCount = static_cast<uint32_t>((asset.Data.size() + ASSET_PACK_BLOCK_SIZE - 1) / ASSET_PACK_BLOCK_SIZE);
+        entries.push_back(entry);
+        names += asset.Name;
+    }
+
+    PackHeader header = {};
+    std::memcpy(header.Magic, ASSET_PACK_MAGIC, sizeof(header.Magic));
+    header.Version = ASSET_PACK_VERSION;
+    header.AssetCount = static_cast<uint32_t>(entries.size());
+    header.BlockCount = static_cast<uint32_t>(blocks.size());
+    header.NamesSize = static_cast<uint32_t>(names.size());
+    header.DataOffset = AlignUp(sizeof(PackHeader) + entries.size() * sizeof(PackEntry) + blocks.size() * sizeof(PackBlock) + names.size());
+
+    std::vector<PackBlock> table;
+    uint64_t offset = header.DataOffset;
+    uint64_t rawBytes = 0, storedBytes = 0;
+    for (const EncodedBlock& block : blocks) {
+        PackBlock stored = {};
+        stored.Offset = offset;
+        stored.StoredSize = static_cast<uint32_t>(block.Stored.size());
+        stored.Compression = block.Compression;
+        table.push_back(stored);
+        offset = AlignUp(offset + block.Stored.size());
+        storedBytes += block.Stored.size();
+    }
+    for (const SourceAsset& asset : assets)
+        rawBytes += asset.Data.size();
+
+    {
+        std::ofstream out(output, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cout << "Cannot write " << output << std::endl;
+            return 1;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PackEntry)));
+        out.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(PackBlock)));
+        out.write(names.data(), static_cast<std::streamsize>(names.size()));
+        for (size_t i = 0; i < blocks.size(); i++) {
+            out.seekp(static_cast<std::streamoff>(table[i].Offset));
+            out.write(blocks[i].Stored.data(), static_cast<std::streamsize>(blocks[i].Stored.size()));
+        }
+        // Pad the last block so the file size is aligned too
+        std::vector<char> padding(static_cast<size_t>(offset - static_cast<uint64_t>(out.tellp())));
+        out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        if (!out) {
+            std::cout << "Failed writing " << output << std::endl;
+            return 1;
+        }
+    }
+
+    AssetPack pack;
+    if (!pack.Open(output))
+        return 1;
+    for (const SourceAsset& asset : assets) {
+        std::string data;
+        if (!pack.Read(asset.Name, data, &jobs) || data != asset.Data) {
+            std::cout << "Verification failed for " << asset.Name << std::endl;
+            return 1;
+        }
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Packed " << assets.size() << " asset(s), " << blocks.size() << " block(s): " << rawBytes << " -> "
+              << storedBytes << " bytes (" << offset << " on disk) in " << ms << " ms" << std::endl;
+    return 0;
+}
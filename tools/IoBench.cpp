@@ -0,0 +1,196 @@
+// Measures asset read throughput: std::ifstream against AsyncIO on the
+// thread-pool fallback, io_uring, io_uring into registered buffers and
+// io_uring with O_DIRECT. Each mode runs once with the page cache dropped
+// for the test files (cold) and once right after (warm).
+//
+// Usage: IoBench [directory] [--files N] [--size MB] [--chunk KB]
+
+#include "../src/AsyncIO.h"
+#include "../src/JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+struct BenchConfig {
+    std::string Directory = "iobench_data";
+    int Files = 32;
+    size_t FileBytes = 4 << 20;
+    size_t ChunkBytes = 1 << 20;
+};
+
+static std::vector<std::string> CreateFiles(const BenchConfig& config) {
+    std::filesystem::create_directories(config.Directory);
+    std::vector<std::string> paths;
+    std::vector<char> block(1 << 20);
+    for (size_t i = 0; i < block.size(); i++)
+        block[i] = static_cast<char>(i * 2654435761u >> 24);
+
+    for (int i = 0; i < config.Files; i++) {
+        std::string path = config.Directory + "/asset_" + std::to_string(i) + ".bin";
+        paths.push_back(path);
+        if (std::filesystem::exists(path) && std::filesystem::file_size(path) == config.FileBytes)
+            continue;
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        for (size_t written = 0; written < config.FileBytes; written += block.size())
+            out.write(block.data(), static_cast<std::streamsize>(std::min(block.size(), config.FileBytes - written)));
+    }
+    return paths;
+}
+
+// Drops clean pages of the files so the next read comes from the device.
+// Works without privileges, unlike /proc/sys/vm/drop_caches.
+static void DropCache(const std::vector<std::string>& paths) {
+    for (const std::string& path : paths) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            continue;
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+static size_t ReadIfstream(const std::vector<std::string>& paths, std::vector<char>& buffer) {
+    size_t total = 0;
+    for (const std::string& path : paths) {
+        std::ifstream in(path, std::ios::binary);
+        in.seekg(0, std::ios::end);
+        size_t size = static_cast<size_t>(in.tellg());
+        in.seekg(0);
+        buffer.resize(size);
+        in.read(buffer.data(), static_cast<std::streamsize>(size));
+        total += static_cast<size_t>(in.gcount());
+    }
+    return total;
+}
+
+enum class AsyncMode { Buffered, Registered, Direct };
+
+// Every file is split into chunk-sized reads and all of them are submitted
+// as one batch; each chunk owns a slice of one destination buffer per file
+static size_t ReadAsync(AsyncIO& io, const BenchConfig& config, const std::vector<std::string>& paths,
+                        std::vector<IoBuffer>& buffers, AsyncMode mode) {
+    std::vector<IoFile> files;
+    for (const std::string& path : paths)
+        files.push_back(io.Open(path, mode == AsyncMode::Direct));
+
+    if (mode == AsyncMode::Registered || mode == AsyncMode::Direct) {
+        std::vector<void*> pointers;
+        std::vector<size_t> sizes;
+        for (IoBuffer& buffer : buffers) {
+            pointers.push_back(buffer.Data());
+            // IoBuffer allocations are rounded up to the O_DIRECT alignment
+            sizes.push_back((buffer.Size() + ASYNC_IO_DIRECT_ALIGNMENT - 1) / ASYNC_IO_DIRECT_ALIGNMENT * ASYNC_IO_DIRECT_ALIGNMENT);
+        }
+        io.RegisterBuffers(pointers.data(), sizes.data(), static_cast<unsigned int>(pointers.size()));
+    }
+
+    std::atomic<size_t> total = 0;
+    std::atomic<int> errors = 0;
+    std::vector<IoRead> reads;
+    for (size_t f = 0; f < files.size(); f++) {
+        for (size_t offset = 0; offset < files[f].Size; offset += config.ChunkBytes) {
+            IoRead read;
+            read.Fd = files[f].Fd;
+            read.Offset = offset;
+            read.Buffer = buffers[f].Data() + offset;
+            read.Size = std::min(config.ChunkBytes, files[f].Size - offset);
+            if (files[f].Direct)
+                read.Size = (read.Size + ASYNC_IO_DIRECT_ALIGNMENT - 1) / ASYNC_IO_DIRECT_ALIGNMENT * ASYNC_IO_DIRECT_ALIGNMENT;
+            read.RegisteredBuffer = mode == AsyncMode::Buffered ? -1 : static_cast<int>(f);
+            read.OnComplete = [&](const IoResult& result) {
+                total += result.Bytes;
+                if (result.Error)
+                    errors++;
+            };
+            reads.push_back(std::move(read));
+        }
+    }
+    io.Submit(reads.data(), reads.size());
+    io.WaitIdle();
+
+    io.UnregisterBuffers();
+    for (IoFile& file : files)
+        io.Close(file);
+    if (errors > 0)
+        std::cout << "  " << errors << " read error(s)" << std::endl;
+    return total;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc)
+            config.Files = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            config.FileBytes = static_cast<size_t>(std::atof(argv[++i]) * 1024 * 1024);
+        else if (std::strcmp(argv[i], "--chunk") == 0 && i + 1 < argc)
+            config.ChunkBytes = static_cast<size_t>(std::atoi(argv[++i])) * 1024;
+        else if (argv[i][0] != '-')
+            config.Directory = argv[i];
+        else {
+            std::cerr << "Usage: IoBench [directory] [--files N] [--size MB] [--chunk KB]" << std::endl;
+            return 1;
+        }
+    }
+    // O_DIRECT chunks must stay block aligned
+    config.ChunkBytes = std::max<size_t>(config.ChunkBytes / ASYNC_IO_DIRECT_ALIGNMENT * ASYNC_IO_DIRECT_ALIGNMENT,
+                                         ASYNC_IO_DIRECT_ALIGNMENT);
+
+    std::vector<std::string> paths = CreateFiles(config);
+    size_t expected = config.FileBytes * paths.size();
+    std::vector<IoBuffer> buffers;
+    for (size_t i = 0; i < paths.size(); i++)
+        buffers.emplace_back(config.FileBytes);
+    std::vector<char> streamBuffer;
+
+    JobSystem jobs;
+    AsyncIO pool(&jobs, false);
+    AsyncIO ring(&jobs);
+    if (!ring.UsesUring())
+        std::cout << "io_uring unavailable; the io_uring rows use the " << ring.GetBackendName() << " fallback" << std::endl;
+
+    struct Mode {
+        const char* Name;
+        std::function<size_t()> Run;
+    };
+    Mode modes[] = {
+        { "ifstream",                 [&] { return ReadIfstream(paths, streamBuffer); } },
+        { "thread pool pread",        [&] { return ReadAsync(pool, config, paths, buffers, AsyncMode::Buffered); } },
+        { "io_uring",                 [&] { return ReadAsync(ring, config, paths, buffers, AsyncMode::Buffered); } },
+        { "io_uring registered",      [&] { return ReadAsync(ring, config, paths, buffers, AsyncMode::Registered); } },
+        { "io_uring O_DIRECT",        [&] { return ReadAsync(ring, config, paths, buffers, AsyncMode::Direct); } },
+    };
+
+    std::cout << paths.size() << " file(s) of " << config.FileBytes / 1024 << " KB in " << config.Directory
+              << ", " << config.ChunkBytes / 1024 << " KB reads" << std::endl;
+    std::cout << std::left << std::setw(24) << "mode" << std::right << std::setw(14) << "cold MB/s" << std::setw(14) << "warm MB/s" << std::endl;
+    for (Mode& mode : modes) {
+        double rates[2];
+        for (int warm = 0; warm < 2; warm++) {
+            if (!warm)
+                DropCache(paths);
+            auto start = std::chrono::steady_clock::now();
+            size_t bytes = mode.Run();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            rates[warm] = bytes / (1024.0 * 1024.0) / seconds;
+            if (bytes != expected)
+                std::cout << "  " << mode.Name << " read " << bytes << " of " << expected << " bytes" << std::endl;
+        }
+        std::cout << std::left << std::setw(24) << mode.Name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << rates[0] << std::setw(14) << rates[1] << std::defaultfloat << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,317 @@
+// Reference renderer for the rasterized scenes: loads the same .scene file,
+// looks through the same camera and projection (SceneCameraDesc and
+// CameraProjection), and path traces the triangle meshes with diffuse
+// materials under a sky and a sun. Line meshes are skipped.
+//
+// Triangles are flattened to world space into a four-wide BVH (src/Bvh.h)
+// that tests a ray against four boxes per SSE step. The image is cut into
+// tiles that the job system spreads over every core; each pass adds one
+// sample per pixel, and the running average is written out every few passes
+// so a long render can be looked at while it converges.
+//
+// Usage: PathTracer [scene] [--width W] [--height H] [--spp N] [--bounces N]
+//                   [--threads N] [--out image.ppm]
+
+#include "../src/Bvh.h"
+#include "../src/JobSystem.h"
+#include "../src/SceneFile.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define PATH_TRACER_TILE_SIZE 32
+// Paths that survive this many bounces continue with probability = throughput
+#define PATH_TRACER_ROULETTE_DEPTH 2
+// Seconds between progressive writes of the image
+#define PATH_TRACER_WRITE_INTERVAL 2.0
+
+struct Triangle {
+    glm::vec3 V0, Edge1, Edge2;
+    glm::vec3 Normal;
+    glm::vec3 Albedo;
+};
+
+struct Hit {
+    float T = FLT_MAX;
+    uint32_t Triangle = 0;
+};
+
+struct TraceScene {
+    std::vector<Triangle> Triangles;
+    Bvh4 Bvh;
+    glm::mat4 InverseViewProjection;
+    glm::vec3 SunDirection = glm::normalize(glm::vec3(0.4f, 1.0f, 0.3f));
+    glm::vec3 SunRadiance = glm::vec3(2.5f);
+};
+
+struct TraceSettings {
+    int Width = 960;
+    int Height = 540;
+    int Samples = 64;
+    int Bounces = 4;
+};
+
+// PCG32: small state, good enough for thousands of samples per pixel
+struct Random {
+    uint64_t State;
+
+    explicit Random(uint64_t seed) : State(seed * 6364136223846793005ull + 1442695040888963407ull) { Next(); }
+    uint32_t Next() {
+        uint64_t old = State;
+        State = old * 6364136223846793005ull + 1442695040888963407ull;
+        uint32_t shifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        uint32_t rotation = static_cast<uint32_t>(old >> 59u);
+        return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+    }
+    float Uniform() { return (Next() >> 8) * (1.0f / 16777216.0f); }
+};
+
+static void AddTriangles(TraceScene& trace, const SceneDesc& desc, const SceneObjectDesc& object, size_t& skipped) {
+    const SceneMeshDesc& mesh = desc.Meshes[object.Mesh];
+    const SceneMeshDesc& source = mesh.Parent >= 0 ? desc.Meshes[mesh.Parent] : mesh;
+    if (mesh.Mode != GL_TRIANGLES) {
+        skipped++;
+        return;
+    }
+    size_t vertexCount = source.Positions.size() / 3;
+    bool indexed = !source.Indices.empty();
+    size_t first = mesh.Parent >= 0 ? mesh.First : 0;
+    size_t count = mesh.Parent >= 0 ? mesh.Count : (indexed ? source.Indices.size() : vertexCount);
+
+    auto vertex = [&](size_t i) {
+        size_t index = indexed ? source.Indices[first + i] : first + i;
+        if (index >= vertexCount)
+            return glm::vec3(0.0f);
+        const float* p = &source.Positions[index * 3];
+        return glm::vec3(object.Model * glm::vec4(p[0], p[1], p[2], 1.0f));
+    };
+    for (size_t i = 0; i + 2 < count; i += 3) {
+        Triangle triangle;
+        triangle.V0 = vertex(i);
+        triangle.Edge1 = vertex(i + 1) - triangle.V0;
+        triangle.Edge2 = vertex(i + 2) - triangle.V0;
+        glm::vec3 normal = glm::cross(triangle.Edge1, triangle.Edge2);
+        float length = glm::length(normal);
+        if (length == 0.0f)
+            continue;                  // degenerate, can never be hit
+        triangle.Normal = normal / length;
+        triangle.Albedo = glm::vec3(object.Color);
+        trace.Triangles.push_back(triangle);
+    }
+}
+
+// Möller-Trumbore; true when the hit is closer than tMax
+static bool IntersectTriangle(const Triangle& triangle, const BvhRay& ray, float& tMax) {
+    glm::vec3 p = glm::cross(ray.Direction, triangle.Edge2);
+    float determinant = glm::dot(triangle.Edge1, p);
+    if (std::fabs(determinant) < 1e-12f)
+        return false;
+    float inverse = 1.0f / determinant;
+    glm::vec3 s = ray.Origin - triangle.V0;
+    float u = glm::dot(s, p) * inverse;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+    glm::vec3 q = glm::cross(s, triangle.Edge1);
+    float v = glm::dot(ray.Direction, q) * inverse;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+    float t = glm::dot(triangle.Edge2, q) * inverse;
+    if (t <= 1e-4f || t >= tMax)
+        return false;
+    tMax = t;
+    return true;
+}
+
+static glm::vec3 Sky(const glm::vec3& direction) {
+    if (direction.y < 0.0f)
+        return glm::vec3(0.25f, 0.23f, 0.2f);
+    return glm::mix(glm::vec3(1.0f), glm::vec3(0.45f, 0.65f, 1.0f), direction.y);
+}
+
+// Cosine-weighted direction around `normal`
+static glm::vec3 SampleHemisphere(const glm::vec3& normal, Random& random) {
+    float r1 = random.Uniform(), r2 = random.Uniform();
+    float phi = 6.28318531f * r1, radius = std::sqrt(r2);
+    glm::vec3 tangent = glm::normalize(glm::cross(std::fabs(normal.x) > 0.5f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0), normal));
+    glm::vec3 bitangent = glm::cross(normal, tangent);
+    return glm::normalize(tangent * (radius * std::cos(phi)) + bitangent * (radius * std::sin(phi)) + normal * std::sqrt(1.0f - r2));
+}
+
+static glm::vec3 TracePath(const TraceScene& trace, BvhRay ray, int bounces, Random& random, uint64_t& rays) {
+    glm::vec3 radiance(0.0f), throughput(1.0f);
+    for (int depth = 0;; depth++) {
+        Hit hit;
+        rays++;
+        trace.Bvh.Intersect(ray, hit.T, [&](uint32_t index, float& tMax) {
+            if (!IntersectTriangle(trace.Triangles[index], ray, tMax))
+                return false;
+            hit.Triangle = index;
+            return true;
+        });
+        if (hit.T == FLT_MAX)
+            return radiance + throughput * Sky(ray.Direction);
+        if (depth >= bounces)
+            return radiance;
+
+        const Triangle& triangle = trace.Triangles[hit.Triangle];
+        glm::vec3 normal = glm::dot(triangle.Normal, ray.Direction) < 0.0f ? triangle.Normal : -triangle.Normal;
+        glm::vec3 position = ray.Origin + ray.Direction * hit.T + normal * 1e-4f;
+
+        // Direct sun light with a shadow ray; the sky reaches the path by bouncing
+        float sun = glm::dot(normal, trace.SunDirection);
+        if (sun > 0.0f) {
+            rays++;
+            BvhRay shadow(position, trace.SunDirection);
+            bool occluded = trace.Bvh.Occluded(shadow, FLT_MAX, [&](uint32_t index, float& tMax) {
+                return IntersectTriangle(trace.Triangles[index], shadow, tMax);
+            });
+            if (!occluded)
+                radiance += throughput * triangle.Albedo * trace.SunRadiance * (sun / 3.14159265f);
+        }
+
+        // Diffuse: cosine sampling cancels the cosine and 1/pi, leaving the albedo
+        throughput *= triangle.Albedo;
+        if (depth >= PATH_TRACER_ROULETTE_DEPTH) {
+            float survive = std::min(0.95f, std::max(throughput.x, std::max(throughput.y, throughput.z)));
+            if (random.Uniform() >= survive)
+                return radiance;
+            throughput /= survive;
+        }
+        ray = BvhRay(position, SampleHemisphere(normal, random));
+    }
+}
+
+static void RenderTile(const TraceScene& trace, const TraceSettings& settings, int tile, int pass,
+                       std::vector<glm::vec3>& accumulated, uint64_t& rays) {
+    int columns = (settings.Width + PATH_TRACER_TILE_SIZE - 1) / PATH_TRACER_TILE_SIZE;
+    int x0 = (tile % columns) * PATH_TRACER_TILE_SIZE, y0 = (tile / columns) * PATH_TRACER_TILE_SIZE;
+    int x1 = std::min(x0 + PATH_TRACER_TILE_SIZE, settings.Width), y1 = std::min(y0 + PATH_TRACER_TILE_SIZE, settings.Height);
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            size_t pixel = static_cast<size_t>(y) * settings.Width + x;
+            Random random(pixel * 0x9E3779B97F4A7C15ull + static_cast<uint64_t>(pass));
+            // Jittered through the rasterizer's own clip space, top row first
+            float ndcX = 2.0f * (x + random.Uniform()) / settings.Width - 1.0f;
+            float ndcY = 1.0f - 2.0f * (y + random.Uniform()) / settings.Height;
+            glm::vec4 nearPoint = trace.InverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+            glm::vec4 farPoint = trace.InverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+            glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+            glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+            accumulated[pixel] += TracePath(trace, BvhRay(origin, direction), settings.Bounces, random, rays);
+        }
+    }
+}
+
+static bool WriteImage(const std::string& path, const std::vector<glm::vec3>& accumulated, int width, int height, int passes) {
+    std::vector<unsigned char> pixels(accumulated.size() * 3);
+    for (size_t i = 0; i < accumulated.size(); i++) {
+        for (int c = 0; c < 3; c++) {
+            float value = accumulated[i][c] / passes;
+            value = std::pow(value / (1.0f + value), 1.0f / 2.2f);   // Reinhard, then gamma
+            pixels[i * 3 + c] = static_cast<unsigned char>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << "P6\n" << width << " " << height << "\n255\n";
+    out.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+    return static_cast<bool>(out);
+}
+
+int main(int argc, char** argv) {
+    std::string scenePath = SCENE_DEFAULT_PATH;
+    std::string outPath = "pathtrace.ppm";
+    TraceSettings settings;
+    unsigned int threads = std::thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--width") == 0 && hasValue)
+            settings.Width = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--height") == 0 && hasValue)
+            settings.Height = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--spp") == 0 && hasValue)
+            settings.Samples = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--bounces") == 0 && hasValue)
+            settings.Bounces = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+            threads = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        else if (std::strcmp(argv[i], "--out") == 0 && hasValue)
+            outPath = argv[++i];
+        else if (argv[i][0] != '-')
+            scenePath = argv[i];
+        else {
+            std::cout << "Usage: PathTracer [scene] [--width W] [--height H] [--spp N] [--bounces N] [--threads N] [--out image.ppm]" << std::endl;
+            return 1;
+        }
+    }
+
+    SceneDesc desc;
+    if (!LoadSceneDesc(scenePath, nullptr, desc))
+        return 1;
+
+    auto buildStart = std::chrono::steady_clock::now();
+    TraceScene trace;
+    size_t skipped = 0;
+    for (const SceneObjectDesc& object : desc.Objects)
+        AddTriangles(trace, desc, object, skipped);
+    std::vector<BvhBounds> bounds(trace.Triangles.size());
+    for (size_t i = 0; i < trace.Triangles.size(); i++) {
+        const Triangle& triangle = trace.Triangles[i];
+        bounds[i].Grow(triangle.V0);
+        bounds[i].Grow(triangle.V0 + triangle.Edge1);
+        bounds[i].Grow(triangle.V0 + triangle.Edge2);
+    }
+    trace.Bvh.Build(bounds);
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+    std::cout << "[Path Tracer] " << trace.Triangles.size() << " triangle(s) from " << desc.Objects.size() - skipped
+              << " object(s) (" << skipped << " non-triangle skipped), BVH " << trace.Bvh.GetNodeCount() << " node(s), "
+              << trace.Bvh.GetMemorySize() / 1024 << " KB, built in " << buildMs << " ms" << std::endl;
+
+    const SceneCameraDesc& camera = desc.Camera;
+    float aspect = static_cast<float>(settings.Width) / settings.Height;
+    trace.InverseViewProjection = glm::inverse(CameraProjection(camera, aspect) * glm::lookAt(camera.Eye, camera.Target, camera.Up));
+
+    int columns = (settings.Width + PATH_TRACER_TILE_SIZE - 1) / PATH_TRACER_TILE_SIZE;
+    int rows = (settings.Height + PATH_TRACER_TILE_SIZE - 1) / PATH_TRACER_TILE_SIZE;
+    std::vector<glm::vec3> accumulated(static_cast<size_t>(settings.Width) * settings.Height, glm::vec3(0.0f));
+    std::atomic<uint64_t> rays = 0;
+    // Dispatch runs jobs on the calling thread too
+    JobSystem jobs(threads - 1);
+
+    auto start = std::chrono::steady_clock::now();
+    auto lastWrite = start;
+    for (int pass = 0; pass < settings.Samples; pass++) {
+        jobs.Dispatch(static_cast<unsigned int>(columns * rows), [&](unsigned int tile) {
+            uint64_t tileRays = 0;
+            RenderTile(trace, settings, static_cast<int>(tile), pass, accumulated, tileRays);
+            rays.fetch_add(tileRays, std::memory_order_relaxed);
+        });
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - lastWrite).count() >= PATH_TRACER_WRITE_INTERVAL && pass + 1 < settings.Samples) {
+            lastWrite = now;
+            WriteImage(outPath, accumulated, settings.Width, settings.Height, pass + 1);
+            double seconds = std::chrono::duration<double>(now - start).count();
+            std::cout << "[Path Tracer] " << pass + 1 << "/" << settings.Samples << " spp, "
+                      << rays.load() / seconds * 1e-6 << " Mrays/s" << std::endl;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!WriteImage(outPath, accumulated, settings.Width, settings.Height, settings.Samples)) {
+        std::cout << "[Path Tracer] cannot write " << outPath << std::endl;
+        return 1;
+    }
+    std::cout << "[Path Tracer] " << settings.Width << "x" << settings.Height << " at " << settings.Samples << " spp on "
+              << threads << " thread(s) in " << seconds << " s: " << rays.load() << " rays, "
+              << rays.load() / seconds * 1e-6 << " Mrays/s -> " << outPath << std::endl;
+    return 0;
+}
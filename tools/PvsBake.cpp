@@ -0,0 +1,347 @@
+// Offline visibility for the scene's cells: for every cell in a .scene file,
+// finds the objects that can be seen from anywhere inside it and writes the
+// sets to a sidecar next to the file (Rooms.scene.pvs), where the app picks
+// them up (src/Pvs.h); asset packs built from the directory include it.
+//
+// Objects that reach into the cell are always in its set, and so are objects
+// without triangles, which never occlude and are too thin for rays to find.
+// Everything else is found by ray casting the triangle meshes with the app's
+// RayQuery (src/RayQuery.h), both faces of every triangle as the rasterizer
+// draws them, from points on the cell's faces only, treating
+// every surface inside the cell as transparent: any view from inside the
+// cell, followed backwards, leaves the cell through a face, and what it
+// passes on the way is already in the set. So sampling the faces covers the
+// whole interior. The cell is grown by the camera's near distance first,
+// since the near plane cuts through anything closer.
+//
+// Each face point casts a jittered cube map of rays (corners and face
+// centers first, then random points); then every object not found yet gets
+// rays aimed at random points on it, which finds what is only visible
+// through narrow gaps. Sampling can still miss slivers; more points and rays
+// make that less likely.
+//
+// The sets belong to the scene's geometry and cells as they are when baked;
+// editing those makes the sidecar stale, and the app then draws everything
+// until the next bake.
+//
+// Usage: PvsBake [scene] [--points N] [--resolution R] [--object-rays N] [--threads N]
+
+#include "../src/JobSystem.h"
+#include "../src/RayQuery.h"
+#include "../src/SceneFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Points on the faces of each cell; the first 14 are its corners and face centers
+#define PVS_BAKE_POINTS 64
+// Rays per cube map face side from each point
+#define PVS_BAKE_RESOLUTION 64
+// Then, per cell and object not found yet: rays aimed from the cell at it
+#define PVS_BAKE_OBJECT_RAYS 1024
+
+// World space, for aiming rays at an object
+struct Triangle {
+    glm::vec3 V0, Edge1, Edge2;
+};
+
+struct BakeScene {
+    RayQuery Rays;                 // over desc.Objects
+    std::vector<Triangle> Triangles;
+    std::vector<BvhBounds> ObjectBounds;   // world space, over every vertex the object draws
+    std::vector<uint32_t> FirstTriangle;   // per object, its triangles' range
+    std::vector<uint32_t> TriangleCount;   // 0: never occludes, is not traced
+    float Near = 0.1f;
+};
+
+struct BakeSettings {
+    int Points = PVS_BAKE_POINTS;
+    int Resolution = PVS_BAKE_RESOLUTION;
+    int ObjectRays = PVS_BAKE_OBJECT_RAYS;
+};
+
+// PCG32, as the path tracer uses
+struct Random {
+    uint64_t State;
+
+    explicit Random(uint64_t seed) : State(seed * 6364136223846793005ull + 1442695040888963407ull) { Next(); }
+    uint32_t Next() {
+        uint64_t old = State;
+        State = old * 6364136223846793005ull + 1442695040888963407ull;
+        uint32_t shifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        uint32_t rotation = static_cast<uint32_t>(old >> 59u);
+        return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+    }
+    float Uniform() { return (Next() >> 8) * (1.0f / 16777216.0f); }
+};
+
+static void AddTriangles(BakeScene& bake, const SceneDesc& desc, uint32_t objectIndex) {
+    const SceneObjectDesc& object = desc.Objects[objectIndex];
+    const SceneMeshDesc& mesh = desc.Meshes[object.Mesh];
+    const SceneMeshDesc& source = mesh.Parent >= 0 ? desc.Meshes[mesh.Parent] : mesh;
+    size_t vertexCount = source.Positions.size() / 3;
+    bool indexed = !source.Indices.empty();
+    size_t first = mesh.Parent >= 0 ? mesh.First : 0;
+    size_t count = mesh.Parent >= 0 ? mesh.Count : (indexed ? source.Indices.size() : vertexCount);
+
+    BvhBounds& bounds = bake.ObjectBounds[objectIndex];
+    auto vertex = [&](size_t i) {
+        size_t index = indexed ? source.Indices[first + i] : first + i;
+        if (index >= vertexCount)
+            return glm::vec3(0.0f);
+        const float* p = &source.Positions[index * 3];
+        return glm::vec3(object.Model * glm::vec4(p[0], p[1], p[2], 1.0f));
+    };
+    for (size_t i = 0; i < count; i++)
+        bounds.Grow(vertex(i));
+    bake.FirstTriangle[objectIndex] = static_cast<uint32_t>(bake.Triangles.size());
+    if (mesh.Mode != GL_TRIANGLES)
+        return;
+    for (size_t i = 0; i + 2 < count; i += 3) {
+        Triangle triangle;
+        triangle.V0 = vertex(i);
+        triangle.Edge1 = vertex(i + 1) - triangle.V0;
+        triangle.Edge2 = vertex(i + 2) - triangle.V0;
+        if (glm::length(glm::cross(triangle.Edge1, triangle.Edge2)) == 0.0f)
+            continue;                  // degenerate, can never be hit
+        bake.Triangles.push_back(triangle);
+        bake.TriangleCount[objectIndex]++;
+    }
+}
+
+static bool Overlaps(const BvhBounds& bounds, const BvhBounds& cell) {
+    return bounds.Min.x <= cell.Max.x && bounds.Min.y <= cell.Max.y && bounds.Min.z <= cell.Max.z &&
+           bounds.Max.x >= cell.Min.x && bounds.Max.y >= cell.Min.y && bounds.Max.z >= cell.Min.z;
+}
+
+// A ray from `origin` in or on the cell through `direction`: hits only count
+// once it has left the cell, so TMin is just short of where it does. A
+// surface on the boundary still occludes.
+static RayDesc MakeRay(const BvhBounds& cell, const glm::vec3& origin, const glm::vec3& direction, float tMax) {
+    float exit = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++) {
+        if (direction[axis] > 0.0f)
+            exit = std::min(exit, (cell.Max[axis] - origin[axis]) / direction[axis]);
+        else if (direction[axis] < 0.0f)
+            exit = std::min(exit, (cell.Min[axis] - origin[axis]) / direction[axis]);
+    }
+    RayDesc ray;
+    ray.Origin = origin;
+    ray.Direction = direction;
+    ray.TMin = std::nextafter(std::max(exit, 0.0f), 0.0f);
+    ray.TMax = tMax;
+    return ray;
+}
+
+// Traces the rays on the calling thread and sets the bit of every object hit
+static void TraceRays(const BakeScene& bake, const std::vector<RayDesc>& rays, std::vector<RayHit>& hits,
+                      std::vector<uint64_t>& visible, uint64_t& count) {
+    hits.resize(rays.size());
+    bake.Rays.TraceClosest(rays.data(), rays.size(), hits.data());
+    for (const RayHit& hit : hits) {
+        if (hit.Object != RAY_QUERY_MISS)
+            visible[hit.Object / 64] |= 1ull << (hit.Object % 64);
+    }
+    count += rays.size();
+}
+
+// Corners, then face centers, then random points on the faces, each face as
+// likely as its share of the area
+static glm::vec3 GetSamplePoint(const BvhBounds& cell, int index, Random& random) {
+    glm::vec3 extent = cell.Max - cell.Min;
+    if (index < 8)
+        return cell.Min + extent * glm::vec3((index & 1) ? 1.0f : 0.0f, (index & 2) ? 1.0f : 0.0f, (index & 4) ? 1.0f : 0.0f);
+    glm::vec3 fraction(0.5f);
+    int face = index - 8;
+    if (index >= 14) {
+        fraction = glm::vec3(random.Uniform(), random.Uniform(), random.Uniform());
+        float areas[3] = { extent.y * extent.z, extent.z * extent.x, extent.x * extent.y };
+        float pick = random.Uniform() * (areas[0] + areas[1] + areas[2]);
+        face = (pick < areas[0] ? 0 : (pick < areas[0] + areas[1] ? 2 : 4)) + static_cast<int>(random.Next() & 1);
+    }
+    fraction[face / 2] = (face & 1) ? 1.0f : 0.0f;
+    return cell.Min + extent * fraction;
+}
+
+// Casts a jittered cube map of rays from `origin` and sets the bit of every
+// object hit. Neighbouring rays of a row go down RayQuery's packet path.
+static void SamplePoint(const BakeScene& bake, const BvhBounds& cell, const glm::vec3& origin, int resolution,
+                        Random& random, std::vector<uint64_t>& visible, uint64_t& rays) {
+    std::vector<RayDesc> faceRays;
+    std::vector<RayHit> hits;
+    faceRays.reserve(static_cast<size_t>(resolution) * resolution);
+    for (int face = 0; face < 6; face++) {
+        int axis = face / 2;
+        float sign = (face & 1) ? -1.0f : 1.0f;
+        glm::vec3 forward(0.0f), right(0.0f), up(0.0f);
+        forward[axis] = sign;
+        right[(axis + 1) % 3] = 1.0f;
+        up[(axis + 2) % 3] = 1.0f;
+        for (int y = 0; y < resolution; y++) {
+            for (int x = 0; x < resolution; x++) {
+                float u = 2.0f * (x + random.Uniform()) / resolution - 1.0f;
+                float v = 2.0f * (y + random.Uniform()) / resolution - 1.0f;
+                faceRays.push_back(MakeRay(cell, origin, glm::normalize(forward + right * u + up * v), FLT_MAX));
+            }
+        }
+        TraceRays(bake, faceRays, hits, visible, rays);
+        faceRays.clear();
+    }
+}
+
+// Rays from random points on the cell's faces through random points on the
+// triangles of `target`. Whatever each meets first outside the cell, the
+// target or something in front of it, is visible.
+static void SampleObject(const BakeScene& bake, const BvhBounds& cell, uint32_t target, int count, Random& random,
+                         std::vector<uint64_t>& visible, uint64_t& rays) {
+    std::vector<RayDesc> aimed;
+    std::vector<RayHit> hits;
+    aimed.reserve(static_cast<size_t>(count));
+    for (int i = 0; i < count; i++) {
+        const Triangle& triangle = bake.Triangles[bake.FirstTriangle[target] + random.Next() % bake.TriangleCount[target]];
+        float u = random.Uniform(), v = random.Uniform();
+        if (u + v > 1.0f) {
+            u = 1.0f - u;
+            v = 1.0f - v;
+        }
+        glm::vec3 point = triangle.V0 + triangle.Edge1 * u + triangle.Edge2 * v;
+        glm::vec3 origin = GetSamplePoint(cell, 14, random);
+        float distance = glm::length(point - origin);
+        if (distance == 0.0f)
+            continue;
+        // Just past the point, so the target itself can be the hit
+        aimed.push_back(MakeRay(cell, origin, (point - origin) / distance, distance * 1.001f + 1e-4f));
+    }
+    TraceRays(bake, aimed, hits, visible, rays);
+}
+
+static void MergeVisible(uint64_t* set, const std::vector<uint64_t>& visible) {
+    for (size_t i = 0; i < visible.size(); i++) {
+        if (visible[i])
+            std::atomic_ref<uint64_t>(set[i]).fetch_or(visible[i], std::memory_order_relaxed);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string scenePath = SCENE_DEFAULT_PATH;
+    BakeSettings settings;
+    unsigned int threads = std::thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--points") == 0 && hasValue)
+            settings.Points = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--resolution") == 0 && hasValue)
+            settings.Resolution = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--object-rays") == 0 && hasValue)
+            settings.ObjectRays = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+            threads = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        else if (argv[i][0] != '-')
+            scenePath = argv[i];
+        else {
+            std::cout << "Usage: PvsBake [scene] [--points N] [--resolution R] [--object-rays N] [--threads N]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Loose files only: the sets go to <scene>.pvs next to the file, where
+    // the app and the asset packer pick them up
+    SceneDesc desc;
+    if (!LoadSceneDesc(scenePath, nullptr, desc))
+        return 1;
+    if (desc.Cells.empty()) {
+        std::cout << "[PVS Bake] " << scenePath << " has no cells" << std::endl;
+        return 1;
+    }
+
+    auto buildStart = std::chrono::steady_clock::now();
+    BakeScene bake;
+    bake.Near = desc.Camera.Near;
+    bake.ObjectBounds.resize(desc.Objects.size());
+    bake.FirstTriangle.resize(desc.Objects.size(), 0);
+    bake.TriangleCount.resize(desc.Objects.size(), 0);
+    for (uint32_t i = 0; i < desc.Objects.size(); i++)
+        AddTriangles(bake, desc, i);
+    bake.Rays.BuildMeshes(desc);
+    bake.Rays.Update(desc);
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+    const RayQueryStats& rayStats = bake.Rays.GetStats();
+    std::cout << "[PVS Bake] " << rayStats.Triangles << " triangle(s) in " << rayStats.Meshes << " mesh(es), "
+              << rayStats.Instances << " instance(s) built in " << buildMs << " ms; " << desc.Cells.size() << " cell(s) x " << settings.Points << " point(s) x 6 x "
+              << settings.Resolution << "^2 rays, then " << settings.ObjectRays << " per object not found" << std::endl;
+
+    // Grown by the near distance: the near plane cuts away anything closer to the camera
+    std::vector<BvhBounds> cells(desc.Cells.size());
+    for (size_t i = 0; i < cells.size(); i++) {
+        cells[i].Min = desc.Cells[i].Min - glm::vec3(bake.Near);
+        cells[i].Max = desc.Cells[i].Max + glm::vec3(bake.Near);
+    }
+    size_t words = desc.GetPvsWords();
+    desc.Pvs.assign(desc.Cells.size() * words, 0);
+    for (size_t cell = 0; cell < cells.size(); cell++) {
+        uint64_t* set = desc.Pvs.data() + cell * words;
+        for (size_t i = 0; i < desc.Objects.size(); i++) {
+            if (bake.TriangleCount[i] == 0 || Overlaps(bake.ObjectBounds[i], cells[cell]))
+                set[i / 64] |= 1ull << (i % 64);
+        }
+    }
+
+    // Dispatch runs jobs on the calling thread too
+    JobSystem jobs(threads - 1);
+    std::atomic<uint64_t> rays = 0;
+    auto start = std::chrono::steady_clock::now();
+    unsigned int points = static_cast<unsigned int>(settings.Points);
+    jobs.Dispatch(static_cast<unsigned int>(cells.size()) * points, [&](unsigned int job) {
+        size_t cell = job / points;
+        Random random(job * 0x9E3779B97F4A7C15ull + 1);
+        std::vector<uint64_t> visible(words, 0);
+        uint64_t jobRays = 0;
+        glm::vec3 origin = GetSamplePoint(cells[cell], static_cast<int>(job % points), random);
+        SamplePoint(bake, cells[cell], origin, settings.Resolution, random, visible, jobRays);
+        MergeVisible(desc.Pvs.data() + cell * words, visible);
+        rays.fetch_add(jobRays, std::memory_order_relaxed);
+    });
+    // Aimed rays at every object the cube maps did not find, 64 objects per job
+    std::vector<uint64_t> found = desc.Pvs;
+    jobs.Dispatch(static_cast<unsigned int>(found.size()), [&](unsigned int job) {
+        size_t cell = job / words;
+        Random random(job * 0x9E3779B97F4A7C15ull + 2);
+        std::vector<uint64_t> visible(words, 0);
+        uint64_t jobRays = 0;
+        for (uint64_t missing = ~found[job]; missing != 0; missing &= missing - 1) {
+            size_t object = (job % words) * 64 + static_cast<size_t>(std::countr_zero(missing));
+            if (object >= desc.Objects.size())
+                break;
+            SampleObject(bake, cells[cell], static_cast<uint32_t>(object), settings.ObjectRays, random, visible, jobRays);
+        }
+        MergeVisible(desc.Pvs.data() + cell * words, visible);
+        rays.fetch_add(jobRays, std::memory_order_relaxed);
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t total = 0;
+    for (size_t cell = 0; cell < desc.Cells.size(); cell++) {
+        size_t visible = 0;
+        for (size_t i = 0; i < words; i++)
+            visible += static_cast<size_t>(std::popcount(desc.Pvs[cell * words + i]));
+        total += visible;
+        std::cout << "[PVS Bake] cell " << desc.Cells[cell].Name << ": " << visible << " of " << desc.Objects.size()
+                  << " object(s) potentially visible" << std::endl;
+    }
+    if (!WriteScenePvs(scenePath, desc))
+        return 1;
+    std::cout << "[PVS Bake] " << rays.load() << " rays in " << seconds << " s (" << rays.load() / seconds * 1e-6
+              << " Mrays/s) on " << threads << " thread(s); on average "
+              << (desc.Objects.empty() ? 0.0 : 100.0 * total / (desc.Cells.size() * desc.Objects.size()))
+              << "% of the objects per cell, " << desc.Pvs.size() * sizeof(uint64_t) << " bytes of sets" << std::endl;
+    return 0;
+}
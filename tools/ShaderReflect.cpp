@@ -0,0 +1,304 @@
+// Build step: reflects the std140/std430 blocks declared in .shader files and
+// writes a header with matching C++ structs. Offsets are computed here with
+// the GLSL layout rules, explicit padding reproduces them in C++, and the
+// generated static_asserts make the compiler check the result.
+//
+// Usage: ShaderReflect <output header> <file.shader>...
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Member {
+    std::string Type;
+    std::string Name;
+    int ArraySize = 0;          // 0 for non-arrays
+    size_t Offset = 0;
+    size_t Size = 0;
+    size_t Stride = 0;          // array element stride
+};
+
+struct Block {
+    std::string Name;
+    std::string Layout;         // std140 or std430
+    std::string Storage;        // uniform or buffer
+    std::string Source;         // first file that declared it
+    std::vector<Member> Members;
+    size_t Size = 0;
+};
+
+struct TypeInfo {
+    size_t Alignment;
+    size_t Size;
+    const char* CppType;
+};
+
+static bool GetTypeInfo(const std::string& type, TypeInfo& info) {
+    static const std::map<std::string, TypeInfo> types = {
+        { "float", { 4, 4, "float" } },      { "int", { 4, 4, "int32_t" } },
+        { "uint", { 4, 4, "uint32_t" } },    { "bool", { 4, 4, "uint32_t" } },
+        { "vec2", { 8, 8, "glm::vec2" } },   { "vec3", { 16, 12, "glm::vec3" } },
+        { "vec4", { 16, 16, "glm::vec4" } }, { "ivec4", { 16, 16, "glm::ivec4" } },
+        { "uvec4", { 16, 16, "glm::uvec4" } },
+        // Matrices are arrays of column vectors; mat3 columns are padded to vec4
+        { "mat3", { 16, 48, nullptr } },     { "mat4", { 16, 64, "glm::mat4" } },
+    };
+    auto it = types.find(type);
+    if (it == types.end())
+        return false;
+    info = it->second;
+    return true;
+}
+
+static std::string StripComments(const std::string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text.compare(i, 2, "//") == 0) {
+            i = text.find('\n', i);
+            if (i == std::string::npos)
+                break;
+            out += '\n';
+        } else if (text.compare(i, 2, "/*") == 0) {
+            i = text.find("*/", i);
+            if (i == std::string::npos)
+                break;
+            i++;
+        } else {
+            out += text[i];
+        }
+    }
+    return out;
+}
+
+static std::vector<std::string> Tokenize(const std::string& text) {
+    std::vector<std::string> tokens;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        // Preprocessor lines (#version, #ifdef, ...) and .shader markers carry no declarations
+        size_t first = line.find_first_not_of(" \t");
+        if (first != std::string::npos && line[first] == '#')
+            continue;
+
+        std::string token;
+        for (char c : line) {
+            if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
+                token += c;
+            } else {
+                if (!token.empty())
+                    tokens.push_back(token);
+                token.clear();
+                if (!std::isspace(static_cast<unsigned char>(c)))
+                    tokens.emplace_back(1, c);
+            }
+        }
+        if (!token.empty())
+            tokens.push_back(token);
+    }
+    return tokens;
+}
+
+static size_t RoundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static bool LayoutBlock(Block& block) {
+    size_t offset = 0;
+    size_t maxAlignment = 4;
+    for (Member& member : block.Members) {
+        TypeInfo info;
+        if (!GetTypeInfo(member.Type, info)) {
+            std::cerr << block.Source << ": unsupported type " << member.Type << " in block " << block.Name << std::endl;
+            return false;
+        }
+        size_t alignment = info.Alignment;
+        if (member.ArraySize > 0) {
+            // std140 rounds array strides up to vec4; std430 keeps the element alignment
+            if (block.Layout == "std140")
+                alignment = RoundUp(alignment, 16);
+            member.Stride = RoundUp(info.Size, alignment);
+            member.Size = member.Stride * member.ArraySize;
+        } else {
+            member.Size = info.Size;
+        }
+        maxAlignment = std::max(maxAlignment, alignment);
+        member.Offset = RoundUp(offset, alignment);
+        offset = member.Offset + member.Size;
+    }
+    if (block.Layout == "std140")
+        maxAlignment = RoundUp(maxAlignment, 16);
+    block.Size = RoundUp(offset, maxAlignment);
+    return true;
+}
+
+static bool ParseFile(const std::string& path, std::vector<Block>& blocks) {
+    std::ifstream stream(path);
+    if (!stream) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+    std::stringstream text;
+    text << stream.rdbuf();
+    std::vector<std::string> tokens = Tokenize(StripComments(text.str()));
+
+    // layout ( <qualifiers> ) uniform|buffer <Name> { <type> <name> [ [N] ] ; ... }
+    for (size_t i = 0; i + 1 < tokens.size(); i++) {
+        if (tokens[i] != "layout" || tokens[i + 1] != "(")
+            continue;
+
+        Block block;
+        block.Source = path;
+        size_t j = i + 2;
+        for (; j < tokens.size() && tokens[j] != ")"; j++) {
+            if (tokens[j] == "std140" || tokens[j] == "std430")
+                block.Layout = tokens[j];
+        }
+        if (j + 3 >= tokens.size() || (tokens[j + 1] != "uniform" && tokens[j + 1] != "buffer") || tokens[j + 3] != "{")
+            continue;
+        if (block.Layout.empty()) {
+            std::cerr << path << ": block " << tokens[j + 2] << " must declare std140 or std430" << std::endl;
+            return false;
+        }
+        block.Storage = tokens[j + 1];
+        block.Name = tokens[j + 2];
+
+        for (j += 4; j < tokens.size() && tokens[j] != "}";) {
+            Member member;
+            if (tokens[j] == "highp" || tokens[j] == "mediump" || tokens[j] == "lowp")
+                j++;
+            member.Type = tokens[j++];
+            member.Name = tokens[j++];
+            if (tokens[j] == "[") {
+                member.ArraySize = std::stoi(tokens[j + 1]);
+                j += 3;
+            }
+            if (tokens[j++] != ";") {
+                std::cerr << path << ": cannot parse member " << member.Name << " of block " << block.Name << std::endl;
+                return false;
+            }
+            block.Members.push_back(member);
+        }
+        if (!LayoutBlock(block))
+            return false;
+
+        // The same block may appear in several shaders, but it must be identical
+        auto existing = std::find_if(blocks.begin(), blocks.end(), [&](const Block& b) { return b.Name == block.Name; });
+        if (existing == blocks.end()) {
+            blocks.push_back(block);
+            continue;
+        }
+        bool same = existing->Layout == block.Layout && existing->Members.size() == block.Members.size();
+        for (size_t m = 0; same && m < block.Members.size(); m++) {
+            same = existing->Members[m].Type == block.Members[m].Type &&
+                   existing->Members[m].Name == block.Members[m].Name &&
+                   existing->Members[m].ArraySize == block.Members[m].ArraySize;
+        }
+        if (!same) {
+            std::cerr << path << ": block " << block.Name << " differs from its declaration in " << existing->Source << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static void WriteBlock(std::ostream& out, const Block& block, unsigned int binding) {
+    out << "// " << block.Layout << " " << block.Storage << " block from " << block.Source << "\n";
+    out << "struct " << block.Name << " {\n";
+    out << "    static constexpr const char* Name = \"" << block.Name << "\";\n";
+    out << "    static constexpr unsigned int Binding = " << binding << ";\n\n";
+
+    size_t offset = 0;
+    int padding = 0;
+    for (const Member& member : block.Members) {
+        if (member.Offset > offset)
+            out << "    uint8_t _pad" << padding++ << "[" << member.Offset - offset << "];\n";
+
+        TypeInfo info;
+        GetTypeInfo(member.Type, info);
+        if (member.Type == "mat3") {
+            out << "    glm::vec4 " << member.Name << "[" << 3 * std::max(member.ArraySize, 1) << "];   // mat3 columns\n";
+        } else if (member.ArraySize > 0 && member.Stride != info.Size) {
+            out << "    Std140Element<" << info.CppType << ", " << member.Stride << "> " << member.Name
+                << "[" << member.ArraySize << "];\n";
+        } else if (member.ArraySize > 0) {
+            out << "    " << info.CppType << " " << member.Name << "[" << member.ArraySize << "];\n";
+        } else {
+            out << "    " << info.CppType << " " << member.Name << ";\n";
+        }
+        offset = member.Offset + member.Size;
+    }
+    if (block.Size > offset)
+        out << "    uint8_t _pad" << padding++ << "[" << block.Size - offset << "];\n";
+    out << "};\n";
+
+    for (const Member& member : block.Members) {
+        out << "static_assert(offsetof(" << block.Name << ", " << member.Name << ") == " << member.Offset
+            << ", \"" << block.Name << "::" << member.Name << " does not match the " << block.Layout << " layout\");\n";
+    }
+    out << "static_assert(sizeof(" << block.Name << ") == " << block.Size << ", \"" << block.Name
+        << " size does not match the " << block.Layout << " layout\");\n\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: ShaderReflect <output header> <file.shader>..." << std::endl;
+        return 1;
+    }
+
+    std::vector<Block> blocks;
+    for (int i = 2; i < argc; i++) {
+        if (!ParseFile(argv[i], blocks))
+            return 1;
+    }
+    // Bindings are assigned by name so they do not depend on the file order
+    std::sort(blocks.begin(), blocks.end(), [](const Block& a, const Block& b) { return a.Name < b.Name; });
+
+    std::ostringstream out;
+    out << "// Generated by ShaderReflect. Do not edit; change the .shader files instead.\n";
+    out << "#pragma once\n\n";
+    out << "#include <glm/glm.hpp>\n\n";
+    out << "#include <cstddef>\n#include <cstdint>\n\n";
+    out << "// Array element padded to the stride its block layout requires\n";
+    out << "template<typename T, size_t Stride>\n";
+    out << "struct Std140Element {\n    T Value;\n    uint8_t _pad[Stride - sizeof(T)];\n};\n\n";
+
+    unsigned int uniformBinding = 0, storageBinding = 0;
+    std::vector<std::pair<const Block*, unsigned int>> bindings;
+    for (const Block& block : blocks) {
+        unsigned int binding = block.Storage == "uniform" ? uniformBinding++ : storageBinding++;
+        WriteBlock(out, block, binding);
+        bindings.emplace_back(&block, binding);
+    }
+
+    out << "struct ShaderBlockInfo {\n    const char* Name;\n    unsigned int Binding;\n    size_t Size;\n    bool Storage;\n};\n\n";
+    out << "// Every reflected block, for binding them on each linked program\n";
+    out << "inline constexpr ShaderBlockInfo g_ShaderBlocks[] = {\n";
+    for (const auto& [block, binding] : bindings) {
+        out << "    { \"" << block->Name << "\", " << binding << ", sizeof(" << block->Name << "), "
+            << (block->Storage == "buffer" ? "true" : "false") << " },\n";
+    }
+    if (bindings.empty())
+        out << "    { nullptr, 0, 0, false },\n";
+    out << "};\n";
+
+    // Leave the file alone when nothing changed, so dependents do not rebuild
+    std::string generated = out.str();
+    std::ifstream previous(argv[1]);
+    std::stringstream previousText;
+    previousText << previous.rdbuf();
+    if (previousText.str() == generated)
+        return 0;
+
+    std::ofstream file(argv[1]);
+    if (!file) {
+        std::cerr << "Cannot write " << argv[1] << std::endl;
+        return 1;
+    }
+    file << generated;
+    return 0;
+}
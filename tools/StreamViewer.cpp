@@ -0,0 +1,225 @@
+// Watches a ModernOpenGL instance started with --stream and sends it the
+// keys pressed in the viewer window, so a headless node can be driven from
+// another machine's desktop (over an SSH-forwarded socket or port).
+//
+// A receiving thread reads packets and applies their tiles to a local copy
+// of the frame; the window uploads the newest copy once per refresh and
+// blits it to the backbuffer. --headless skips the window, which is how the
+// stream is benchmarked, and --dump writes the last frame as a PPM.
+//
+// Usage: StreamViewer [address] [--headless] [--frames N] [--dump out.ppm]
+
+#include "../src/StreamProtocol.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define STREAM_VIEWER_DEFAULT_ADDRESS "modernopengl-stream.sock"
+
+struct ViewerState {
+    int Fd = -1;
+    std::mutex Mutex;
+    std::vector<unsigned char> Frame;     // guarded by Mutex, bottom row first
+    int Width = 0, Height = 0;
+    unsigned int Version = 0;
+    std::atomic<bool> Quit = false;
+
+    // Receiving thread
+    unsigned long long Frames = 0;
+    unsigned long long Bytes = 0;
+    unsigned long long EncodeMicros = 0;
+    unsigned int EncodeMicrosMax = 0;
+};
+
+static bool ReadExactly(int fd, void* data, size_t size) {
+    unsigned char* bytes = static_cast<unsigned char*>(data);
+    while (size > 0) {
+        ssize_t got = recv(fd, bytes, size, 0);
+        if (got <= 0)
+            return false;
+        bytes += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+static void Receive(ViewerState& state, unsigned long long maxFrames) {
+    std::vector<unsigned char> frame, scratch, payload;
+    bool keyed = false;
+    StreamFrameHeader header;
+    while (!state.Quit && ReadExactly(state.Fd, &header, sizeof(header))) {
+        if (header.Magic != STREAM_MAGIC) {
+            std::cout << "[Viewer] bad packet" << std::endl;
+            break;
+        }
+        payload.resize(header.PayloadSize);
+        if (!ReadExactly(state.Fd, payload.data(), payload.size()))
+            break;
+        keyed |= (header.Flags & STREAM_FRAME_KEY) != 0;
+        if (!keyed)
+            continue;
+        if (!ApplyStreamFrame(header, payload.data(), frame, scratch)) {
+            std::cout << "[Viewer] malformed frame " << header.Frame << std::endl;
+            break;
+        }
+        state.Frames++;
+        state.Bytes += sizeof(header) + header.PayloadSize;
+        state.EncodeMicros += header.EncodeMicros;
+        if (header.EncodeMicros > state.EncodeMicrosMax)
+            state.EncodeMicrosMax = header.EncodeMicros;
+        {
+            std::lock_guard<std::mutex> lock(state.Mutex);
+            state.Frame = frame;
+            state.Width = header.Width;
+            state.Height = header.Height;
+            state.Version++;
+        }
+        if (maxFrames > 0 && state.Frames >= maxFrames)
+            break;
+    }
+    state.Quit = true;
+}
+
+static bool WritePpm(const std::string& path, const std::vector<unsigned char>& rgb, int width, int height) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    out << "P6\n" << width << " " << height << "\n255\n";
+    // PPM is top row first
+    for (int y = height - 1; y >= 0; y--)
+        out.write(reinterpret_cast<const char*>(rgb.data() + static_cast<size_t>(y) * width * 3), width * 3);
+    return static_cast<bool>(out);
+}
+
+static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    ViewerState* state = static_cast<ViewerState*>(glfwGetWindowUserPointer(window));
+    StreamInputEvent event = { key, action };
+    send(state->Fd, &event, sizeof(event), MSG_NOSIGNAL);
+}
+
+static void Show(ViewerState& state) {
+    if (!glfwInit())
+        return;
+    GLFWwindow* window = glfwCreateWindow(1280, 720, "Stream", nullptr, nullptr);
+    if (!window) {
+        glfwTerminate();
+        return;
+    }
+    glfwSetWindowUserPointer(window, &state);
+    glfwSetKeyCallback(window, KeyCallback);
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(1);
+    if (glewInit() != GLEW_OK) {
+        std::cout << "Error initializing GLEW!" << std::endl;
+        glfwTerminate();
+        return;
+    }
+
+    GLuint texture = 0, framebuffer = 0;
+    glGenTextures(1, &texture);
+    glGenFramebuffers(1, &framebuffer);
+    int textureWidth = 0, textureHeight = 0;
+    unsigned int shown = 0;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    while (!state.Quit && !glfwWindowShouldClose(window)) {
+        glfwPollEvents();
+        {
+            std::lock_guard<std::mutex> lock(state.Mutex);
+            if (state.Version != shown) {
+                shown = state.Version;
+                glBindTexture(GL_TEXTURE_2D, texture);
+                if (state.Width != textureWidth || state.Height != textureHeight) {
+                    textureWidth = state.Width;
+                    textureHeight = state.Height;
+                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, textureWidth, textureHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+                    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+                    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+                }
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, GL_RGB, GL_UNSIGNED_BYTE, state.Frame.data());
+            }
+        }
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glClear(GL_COLOR_BUFFER_BIT);
+        if (textureWidth > 0) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+            glBlitFramebuffer(0, 0, textureWidth, textureHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+        glfwSwapBuffers(window);
+    }
+
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &texture);
+    glfwTerminate();
+}
+
+int main(int argc, char** argv) {
+    std::string address = STREAM_VIEWER_DEFAULT_ADDRESS;
+    std::string dumpPath;
+    bool headless = false;
+    unsigned long long maxFrames = 0;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            maxFrames = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+            dumpPath = argv[++i];
+        else if (argv[i][0] != '-')
+            address = argv[i];
+        else {
+            std::cout << "Usage: StreamViewer [address] [--headless] [--frames N] [--dump out.ppm]" << std::endl;
+            return 1;
+        }
+    }
+
+    ViewerState state;
+    state.Fd = ConnectStreamSocket(address);
+    if (state.Fd < 0)
+        return 1;
+    std::cout << "[Viewer] connected to " << address << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread receiver(Receive, std::ref(state), maxFrames);
+    if (!headless) {
+        Show(state);
+        state.Quit = true;
+        // Unblocks the receiving thread if the window was closed first
+        shutdown(state.Fd, SHUT_RDWR);
+    }
+    receiver.join();
+    close(state.Fd);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (state.Frames > 0) {
+        std::cout << "[Viewer] " << state.Frames << " frame(s) in " << seconds << " s (" << state.Frames / seconds
+                  << " fps), " << state.Bytes / state.Frames / 1024.0 << " KB/frame, server encode "
+                  << state.EncodeMicros / state.Frames << " us avg / " << state.EncodeMicrosMax << " us max" << std::endl;
+    } else {
+        std::cout << "[Viewer] no frames received" << std::endl;
+    }
+    if (!dumpPath.empty() && state.Width > 0) {
+        if (!WritePpm(dumpPath, state.Frame, state.Width, state.Height)) {
+            std::cout << "[Viewer] cannot write " << dumpPath << std::endl;
+            return 1;
+        }
+        std::cout << "[Viewer] wrote " << dumpPath << std::endl;
+    }
+    return 0;
+}